@@ -0,0 +1,113 @@
+/*
+ * BenchUtil.h
+ *
+ * Helpers shared by the libeye benchmarks.
+ *
+ * Copyright (c) 2016 M.J.A. Duijndam.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see Licenses at www.gnu.org.
+ */
+
+#ifndef BENCH_UTIL_H
+#define BENCH_UTIL_H
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <eyelog/EyeLog.h>
+
+/**
+ * Measures wall clock time since construction or the last reset.
+ */
+class BenchTimer {
+
+public:
+
+    BenchTimer() : m_start(std::chrono::steady_clock::now()) {}
+
+    void reset()
+    {
+        m_start = std::chrono::steady_clock::now();
+    }
+
+    double seconds() const
+    {
+        std::chrono::duration<double> d =
+            std::chrono::steady_clock::now() - m_start;
+        return d.count();
+    }
+
+private:
+
+    std::chrono::steady_clock::time_point m_start;
+};
+
+/**
+ * Prints one line of a benchmark report.
+ */
+inline void benchReport(const char* name, double seconds, double nrecords)
+{
+    printf("%-36s %10.4f s %14.0f records/s\n",
+           name,
+           seconds,
+           seconds > 0 ? nrecords / seconds : 0.0
+           );
+}
+
+/**
+ * Parses the number of samples from the commandline or returns def.
+ */
+inline unsigned benchSamples(int argc, char** argv, unsigned def)
+{
+    if (argc > 1) {
+        long n = strtol(argv[1], nullptr, 10);
+        if (n > 0)
+            return unsigned(n);
+    }
+    return def;
+}
+
+/**
+ * Fills log with a binocular 1000 Hz session of nsamples samples per eye.
+ *
+ * Every 1000 samples a trial starts, fixations and saccades are sprinkled
+ * in between. Without trials, only a message marks the trial onset.
+ */
+inline void benchMakeSession(PEyeLog& log, unsigned nsamples, bool trials=true)
+{
+    log.clear();
+    log.reserve(2 * nsamples + nsamples / 50);
+    log.addEntry(new PMessageEntry(0, "RECORDED BY: libeye benchmark"));
+    for (unsigned i = 0; i < nsamples; ++i) {
+        double t = 1000.0 + i;
+        float x = float(960 + 300 * std::sin(i / 250.0));
+        float y = float(540 + 200 * std::cos(i / 333.0));
+        if (i % 1000 == 0) {
+            char id[32];
+            snprintf(id, sizeof(id), "%u", i / 1000);
+            if (trials)
+                log.addEntry(new PTrialEntry(t, id, "benchmark"));
+            log.addEntry(new PMessageEntry(t, "trial onset"));
+        }
+        log.addEntry(new PGazeEntry(LGAZE, t, x, y, 3.0f));
+        log.addEntry(new PGazeEntry(RGAZE, t, x + 5, y - 5, 2.8f));
+        if (i % 250 == 249) {
+            log.addEntry(new PFixationEntry(LFIX, t - 200, 200, x, y));
+            log.addEntry(new PSaccadeEntry(LSAC, t, 20, x, y, x + 80, y));
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,95 @@
+/*
+ * bench_binary_read.cpp
+ *
+ * Compares reading a binary logfile through an ifstream, with PLogReader,
+ * with the memory mapped reader that readLog uses.
+ *
+ * Copyright (C) 2016  Maarten Duijndam
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cstdio>
+#include "BenchUtil.h"
+
+using namespace std;
+
+const char* usage = "%s [nsamples]\n";
+const char* fname = "bench_binary_read.bin";
+
+int main(int argc, char** argv)
+{
+    unsigned nsamples = benchSamples(argc, argv, 1000000);
+    int ret;
+    double nrecords;
+
+    if (argc > 2) {
+        fprintf(stderr, usage, argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    {
+        PEyeLog log;
+        benchMakeSession(log, nsamples, false);
+        nrecords = log.getEntries().size();
+        if ((ret = log.open(fname)) != 0 || (ret = log.write()) != 0) {
+            fprintf(stderr, "unable to write %s: %s\n", fname, eyelog_error(ret));
+            return EXIT_FAILURE;
+        }
+    }
+
+    printf("binary read of %.0f records\n", nrecords);
+
+    BenchTimer timer;
+    {
+        PEyeLog log;
+        PLogReader reader;
+        timer.reset();
+        log.reserve(unsigned(nrecords));
+        ret = reader.open(fname);
+        if (ret == 0) {
+            while (reader.readBatch(&log, 4096) == 4096)
+                ;
+            ret = reader.status();
+        }
+        benchReport("PLogReader (ifstream)", timer.seconds(), nrecords);
+    }
+    {
+        PEyeLog log;
+        timer.reset();
+        ret |= readMappedLog(&log, fname);
+        benchReport("readLog/readMappedLog (mmap)", timer.seconds(), nrecords);
+    }
+    {
+        PMappedLog log;
+        PEntryView view;
+        double sum = 0;
+        timer.reset();
+        ret |= log.open(fname);
+        while (log.next(view))
+            if (view.getEntryType() == LGAZE)
+                sum += view.getX();
+        benchReport("PMappedLog views only", timer.seconds(), nrecords);
+        if (sum == 0)
+            printf("unexpected sum\n");
+    }
+
+    remove(fname);
+    if (ret) {
+        fprintf(stderr, "reading failed: %s\n", eyelog_error(ret));
+        return EXIT_FAILURE;
+    }
+    return 0;
+}
@@ -0,0 +1,100 @@
+/*
+ * bench_binary_write.cpp
+ *
+ * Compares the ways PEyeLog::write can write a binary logfile.
+ *
+ * Copyright (C) 2016  Maarten Duijndam
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include "BenchUtil.h"
+
+using namespace std;
+
+const char* usage = "%s [nsamples]\n";
+const char* fname_stream = "bench_binary_write_stream.bin";
+const char* fname_buffered = "bench_binary_write_buffered.bin";
+const char* fname_direct = "bench_binary_write_direct.bin";
+
+static string contents(const char* fname)
+{
+    ifstream in(fname, ios::binary);
+    return string(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+}
+
+static int timeWrite(const PEyeLog& log,
+                     PEyeLog& out,
+                     const char* fname,
+                     unsigned flags,
+                     const char* name,
+                     double nrecords
+                     )
+{
+    int ret;
+    BenchTimer timer;
+    if ((ret = out.open(fname)) != 0)
+        return ret;
+    out.setEntries(log.getEntries());
+    timer.reset();
+    ret = out.write(FORMAT_BINARY, flags);
+    out.close();
+    benchReport(name, timer.seconds(), nrecords);
+    return ret;
+}
+
+int main(int argc, char** argv)
+{
+    unsigned nsamples = benchSamples(argc, argv, 1000000);
+    int ret = 0;
+
+    if (argc > 2) {
+        fprintf(stderr, usage, argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    PEyeLog log, out;
+    benchMakeSession(log, nsamples);
+    double nrecords = log.getEntries().size();
+    printf("binary write of %.0f records\n", nrecords);
+
+    ret |= timeWrite(log, out, fname_stream, WRITE_STREAM,
+                     "write (ofstream per field)", nrecords);
+    ret |= timeWrite(log, out, fname_buffered, WRITE_BUFFERED,
+                     "write WRITE_BUFFERED", nrecords);
+    ret |= timeWrite(log, out, fname_direct, WRITE_DIRECT,
+                     "write WRITE_DIRECT", nrecords);
+
+    if (ret) {
+        fprintf(stderr, "writing failed: %s\n", eyelog_error(ret));
+        return EXIT_FAILURE;
+    }
+
+    string expected = contents(fname_stream);
+    if (contents(fname_buffered) != expected ||
+        contents(fname_direct) != expected) {
+        fprintf(stderr, "the files differ\n");
+        ret = 1;
+    }
+
+    remove(fname_stream);
+    remove(fname_buffered);
+    remove(fname_direct);
+    return ret ? EXIT_FAILURE : 0;
+}
@@ -0,0 +1,111 @@
+/*
+ * bench_binocular_average.cpp
+ *
+ * Compares the ways to compute the average of both eyes of an .asc file:
+ * streaming the parsed samples through a PBinocularAverager, averaging
+ * while parsing and averaging the columns of a PSampleStore.
+ *
+ * Copyright (C) 2016  Maarten Duijndam
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cstdio>
+#include <string>
+#include "BenchUtil.h"
+
+using namespace std;
+
+const char* usage = "%s [repeat [ascfile]]\n";
+const char* default_file = BENCH_SAMPLES_DIR "/0001_01_01.asc";
+
+/*
+ * Counts the AVGGAZE samples it receives and discards everything.
+ */
+class AverageSink : public PEntrySink {
+public:
+    AverageSink() : n(0), sum(0) {}
+    virtual void addGaze(entrytype eye, double, float x, float, float)
+    {
+        if (eye == AVGGAZE) {
+            n++;
+            sum += x;
+        }
+    }
+    virtual void addEntry(PEyeLogEntry* entry)
+    {
+        delete entry;
+    }
+    unsigned long n;
+    double sum;
+};
+
+int main(int argc, char** argv)
+{
+    unsigned repeat = benchSamples(argc, argv, 200);
+    const char* fname = argc > 2 ? argv[2] : default_file;
+
+    if (argc > 3) {
+        fprintf(stderr, usage, argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    PMappedFile file;
+    int ret = file.open(fname);
+    if (ret) {
+        fprintf(stderr, "unable to open %s: %s\n", fname, eyelog_error(ret));
+        return EXIT_FAILURE;
+    }
+    string one(file.data(), file.size());
+    if (one.size() && one[one.size() - 1] != '\n')
+        one += '\n';
+    string text;
+    text.reserve(one.size() * repeat);
+    for (unsigned i = 0; i < repeat; i++)
+        text += one;
+    const char* begin = text.data();
+    const char* end = begin + text.size();
+
+    AverageSink streamed;
+    BenchTimer timer;
+    {
+        PBinocularAverager averager(&streamed, false);
+        ret = readAscBuffer(&averager, begin, end, 1);
+    }
+    benchReport("parse + PBinocularAverager", timer.seconds(), streamed.n);
+
+    AverageSink parsed;
+    bool isleft = false;
+    timer.reset();
+    ret |= readAscBuffer(&parsed, begin, end, 1, &isleft, ASC_AVERAGE_EYES);
+    benchReport("parse with ASC_AVERAGE_EYES", timer.seconds(), parsed.n);
+
+    PSampleStore store;
+    ret |= readAscBuffer(&store, begin, end, 1);
+    timer.reset();
+    store.average();
+    benchReport("PSampleStore::average", timer.seconds(),
+                store[AVGGAZE].size()
+                );
+
+    printf("averages: %lu %lu %lu, checksums: %.1f %.1f\n",
+           streamed.n,
+           parsed.n,
+           (unsigned long) store[AVGGAZE].size(),
+           streamed.sum,
+           parsed.sum
+           );
+    return ret ? EXIT_FAILURE : EXIT_SUCCESS;
+}
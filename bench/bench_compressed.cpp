@@ -0,0 +1,181 @@
+/*
+ * bench_compressed.cpp
+ *
+ * Compares the size and the speed of writing and reading the binary
+ * format with the compressed binary format for every codec.
+ *
+ * Copyright (C) 2016  Maarten Duijndam
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cstdio>
+#include <fstream>
+#include "BenchUtil.h"
+
+using namespace std;
+
+const char* usage = "%s [nsamples [logfile]]\n";
+const char* fname = "bench_compressed.bin";
+
+static long fileSize(const char* name)
+{
+    ifstream in(name, ios::binary | ios::ate);
+    return long(in.tellg());
+}
+
+/*
+ * Writes log in the compressed format with codec, reads it back and
+ * reports the results.
+ */
+static int run(const PEyeLog& log,
+               const char* name,
+               block_codec codec,
+               long v1size
+               )
+{
+    double nrecords = log.getEntries().size();
+    PCompressedWriter writer;
+    PEyeLog in;
+    char label[64];
+    BenchTimer timer;
+    int ret;
+
+    if ((ret = writer.setCodec(codec)) == 0 &&
+        (ret = writer.open(fname)) == 0 &&
+        (ret = writer.write(log.getEntries())) == 0
+        )
+        ret = writer.close();
+    double wtime = timer.seconds();
+    if (ret)
+        return ret;
+
+    timer.reset();
+    ret = readLog(&in, fname);
+    double rtime = timer.seconds();
+    if (ret)
+        return ret;
+    if (in.getEntries().size() != log.getEntries().size())
+        return ERR_INVALID_FILE_FORMAT;
+
+    long size = fileSize(fname);
+    snprintf(label, sizeof(label), "%s write", name);
+    benchReport(label, wtime, nrecords);
+    snprintf(label, sizeof(label), "%s read", name);
+    benchReport(label, rtime, nrecords);
+    printf("%-40s %ld bytes, %.2f bytes/record, %.1f%% of v1\n",
+           name,
+           size,
+           size / nrecords,
+           100.0 * size / v1size
+           );
+    return 0;
+}
+
+/*
+ * Decodes the blocks of the last file with one and with all threads and
+ * reads a hundredth of its time range.
+ */
+static int runBlocks(const PEyeLog& log)
+{
+    double nrecords = log.getEntries().size();
+    PBlockIndex blocks;
+    BenchTimer timer;
+    int ret = readCompressedBlocks(&blocks, fname);
+    benchReport("readCompressedBlocks", timer.seconds(), nrecords);
+    if (ret || !blocks.size())
+        return ret;
+
+    const unsigned nthreads[] = {1, 0};
+    for (unsigned n : nthreads) {
+        PEyeLog in;
+        timer.reset();
+        ret = readCompressedLog(&in, fname, n);
+        benchReport(n ? "readCompressedLog 1 thread" :
+                        "readCompressedLog all cores",
+                    timer.seconds(),
+                    nrecords
+                    );
+        if (ret)
+            return ret;
+    }
+
+    double t0 = blocks[0].tmin;
+    double t1 = blocks[blocks.size() - 1].tmax;
+    PEyeLog part;
+    timer.reset();
+    ret = readCompressedRange(&part, fname, t0 + (t1 - t0) / 2,
+                              t0 + (t1 - t0) * 0.51
+                              );
+    double secs = timer.seconds();
+    benchReport("readCompressedRange 1%", secs, part.getEntries().size());
+    return ret;
+}
+
+int main(int argc, char** argv)
+{
+    unsigned nsamples = benchSamples(argc, argv, 1000000);
+    int ret;
+
+    if (argc > 3) {
+        fprintf(stderr, usage, argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    PEyeLog log;
+    if (argc > 2) {
+        if ((ret = readLog(&log, argv[2])) != 0) {
+            fprintf(stderr, "unable to read %s: %s\n", argv[2], eyelog_error(ret));
+            return EXIT_FAILURE;
+        }
+    }
+    else {
+        benchMakeSession(log, nsamples);
+    }
+    printf("%u records\n", unsigned(log.getEntries().size()));
+
+    // The log writes to the file it has opened.
+    if ((ret = log.open(fname)) != 0 ||
+        (ret = log.write(FORMAT_BINARY, WRITE_BUFFERED)) != 0
+        ) {
+        fprintf(stderr, "unable to write %s: %s\n", fname, eyelog_error(ret));
+        return EXIT_FAILURE;
+    }
+    log.close();
+    long v1size = fileSize(fname);
+    printf("%-40s %ld bytes\n", "FORMAT_BINARY", v1size);
+
+    const block_codec codecs[] = {CODEC_NONE, CODEC_ZLIB, CODEC_LZ4, CODEC_ZSTD};
+    const char* names[] = {"v2 delta only", "v2 zlib", "v2 lz4", "v2 zstd"};
+    for (int i = 0; i < 4; i++) {
+        if (!blockCodecSupported(codecs[i])) {
+            printf("%-40s not available\n", names[i]);
+            continue;
+        }
+        ret = run(log, names[i], codecs[i], v1size);
+        if (ret) {
+            fprintf(stderr, "%s failed: %s\n", names[i], eyelog_error(ret));
+            break;
+        }
+    }
+
+    if (ret == 0)
+        ret = runBlocks(log);
+    if (ret)
+        fprintf(stderr, "reading blocks failed: %s\n", eyelog_error(ret));
+
+    remove(fname);
+    return ret ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,67 @@
+/*
+ * bench_csv_write.cpp
+ *
+ * Compares formatting entries with toString and with PCsvWriter.
+ *
+ * Copyright (C) 2016  Maarten Duijndam
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include "BenchUtil.h"
+
+using namespace std;
+
+const char* usage = "%s [nsamples]\n";
+
+int main(int argc, char** argv)
+{
+    unsigned nsamples = benchSamples(argc, argv, 1000000);
+
+    if (argc > 2) {
+        fprintf(stderr, usage, argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    PEyeLog log;
+    benchMakeSession(log, nsamples);
+    const PEntryVec& entries = log.getEntries();
+    double nrecords = entries.size();
+    printf("csv write of %.0f records\n", nrecords);
+
+    BenchTimer timer;
+    ostringstream slow;
+    for (const auto& e : entries)
+        slow << e->toString().c_str() << '\n';
+    benchReport("toString", timer.seconds(), nrecords);
+
+    ostringstream fast;
+    timer.reset();
+    {
+        PCsvWriter writer(fast);
+        for (const auto& e : entries)
+            writer.write(*e);
+    }
+    benchReport("PCsvWriter", timer.seconds(), nrecords);
+
+    if (slow.str() != fast.str()) {
+        fprintf(stderr, "the output differs\n");
+        return EXIT_FAILURE;
+    }
+    return 0;
+}
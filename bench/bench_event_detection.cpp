@@ -0,0 +1,117 @@
+/*
+ * bench_event_detection.cpp
+ *
+ * Measures the detection of fixations and saccades with a
+ * PEventDetector, from a log in memory and while reading a binary file.
+ *
+ * Copyright (C) 2016  Maarten Duijndam
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cstdio>
+#include "BenchUtil.h"
+
+using namespace std;
+
+const char* usage = "%s [nsamples]\n";
+
+const char* session_file = "bench_event_detection.bin";
+
+/*
+ * Counts the events instead of storing them.
+ */
+class CountSink : public PEntrySink {
+
+public:
+
+    CountSink() : m_count(0) {}
+
+    virtual void addEntry(PEyeLogEntry* entry)
+    {
+        m_count++;
+        delete entry;
+    }
+
+    unsigned count() const {return m_count;}
+
+private:
+
+    unsigned m_count;
+};
+
+static unsigned detect(const PEyeLog& log, detection_algorithm algorithm)
+{
+    CountSink events;
+    PEventDetector detector(&events, algorithm);
+    for (const auto* e : log.getEntries()) {
+        entrytype type = e->getEntryType();
+        if (type == LGAZE || type == RGAZE) {
+            const PGazeEntry* g = static_cast<const PGazeEntry*>(e);
+            detector.addGaze(type, g->getTime(), g->getX(), g->getY(),
+                             g->getPupil()
+                             );
+        }
+    }
+    detector.flush();
+    return events.count();
+}
+
+int main(int argc, char** argv)
+{
+    unsigned nsamples = benchSamples(argc, argv, 1000000);
+
+    if (argc > 2) {
+        fprintf(stderr, usage, argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    PEyeLog log;
+    benchMakeSession(log, nsamples);
+    double nrecords = 2.0 * nsamples;
+    printf("detecting events in %.0f samples\n", nrecords);
+
+    BenchTimer timer;
+    unsigned n = detect(log, DETECT_IVT);
+    benchReport("I-VT from memory", timer.seconds(), nrecords);
+    printf("%u events\n", n);
+
+    timer.reset();
+    n = detect(log, DETECT_IDT);
+    benchReport("I-DT from memory", timer.seconds(), nrecords);
+    printf("%u events\n", n);
+
+    if (log.open(session_file) || log.write(FORMAT_BINARY)) {
+        fprintf(stderr, "unable to write %s\n", session_file);
+        return EXIT_FAILURE;
+    }
+    log.close();
+
+    CountSink events;
+    int ret;
+    timer.reset();
+    {
+        PEventDetector detector(&events, DETECT_IVT);
+        ret = readLog(&detector, session_file);
+    }
+    benchReport("I-VT while reading", timer.seconds(), nrecords);
+    remove(session_file);
+
+    if (ret) {
+        fprintf(stderr, "unable to read %s\n", session_file);
+        return EXIT_FAILURE;
+    }
+    return 0;
+}
@@ -0,0 +1,121 @@
+/*
+ * bench_gaze_kernels.cpp
+ *
+ * Compares computing per sample quantities through the entries of a
+ * PEyeLog with the kernels in PGazeKernels.h for every instruction set.
+ *
+ * Copyright (C) 2016  Maarten Duijndam
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include "BenchUtil.h"
+
+using namespace std;
+
+const char* usage = "%s [nsamples]\n";
+
+// Every kernel runs this many times, so the timings are long enough.
+const unsigned REPEAT = 20;
+
+int main(int argc, char** argv)
+{
+    unsigned nsamples = benchSamples(argc, argv, 1000000);
+
+    if (argc > 2) {
+        fprintf(stderr, usage, argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    PEyeLog log;
+    benchMakeSession(log, nsamples);
+    PSampleStore store(log);
+    const PGazeColumns& left = store[LGAZE];
+    const PGazeColumns& right = store[RGAZE];
+    size_t n = left.size();
+    double nrecords = double(n) * REPEAT;
+    printf("%u samples per eye, every kernel runs %u times\n", nsamples, REPEAT);
+
+    // The velocities the way they are computed on the entries of a log.
+    vector<float> v(n), a(n), out(n);
+    float checksum = 0;
+    BenchTimer timer;
+    for (unsigned r = 0; r < REPEAT; r++) {
+        const PGazeEntry* prev = nullptr;
+        size_t i = 0;
+        for (const auto* e : log.getEntries()) {
+            if (e->getEntryType() != LGAZE)
+                continue;
+            const PGazeEntry* g = static_cast<const PGazeEntry*>(e);
+            if (prev) {
+                float dx = g->getX() - prev->getX();
+                float dy = g->getY() - prev->getY();
+                float dt = float(g->getTime() - prev->getTime());
+                v[i++] = std::sqrt(dx * dx + dy * dy) * 1000.0f / dt;
+            }
+            prev = g;
+        }
+    }
+    benchReport("velocities through PGazeEntry", timer.seconds(), nrecords);
+    checksum += v[n / 2];
+
+    const gaze_kernel_isa isas[] = {KERNEL_SCALAR, KERNEL_SSE2, KERNEL_AVX2};
+    const char* names[] = {"scalar", "sse2", "avx2"};
+    for (gaze_kernel_isa isa : isas) {
+        if (setGazeKernelIsa(isa) != 0) {
+            printf("%s is not supported\n", names[isa]);
+            continue;
+        }
+        char name[64];
+
+        timer.reset();
+        for (unsigned r = 0; r < REPEAT; r++)
+            computeVelocities(left.getTime().begin(), left.getX().begin(),
+                              left.getY().begin(), n, v.data()
+                              );
+        snprintf(name, sizeof(name), "%s velocities", names[isa]);
+        benchReport(name, timer.seconds(), nrecords);
+
+        timer.reset();
+        for (unsigned r = 0; r < REPEAT; r++)
+            computeAccelerations(left.getTime().begin(), v.data(), n, a.data());
+        snprintf(name, sizeof(name), "%s accelerations", names[isa]);
+        benchReport(name, timer.seconds(), nrecords);
+
+        timer.reset();
+        for (unsigned r = 0; r < REPEAT; r++)
+            averageEyes(left.getX().begin(), right.getX().begin(), n, out.data());
+        snprintf(name, sizeof(name), "%s average", names[isa]);
+        benchReport(name, timer.seconds(), nrecords);
+
+        timer.reset();
+        for (unsigned r = 0; r < REPEAT; r++)
+            pixelsToDegrees(left.getX().begin(), n, 960, 35, out.data());
+        snprintf(name, sizeof(name), "%s pixels to degrees", names[isa]);
+        benchReport(name, timer.seconds(), nrecords);
+
+        timer.reset();
+        for (unsigned r = 0; r < REPEAT; r++)
+            normalizePupil(left.getPupil().begin(), n, out.data());
+        snprintf(name, sizeof(name), "%s pupil z-scores", names[isa]);
+        benchReport(name, timer.seconds(), nrecords);
+        checksum += v[n / 2] + a[n / 2] + out[n / 2];
+    }
+    // keeps the compiler from removing the loops.
+    return std::isfinite(checksum) ? 0 : EXIT_FAILURE;
+}
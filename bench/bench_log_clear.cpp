@@ -0,0 +1,73 @@
+/*
+ * bench_log_clear.cpp
+ *
+ * Compares tearing down a log with entries from the heap and from the
+ * arena of the log.
+ *
+ * Copyright (C) 2016  Maarten Duijndam
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cstdio>
+#include "BenchUtil.h"
+
+using namespace std;
+
+const char* usage = "%s [nsamples]\n";
+const char* fname = "bench_log_clear.bin";
+
+int main(int argc, char** argv)
+{
+    unsigned nsamples = benchSamples(argc, argv, 1000000);
+    int ret;
+    double nrecords;
+
+    if (argc > 2) {
+        fprintf(stderr, usage, argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    BenchTimer timer;
+    {
+        PEyeLog log;
+        benchMakeSession(log, nsamples);
+        nrecords = log.getEntries().size();
+        if ((ret = log.open(fname)) != 0 || (ret = log.write()) != 0) {
+            fprintf(stderr, "unable to write %s: %s\n", fname, eyelog_error(ret));
+            return EXIT_FAILURE;
+        }
+        printf("clearing a log of %.0f records\n", nrecords);
+        timer.reset();
+        log.clear();
+        benchReport("clear (new/delete)", timer.seconds(), nrecords);
+    }
+    {
+        PEyeLog log;
+        timer.reset();
+        ret = readLog(&log, fname);
+        benchReport("readLog (arena)", timer.seconds(), nrecords);
+        timer.reset();
+        log.clear();
+        benchReport("clear (arena)", timer.seconds(), nrecords);
+    }
+
+    remove(fname);
+    if (ret) {
+        fprintf(stderr, "reading failed: %s\n", eyelog_error(ret));
+        return EXIT_FAILURE;
+    }
+    return 0;
+}
@@ -0,0 +1,130 @@
+/*
+ * bench_merge.cpp
+ *
+ * Compares merging the log of the eyetracker with a log of events by
+ * sorting their concatenation, with PEyeLog::merge and, file to file,
+ * with mergeLogFiles.
+ *
+ * Copyright (C) 2016  Maarten Duijndam
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cstdio>
+#include <vector>
+#include "BenchUtil.h"
+
+using namespace std;
+
+const char* usage = "%s [nsamples]\n";
+
+const char* tracker_file = "bench_merge_tracker.bin";
+const char* events_file  = "bench_merge_events.bin";
+const char* merged_file  = "bench_merge_merged.bin";
+
+/*
+ * Splits a session into the samples of the tracker and the other events.
+ */
+static void makeInputs(PEyeLog& tracker, PEyeLog& events, unsigned nsamples)
+{
+    PEyeLog session;
+    PEntryVec other;
+    benchMakeSession(session, nsamples);
+    for (auto* e : session.getEntries()) {
+        entrytype type = e->getEntryType();
+        if (type == LGAZE || type == RGAZE)
+            tracker.addEntry(e->clone());
+        else
+            other.push_back(e);
+    }
+    sortPEntryVec(other);
+    for (const auto* e : other)
+        events.addEntry(e->clone());
+}
+
+static bool equalEntries(const PEntryVec& a, const PEntryVec& b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (size_t i = 0; i < a.size(); i++)
+        if (a[i]->compare(*b[i]) != 0)
+            return false;
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    unsigned nsamples = benchSamples(argc, argv, 1000000);
+
+    if (argc > 2) {
+        fprintf(stderr, usage, argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    PEyeLog tracker, events;
+    makeInputs(tracker, events, nsamples);
+    double nrecords = tracker.getEntries().size() + events.getEntries().size();
+    printf("merging %.0f records\n", nrecords);
+
+    PEntryVec all = tracker.getEntries();
+    all.insert(all.end(), events.getEntries().begin(), events.getEntries().end());
+    BenchTimer timer;
+    sortPEntryVec(all);
+    benchReport("concatenate and sortPEntryVec", timer.seconds(), nrecords);
+
+    timer.reset();
+    tracker.merge(vector<PEyeLog*>{&events});
+    benchReport("PEyeLog::merge", timer.seconds(), nrecords);
+    bool ok = equalEntries(tracker.getEntries(), all);
+
+    // Split again and write both logs to disk.
+    PEyeLog tracker2, events2;
+    makeInputs(tracker2, events2, nsamples);
+    if (tracker2.open(tracker_file) || tracker2.write(FORMAT_BINARY) ||
+        events2.open(events_file) || events2.write(FORMAT_BINARY)) {
+        fprintf(stderr, "unable to write the inputs\n");
+        return EXIT_FAILURE;
+    }
+    tracker2.clear();
+    events2.clear();
+
+    timer.reset();
+    {
+        PEyeLog a, b;
+        ok = ok && readLog(&a, tracker_file) == 0 && readLog(&b, events_file) == 0;
+        a.merge(vector<PEyeLog*>{&b});
+        ok = ok && a.open(merged_file) == 0 && a.write(FORMAT_BINARY) == 0;
+    }
+    benchReport("read, merge and write", timer.seconds(), nrecords);
+
+    timer.reset();
+    vector<String> inputs = {tracker_file, events_file};
+    ok = ok && mergeLogFiles(inputs, merged_file) == 0;
+    benchReport("mergeLogFiles", timer.seconds(), nrecords);
+
+    PEyeLog check;
+    ok = ok && readLog(&check, merged_file) == 0 &&
+         check.getEntries().size() == all.size();
+
+    remove(tracker_file);
+    remove(events_file);
+    remove(merged_file);
+
+    if (!ok) {
+        fprintf(stderr, "the merged logs differ\n");
+        return EXIT_FAILURE;
+    }
+    return 0;
+}
@@ -0,0 +1,103 @@
+/*
+ * bench_sort.cpp
+ *
+ * Compares sorting entries with std::sort and PEyeLogEntry::compare,
+ * with sortPEntryVec and merging the separately sorted streams of
+ * a session with mergePEntryVecs.
+ *
+ * Copyright (C) 2016  Maarten Duijndam
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "BenchUtil.h"
+
+using namespace std;
+
+const char* usage = "%s [nsamples]\n";
+
+static bool isSorted(const PEntryVec& entries)
+{
+    for (size_t i = 1; i < entries.size(); i++)
+        if (entries[i]->compare(*entries[i - 1]) < 0)
+            return false;
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    unsigned nsamples = benchSamples(argc, argv, 1000000);
+
+    if (argc > 2) {
+        fprintf(stderr, usage, argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    PEyeLog log;
+    benchMakeSession(log, nsamples);
+    PEntryVec shuffled = log.getEntries();
+    std::mt19937 rng(42);
+    std::shuffle(shuffled.begin(), shuffled.end(), rng);
+    double nrecords = shuffled.size();
+    printf("sorting %.0f shuffled records\n", nrecords);
+
+    PEntryVec entries = shuffled;
+    BenchTimer timer;
+    std::sort(entries.begin(), entries.end(),
+              [](const PEyeLogEntry* l, const PEyeLogEntry* r) {
+                  return l->compare(*r) < 0;
+              });
+    benchReport("std::sort with compare", timer.seconds(), nrecords);
+    bool ok = isSorted(entries);
+
+    entries = shuffled;
+    timer.reset();
+    sortPEntryVec(entries, 1);
+    benchReport("sortPEntryVec 1 thread", timer.seconds(), nrecords);
+    ok = ok && isSorted(entries);
+
+    entries = shuffled;
+    timer.reset();
+    sortPEntryVec(entries);
+    benchReport("sortPEntryVec all cores", timer.seconds(), nrecords);
+    ok = ok && isSorted(entries);
+
+    // The streams of a tracker arrive sorted, only their merge is needed.
+    PEntryVec left, right, other, merged;
+    for (auto* e : log.getEntries()) {
+        if (e->getEntryType() == LGAZE)
+            left.push_back(e);
+        else if (e->getEntryType() == RGAZE)
+            right.push_back(e);
+        else
+            other.push_back(e);
+    }
+    sortPEntryVec(other);
+    vector<const PEntryVec*> inputs = {&left, &right, &other};
+    timer.reset();
+    mergePEntryVecs(inputs, merged);
+    benchReport("mergePEntryVecs 3 streams", timer.seconds(), nrecords);
+    ok = ok && isSorted(merged) && merged.size() == entries.size();
+
+    if (!ok) {
+        fprintf(stderr, "the entries are not sorted\n");
+        return EXIT_FAILURE;
+    }
+    return 0;
+}
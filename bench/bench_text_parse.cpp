@@ -0,0 +1,175 @@
+/*
+ * bench_text_parse.cpp
+ *
+ * Compares the iostream/sscanf line parser with PTextScanner on an .asc file.
+ *
+ * Copyright (C) 2016  Maarten Duijndam
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include "BenchUtil.h"
+
+using namespace std;
+
+const char* usage = "%s [repeat [ascfile]]\n";
+const char* default_file = BENCH_SAMPLES_DIR "/0001_01_01.asc";
+
+/*
+ * Counts and discards everything it receives.
+ */
+class CountingSink : public PEntrySink {
+public:
+    CountingSink() : n(0) {}
+    virtual void addGaze(entrytype, double, float, float, float)
+    {
+        n++;
+    }
+    virtual void addEntry(PEyeLogEntry* entry)
+    {
+        n++;
+        delete entry;
+    }
+    unsigned long n;
+};
+
+/*
+ * The way samples were parsed before PTextScanner.
+ */
+static unsigned parseLineStream(const char* begin, const char* end, double& sum)
+{
+    istringstream stream(string(begin, end));
+    string token;
+    stream >> token;
+    if (token.empty() || token.find_first_not_of("0123456789") != string::npos)
+        return 0;
+    float v[6];
+    double time = atof(token.c_str());
+    string leftover;
+    getline(stream, leftover);
+    int matched = sscanf(leftover.c_str(), "%f%f%f%f%f%f",
+                         &v[0], &v[1], &v[2], &v[3], &v[4], &v[5]
+                         );
+    if (matched < 3)
+        return 0;
+    sum += time + v[0];
+    return matched == 6 ? 2 : 1;
+}
+
+static unsigned parseLineScanner(const char* begin, const char* end, double& sum)
+{
+    PTextScanner scanner(begin, end);
+    const char *token, *tokenend;
+    if (!scanner.readToken(token, tokenend))
+        return 0;
+    for (const char* p = token; p < tokenend; p++)
+        if (*p < '0' || *p > '9')
+            return 0;
+    float v[6];
+    double time;
+    PTextScanner(token, tokenend).readDouble(time);
+    int matched = 0;
+    while (matched < 6 && scanner.readFloat(v[matched]))
+        matched++;
+    if (matched < 3)
+        return 0;
+    sum += time + v[0];
+    return matched == 6 ? 2 : 1;
+}
+
+template <class Parser>
+static double parseLines(const string& text, Parser parse, double& nsamples)
+{
+    const char* line = text.data();
+    const char* end = line + text.size();
+    double sum = 0;
+    nsamples = 0;
+    while (line < end) {
+        const char* eol = static_cast<const char*>(memchr(line, '\n', end - line));
+        if (!eol)
+            eol = end;
+        nsamples += parse(line, eol, sum);
+        line = eol + 1;
+    }
+    return sum;
+}
+
+int main(int argc, char** argv)
+{
+    unsigned repeat = benchSamples(argc, argv, 20);
+    const char* fname = argc > 2 ? argv[2] : default_file;
+
+    if (argc > 3) {
+        fprintf(stderr, usage, argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    PMappedFile file;
+    int ret = file.open(fname);
+    if (ret) {
+        fprintf(stderr, "unable to open %s: %s\n", fname, eyelog_error(ret));
+        return EXIT_FAILURE;
+    }
+
+    string one(file.data(), file.size());
+    if (one.size() && one[one.size() - 1] != '\n')
+        one += '\n';
+    string text;
+    text.reserve(one.size() * repeat);
+    for (unsigned i = 0; i < repeat; i++)
+        text += one;
+
+    double nlines = 0;
+    for (char c : text)
+        nlines += c == '\n';
+    printf("parsing %.0f lines (%s x %u)\n", nlines, fname, repeat);
+
+    BenchTimer timer;
+    double nstream, nscanner;
+    double sumstream = parseLines(text, parseLineStream, nstream);
+    benchReport("istringstream + sscanf", timer.seconds(), nlines);
+
+    timer.reset();
+    double sumscanner = parseLines(text, parseLineScanner, nscanner);
+    benchReport("PTextScanner", timer.seconds(), nlines);
+
+    if (nstream != nscanner || sumstream != sumscanner) {
+        fprintf(stderr, "parsers disagree\n");
+        return EXIT_FAILURE;
+    }
+
+    {
+        CountingSink sink;
+        timer.reset();
+        ret = readAscBuffer(&sink, text.data(), text.data() + text.size(), 1);
+        benchReport("readAscBuffer 1 thread", timer.seconds(), nlines);
+    }
+    {
+        CountingSink sink;
+        timer.reset();
+        ret |= readAscBuffer(&sink, text.data(), text.data() + text.size());
+        benchReport("readAscBuffer all cores", timer.seconds(), nlines);
+    }
+
+    if (ret) {
+        fprintf(stderr, "reading failed: %s\n", eyelog_error(ret));
+        return EXIT_FAILURE;
+    }
+    return 0;
+}
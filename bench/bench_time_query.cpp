@@ -0,0 +1,139 @@
+/*
+ * bench_time_query.cpp
+ *
+ * Compares cutting epochs around trial onsets by a scan of the log
+ * with a PTimeIndex, and reading a time range of a file with and without
+ * its block index.
+ *
+ * Copyright (C) 2016  Maarten Duijndam
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cstdio>
+#include <vector>
+#include "BenchUtil.h"
+
+using namespace std;
+
+const char* usage = "%s [nsamples]\n";
+const char* fname = "bench_time_query.bin";
+
+/*
+ * Counts the samples in a sink without keeping them.
+ */
+class CountingSink : public PEntrySink {
+
+public:
+
+    CountingSink() : n(0) {}
+
+    virtual void addGaze(entrytype, double, float, float, float)
+    {
+        n++;
+    }
+
+    virtual void addEntry(PEyeLogEntry* entry)
+    {
+        n++;
+        delete entry;
+    }
+
+    double n;
+};
+
+int main(int argc, char** argv)
+{
+    unsigned nsamples = benchSamples(argc, argv, 2000000);
+    int ret;
+
+    if (argc > 2) {
+        fprintf(stderr, usage, argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    PEyeLog log;
+    benchMakeSession(log, nsamples);
+    const PEntryVec& entries = log.getEntries();
+
+    // The scans are slow, so at most 100 trials are epoched.
+    vector<double> onsets;
+    for (const auto* e : entries)
+        if (e->getEntryType() == TRIAL)
+            onsets.push_back(e->getTime());
+    size_t step = onsets.size() / 100 + 1;
+    for (size_t i = 0; i * step < onsets.size(); i++)
+        onsets[i] = onsets[i * step];
+    onsets.resize((onsets.size() + step - 1) / step);
+    printf("%zu epochs of -100 to 500 ms in %zu records\n",
+           onsets.size(), entries.size()
+           );
+
+    BenchTimer timer;
+    double nscan = 0;
+    for (double onset : onsets) {
+        for (const auto* e : entries)
+            if (e->getEntryType() == LGAZE &&
+                e->getTime() >= onset - 100 && e->getTime() < onset + 500)
+                nscan++;
+    }
+    benchReport("epochs (scan)", timer.seconds(), nscan);
+
+    timer.reset();
+    PTimeIndex index(entries);
+    benchReport("build PTimeIndex", timer.seconds(), double(entries.size()));
+
+    timer.reset();
+    double nindex = 0;
+    for (double onset : onsets)
+        nindex += index.find(LGAZE, onset - 100, onset + 500).size();
+    benchReport("epochs (PTimeIndex)", timer.seconds(), nindex);
+    if (nindex != nscan) {
+        fprintf(stderr, "the index found %.0f samples, the scan %.0f\n",
+                nindex, nscan
+                );
+        return EXIT_FAILURE;
+    }
+
+    if ((ret = log.open(fname)) != 0 || (ret = log.write()) != 0) {
+        fprintf(stderr, "unable to write %s: %s\n", fname, eyelog_error(ret));
+        return EXIT_FAILURE;
+    }
+    log.close();
+
+    // A range of one second in the middle of the file.
+    double t0 = 1000.0 + nsamples / 2, t1 = t0 + 1000;
+    CountingSink all, range;
+    timer.reset();
+    PMappedLog mapped;
+    PEntryView view;
+    ret = mapped.open(fname);
+    while (ret == 0 && mapped.next(view))
+        if (view.getTime() >= t0 && view.getTime() < t1)
+            all.n++;
+    benchReport("1 s of the file (scan)", timer.seconds(), all.n);
+
+    timer.reset();
+    if (ret == 0)
+        ret = readMappedRange(&range, fname, t0, t1);
+    benchReport("1 s of the file (block index)", timer.seconds(), range.n);
+
+    remove(fname);
+    if (ret || all.n != range.n) {
+        fprintf(stderr, "reading the range failed: %s\n", eyelog_error(ret));
+        return EXIT_FAILURE;
+    }
+    return 0;
+}
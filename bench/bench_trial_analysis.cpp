@@ -0,0 +1,96 @@
+/*
+ * bench_trial_analysis.cpp
+ *
+ * Times an analysis of every trial of an experiment, serially and with
+ * analyzeTrials on pools of several sizes.
+ *
+ * Copyright (C) 2016  Maarten Duijndam
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include "BenchUtil.h"
+
+using namespace std;
+
+const char* usage = "%s [nsamples]\n";
+
+/*
+ * The mean distance of the left gaze samples of a trial to their centroid.
+ */
+static double dispersion(const PTrial& trial)
+{
+    const DArray<PEyeLogEntry*>& samples = trial[LGAZE];
+    if (samples.size() == 0)
+        return 0;
+
+    double mx = 0, my = 0;
+    for (const auto* e : samples) {
+        const PGazeEntry* g = static_cast<const PGazeEntry*>(e);
+        mx += g->getX();
+        my += g->getY();
+    }
+    mx /= samples.size();
+    my /= samples.size();
+
+    double d = 0;
+    for (const auto* e : samples) {
+        const PGazeEntry* g = static_cast<const PGazeEntry*>(e);
+        d += std::hypot(g->getX() - mx, g->getY() - my);
+    }
+    return d / samples.size();
+}
+
+int main(int argc, char** argv)
+{
+    unsigned nsamples = benchSamples(argc, argv, 2000000);
+
+    if (argc > 2) {
+        fprintf(stderr, usage, argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    PEyeLog log;
+    benchMakeSession(log, nsamples);
+    PExperiment expt(std::move(log));
+    printf("%u trials of %u samples\n", expt.nTrials(), nsamples);
+
+    BenchTimer timer;
+    std::vector<double> serial;
+    for (unsigned i = 0; i < expt.nTrials(); i++)
+        serial.push_back(dispersion(expt[i]));
+    benchReport("serial", timer.seconds(), nsamples);
+
+    unsigned ncores = std::thread::hardware_concurrency();
+    unsigned sizes[] = {1, 2, ncores > 2 ? ncores : 0};
+    for (unsigned nthreads : sizes) {
+        if (nthreads == 0)
+            continue;
+        PThreadPool pool(nthreads);
+        char name[64];
+        snprintf(name, sizeof(name), "analyzeTrials %u threads", nthreads);
+        timer.reset();
+        std::vector<double> results = analyzeTrials(pool, expt, dispersion);
+        benchReport(name, timer.seconds(), nsamples);
+        if (results != serial) {
+            fprintf(stderr, "unexpected results\n");
+            return EXIT_FAILURE;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,138 @@
+/*
+ * bench_trial_iteration.cpp
+ *
+ * Times iterating over the gaze samples of every trial of an experiment,
+ * through the entries of a type and through the gaze columns, which are
+ * made on the first call of getGaze.
+ *
+ * Copyright (C) 2016  Maarten Duijndam
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cmath>
+#include <cstdio>
+#include "BenchUtil.h"
+
+using namespace std;
+
+const char* usage = "%s [nsamples]\n";
+
+/*
+ * Sums the coordinates of the samples of both eyes via the entries.
+ */
+static double sumEntries(const PExperiment& expt)
+{
+    double sum = 0;
+    for (unsigned i = 0; i < expt.nTrials(); i++) {
+        const PTrial& trial = expt[i];
+        for (entrytype eye : {LGAZE, RGAZE})
+            for (const auto* e : trial[eye]) {
+                const PGazeEntry* g = static_cast<const PGazeEntry*>(e);
+                sum += g->getX() + g->getY();
+            }
+    }
+    return sum;
+}
+
+/*
+ * Sums the coordinates of the samples of both eyes via the gaze columns.
+ */
+static double sumColumns(const PExperiment& expt)
+{
+    double sum = 0;
+    for (unsigned i = 0; i < expt.nTrials(); i++) {
+        const PTrial& trial = expt[i];
+        for (entrytype eye : {LGAZE, RGAZE}) {
+            const PGazeColumns& columns = trial.getGaze(eye);
+            const float* x = columns.getX().begin();
+            const float* y = columns.getY().begin();
+            for (PGazeColumns::size_type j = 0; j < columns.size(); j++)
+                sum += x[j] + y[j];
+        }
+    }
+    return sum;
+}
+
+/*
+ * Looks up the entries of every type of every trial.
+ */
+static double lookupTypes(const PExperiment& expt)
+{
+    double n = 0;
+    for (unsigned i = 0; i < expt.nTrials(); i++)
+        for (unsigned t = LGAZE; t <= TRIALEND; t++)
+            n += expt[i][entrytype(t)].size();
+    return n;
+}
+
+int main(int argc, char** argv)
+{
+    unsigned nsamples = benchSamples(argc, argv, 2000000);
+
+    if (argc > 2) {
+        fprintf(stderr, usage, argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    PEyeLog log;
+    benchMakeSession(log, nsamples);
+    double nrecords = 2.0 * nsamples;
+
+    BenchTimer timer;
+    PExperiment owning(log);
+    benchReport("PExperiment(const PEyeLog&)", timer.seconds(), nrecords);
+    timer.reset();
+    PExperiment borrowed(std::move(log));
+    benchReport("PExperiment(PEyeLog&&)", timer.seconds(), nrecords);
+
+    const int nrepeats = 5;
+    double entries = 0, columns = 0, ntypes = 0;
+
+    timer.reset();
+    for (int r = 0; r < nrepeats; r++)
+        entries += sumEntries(borrowed);
+    benchReport("trial[eye] entries", timer.seconds(), nrepeats * nrecords);
+
+    // The first call of getGaze makes the columns.
+    timer.reset();
+    double first = sumColumns(borrowed);
+    benchReport("trial.getGaze(eye) first call", timer.seconds(), nrecords);
+
+    timer.reset();
+    for (int r = 0; r < nrepeats; r++)
+        columns += sumColumns(borrowed);
+    benchReport("trial.getGaze(eye) columns", timer.seconds(), nrepeats * nrecords);
+
+    const int nlookups = 1000;
+    timer.reset();
+    for (int r = 0; r < nlookups; r++)
+        ntypes += lookupTypes(owning);
+    benchReport("trial[type] lookups",
+                timer.seconds(),
+                double(nlookups) * owning.nTrials() * (TRIALEND + 1)
+                );
+
+    double nentries = 0;
+    for (unsigned i = 0; i < owning.nTrials(); i++)
+        nentries += owning[i].size();
+    if (entries != columns || first != sumEntries(borrowed) ||
+        ntypes != nlookups * nentries
+        ) {
+        fprintf(stderr, "unexpected sums\n");
+        return EXIT_FAILURE;
+    }
+    return 0;
+}
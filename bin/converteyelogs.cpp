@@ -0,0 +1,454 @@
+/*
+ * converteyelogs.cpp this file is part of libeye and converts many
+ * logfiles at once.
+ *
+ * Copyright (C) 2016  Maarten Duijndam
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+#include <eyelog/EyeLog.h>
+
+#if defined(MSDOS) || defined(OS2) || defined(WIN32) || defined(__CYGWIN__)
+#  define NO_DIRENT
+#else
+#  include <dirent.h>
+#endif
+
+using namespace std;
+
+std::string usage = "%s [options] <input>...\n\
+\n\
+    Converts every input to another format. An input is a logfile or a\n\
+    directory, of which the .asc, .csv and .bin files are converted.\n\
+    The output gets the name of the input with the extension of the\n\
+    output format. An output that is newer than its input is up to date\n\
+    and skipped.\n\
+\n\
+    options are:\n\
+        -b          write in binary mode, the default.\n\
+        -z          write in compressed binary mode.\n\
+        -csv        write in csv form.\n\
+        -o <dir>    write the outputs in dir instead of next to the inputs.\n\
+        -l <file>   read the inputs from file, one per line, - is stdin.\n\
+        -j <n>      convert n files at once, 0 is one per core, the default.\n\
+        -m <MB>     limit the memory of the logs in memory, default 1024.\n\
+        -f          convert inputs of which the output is up to date too.\n\
+        -v          print every converted file.\n";
+
+/*
+ * A log in memory takes about this many times the size of its file.
+ */
+const double MEMORY_PER_BYTE = 2.5;
+
+eyelog_format   out_format(FORMAT_BINARY);
+string          out_dir;
+unsigned        nthreads(0);
+double          max_memory(1024.0 * 1024 * 1024);
+bool            force(false);
+bool            verbose(false);
+vector<string>  inputs;
+
+/*
+ * One file to convert.
+ */
+struct Job {
+    string          input;
+    string          output;
+    double          size;       // of the input in bytes.
+    int             status;     // 0 or an errno or eyelog error.
+    bool            skipped;    // the output is up to date.
+    unsigned long   nentries;
+};
+
+/*
+ * Lets a worker load a file only when the logs that are in memory leave
+ * room for it. A file that exceeds the limit on its own is converted
+ * when nothing else is in memory.
+ */
+class MemoryBudget {
+
+public:
+
+    MemoryBudget(double limit) : m_limit(limit), m_used(0) {}
+
+    void acquire(double n)
+    {
+        unique_lock<mutex> lock(m_mutex);
+        m_cond.wait(lock, [this, n] () {
+            return m_used == 0 || m_used + n <= m_limit;
+        });
+        m_used += n;
+    }
+
+    void release(double n)
+    {
+        {
+            lock_guard<mutex> lock(m_mutex);
+            m_used -= n;
+        }
+        m_cond.notify_all();
+    }
+
+private:
+
+    double              m_limit;
+    double              m_used;
+    mutex               m_mutex;
+    condition_variable  m_cond;
+};
+
+/**
+ * print usage and exit.
+ */
+void print_usage(string name) {
+    fprintf(stderr, usage.c_str(), name.c_str());
+    exit(EXIT_FAILURE);
+}
+
+/*
+ * Reads the names of inputs from a file, empty lines are ignored.
+ */
+void read_list(const string& name, const char* program) {
+    ifstream file;
+    istream* in = &cin;
+    if (name != "-") {
+        file.open(name.c_str());
+        if (!file.is_open()) {
+            fprintf(stderr, "Unable to open %s\n", name.c_str());
+            print_usage(program);
+        }
+        in = &file;
+    }
+    string line;
+    while (getline(*in, line)) {
+        if (!line.empty() && line[line.size() - 1] == '\r')
+            line.erase(line.size() - 1);
+        if (!line.empty())
+            inputs.push_back(line);
+    }
+}
+
+void parse_cmd(int argc, char** argv) {
+
+    int i;
+    for (i = 1; i < argc && argv[i][0] == '-' && argv[i][1] != '\0'; i++) {
+        string arg(argv[i]);
+        bool has_value = arg == "-o" || arg == "-l" || arg == "-j" ||
+                         arg == "-m";
+        if (has_value && i + 1 == argc)
+            print_usage(argv[0]);
+
+        if (arg == "-b")
+            out_format = FORMAT_BINARY;
+        else if (arg == "-z")
+            out_format = FORMAT_BINARY_V2;
+        else if (arg == "-csv")
+            out_format = FORMAT_CSV;
+        else if (arg == "-o")
+            out_dir = argv[++i];
+        else if (arg == "-l")
+            read_list(argv[++i], argv[0]);
+        else if (arg == "-j")
+            nthreads = unsigned(atoi(argv[++i]));
+        else if (arg == "-m")
+            max_memory = atof(argv[++i]) * 1024 * 1024;
+        else if (arg == "-f")
+            force = true;
+        else if (arg == "-v")
+            verbose = true;
+        else
+            print_usage(argv[0]);
+    }
+    for (; i < argc; i++)
+        inputs.push_back(argv[i]);
+
+    if (inputs.empty() || max_memory <= 0)
+        print_usage(argv[0]);
+}
+
+bool is_directory(const string& name) {
+    struct stat st;
+    return stat(name.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+string extension(const string& name) {
+    size_t slash = name.find_last_of("/\\");
+    size_t dot = name.rfind('.');
+    if (dot == string::npos || (slash != string::npos && dot < slash))
+        return string();
+    return name.substr(dot);
+}
+
+/*
+ * Adds the logfiles in directory dir to files, subdirectories are
+ * not searched.
+ */
+int list_directory(const string& dir, vector<string>& files) {
+#if defined(NO_DIRENT)
+    (void) files;
+    fprintf(stderr, "%s: directories are not supported here\n", dir.c_str());
+    return ERR_INVALID_PARAMETER;
+#else
+    DIR* d = opendir(dir.c_str());
+    if (!d)
+        return errno;
+    struct dirent* entry;
+    while ((entry = readdir(d)) != nullptr) {
+        string name = dir + "/" + entry->d_name;
+        string ext = extension(name);
+        if ((ext == ".asc" || ext == ".csv" || ext == ".bin") &&
+            !is_directory(name)
+            )
+            files.push_back(name);
+    }
+    closedir(d);
+    return 0;
+#endif
+}
+
+string output_name(const string& input) {
+    string name = input.substr(0, input.size() - extension(input).size());
+    if (!out_dir.empty()) {
+        size_t slash = name.find_last_of("/\\");
+        if (slash != string::npos)
+            name = name.substr(slash + 1);
+        name = out_dir + "/" + name;
+    }
+    return name + (out_format == FORMAT_CSV ? ".csv" : ".bin");
+}
+
+/*
+ * Orders the files of a directory on name, the recording that was
+ * converted to the other formats comes first: .asc, .csv and then .bin.
+ */
+bool original_first(const string& a, const string& b) {
+    string exta = extension(a), extb = extension(b);
+    string stema = a.substr(0, a.size() - exta.size());
+    string stemb = b.substr(0, b.size() - extb.size());
+    if (stema != stemb)
+        return stema < stemb;
+    return (exta == ".asc" ? 0 : exta == ".csv" ? 1 : 2) <
+           (extb == ".asc" ? 0 : extb == ".csv" ? 1 : 2);
+}
+
+/*
+ * Expands the inputs to jobs. Of the files in a directory with the same
+ * name only the original recording is converted, the others are likely
+ * outputs of an earlier run. Files that are named explicitly must have
+ * an output of their own.
+ */
+int make_jobs(vector<Job>& jobs) {
+    int ret = 0;
+    for (const auto& input : inputs) {
+        vector<string> files;
+        bool listed = is_directory(input);
+        if (listed) {
+            int error = list_directory(input, files);
+            if (error) {
+                fprintf(stderr, "%s: %s\n", input.c_str(), eyelog_error(error));
+                ret = error;
+            }
+            sort(files.begin(), files.end(), original_first);
+        }
+        else {
+            files.push_back(input);
+        }
+
+        string previous;
+        for (const auto& file : files) {
+            Job job = {file, output_name(file), 0, 0, false, 0};
+            if (listed && job.output == previous)
+                continue;
+            previous = job.output;
+            if (job.output == job.input) {
+                if (listed)
+                    continue;
+                fprintf(stderr, "%s: the output would replace the input\n",
+                        file.c_str()
+                        );
+                ret = ERR_INVALID_PARAMETER;
+                continue;
+            }
+            jobs.push_back(job);
+        }
+    }
+
+    // Two inputs can't write the same output, the second one is refused.
+    set<string> outputs;
+    for (auto& job : jobs) {
+        if (!outputs.insert(job.output).second) {
+            fprintf(stderr, "%s: %s is the output of another input too\n",
+                    job.input.c_str(),
+                    job.output.c_str()
+                    );
+            job.status = ERR_INVALID_PARAMETER;
+        }
+    }
+    return ret;
+}
+
+/*
+ * Reads a log with a single thread, the files themselves are converted
+ * in parallel.
+ */
+int read_input(PEyeLog& log, const string& input) {
+    eyelog_format format;
+    String name(input.c_str());
+    int ret = detectLogFormat(name, &format);
+    if (ret)
+        return ret;
+    switch (format) {
+        case FORMAT_ASC:
+            return readAscLog(&log, name, 1);
+        case FORMAT_BINARY_V2:
+            return readCompressedLog(&log, name, 1);
+        default:
+            return readLog(&log, name);
+    }
+}
+
+/*
+ * Converts one input, the output is written under a temporary name
+ * first, so that an interrupted conversion never looks up to date.
+ */
+void convert(Job& job, MemoryBudget& budget) {
+    struct stat in, out;
+    if (job.status)
+        return;
+    if (stat(job.input.c_str(), &in) != 0) {
+        job.status = errno;
+        return;
+    }
+    job.size = double(in.st_size);
+    if (!force && stat(job.output.c_str(), &out) == 0 &&
+        out.st_mtime >= in.st_mtime
+        ) {
+        job.skipped = true;
+        return;
+    }
+
+    double memory = job.size * MEMORY_PER_BYTE;
+    budget.acquire(memory);
+    {
+        PEyeLog log;
+        string temp = job.output + ".tmp";
+        job.status = read_input(log, job.input);
+        if (job.status == 0)
+            job.status = log.open(temp.c_str());
+        if (job.status == 0) {
+            job.nentries = log.getEntries().size();
+            job.status = log.write(out_format, WRITE_BUFFERED);
+            log.close();
+            if (job.status == 0 && rename(temp.c_str(), job.output.c_str())) {
+                // Not every system replaces an existing file.
+                remove(job.output.c_str());
+                if (rename(temp.c_str(), job.output.c_str()))
+                    job.status = errno;
+            }
+            if (job.status)
+                remove(temp.c_str());
+        }
+    }
+    budget.release(memory);
+}
+
+int main(int argc, char **argv) {
+
+    vector<Job> jobs;
+    parse_cmd(argc, argv);
+    int ret = make_jobs(jobs);
+
+    if (nthreads == 0)
+        nthreads = thread::hardware_concurrency();
+    if (nthreads == 0)
+        nthreads = 1;
+    if (nthreads > jobs.size())
+        nthreads = unsigned(jobs.size());
+
+    auto start = chrono::steady_clock::now();
+    MemoryBudget budget(max_memory);
+    atomic<size_t> next(0);
+    mutex print;
+    auto work = [&] () {
+        size_t i;
+        while ((i = next++) < jobs.size()) {
+            Job& job = jobs[i];
+            bool refused = job.status != 0;
+            convert(job, budget);
+            lock_guard<mutex> lock(print);
+            if (job.status && !refused)
+                fprintf(stderr, "%s: %s\n",
+                        job.input.c_str(),
+                        eyelog_error(job.status)
+                        );
+            else if (verbose && !job.skipped)
+                printf("%s -> %s\n", job.input.c_str(), job.output.c_str());
+        }
+    };
+    vector<thread> threads;
+    for (unsigned i = 0; i < nthreads; i++)
+        threads.push_back(thread(work));
+    for (auto& t : threads)
+        t.join();
+    double seconds = chrono::duration<double>(
+            chrono::steady_clock::now() - start
+            ).count();
+
+    unsigned converted = 0, skipped = 0, failed = 0;
+    double bytes = 0, nentries = 0;
+    for (const auto& job : jobs) {
+        if (job.status) {
+            failed++;
+            ret = job.status;
+        }
+        else if (job.skipped) {
+            skipped++;
+        }
+        else {
+            converted++;
+            bytes += job.size;
+            nentries += job.nentries;
+        }
+    }
+
+    printf("converted %u, up to date %u, failed %u files with %u threads\n",
+           converted, skipped, failed, nthreads
+           );
+    printf("%.1f MB, %.0f entries in %.2f s: %.1f MB/s, %.0f entries/s, "
+           "%.1f files/s\n",
+           bytes / (1024 * 1024), nentries, seconds,
+           seconds > 0 ? bytes / (1024 * 1024) / seconds : 0,
+           seconds > 0 ? nentries / seconds : 0,
+           seconds > 0 ? converted / seconds : 0
+           );
+
+    return ret ? EXIT_FAILURE : EXIT_SUCCESS;
+}
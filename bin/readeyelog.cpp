@@ -52,10 +52,11 @@ using namespace std;
 std::string usage = "%s [options] <intput> [output]\n\
 \n\
     arguments are input is mandatory and output is optional\n\
-    unless -b is specified, then output is mandatory aswell\n\
+    unless -b or -z is specified, then output is mandatory aswell\n\
 \n\
     options are:\n\
         -b      write in binary mode output must be specified.\n\
+        -z      write in compressed binary mode output must be specified.\n\
         -csv    write in csv form\n";
 
 String input;
@@ -63,6 +64,7 @@ String output;
 
 bool write_csv(true);
 bool write_binary(false);
+bool write_compressed(false);
 bool write_stdout(true);
 
 
@@ -87,6 +89,12 @@ void parse_cmd(int argc, char** argv) {
         write_binary = true;
         write_csv = false;
     }
+    else if (arg1 == "-z") {
+        has_option = true;
+        write_binary = true;
+        write_compressed = true;
+        write_csv = false;
+    }
     else if(arg1 == "-csv") {
         has_option = true;
     }
@@ -127,8 +135,14 @@ int main(int argc, char **argv) {
         // set to binary mode to always write '\n' as line ending
         SET_BINARY_MODE(stdout); 
         auto entries = log.getEntries();
+        PCsvWriter writer(cout);
         for (const auto& e : entries)
-            cout << e->toString().c_str() << '\n';
+            writer.write(*e);
+        ret = writer.flush();
+        if (ret) {
+            cerr << "unable to write: " << eyelog_error(ret) << endl;
+            return EXIT_FAILURE;
+        }
     } else {
         ret = log.open(output);
         if (ret) {
@@ -138,6 +152,8 @@ int main(int argc, char **argv) {
         }
         if (write_csv)
             ret = log.write(FORMAT_CSV);
+        else if (write_compressed)
+            ret = log.write(FORMAT_BINARY_V2);
         else
             ret = log.write(FORMAT_BINARY);
         
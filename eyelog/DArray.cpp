@@ -1,6 +1,7 @@
 
 #include "DArray.h"
 #include <cassert>
+#include <new>
 #include <utility>
 
 
@@ -41,12 +42,13 @@ DArray<T>::DArray(DArray&& other) noexcept
 template <class T>
 DArray<T>::DArray(const T* begin, const T* end)
     :
-        m_items(nullptr)
+        m_items(nullptr),
+        m_size(0),
+        m_capacity(0)
 {
-    m_size = end - begin;
-    m_setCapacity(m_size);
-    for (auto it = &m_items[0]; it < &m_items[0] + m_size; ++it)
-        *it=*begin++;
+    m_setCapacity(end - begin);
+    for (; begin < end; ++begin)
+        new (&m_items[m_size++]) T(*begin);
 }
 
 template <class T>
@@ -57,7 +59,8 @@ DArray<T>::DArray(size_type n)
         m_capacity(0)
 {
     m_setCapacity(n);
-    m_size = n;
+    for (; m_size < n; ++m_size)
+        new (&m_items[m_size]) T();
 }
 
 template <class T>
@@ -68,10 +71,8 @@ DArray<T>::DArray(size_type n, const T& value)
         m_capacity(0)
 {
     m_setCapacity(n);
-    for (size_type i = 0; i < m_capacity; ++i) {
-        m_items[i] = value;
-    }
-    m_size = n;
+    for (; m_size < n; ++m_size)
+        new (&m_items[m_size]) T(value);
 }
 
 template <class T>
@@ -79,11 +80,9 @@ DArray<T>& DArray<T>::operator=(const DArray& other)
 {
     if (&other != this) {
         clear();
-        m_items = new T[other.size()];
-        m_capacity = other.size();
-        m_size = other.size();
-        for (size_type i = 0; i < other.size(); i++)
-            m_items[i] = other[i];
+        m_setCapacity(other.size());
+        for (; m_size < other.size(); ++m_size)
+            new (&m_items[m_size]) T(other[m_size]);
     }
     
     return *this;
@@ -111,24 +110,45 @@ DArray<T>::~DArray()
     clear();
 }
 
+/*
+ * Reallocates the storage, only the first m_size items are constructed.
+ * The items are moved to the new storage, unless moving might throw. The
+ * old items are only destroyed once all are in the new storage, so when
+ * a copy throws the array is left as it was.
+ *
+ * m_size is read before operator new, the compiler must assume that the
+ * call changes the members. Then it also knows that the items fit.
+ */
 template <class T>
 void DArray<T>::m_setCapacity(size_type n)
 {
-    if (!m_items) {
-        m_items = new T[n];
-    } else {
-        T* temp = new T[n];
-        T* ts = &temp[0];
-        T* is = &m_items[0];
-        for ( ;is < &m_items[0]+m_size; ++ts, ++is) {
-            *ts = *is;
-        }
-        delete[] m_items;
-        m_items = temp;
+    const size_type size = m_size;
+    assert(n >= size);
+    T* temp = n ? static_cast<T*>(::operator new(n * sizeof(T))) : nullptr;
+    size_type i = 0;
+    try {
+        for (; i < size; ++i)
+            new (&temp[i]) T(std::move_if_noexcept(m_items[i]));
     }
+    catch (...) {
+        while (i > 0)
+            temp[--i].~T();
+        ::operator delete(temp);
+        throw;
+    }
+    for (i = 0; i < size; ++i)
+        m_items[i].~T();
+    ::operator delete(m_items);
+    m_items = temp;
     m_capacity = n;
 }
 
+template <class T>
+void DArray<T>::m_grow()
+{
+    m_setCapacity(m_size == 0 ? 1 : m_size * 2);
+}
+
 template <class T>
 typename DArray<T>::size_type DArray<T>::size()const
 {
@@ -161,22 +181,39 @@ template <class T>
 void DArray<T>::push_back(const T& ref)
 {
     if(m_capacity <= m_size) {
-        size_type newsize = m_size == 0 ? 1 : m_size * 2;
-        m_setCapacity(newsize);
+        // ref might be an item of this array.
+        T copy(ref);
+        m_grow();
+        new (&m_items[m_size++]) T(std::move(copy));
+        return;
+    }
+    new (&m_items[m_size++]) T(ref);
+}
+
+template <class T>
+void DArray<T>::push_back(T&& ref)
+{
+    if(m_capacity <= m_size) {
+        T temp(std::move(ref));
+        m_grow();
+        new (&m_items[m_size++]) T(std::move(temp));
+        return;
     }
-    m_items[m_size++] = ref;
+    new (&m_items[m_size++]) T(std::move(ref));
 }
 
 template <class T>
 void DArray<T>::pop_back(void)
 {
-    --m_size;
+    m_items[--m_size].~T();
 }
 
 template <class T>
 void DArray<T>::clear()
 {
-    delete[] m_items;
+    for (size_type i = 0; i < m_size; ++i)
+        m_items[i].~T();
+    ::operator delete(m_items);
     m_items = nullptr;
     m_size=0;
     m_capacity=0;
@@ -198,19 +235,23 @@ template <class T>
 void DArray<T>::resize(size_type n, const T& value)
 {
     if (n < m_size) { // shrinking
-        m_size = n;
+        while (m_size > n)
+            m_items[--m_size].~T();
         if (m_capacity/2 >= m_size) {
             m_setCapacity(m_size);
         }
     }
     else if (n > m_size) { // expanding
         if (n > m_capacity) {
+            // value might be an item of this array.
+            T copy(value);
             m_setCapacity(m_capacity*2>n ? m_capacity*2 : n);
+            for (; m_size < n; m_size++)
+                new (&m_items[m_size]) T(copy);
+            return;
         }
-        for (size_type i = m_size; i < n; i++) {
-            m_items[i] = value;
-        }
-        m_size = n;
+        for (; m_size < n; m_size++)
+            new (&m_items[m_size]) T(value);
     }
     else {
         // Nothing to do, resizing to equal size.
@@ -252,7 +293,7 @@ void DArray<T>::insert(iterator pos, const_iterator beg_it, const_iterator end_i
     iterator it = begin() + size() - 1;
     iterator revend = it - nmove;
     for ( ; it > revend; --it) {
-        *it = *(it - move_dist);
+        *it = std::move(*(it - move_dist));
     }
 
     it = begin() + ins_pos;
@@ -23,6 +23,8 @@
 #   define DARRAY_H 1
 
 #include <cstddef>
+#include <new>
+#include <utility>
 #include "eyelog_export.h"
 
 template <class T>
@@ -49,6 +51,14 @@ class EYELOG_EXPORT DArray {
         ~DArray();
 
         void push_back(const T& ref);
+        void push_back(T&& ref);
+
+        /**
+         * Constructs a new item at the end of the array from args.
+         */
+        template <class... Args>
+        void emplace_back(Args&&... args);
+
         void pop_back(void);
 
         size_type   size()const;
@@ -79,12 +89,31 @@ class EYELOG_EXPORT DArray {
     private :
 
         void m_setCapacity(size_type n);
+        void m_grow();
 
     private :
 
-        T*          m_items;
+        T*          m_items;    // raw storage for m_capacity items.
         size_type   m_size;
         size_type   m_capacity;
 };
 
+/*
+ * Member templates aren't part of the instantiations in the library,
+ * therefore emplace_back is defined here.
+ */
+template <class T>
+template <class... Args>
+void DArray<T>::emplace_back(Args&&... args)
+{
+    if (m_capacity <= m_size) {
+        // args might refer to items of this array.
+        T temp(std::forward<Args>(args)...);
+        m_grow();
+        new (&m_items[m_size++]) T(std::move(temp));
+        return;
+    }
+    new (&m_items[m_size++]) T(std::forward<Args>(args)...);
+}
+
 #endif
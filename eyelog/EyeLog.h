@@ -29,6 +29,24 @@
 #include "PCoordinate.h"
 #include "PExperiment.h"
 #include "PEyeLog.h"
+#include "PMappedLog.h"
+#include "PEntrySink.h"
+#include "PSampleStore.h"
+#include "PAscReader.h"
+#include "PTextScanner.h"
+#include "PLogReader.h"
+#include "PBinaryWriter.h"
+#include "PCsvWriter.h"
+#include "PEntryArena.h"
+#include "PTrialIndex.h"
+#include "PTimeIndex.h"
+#include "PLogMerger.h"
+#include "PEventDetector.h"
+#include "PGazeKernels.h"
+#include "PBinocularAverager.h"
+#include "PCompressedLog.h"
+#include "PThreadPool.h"
+#include "PTrialAnalysis.h"
 #include "TypeDefs.h"
 #include "cError.h"
 
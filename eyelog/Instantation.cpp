@@ -29,6 +29,10 @@
 template class DArray<char>; // the underlying allocator for Base string.
 template class BaseString<char>;
 
+// Templates to the columns of a PSampleStore.
+template class DArray<float>;
+template class DArray<double>;
+
 // Template to a dynamic array of strings.
 template class DArray <BaseString<char> >;
 
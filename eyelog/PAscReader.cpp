@@ -0,0 +1,355 @@
+/*
+ * PAscReader.cpp
+ *
+ * This file is part of libeye and reads EyeLink .asc files.
+ *
+ * Copyright (C) 2016  Maarten Duijndam
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "PAscReader.h"
+#include "PBinocularAverager.h"
+#include "PEyeLogEntry.h"
+#include "PMappedFile.h"
+#include "PTextScanner.h"
+#include "cError.h"
+
+using namespace std;
+
+/*
+ * Chunks smaller than this are not worth a thread.
+ */
+static const size_t MIN_CHUNK_SIZE = 1 << 20;
+
+/*
+ * Every thread gets a few chunks, so that a chunk with many events
+ * doesn't keep the others waiting.
+ */
+static const unsigned CHUNKS_PER_THREAD = 4;
+
+/*
+ * eye of a monocular sample before the first SAMPLES line in a chunk.
+ */
+static const int EYE_UNRESOLVED = -1;
+
+/*
+ * One parsed line, either an entry or a gaze sample.
+ */
+struct AscItem {
+    PEyeLogEntry*   entry;  // nullptr for a gaze sample.
+    double          time;
+    float           x;
+    float           y;
+    float           pupil;
+    int             eye;    // LGAZE, RGAZE, AVGGAZE or EYE_UNRESOLVED
+};
+
+/*
+ * The result of one chunk.
+ */
+struct AscChunk {
+    const char*         begin;
+    const char*         end;
+    vector<AscItem>     items;
+    bool                samples_seen;   // chunk contains a SAMPLES line.
+    bool                isleft;         // value after the last SAMPLES line.
+    bool                average;        // ASC_AVERAGE_EYES
+};
+
+static void addGazeItem(AscChunk& chunk,
+                        int eye,
+                        double time,
+                        float x,
+                        float y,
+                        float pupil
+                        )
+{
+    AscItem item = {nullptr, time, x, y, pupil, eye};
+    chunk.items.push_back(item);
+}
+
+static void addEntryItem(AscChunk& chunk, PEyeLogEntry* entry)
+{
+    AscItem item = {entry, 0, 0, 0, 0, 0};
+    chunk.items.push_back(item);
+}
+
+static bool tokenIs(const char* begin, const char* end, const char* word)
+{
+    size_t n = strlen(word);
+    return size_t(end - begin) == n && memcmp(begin, word, n) == 0;
+}
+
+static bool isDigits(const char* begin, const char* end)
+{
+    for (; begin < end; begin++) {
+        if (*begin < '0' || *begin > '9')
+            return false;
+    }
+    return true;
+}
+
+/*
+ * Reads a value of a sample, a missing value, ".", is read as NaN.
+ */
+static bool readSampleValue(PTextScanner& scanner, float& value)
+{
+    if (scanner.readFloat(value))
+        return true;
+    const char *token, *tokenend;
+    PTextScanner copy(scanner);
+    if (copy.readToken(token, tokenend) && tokenIs(token, tokenend, ".")) {
+        scanner = copy;
+        value = NAN;
+        return true;
+    }
+    return false;
+}
+
+/*
+ * Parses one line, lines it doesn't understand are ignored.
+ */
+static void parseAscLine(const char* begin, const char* end, AscChunk& chunk)
+{
+    PTextScanner scanner(begin, end);
+    const char *token, *tokenend;
+
+    scanner.readToken(token, tokenend);
+
+    if (isDigits(token, tokenend)) { // either bi or monocular sample
+        float v[6] = {0, 0, 0, 0, 0, 0};
+        double time = 0;
+        PTextScanner(token, tokenend).readDouble(time);
+        int matched = 0;
+        if (chunk.average) {
+            // Both eyes go into one AVGGAZE sample, no need to resolve
+            // the eye of monocular samples.
+            while (matched < 6 && readSampleValue(scanner, v[matched]))
+                matched++;
+            if (matched == 6)
+                averageSample(v, v + 3, v);
+            if (matched >= 3)
+                addGazeItem(chunk, AVGGAZE, time, v[0], v[1], v[2]);
+            return;
+        }
+        while (matched < 6 && scanner.readFloat(v[matched]))
+            matched++;
+        if (matched >= 3 && matched < 6) { // monocular sample
+            int eye = EYE_UNRESOLVED;
+            if (chunk.samples_seen)
+                eye = chunk.isleft ? LGAZE : RGAZE;
+            addGazeItem(chunk, eye, time, v[0], v[1], v[2]);
+        }
+        else if (matched == 6) { // binocular sample
+            addGazeItem(chunk, LGAZE, time, v[0], v[1], v[2]);
+            addGazeItem(chunk, RGAZE, time, v[3], v[4], v[5]);
+        }
+    }
+    else if (tokenIs(token, tokenend, "EFIX")) {
+        const char *c, *cend;
+        double tstart, tend, dur;
+        float x, y;
+        if (scanner.readToken(c, cend)   &&
+            scanner.readDouble(tstart)   &&
+            scanner.readDouble(tend)     &&
+            scanner.readDouble(dur)      &&
+            scanner.readFloat(x)         &&
+            scanner.readFloat(y)
+            )
+        {
+            addEntryItem(chunk,
+                         new PFixationEntry(tokenIs(c, cend, "L") ? LFIX : RFIX,
+                                            tstart,
+                                            dur,
+                                            x,
+                                            y
+                                            )
+                         );
+        }
+    }
+    else if (tokenIs(token, tokenend, "MSG")) {
+        double time;
+        const char *msg, *msgend;
+        if (!scanner.readDouble(time))
+            return;
+
+        // remove leading and trailing whitespace
+        scanner.skipSpace();
+        scanner.readLine(msg, msgend);
+        while (msgend > msg && PTextScanner::isSpace(msgend[-1]))
+            msgend--;
+
+        addEntryItem(chunk, new PMessageEntry(time, String(msg, msgend)));
+    }
+    else if (tokenIs(token, tokenend, "SAMPLES")) {
+        const char *gaze, *gazeend, *side, *sideend;
+        if (scanner.readToken(gaze, gazeend) &&
+            scanner.readToken(side, sideend)
+            )
+        {
+            if (!tokenIs(gaze, gazeend, "GAZE"))
+                return;
+            chunk.samples_seen = true;
+            chunk.isleft = tokenIs(side, sideend, "RIGHT");
+        }
+    }
+}
+
+static void parseAscChunk(AscChunk& chunk)
+{
+    const char* line = chunk.begin;
+    while (line < chunk.end) {
+        const char* eol = static_cast<const char*>(
+                memchr(line, '\n', chunk.end - line)
+                );
+        if (!eol)
+            eol = chunk.end;
+        parseAscLine(line, eol, chunk);
+        line = eol + 1;
+    }
+}
+
+/*
+ * Cuts the buffer in n chunks, the chunks end just after a newline.
+ */
+static void splitChunks(const char* begin,
+                        const char* end,
+                        unsigned n,
+                        bool average,
+                        vector<AscChunk>& chunks
+                        )
+{
+    size_t size = (end - begin) / n;
+    const char* pos = begin;
+    while (pos < end) {
+        AscChunk chunk;
+        const char* stop = end - pos > ptrdiff_t(size) ? pos + size : end;
+        if (stop < end) {
+            const char* eol = static_cast<const char*>(
+                    memchr(stop, '\n', end - stop)
+                    );
+            stop = eol ? eol + 1 : end;
+        }
+        chunk.begin = pos;
+        chunk.end = stop;
+        chunk.samples_seen = false;
+        chunk.isleft = false;
+        chunk.average = average;
+        chunks.push_back(std::move(chunk));
+        pos = stop;
+    }
+}
+
+int readAscBuffer(PEntrySink* out,
+                  const char* begin,
+                  const char* end,
+                  unsigned nthreads
+                  )
+{
+    bool isleft = false;
+    return readAscBuffer(out, begin, end, nthreads, &isleft);
+}
+
+int readAscBuffer(PEntrySink* out,
+                  const char* begin,
+                  const char* end,
+                  unsigned nthreads,
+                  bool* isleft,
+                  unsigned flags
+                  )
+{
+    vector<AscChunk> chunks;
+    unsigned long nentries = 0;
+
+    if (nthreads == 0)
+        nthreads = std::thread::hardware_concurrency();
+    if (nthreads == 0)
+        nthreads = 1;
+
+    size_t size = end - begin;
+    unsigned nchunks = nthreads * CHUNKS_PER_THREAD;
+    if (size / nchunks < MIN_CHUNK_SIZE)
+        nchunks = unsigned(size / MIN_CHUNK_SIZE) + 1;
+    if (nthreads > nchunks)
+        nthreads = nchunks;
+
+    splitChunks(begin, end, nchunks, (flags & ASC_AVERAGE_EYES) != 0, chunks);
+
+    if (nthreads <= 1) {
+        for (auto& chunk : chunks)
+            parseAscChunk(chunk);
+    }
+    else {
+        std::atomic<unsigned> next(0);
+        vector<std::thread> threads;
+        auto work = [&chunks, &next] () {
+            unsigned i;
+            while ((i = next++) < chunks.size())
+                parseAscChunk(chunks[i]);
+        };
+        for (unsigned i = 0; i < nthreads; i++)
+            threads.push_back(std::thread(work));
+        for (auto& t : threads)
+            t.join();
+    }
+
+    // Merge the chunks in order. Monocular samples that preceded the
+    // first SAMPLES line of their chunk get the eye of the previous chunks.
+    for (auto& chunk : chunks) {
+        for (const auto& item : chunk.items) {
+            if (item.entry) {
+                out->addEntry(item.entry);
+            }
+            else {
+                entrytype eye = item.eye == EYE_UNRESOLVED ?
+                    (*isleft ? LGAZE : RGAZE) : entrytype(item.eye);
+                out->addGaze(eye, item.time, item.x, item.y, item.pupil);
+            }
+        }
+        nentries += chunk.items.size();
+        if (chunk.samples_seen)
+            *isleft = chunk.isleft;
+        vector<AscItem>().swap(chunk.items);
+    }
+
+    return nentries > 0 ? 0 : ERR_INVALID_FILE_FORMAT;
+}
+
+int readAscLog(PEntrySink* out,
+               const String& filename,
+               unsigned nthreads,
+               unsigned flags
+               )
+{
+    PMappedFile file;
+    int ret = file.open(filename);
+    if (ret)
+        return ret;
+    bool isleft = false;
+    return readAscBuffer(out,
+                         file.data(),
+                         file.data() + file.size(),
+                         nthreads,
+                         &isleft,
+                         flags
+                         );
+}
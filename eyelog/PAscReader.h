@@ -0,0 +1,100 @@
+/*
+ * PAscReader.h
+ *
+ * Public header that provides a reader for EyeLink .asc files.
+ *
+ * Copyright (c) 2016 M.J.A. Duijndam.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see Licenses at www.gnu.org.
+ */
+
+/**
+ * \file PAscReader.h
+ *
+ * The .asc files of EyeLink are line based, every line is a sample or an
+ * event that doesn't depend on the previous lines. The only exception is
+ * the "SAMPLES GAZE LEFT/RIGHT" line that tells to which eye the
+ * monocular samples that follow belong. This makes it possible to cut the
+ * file in chunks at line boundaries and to parse the chunks in parallel.
+ * The monocular samples before the first SAMPLES line of a chunk get
+ * their eye afterwards, from the setting of the preceding chunks.
+ */
+
+#ifndef PASC_READER_H
+#define PASC_READER_H
+
+#include "TypeDefs.h"
+#include "constants.h"
+#include "PEntrySink.h"
+
+/**
+ * Parses the contents of an .asc file in memory.
+ *
+ * The entries are delivered to out in the order of the lines in the
+ * buffer, no matter how many threads are used.
+ *
+ * @param out       receives the parsed entries.
+ * @param begin     first character of the buffer.
+ * @param end       one past the last character of the buffer.
+ * @param nthreads  number of threads to use, 0 uses one per core.
+ *
+ * @return 0 or ERR_INVALID_FILE_FORMAT when nothing was understood.
+ */
+EYELOG_EXPORT int readAscBuffer(PEntrySink* out,
+                                const char* begin,
+                                const char* end,
+                                unsigned nthreads=0
+                                );
+
+/**
+ * Parses a piece of an .asc file in memory.
+ *
+ * This allows to read an .asc file in pieces, the setting of the SAMPLES
+ * line is carried from one piece to the next in isleft. Every piece must
+ * end at a line boundary.
+ *
+ * @param isleft    [in,out] the SAMPLES setting at the start of the
+ *                  piece, on return the setting at the end. Start with
+ *                  false at the beginning of a file.
+ * @param flags     asc_read_flags, with ASC_AVERAGE_EYES the samples are
+ *                  delivered as AVGGAZE, a missing eye, ".", is ignored
+ *                  like averageSample does.
+ *
+ * @return 0 or ERR_INVALID_FILE_FORMAT when nothing was understood.
+ */
+EYELOG_EXPORT int readAscBuffer(PEntrySink* out,
+                                const char* begin,
+                                const char* end,
+                                unsigned nthreads,
+                                bool* isleft,
+                                unsigned flags=ASC_DEFAULT
+                                );
+
+/**
+ * Reads an .asc file with multiple threads.
+ *
+ * @param out       receives the parsed entries.
+ * @param filename  the name of the .asc file.
+ * @param nthreads  number of threads to use, 0 uses one per core.
+ * @param flags     asc_read_flags, see readAscBuffer.
+ *
+ * @return 0, an errno value or ERR_INVALID_FILE_FORMAT.
+ */
+EYELOG_EXPORT int readAscLog(PEntrySink* out,
+                             const String& filename,
+                             unsigned nthreads=0,
+                             unsigned flags=ASC_DEFAULT
+                             );
+
+#endif
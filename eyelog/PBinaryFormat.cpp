@@ -0,0 +1,416 @@
+/*
+ * PBinaryFormat.cpp
+ *
+ * This file is part of libeye and reads and writes binary log headers.
+ *
+ * Copyright (C) 2016  Maarten Duijndam
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cerrno>
+#include <cstring>
+#include "PBinaryFormat.h"
+#include "PTrialIndex.h"
+#include "PTimeIndex.h"
+#include "cError.h"
+
+const char BINARY_MAGIC[] = "\x89" "EYELOG\n";
+const char INDEX_MAGIC[] = "EYEINDEX";
+
+void encodeBinaryHeader(char* out, uint16_t flags, uint16_t version)
+{
+    memset(out, 0, BINARY_HEADER_SIZE);
+    memcpy(out, BINARY_MAGIC, BINARY_MAGIC_SIZE);
+    memcpy(out + 8, &version, sizeof(version));
+    memcpy(out + 10, &flags, sizeof(flags));
+}
+
+int writeBinaryHeader(std::ostream& stream, uint16_t flags, uint16_t version)
+{
+    char header[BINARY_HEADER_SIZE];
+    encodeBinaryHeader(header, flags, version);
+
+    if (!stream.write(header, sizeof(header)))
+        return errno;
+    return 0;
+}
+
+bool hasBinaryMagic(const char* data, std::size_t size)
+{
+    return size >= BINARY_MAGIC_SIZE &&
+           memcmp(data, BINARY_MAGIC, BINARY_MAGIC_SIZE) == 0;
+}
+
+int readBinaryHeader(const char* data,
+                     std::size_t size,
+                     PBinaryHeader* header,
+                     std::size_t* offset
+                     )
+{
+    if (!hasBinaryMagic(data, size)) {
+        header->version = 0;
+        header->flags = 0;
+        *offset = 0;
+        return 0;
+    }
+    if (size < BINARY_HEADER_SIZE)
+        return ERR_INVALID_FILE_FORMAT;
+
+    memcpy(&header->version, data + 8, sizeof(header->version));
+    memcpy(&header->flags, data + 10, sizeof(header->flags));
+    if (header->version > BINARY_VERSION ||
+        (header->flags & ~BINARY_KNOWN_FLAGS) != 0
+        )
+        return ERR_INVALID_FILE_FORMAT;
+
+    *offset = BINARY_HEADER_SIZE;
+    return 0;
+}
+
+/*
+ * Reads a length prefixed string at offset, returns false if it doesn't
+ * fit in avail bytes. end is set to the first byte after the string.
+ */
+static bool stringEnd(const char* record,
+                      std::size_t offset,
+                      std::size_t avail,
+                      std::size_t* end
+                      )
+{
+    uint32_t n;
+    if (avail < offset + sizeof(n))
+        return false;
+    memcpy(&n, record + offset, sizeof(n));
+    if (avail - offset - sizeof(n) < n)
+        return false;
+    *end = offset + sizeof(n) + n;
+    return true;
+}
+
+std::size_t binaryRecordSize(const char* p, std::size_t avail, entrytype* et)
+{
+    uint16_t type;
+    std::size_t size = 0;
+
+    if (avail < RECORD_TYPE_SIZE)
+        return 0;
+    memcpy(&type, p, sizeof(type));
+    *et = entrytype(type);
+    if (avail < RECORD_HEADER_SIZE)
+        return 0;
+
+    if (type == INDEX_RECORD_TYPE) {
+        if (!stringEnd(p, RECORD_HEADER_SIZE, avail, &size))
+            return 0;
+        return size;
+    }
+
+    switch (*et) {
+        case LGAZE:
+        case RGAZE:
+        case AVGGAZE:
+            size = GAZE_RECORD_SIZE;
+            break;
+        case LFIX:
+        case RFIX:
+        case AVGFIX:
+            size = FIX_RECORD_SIZE;
+            break;
+        case LSAC:
+        case RSAC:
+        case AVGSAC:
+            size = SAC_RECORD_SIZE;
+            break;
+        case MESSAGE:
+            if (!stringEnd(p, RECORD_HEADER_SIZE, avail, &size))
+                return 0;
+            break;
+        case TRIAL:
+            if (!stringEnd(p, RECORD_HEADER_SIZE, avail, &size))
+                return 0;
+            if (!stringEnd(p, size, avail, &size))
+                return 0;
+            break;
+        case TRIALSTART:
+        case TRIALEND:
+            size = RECORD_HEADER_SIZE;
+            break;
+        default:
+            return 0;
+    }
+    return size <= avail ? size : 0;
+}
+
+bool isBinaryRecordType(uint16_t type)
+{
+    switch (entrytype(type)) {
+        case LGAZE:
+        case RGAZE:
+        case AVGGAZE:
+        case LFIX:
+        case RFIX:
+        case LSAC:
+        case RSAC:
+        case AVGFIX:
+        case AVGSAC:
+        case MESSAGE:
+        case TRIAL:
+        case TRIALSTART:
+        case TRIALEND:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool isIndexRecord(const char* p)
+{
+    uint16_t type;
+    memcpy(&type, p, sizeof(type));
+    return type == INDEX_RECORD_TYPE;
+}
+
+template <class T>
+static void append(std::vector<char>& out, const T& value)
+{
+    const char* p = reinterpret_cast<const char*>(&value);
+    out.insert(out.end(), p, p + sizeof(value));
+}
+
+static void appendString(std::vector<char>& out, const String& s)
+{
+    append(out, uint32_t(s.size()));
+    out.insert(out.end(), s.c_str(), s.c_str() + s.size());
+}
+
+/*
+ * Reads a T at pos and advances pos, returns false if it doesn't fit.
+ */
+template <class T>
+static bool take(const char* data, std::size_t n, std::size_t& pos, T* value)
+{
+    if (n - pos < sizeof(T))
+        return false;
+    memcpy(value, data + pos, sizeof(T));
+    pos += sizeof(T);
+    return true;
+}
+
+static bool takeString(const char* data,
+                       std::size_t n,
+                       std::size_t& pos,
+                       String* s
+                       )
+{
+    uint32_t len;
+    if (!take(data, n, pos, &len) || n - pos < len)
+        return false;
+    *s = String(data + pos, data + pos + len);
+    pos += len;
+    return true;
+}
+
+void encodeBinaryIndex(std::vector<char>& out,
+                       const PTrialIndex& trials,
+                       const PBlockIndex& blocks,
+                       uint64_t nentries,
+                       uint64_t offset
+                       )
+{
+    append(out, INDEX_RECORD_TYPE);
+    append(out, double(0));
+    append(out, uint32_t(0)); // the size, filled in below.
+    std::size_t payload = out.size();
+    append(out, nentries);
+
+    append(out, INDEX_SECTION_TRIALS);
+    append(out, uint32_t(0));
+    std::size_t section = out.size();
+    append(out, uint32_t(trials.size()));
+    for (std::size_t i = 0; i < trials.size(); i++) {
+        const PTrialIndex::Trial& t = trials[i];
+        append(out, t.time);
+        append(out, uint64_t(t.begin));
+        append(out, t.start == PTrialIndex::npos ? UINT64_MAX : uint64_t(t.start));
+        append(out, t.end == PTrialIndex::npos ? UINT64_MAX : uint64_t(t.end));
+        appendString(out, t.identifier);
+        appendString(out, t.group);
+    }
+    uint32_t n = uint32_t(out.size() - section);
+    memcpy(&out[section - sizeof(n)], &n, sizeof(n));
+
+    append(out, INDEX_SECTION_BLOCKS);
+    append(out, uint32_t(0));
+    section = out.size();
+    append(out, uint32_t(blocks.size()));
+    for (std::size_t i = 0; i < blocks.size(); i++) {
+        append(out, blocks[i].offset);
+        append(out, blocks[i].first);
+        append(out, blocks[i].tmin);
+        append(out, blocks[i].tmax);
+    }
+    n = uint32_t(out.size() - section);
+    memcpy(&out[section - sizeof(n)], &n, sizeof(n));
+
+    append(out, offset);
+    out.insert(out.end(), INDEX_MAGIC, INDEX_MAGIC + INDEX_MAGIC_SIZE);
+    n = uint32_t(out.size() - payload);
+    memcpy(&out[payload - sizeof(n)], &n, sizeof(n));
+}
+
+bool findBinaryIndex(const char* data,
+                     std::size_t size,
+                     const char** payload,
+                     std::size_t* n
+                     )
+{
+    PBinaryHeader header;
+    std::size_t first;
+    uint64_t offset;
+    entrytype et;
+
+    if (readBinaryHeader(data, size, &header, &first) != 0 ||
+        !(header.flags & BINARY_FLAG_INDEX) ||
+        size < first + RECORD_HEADER_SIZE + sizeof(uint32_t) + INDEX_TRAILER_SIZE
+        )
+        return false;
+    if (memcmp(data + size - INDEX_MAGIC_SIZE, INDEX_MAGIC, INDEX_MAGIC_SIZE))
+        return false;
+    memcpy(&offset, data + size - INDEX_TRAILER_SIZE, sizeof(offset));
+    if (offset < first || offset >= size)
+        return false;
+
+    // The record must be an index record that ends the file.
+    const char* p = data + offset;
+    if (binaryRecordSize(p, size - offset, &et) != size - offset ||
+        !isIndexRecord(p)
+        )
+        return false;
+
+    const std::size_t skip = RECORD_HEADER_SIZE + sizeof(uint32_t);
+    *payload = p + skip;
+    *n = size - offset - skip - INDEX_TRAILER_SIZE;
+    return true;
+}
+
+/*
+ * Looks up the section with tag in the payload of an index record, data
+ * is set to nullptr when there is no such section.
+ */
+static int findSection(const char* payload,
+                       std::size_t n,
+                       uint32_t tag,
+                       uint64_t* nentries,
+                       const char** data,
+                       std::size_t* size
+                       )
+{
+    std::size_t pos = 0;
+
+    *data = nullptr;
+    *size = 0;
+    if (!take(payload, n, pos, nentries))
+        return ERR_INVALID_FILE_FORMAT;
+
+    while (pos < n) {
+        uint32_t t, sz;
+        if (!take(payload, n, pos, &t) ||
+            !take(payload, n, pos, &sz) ||
+            n - pos < sz
+            )
+            return ERR_INVALID_FILE_FORMAT;
+
+        // Other sections, also those unknown to this version, are skipped.
+        if (t == tag) {
+            *data = payload + pos;
+            *size = sz;
+            return 0;
+        }
+        pos += sz;
+    }
+    return 0;
+}
+
+int decodeBinaryIndex(const char* payload, std::size_t n, PTrialIndex* trials)
+{
+    uint64_t nentries;
+    const char* data;
+    std::size_t size, p = 0;
+    uint32_t count;
+
+    trials->clear();
+    int ret = findSection(payload, n, INDEX_SECTION_TRIALS,
+                          &nentries, &data, &size
+                          );
+    if (ret || !data)
+        return ret;
+
+    if (!take(data, size, p, &count))
+        return ERR_INVALID_FILE_FORMAT;
+    for (uint32_t i = 0; i < count; i++) {
+        PTrialIndex::Trial t;
+        uint64_t begin, start, end;
+        if (!take(data, size, p, &t.time) ||
+            !take(data, size, p, &begin) ||
+            !take(data, size, p, &start) ||
+            !take(data, size, p, &end) ||
+            !takeString(data, size, p, &t.identifier) ||
+            !takeString(data, size, p, &t.group) ||
+            begin >= nentries ||
+            (end > nentries && end != UINT64_MAX)
+            )
+            return ERR_INVALID_FILE_FORMAT;
+        t.begin = std::size_t(begin);
+        t.start = start == UINT64_MAX ? PTrialIndex::npos : std::size_t(start);
+        t.end = end == UINT64_MAX ? PTrialIndex::npos : std::size_t(end);
+        trials->addTrial(t);
+    }
+    return 0;
+}
+
+int decodeBinaryBlocks(const char* payload, std::size_t n, PBlockIndex* blocks)
+{
+    uint64_t nentries;
+    const char* data;
+    std::size_t size, p = 0;
+    uint32_t count;
+
+    blocks->clear();
+    int ret = findSection(payload, n, INDEX_SECTION_BLOCKS,
+                          &nentries, &data, &size
+                          );
+    if (ret || !data)
+        return ret;
+
+    if (!take(data, size, p, &count))
+        return ERR_INVALID_FILE_FORMAT;
+    for (uint32_t i = 0; i < count; i++) {
+        PBlockIndex::Block b;
+        if (!take(data, size, p, &b.offset) ||
+            !take(data, size, p, &b.first) ||
+            !take(data, size, p, &b.tmin) ||
+            !take(data, size, p, &b.tmax) ||
+            b.first >= nentries ||
+            (i > 0 && (b.offset <= (*blocks)[i - 1].offset ||
+                       b.first <= (*blocks)[i - 1].first))
+            ) {
+            blocks->clear();
+            return ERR_INVALID_FILE_FORMAT;
+        }
+        blocks->addBlock(b);
+    }
+    return 0;
+}
@@ -0,0 +1,229 @@
+/*
+ * PBinaryFormat.h
+ *
+ * Private header that describes the header of binary logfiles.
+ *
+ * Copyright (c) 2016 M.J.A. Duijndam.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see Licenses at www.gnu.org.
+ */
+
+/**
+ * \file PBinaryFormat.h
+ *
+ * Binary logfiles start with a header of BINARY_HEADER_SIZE bytes:
+ *
+ *  offset  size    contents
+ *  0       8       BINARY_MAGIC
+ *  8       2       uint16_t version
+ *  10      2       uint16_t flags
+ *  12      4       reserved, 0
+ *
+ * The records follow directly after the header. Files written by older
+ * versions of libeye lack the header and start with the first record,
+ * they are still read. The first byte of the magic is not an entrytype
+ * and not ASCII, so the header can't be mistaken for a record or text.
+ *
+ * Every record starts with a uint16_t type and a double time, followed by
+ * the fields of the entry, see the writeBinary methods of the entries. The
+ * fields are not aligned, hence all reads go through memcpy.
+ *
+ * A file with BINARY_FLAG_INDEX in its header may contain index records,
+ * they are not entries and skipped by the readers. An index record is
+ * written after the last entry of a new file:
+ *
+ *  size    contents
+ *  2       uint16_t INDEX_RECORD_TYPE
+ *  8       double time, 0
+ *  4       uint32_t n, the size of the rest of the record
+ *  8       uint64_t the number of entries before the index
+ *  ...     sections, each a uint32_t tag, a uint32_t size and the data
+ *  8       uint64_t the offset of the index record in the file
+ *  8       INDEX_MAGIC
+ *
+ * The last 16 bytes make it possible to find the index from the end of
+ * the file. The INDEX_SECTION_TRIALS section contains a uint32_t count
+ * followed by the trials: double time, uint64_t begin, start and end,
+ * and the identifier and group as length prefixed strings. A start or
+ * end that is not known is stored as UINT64_MAX. The INDEX_SECTION_BLOCKS
+ * section contains a uint32_t count followed by the blocks of a
+ * PBlockIndex: uint64_t offset and first and double tmin and tmax.
+ *
+ * This header is not installed.
+ */
+
+#ifndef PBINARY_FORMAT_H
+#define PBINARY_FORMAT_H
+
+#include <cstddef>
+#include <ostream>
+#include <vector>
+#include <stdint.h>
+#include "constants.h"
+
+class PTrialIndex;
+class PBlockIndex;
+
+extern const char       BINARY_MAGIC[];
+const std::size_t       BINARY_MAGIC_SIZE   = 8;
+const std::size_t       BINARY_HEADER_SIZE  = 16;
+
+/**
+ * The version written by this libeye, files with a newer version
+ * are rejected. Version 2 files contain compressed blocks instead of
+ * records, see PCompressedFormat.h.
+ */
+const uint16_t          BINARY_VERSION      = 1;
+
+/**
+ * The file may contain index records.
+ */
+const uint16_t          BINARY_FLAG_INDEX   = 1;
+
+/**
+ * The flags this version understands, files with other flags are rejected.
+ */
+const uint16_t          BINARY_KNOWN_FLAGS  = BINARY_FLAG_INDEX;
+
+const std::size_t       RECORD_TYPE_SIZE    = sizeof(uint16_t);
+const std::size_t       RECORD_HEADER_SIZE  = RECORD_TYPE_SIZE + sizeof(double);
+const std::size_t       GAZE_RECORD_SIZE    = RECORD_HEADER_SIZE +
+                                              3 * sizeof(float);
+const std::size_t       FIX_RECORD_SIZE     = RECORD_HEADER_SIZE +
+                                              sizeof(double) +
+                                              2 * sizeof(float);
+const std::size_t       SAC_RECORD_SIZE     = RECORD_HEADER_SIZE +
+                                              sizeof(double) +
+                                              4 * sizeof(float);
+
+const uint16_t          INDEX_RECORD_TYPE   = 0xffff;
+extern const char       INDEX_MAGIC[];
+const std::size_t       INDEX_MAGIC_SIZE    = 8;
+const std::size_t       INDEX_TRAILER_SIZE  = sizeof(uint64_t) + INDEX_MAGIC_SIZE;
+const uint32_t          INDEX_SECTION_TRIALS= 1;
+const uint32_t          INDEX_SECTION_BLOCKS= 2;
+
+struct PBinaryHeader {
+    uint16_t version;
+    uint16_t flags;
+};
+
+/**
+ * Stores a header in the BINARY_HEADER_SIZE bytes at out.
+ *
+ * @param version   BINARY_VERSION or the version of another format that
+ *                  uses the same header.
+ */
+void encodeBinaryHeader(char* out,
+                        uint16_t flags=0,
+                        uint16_t version=BINARY_VERSION
+                        );
+
+/**
+ * Writes the header at the current position of stream.
+ *
+ * @return 0 or an errno value.
+ */
+int writeBinaryHeader(std::ostream& stream,
+                      uint16_t flags=0,
+                      uint16_t version=BINARY_VERSION
+                      );
+
+/**
+ * Tests whether data starts with BINARY_MAGIC.
+ */
+bool hasBinaryMagic(const char* data, std::size_t size);
+
+/**
+ * Reads the header at the start of data.
+ *
+ * @param [out] header  the version and flags of the file.
+ * @param [out] offset  the offset of the first record, 0 for a file
+ *                      without header.
+ *
+ * @return 0 or ERR_INVALID_FILE_FORMAT if the header is truncated or
+ *         written by a newer libeye.
+ */
+int readBinaryHeader(const char* data,
+                     std::size_t size,
+                     PBinaryHeader* header,
+                     std::size_t* offset
+                     );
+
+/**
+ * Determines the size of the record at p.
+ *
+ * @param [out] et the type of the record, if at least the type fits in avail.
+ *
+ * @return the size of the record or 0 when the type is unknown or the
+ *         record extends beyond avail bytes.
+ */
+std::size_t binaryRecordSize(const char* p, std::size_t avail, entrytype* et);
+
+/**
+ * Tests whether type is a type of record that can be read.
+ */
+bool isBinaryRecordType(uint16_t type);
+
+/**
+ * Tests whether the record at p, of which binaryRecordSize returned the
+ * size, is an index record instead of an entry.
+ */
+bool isIndexRecord(const char* p);
+
+/**
+ * Appends an index record to out.
+ *
+ * @param trials    the trials of the file.
+ * @param blocks    the block index of the file.
+ * @param nentries  the number of entries in the file.
+ * @param offset    the offset in the file at which the record is written.
+ */
+void encodeBinaryIndex(std::vector<char>& out,
+                       const PTrialIndex& trials,
+                       const PBlockIndex& blocks,
+                       uint64_t nentries,
+                       uint64_t offset
+                       );
+
+/**
+ * Looks for an index record at the end of a binary file.
+ *
+ * @param data  the complete file.
+ * @param [out] payload the contents of the index record after its size.
+ * @param [out] n       the size of the payload.
+ *
+ * @return true if the file ends with an index record.
+ */
+bool findBinaryIndex(const char* data,
+                     std::size_t size,
+                     const char** payload,
+                     std::size_t* n
+                     );
+
+/**
+ * Decodes the trials of an index record found by findBinaryIndex.
+ *
+ * @return 0 or ERR_INVALID_FILE_FORMAT.
+ */
+int decodeBinaryIndex(const char* payload, std::size_t n, PTrialIndex* trials);
+
+/**
+ * Decodes the block index of an index record found by findBinaryIndex.
+ *
+ * @return 0 or ERR_INVALID_FILE_FORMAT.
+ */
+int decodeBinaryBlocks(const char* payload, std::size_t n, PBlockIndex* blocks);
+
+#endif
@@ -0,0 +1,381 @@
+/*
+ * PBinaryWriter.cpp
+ *
+ * This file is part of libeye and writes binary logfiles in big blocks.
+ *
+ * Copyright (C) 2016  Maarten Duijndam
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "libeye-config.h"
+#include <cassert>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <stdint.h>
+#include "PBinaryWriter.h"
+#include "PBinaryFormat.h"
+
+#if defined(HAVE_UNISTD_H)
+#   define USE_POSIX_IO 1
+#   include <fcntl.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+
+/*
+ * O_DIRECT wants the buffer, the file offset and the size of every write
+ * aligned to the logical block size of the device, 4096 covers all
+ * common devices.
+ */
+static const std::size_t DIRECT_ALIGN = 4096;
+
+template <class T>
+static inline char* put(char* p, const T& value)
+{
+    memcpy(p, &value, sizeof(value));
+    return p + sizeof(value);
+}
+
+static inline char* putString(char* p, const String& s)
+{
+    uint32_t n = uint32_t(s.size());
+    p = put(p, n);
+    if (n)
+        memcpy(p, s.c_str(), n);
+    return p + n;
+}
+
+static inline char* putHeader(char* p, const PEyeLogEntry& e)
+{
+    uint16_t type = uint16_t(e.getEntryType());
+    p = put(p, type);
+    return put(p, e.getTime());
+}
+
+PBinaryWriter::PBinaryWriter()
+    : m_storage(nullptr),
+      m_buffer(nullptr),
+      m_capacity(0),
+      m_size(0),
+      m_written(0),
+      m_count(0),
+      m_hasindex(false),
+      m_stream(nullptr),
+      m_fd(-1),
+      m_direct(false),
+      m_status(0)
+{
+}
+
+PBinaryWriter::~PBinaryWriter()
+{
+    close();
+    free(m_storage);
+}
+
+int PBinaryWriter::open(const String& filename, unsigned flags)
+{
+    close();
+    m_status = 0;
+
+#if defined(USE_POSIX_IO)
+    int oflags = O_WRONLY | O_CREAT | O_TRUNC;
+    const mode_t mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH;
+#   if defined(O_DIRECT)
+    if (flags & WRITE_DIRECT) {
+        m_fd = ::open(filename.c_str(), oflags | O_DIRECT, mode);
+        m_direct = m_fd >= 0;
+    }
+#   endif
+    // e.g. tmpfs refuses O_DIRECT with EINVAL.
+    if (m_fd < 0)
+        m_fd = ::open(filename.c_str(), oflags, mode);
+    if (m_fd < 0)
+        return errno;
+#else
+    (void) flags;
+    m_file.open(filename.c_str(), std::ios::out | std::ios::binary);
+    if (!m_file.is_open())
+        return errno;
+    m_stream = &m_file;
+#endif
+
+    int ret = reserve(BINARY_HEADER_SIZE);
+    if (ret)
+        return ret;
+    encodeBinaryHeader(m_buffer, BINARY_FLAG_INDEX);
+    m_size = BINARY_HEADER_SIZE;
+    m_hasindex = true;
+    return 0;
+}
+
+int PBinaryWriter::open(std::ostream& stream)
+{
+    close();
+    m_status = 0;
+    m_stream = &stream;
+
+    if (stream.tellp() == std::ostream::pos_type(0)) {
+        int ret = reserve(BINARY_HEADER_SIZE);
+        if (ret)
+            return ret;
+        encodeBinaryHeader(m_buffer, BINARY_FLAG_INDEX);
+        m_size = BINARY_HEADER_SIZE;
+        m_hasindex = true;
+    }
+    return 0;
+}
+
+int PBinaryWriter::write(const PEyeLogEntry& e)
+{
+    const uint64_t offset = m_written + m_size;
+    std::size_t size;
+    String s1, s2;
+    char* p;
+
+    if (m_status)
+        return m_status;
+    assert(isOpen());
+
+    switch (e.getEntryType()) {
+        case LGAZE:
+        case RGAZE:
+        case AVGGAZE:
+            {
+                const PGazeEntry& g = static_cast<const PGazeEntry&>(e);
+                if ((m_status = reserve(GAZE_RECORD_SIZE)) != 0)
+                    return m_status;
+                p = putHeader(m_buffer + m_size, e);
+                p = put(p, g.getX());
+                p = put(p, g.getY());
+                p = put(p, g.getPupil());
+            }
+            break;
+        case LFIX:
+        case RFIX:
+        case AVGFIX:
+            {
+                const PFixationEntry& f = static_cast<const PFixationEntry&>(e);
+                if ((m_status = reserve(FIX_RECORD_SIZE)) != 0)
+                    return m_status;
+                p = putHeader(m_buffer + m_size, e);
+                p = put(p, f.getDuration());
+                p = put(p, f.getX());
+                p = put(p, f.getY());
+            }
+            break;
+        case LSAC:
+        case RSAC:
+        case AVGSAC:
+            {
+                const PSaccadeEntry& s = static_cast<const PSaccadeEntry&>(e);
+                if ((m_status = reserve(SAC_RECORD_SIZE)) != 0)
+                    return m_status;
+                p = putHeader(m_buffer + m_size, e);
+                p = put(p, s.getDuration());
+                p = put(p, s.getX1());
+                p = put(p, s.getY1());
+                p = put(p, s.getX2());
+                p = put(p, s.getY2());
+            }
+            break;
+        case MESSAGE:
+            s1 = static_cast<const PMessageEntry&>(e).getMessage();
+            size = RECORD_HEADER_SIZE + sizeof(uint32_t) + s1.size();
+            if ((m_status = reserve(size)) != 0)
+                return m_status;
+            p = putHeader(m_buffer + m_size, e);
+            p = putString(p, s1);
+            break;
+        case TRIAL:
+            s1 = static_cast<const PTrialEntry&>(e).getIdentifier();
+            s2 = static_cast<const PTrialEntry&>(e).getGroup();
+            size = RECORD_HEADER_SIZE + 2 * sizeof(uint32_t) +
+                   s1.size() + s2.size();
+            if ((m_status = reserve(size)) != 0)
+                return m_status;
+            p = putHeader(m_buffer + m_size, e);
+            p = putString(p, s1);
+            p = putString(p, s2);
+            break;
+        default:
+            // Just like PEyeLogEntry::writeBinary.
+            if ((m_status = reserve(RECORD_HEADER_SIZE)) != 0)
+                return m_status;
+            p = putHeader(m_buffer + m_size, e);
+    }
+
+    m_size = std::size_t(p - m_buffer);
+    assert(m_size <= m_capacity);
+    if (m_hasindex) {
+        m_index.addEntry(e, m_count);
+        m_blocks.addEntry(e.getTime(), offset);
+    }
+    m_count++;
+    return 0;
+}
+
+int PBinaryWriter::write(const PEntryVec& entries)
+{
+    for (const auto* e : entries) {
+        int ret = write(*e);
+        if (ret)
+            return ret;
+    }
+    return 0;
+}
+
+int PBinaryWriter::flush()
+{
+    if (m_status)
+        return m_status;
+    if (m_direct)
+        return writeOut(m_size - m_size % DIRECT_ALIGN);
+    return writeOut(m_size);
+}
+
+int PBinaryWriter::close()
+{
+    if (!isOpen())
+        return m_status;
+
+    if (m_hasindex && m_status == 0) {
+        std::vector<char> record;
+        encodeBinaryIndex(record,
+                          m_index,
+                          m_blocks,
+                          m_count,
+                          m_written + m_size
+                          );
+        if ((m_status = reserve(record.size())) == 0) {
+            memcpy(m_buffer + m_size, record.data(), record.size());
+            m_size += record.size();
+        }
+    }
+
+#if defined(USE_POSIX_IO) && defined(O_DIRECT)
+    // The tail is not a whole block, write it through the page cache.
+    if (m_direct && m_status == 0 && m_size % DIRECT_ALIGN) {
+        int fl = fcntl(m_fd, F_GETFL);
+        if (fl == -1 || fcntl(m_fd, F_SETFL, fl & ~O_DIRECT) == -1)
+            m_status = errno;
+        m_direct = false;
+    }
+#endif
+    if (m_status == 0)
+        writeOut(m_size);
+
+    if (m_stream) {
+        if (!m_stream->flush() && m_status == 0)
+            m_status = errno;
+        if (m_stream == &m_file)
+            m_file.close();
+        m_stream = nullptr;
+    }
+#if defined(USE_POSIX_IO)
+    if (m_fd >= 0) {
+        if (::close(m_fd) != 0 && m_status == 0)
+            m_status = errno;
+        m_fd = -1;
+    }
+#endif
+    m_direct = false;
+    m_size = 0;
+    m_written = 0;
+    m_index.clear();
+    m_blocks.clear();
+    m_count = 0;
+    m_hasindex = false;
+    return m_status;
+}
+
+bool PBinaryWriter::isOpen() const
+{
+    return m_stream != nullptr || m_fd >= 0;
+}
+
+/*
+ * Makes room for n more bytes, by writing the buffer or when that's
+ * not enough by growing the buffer.
+ */
+int PBinaryWriter::reserve(std::size_t n)
+{
+    if (m_size + n <= m_capacity)
+        return 0;
+    if (m_size > 0) {
+        int ret = flush();
+        if (ret)
+            return ret;
+        if (m_size + n <= m_capacity)
+            return 0;
+    }
+
+    std::size_t capacity = m_capacity ? m_capacity : BUFFER_SIZE;
+    while (capacity < m_size + n)
+        capacity *= 2;
+
+    char* storage = static_cast<char*>(malloc(capacity + DIRECT_ALIGN));
+    if (!storage)
+        return ENOMEM;
+    char* buffer = storage + (DIRECT_ALIGN -
+                   reinterpret_cast<uintptr_t>(storage) % DIRECT_ALIGN);
+    if (m_size)
+        memcpy(buffer, m_buffer, m_size);
+    free(m_storage);
+    m_storage = storage;
+    m_buffer = buffer;
+    m_capacity = capacity;
+    return 0;
+}
+
+/*
+ * Writes the first n bytes of the buffer and moves the rest to the front.
+ */
+int PBinaryWriter::writeOut(std::size_t n)
+{
+    assert(n <= m_size);
+    if (n == 0)
+        return m_status;
+
+    if (m_stream) {
+        if (!m_stream->write(m_buffer, n))
+            m_status = errno ? errno : EIO;
+    }
+#if defined(USE_POSIX_IO)
+    else {
+        std::size_t done = 0;
+        while (done < n) {
+            ssize_t w = ::write(m_fd, m_buffer + done, n - done);
+            if (w < 0) {
+                if (errno == EINTR)
+                    continue;
+                m_status = errno;
+                break;
+            }
+            done += std::size_t(w);
+        }
+    }
+#endif
+    if (m_status)
+        return m_status;
+
+    memmove(m_buffer, m_buffer + n, m_size - n);
+    m_size -= n;
+    m_written += n;
+    return 0;
+}
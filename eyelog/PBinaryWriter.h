@@ -0,0 +1,149 @@
+/*
+ * PBinaryWriter.h
+ *
+ * Public header that provides a buffered writer for binary logfiles.
+ *
+ * Copyright (c) 2016 M.J.A. Duijndam.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see Licenses at www.gnu.org.
+ */
+
+#ifndef PBINARY_WRITER_H
+#define PBINARY_WRITER_H
+
+#include <cstddef>
+#include <fstream>
+#include <ostream>
+#include <stdint.h>
+#include "TypeDefs.h"
+#include "constants.h"
+#include "PEyeLogEntry.h"
+#include "PTrialIndex.h"
+#include "PTimeIndex.h"
+
+/**
+ * PBinaryWriter serializes entries in the binary format into a large
+ * buffer and writes the buffer in big blocks.
+ *
+ * The output is identical to that of PEyeLogEntry::writeBinary, but
+ * instead of a few stream writes per record, there is one write per
+ * BUFFER_SIZE bytes.
+ *
+ * The writer either writes to a file it opens itself, or to a stream
+ * of the caller. A file opened with WRITE_DIRECT is written with O_DIRECT
+ * on systems and file systems that support it, so a long recording
+ * doesn't push everything else out of the page cache.
+ *
+ * When the writer starts a new file, it writes the header, keeps a
+ * PTrialIndex and a PBlockIndex of the entries and closes the file with
+ * an index record.
+ */
+class EYELOG_EXPORT PBinaryWriter {
+
+public:
+
+    /**
+     * Size of the write buffer in bytes.
+     */
+    static const std::size_t BUFFER_SIZE = 1 << 20;
+
+    PBinaryWriter();
+
+    /**
+     * Closes the writer, the buffered records are written.
+     */
+    ~PBinaryWriter();
+
+    /**
+     * Creates or truncates filename and writes the header.
+     *
+     * @param flags WRITE_DIRECT or WRITE_BUFFERED.
+     *
+     * @return 0 or an errno value.
+     */
+    int open(const String& filename, unsigned flags=WRITE_BUFFERED);
+
+    /**
+     * Writes to stream, the header is written if stream is at the start.
+     *
+     * The stream must outlive the writer or the call to close().
+     *
+     * @return 0 or an errno value.
+     */
+    int open(std::ostream& stream);
+
+    /**
+     * Appends one record to the buffer, the buffer is written when full.
+     *
+     * @return 0 or an errno value.
+     */
+    int write(const PEyeLogEntry& entry);
+
+    /**
+     * Appends a record for every entry.
+     *
+     * @return 0 or an errno value.
+     */
+    int write(const PEntryVec& entries);
+
+    /**
+     * Writes the contents of the buffer.
+     *
+     * With WRITE_DIRECT only whole blocks can be written, the remainder
+     * stays in the buffer until close().
+     *
+     * @return 0 or an errno value.
+     */
+    int flush();
+
+    /**
+     * Writes the index record if the writer wrote the header, writes the
+     * buffer and closes the file.
+     *
+     * @return 0 or the first error that occurred since open.
+     */
+    int close();
+
+    /**
+     * @return true if the writer has an open file or stream.
+     */
+    bool isOpen() const;
+
+private:
+
+    PBinaryWriter(const PBinaryWriter&);
+    PBinaryWriter& operator=(const PBinaryWriter&);
+
+    int reserve(std::size_t n);
+    int writeOut(std::size_t n);
+
+    char*           m_storage;  // allocated memory.
+    char*           m_buffer;   // m_storage aligned for O_DIRECT.
+    std::size_t     m_capacity;
+    std::size_t     m_size;     // bytes in use.
+    uint64_t        m_written;  // bytes written before the buffer.
+
+    PTrialIndex     m_index;
+    PBlockIndex     m_blocks;
+    std::size_t     m_count;    // entries written.
+    bool            m_hasindex; // the file gets an index record.
+
+    std::ostream*   m_stream;   // when writing to a stream.
+    std::ofstream   m_file;     // file opened without POSIX io.
+    int             m_fd;       // file opened with POSIX io.
+    bool            m_direct;   // m_fd is opened with O_DIRECT.
+    int             m_status;
+};
+
+#endif
@@ -0,0 +1,135 @@
+/*
+ * PBinocularAverager.cpp
+ *
+ * This file is part of libeye and averages the gaze samples of both
+ * eyes.
+ *
+ * Copyright (C) 2016  Maarten Duijndam
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cassert>
+#include <cmath>
+#include "PBinocularAverager.h"
+#include "PEyeLogEntry.h"
+#include "PGazeKernels.h"
+
+/*
+ * The same tolerance PEyeLogEntry::compare uses for equal times.
+ */
+const double PBinocularAverager::PAIR_TOLERANCE = 1e-6;
+
+void averageSample(const float* left, const float* right, float* out)
+{
+    bool noleft = std::isnan(left[0]) || std::isnan(left[1]);
+    bool noright = std::isnan(right[0]) || std::isnan(right[1]);
+    if (noleft == noright) {
+        averageEyes(left, right, 3, out);
+        return;
+    }
+    const float* eye = noleft ? right : left;
+    for (int i = 0; i < 3; i++)
+        out[i] = eye[i];
+}
+
+PBinocularAverager::PBinocularAverager(PEntrySink* out, bool keepeyes)
+    : m_out(out),
+      m_keepeyes(keepeyes),
+      m_hasleft(false),
+      m_hasright(false)
+{
+    assert(out);
+}
+
+PBinocularAverager::~PBinocularAverager()
+{
+    flush();
+}
+
+void PBinocularAverager::addGaze(entrytype eye,
+                                 double time,
+                                 float x,
+                                 float y,
+                                 float pupil
+                                 )
+{
+    if (eye != LGAZE && eye != RGAZE) {
+        flushBefore(eye, time);
+        m_out->addGaze(eye, time, x, y, pupil);
+        return;
+    }
+
+    bool left = eye == LGAZE;
+    // A second sample of the same eye belongs to another time.
+    if ((left && m_hasleft) || (!left && m_hasright))
+        flush();
+    else
+        flushBefore(eye, time);
+
+    Sample sample = {time, {x, y, pupil}};
+    if (left) {
+        m_left = sample;
+        m_hasleft = true;
+    }
+    else {
+        m_right = sample;
+        m_hasright = true;
+    }
+    if (m_keepeyes)
+        m_out->addGaze(eye, time, x, y, pupil);
+}
+
+void PBinocularAverager::addEntry(PEyeLogEntry* entry)
+{
+    entrytype type = entry->getEntryType();
+    if (type == LGAZE || type == RGAZE) {
+        const PGazeEntry* g = static_cast<const PGazeEntry*>(entry);
+        addGaze(type, g->getTime(), g->getX(), g->getY(), g->getPupil());
+        delete entry;
+        return;
+    }
+    flushBefore(type, entry->getTime());
+    m_out->addEntry(entry);
+}
+
+void PBinocularAverager::flush()
+{
+    if (m_hasleft && m_hasright)
+        averageSample(m_left.values, m_right.values, m_left.values);
+    else if (m_hasright)
+        m_left = m_right;
+    if (m_hasleft || m_hasright) {
+        m_out->addGaze(AVGGAZE,
+                       m_left.time,
+                       m_left.values[0],
+                       m_left.values[1],
+                       m_left.values[2]
+                       );
+    }
+    m_hasleft = m_hasright = false;
+}
+
+/*
+ * Flushes the average when an entry of type at time sorts after it.
+ */
+void PBinocularAverager::flushBefore(entrytype type, double time)
+{
+    if (!m_hasleft && !m_hasright)
+        return;
+    double pending = m_hasleft ? m_left.time : m_right.time;
+    if (std::fabs(time - pending) > PAIR_TOLERANCE || type >= AVGGAZE)
+        flush();
+}
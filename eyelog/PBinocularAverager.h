@@ -0,0 +1,131 @@
+/*
+ * PBinocularAverager.h
+ *
+ * Public header that provides the average of the gaze samples of both
+ * eyes.
+ *
+ * Copyright (c) 2016 M.J.A. Duijndam.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see Licenses at www.gnu.org.
+ */
+
+#ifndef PBINOCULAR_AVERAGER_H
+#define PBINOCULAR_AVERAGER_H
+
+#include "constants.h"
+#include "PEntrySink.h"
+
+/**
+ * Averages a sample of the left and the right eye, both {x, y, pupil}.
+ *
+ * An eye of which x or y is NaN is missing, then all three values of the
+ * other eye are used. EyeLink writes a missing eye as ". . 0.0", so
+ * averaging the values one by one would halve the pupil size. When both
+ * eyes are present or both are missing, each value is averaged like
+ * averageEyes does. out may be left or right.
+ */
+EYELOG_EXPORT void averageSample(const float* left,
+                                 const float* right,
+                                 float* out
+                                 );
+
+/**
+ * PBinocularAverager adds AVGGAZE samples to a stream of entries.
+ *
+ * The LGAZE and RGAZE samples that are taken at the same time, within
+ * PAIR_TOLERANCE, are averaged to one AVGGAZE sample with averageSample.
+ * When one eye is missing, the sample of the other eye is used. The
+ * averager only remembers the samples of the current time, so it works in
+ * one pass over a recording of any length.
+ *
+ * When the input is sorted, e.g. because it is read from a file, the
+ * output is sorted as well: the average is passed on after the entries
+ * that sort before an AVGGAZE entry at the same time.
+ *
+ * Usage:
+ * \code
+ *  PEyeLog log;
+ *  PBinocularAverager averager(&log, false);
+ *  int ret = readLog(&averager, "recording.asc");
+ *  averager.flush();
+ * \endcode
+ */
+class EYELOG_EXPORT PBinocularAverager : public PEntrySink {
+
+public:
+
+    /**
+     * The maximum difference in ms between the times of a left and right
+     * sample that belong together.
+     */
+    static const double PAIR_TOLERANCE;
+
+    /**
+     * Creates an averager that passes the entries to out.
+     *
+     * @param out       receives the entries, must outlive the averager.
+     * @param keepeyes  if false the LGAZE and RGAZE samples are dropped
+     *                  and only their average is passed on.
+     */
+    PBinocularAverager(PEntrySink* out, bool keepeyes=true);
+
+    /**
+     * Flushes the last average.
+     */
+    ~PBinocularAverager();
+
+    /**
+     * Receives a gaze sample.
+     */
+    virtual void addGaze(entrytype eye,
+                         double time,
+                         float x,
+                         float y,
+                         float pupil
+                         );
+
+    /**
+     * Receives an entry, gaze samples are handled like addGaze, other
+     * entries are passed on.
+     */
+    virtual void addEntry(PEyeLogEntry* entry);
+
+    /**
+     * Passes the average of the last samples to the output.
+     *
+     * Call it when all entries have been added.
+     */
+    void flush();
+
+private:
+
+    PBinocularAverager(const PBinocularAverager&);
+    PBinocularAverager& operator=(const PBinocularAverager&);
+
+    struct Sample {
+        double  time;
+        float   values[3];  // x, y and pupil
+    };
+
+    void flushBefore(entrytype type, double time);
+
+    PEntrySink* m_out;
+    bool        m_keepeyes;
+    bool        m_hasleft;
+    bool        m_hasright;
+    Sample      m_left;
+    Sample      m_right;
+};
+
+#endif
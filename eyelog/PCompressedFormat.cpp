@@ -0,0 +1,668 @@
+/*
+ * PCompressedFormat.cpp
+ *
+ * This file is part of libeye and encodes and decodes the blocks of
+ * compressed binary logfiles.
+ *
+ * Copyright (C) 2016  Maarten Duijndam
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "libeye-config.h"
+#include <cmath>
+#include <cstring>
+#include "PCompressedFormat.h"
+#include "PCompressedLog.h"
+#include "PBinaryFormat.h"
+#include "PEntrySink.h"
+#include "cError.h"
+
+#if defined(HAVE_ZLIB)
+#   include <zlib.h>
+#endif
+#if defined(HAVE_ZSTD)
+#   include <zstd.h>
+#endif
+#if defined(HAVE_LZ4)
+#   include <lz4.h>
+#endif
+
+/*
+ * A block that claims to be larger than this when decoded is invalid,
+ * it protects against huge allocations for corrupt files.
+ */
+static const uint32_t MAX_RAW_SIZE = 1u << 28;
+
+/*
+ * The most bytes a varint takes.
+ */
+static const std::size_t MAX_VARINT = 10;
+
+/*
+ * Fast, the block data is already small, a higher level gains a few
+ * percent at several times the cost.
+ */
+static const int CODEC_LEVEL = 1;
+
+bool blockCodecSupported(block_codec codec)
+{
+    switch (codec) {
+        case CODEC_NONE:
+            return true;
+#if defined(HAVE_ZLIB)
+        case CODEC_ZLIB:
+            return true;
+#endif
+#if defined(HAVE_LZ4)
+        case CODEC_LZ4:
+            return true;
+#endif
+#if defined(HAVE_ZSTD)
+        case CODEC_ZSTD:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+bool isCompressedBinary(const char* data, std::size_t size)
+{
+    uint16_t version;
+    if (!hasBinaryMagic(data, size) || size < BINARY_HEADER_SIZE)
+        return false;
+    memcpy(&version, data + BINARY_MAGIC_SIZE, sizeof(version));
+    return version == BINARY_VERSION_BLOCKS;
+}
+
+/* **** encoding **** */
+
+template <class T>
+static inline char* put(char* p, const T& value)
+{
+    memcpy(p, &value, sizeof(value));
+    return p + sizeof(value);
+}
+
+static inline char* putVarint(char* p, uint64_t v)
+{
+    while (v >= 0x80) {
+        *p++ = char(uint8_t(v) | 0x80);
+        v >>= 7;
+    }
+    *p++ = char(v);
+    return p;
+}
+
+static inline char* putString(char* p, const String& s)
+{
+    uint32_t n = uint32_t(s.size());
+    p = put(p, n);
+    if (n)
+        memcpy(p, s.c_str(), n);
+    return p + n;
+}
+
+static inline uint64_t zigzag(int64_t v)
+{
+    return (uint64_t(v) << 1) ^ uint64_t(v >> 63);
+}
+
+static inline uint32_t floatBits(float f)
+{
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}
+
+/*
+ * Stores the difference of the bits of value with prev.
+ */
+static inline char* putFloat(char* p, float value, uint32_t& prev)
+{
+    uint32_t bits = floatBits(value);
+    uint32_t d = bits - prev;
+    prev = bits;
+    return putVarint(p, (d << 1) ^ uint32_t(int32_t(d) >> 31));
+}
+
+/*
+ * The index of the previous values of the samples of an eye.
+ */
+static inline int eyeIndex(entrytype type)
+{
+    return type == LGAZE ? 0 : type == RGAZE ? 1 : 2;
+}
+
+/*
+ * Tests whether time is a whole number of ticks, that converts back
+ * to exactly the same double.
+ */
+static bool timeInTicks(double time, int64_t* ticks)
+{
+    double t = time * TICKS_PER_MS;
+    if (!(std::fabs(t) < 9007199254740992.0)) // 2^53, also false for NaN
+        return false;
+    *ticks = int64_t(std::llround(t));
+    return double(*ticks) / TICKS_PER_MS == time;
+}
+
+/*
+ * The maximum number of bytes entry takes in the decoded data.
+ */
+static std::size_t maxEntrySize(const PEyeLogEntry& e)
+{
+    const std::size_t header = 1 + MAX_VARINT;
+    switch (e.getEntryType()) {
+        case LGAZE:
+        case RGAZE:
+        case AVGGAZE:
+            return header + 3 * MAX_VARINT;
+        case LFIX:
+        case RFIX:
+        case AVGFIX:
+            return header + FIX_RECORD_SIZE - RECORD_HEADER_SIZE;
+        case LSAC:
+        case RSAC:
+        case AVGSAC:
+            return header + SAC_RECORD_SIZE - RECORD_HEADER_SIZE;
+        case MESSAGE:
+            return header + sizeof(uint32_t) +
+                   static_cast<const PMessageEntry&>(e).getMessage().size();
+        case TRIAL:
+            return header + 2 * sizeof(uint32_t) +
+                   static_cast<const PTrialEntry&>(e).getIdentifier().size() +
+                   static_cast<const PTrialEntry&>(e).getGroup().size();
+        default:
+            return header;
+    }
+}
+
+/*
+ * Appends the fields of the entries to raw.
+ */
+static void encodeEntries(const PEyeLogEntry* const* entries,
+                          std::size_t n,
+                          bool ticks,
+                          std::vector<char>& raw
+                          )
+{
+    std::size_t max = 0;
+    for (std::size_t i = 0; i < n; i++)
+        max += maxEntrySize(*entries[i]);
+    raw.resize(max);
+
+    char* p = raw.data();
+    int64_t prevticks = 0;
+    uint32_t prev[3][3] = {{0, 0, 0}, {0, 0, 0}, {0, 0, 0}};
+    for (std::size_t i = 0; i < n; i++) {
+        const PEyeLogEntry& e = *entries[i];
+        entrytype type = e.getEntryType();
+        *p++ = char(uint8_t(type));
+        if (ticks) {
+            int64_t t = 0;
+            timeInTicks(e.getTime(), &t);
+            p = putVarint(p, zigzag(t - prevticks));
+            prevticks = t;
+        }
+        else {
+            p = put(p, e.getTime());
+        }
+
+        switch (type) {
+            case LGAZE:
+            case RGAZE:
+            case AVGGAZE:
+                {
+                    const PGazeEntry& g = static_cast<const PGazeEntry&>(e);
+                    uint32_t* eye = prev[eyeIndex(type)];
+                    p = putFloat(p, g.getX(), eye[0]);
+                    p = putFloat(p, g.getY(), eye[1]);
+                    p = putFloat(p, g.getPupil(), eye[2]);
+                }
+                break;
+            case LFIX:
+            case RFIX:
+            case AVGFIX:
+                {
+                    const PFixationEntry& f =
+                        static_cast<const PFixationEntry&>(e);
+                    p = put(p, f.getDuration());
+                    p = put(p, f.getX());
+                    p = put(p, f.getY());
+                }
+                break;
+            case LSAC:
+            case RSAC:
+            case AVGSAC:
+                {
+                    const PSaccadeEntry& s =
+                        static_cast<const PSaccadeEntry&>(e);
+                    p = put(p, s.getDuration());
+                    p = put(p, s.getX1());
+                    p = put(p, s.getY1());
+                    p = put(p, s.getX2());
+                    p = put(p, s.getY2());
+                }
+                break;
+            case MESSAGE:
+                p = putString(p, static_cast<const PMessageEntry&>(e).getMessage());
+                break;
+            case TRIAL:
+                p = putString(p, static_cast<const PTrialEntry&>(e).getIdentifier());
+                p = putString(p, static_cast<const PTrialEntry&>(e).getGroup());
+                break;
+            default:
+                // Just like the version 1 records, only the type and time.
+                break;
+        }
+    }
+    raw.resize(std::size_t(p - raw.data()));
+}
+
+/*
+ * Compresses raw to out, returns 0 when it didn't work or didn't help.
+ */
+static std::size_t compressData(block_codec codec,
+                            const std::vector<char>& raw,
+                            char* out,
+                            std::size_t capacity
+                            )
+{
+    switch (codec) {
+#if defined(HAVE_ZLIB)
+        case CODEC_ZLIB:
+            {
+                uLongf n = uLongf(capacity);
+                if (compress2(reinterpret_cast<Bytef*>(out),
+                              &n,
+                              reinterpret_cast<const Bytef*>(raw.data()),
+                              uLong(raw.size()),
+                              CODEC_LEVEL
+                              ) != Z_OK)
+                    return 0;
+                return n < raw.size() ? std::size_t(n) : 0;
+            }
+#endif
+#if defined(HAVE_LZ4)
+        case CODEC_LZ4:
+            {
+                int n = LZ4_compress_default(raw.data(),
+                                             out,
+                                             int(raw.size()),
+                                             int(capacity)
+                                             );
+                return n > 0 && std::size_t(n) < raw.size() ? std::size_t(n) : 0;
+            }
+#endif
+#if defined(HAVE_ZSTD)
+        case CODEC_ZSTD:
+            {
+                std::size_t n = ZSTD_compress(out,
+                                              capacity,
+                                              raw.data(),
+                                              raw.size(),
+                                              CODEC_LEVEL
+                                              );
+                return !ZSTD_isError(n) && n < raw.size() ? n : 0;
+            }
+#endif
+        default:
+            (void) raw;
+            (void) out;
+            (void) capacity;
+            return 0;
+    }
+}
+
+static std::size_t compressedBound(block_codec codec, std::size_t n)
+{
+    switch (codec) {
+#if defined(HAVE_ZLIB)
+        case CODEC_ZLIB:
+            return std::size_t(::compressBound(uLong(n)));
+#endif
+#if defined(HAVE_LZ4)
+        case CODEC_LZ4:
+            return std::size_t(LZ4_compressBound(int(n)));
+#endif
+#if defined(HAVE_ZSTD)
+        case CODEC_ZSTD:
+            return ZSTD_compressBound(n);
+#endif
+        default:
+            return 0;
+    }
+}
+
+int encodeBlock(const PEyeLogEntry* const* entries,
+                std::size_t n,
+                block_codec codec,
+                std::vector<char>& out
+                )
+{
+    if (!blockCodecSupported(codec))
+        return ERR_INVALID_PARAMETER;
+
+    PBlockHeader header = {0, 0, uint32_t(n), uint8_t(CODEC_NONE),
+                           BLOCK_TIME_TICKS, NAN, NAN
+                           };
+    // NaN times don't widen the range, they are never inside a range.
+    for (std::size_t i = 0; i < n; i++) {
+        double t = entries[i]->getTime();
+        int64_t ticks;
+        if (std::isnan(header.tmin) || t < header.tmin)
+            header.tmin = t;
+        if (std::isnan(header.tmax) || t > header.tmax)
+            header.tmax = t;
+        if (!timeInTicks(t, &ticks))
+            header.timecoding = BLOCK_TIME_DOUBLE;
+    }
+
+    std::vector<char> raw;
+    encodeEntries(entries, n, header.timecoding == BLOCK_TIME_TICKS, raw);
+    header.rawsize = uint32_t(raw.size());
+
+    std::size_t start = out.size();
+    std::size_t bound = compressedBound(codec, raw.size());
+    out.resize(start + BLOCK_HEADER_SIZE + (bound > raw.size() ? bound : raw.size()));
+    char* data = out.data() + start + BLOCK_HEADER_SIZE;
+    std::size_t size = compressData(codec, raw, data, bound);
+    if (size) {
+        header.codec = uint8_t(codec);
+    }
+    else {
+        size = raw.size();
+        if (size)
+            memcpy(data, raw.data(), size);
+    }
+    header.size = uint32_t(size);
+    out.resize(start + BLOCK_HEADER_SIZE + size);
+
+    char* p = out.data() + start;
+    memset(p, 0, BLOCK_HEADER_SIZE);
+    put(p + 0, header.size);
+    put(p + 4, header.rawsize);
+    put(p + 8, header.nentries);
+    put(p + 12, header.codec);
+    put(p + 13, header.timecoding);
+    put(p + 16, header.tmin);
+    put(p + 24, header.tmax);
+    return 0;
+}
+
+/* **** decoding **** */
+
+std::size_t blockSize(const char* p,
+                      std::size_t avail,
+                      PBlockHeader* header,
+                      int* error
+                      )
+{
+    *error = 0;
+    if (avail < BLOCK_HEADER_SIZE)
+        return 0;
+    memcpy(&header->size, p + 0, sizeof(header->size));
+    memcpy(&header->rawsize, p + 4, sizeof(header->rawsize));
+    memcpy(&header->nentries, p + 8, sizeof(header->nentries));
+    memcpy(&header->codec, p + 12, sizeof(header->codec));
+    memcpy(&header->timecoding, p + 13, sizeof(header->timecoding));
+    memcpy(&header->tmin, p + 16, sizeof(header->tmin));
+    memcpy(&header->tmax, p + 24, sizeof(header->tmax));
+
+    if (header->codec > CODEC_ZSTD ||
+        header->timecoding > BLOCK_TIME_TICKS ||
+        header->rawsize > MAX_RAW_SIZE ||
+        (header->codec == CODEC_NONE && header->size != header->rawsize)
+        ) {
+        *error = ERR_INVALID_FILE_FORMAT;
+        return 0;
+    }
+    if (avail - BLOCK_HEADER_SIZE < header->size)
+        return 0;
+    return BLOCK_HEADER_SIZE + header->size;
+}
+
+/*
+ * Decompresses the stored data of a block to out, which has room for
+ * the decoded size, returns false when that fails.
+ */
+static bool decompressData(const PBlockHeader& header,
+                       const char* data,
+                       char* out
+                       )
+{
+    switch (header.codec) {
+#if defined(HAVE_ZLIB)
+        case CODEC_ZLIB:
+            {
+                uLongf n = uLongf(header.rawsize);
+                return uncompress(reinterpret_cast<Bytef*>(out),
+                                  &n,
+                                  reinterpret_cast<const Bytef*>(data),
+                                  uLong(header.size)
+                                  ) == Z_OK && n == header.rawsize;
+            }
+#endif
+#if defined(HAVE_LZ4)
+        case CODEC_LZ4:
+            return LZ4_decompress_safe(data,
+                                       out,
+                                       int(header.size),
+                                       int(header.rawsize)
+                                       ) == int(header.rawsize);
+#endif
+#if defined(HAVE_ZSTD)
+        case CODEC_ZSTD:
+            return ZSTD_decompress(out,
+                                   header.rawsize,
+                                   data,
+                                   header.size
+                                   ) == header.rawsize;
+#endif
+        default:
+            // A codec this libeye was built without.
+            (void) data;
+            (void) out;
+            return false;
+    }
+}
+
+/*
+ * Reads the decoded data, every get fails once the end has been passed.
+ */
+class PBlockScanner {
+
+public:
+
+    PBlockScanner(const char* begin, const char* end)
+        : m_pos(begin), m_end(end)
+    {}
+
+    bool atEnd() const {return m_pos == m_end;}
+
+    template <class T>
+    bool get(T& value)
+    {
+        if (std::size_t(m_end - m_pos) < sizeof(T))
+            return false;
+        memcpy(&value, m_pos, sizeof(T));
+        m_pos += sizeof(T);
+        return true;
+    }
+
+    bool getVarint(uint64_t& value)
+    {
+        value = 0;
+        for (unsigned shift = 0; shift < 64 && m_pos < m_end; shift += 7) {
+            uint8_t byte = uint8_t(*m_pos++);
+            value |= uint64_t(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                return true;
+        }
+        return false;
+    }
+
+    bool getFloat(float& value, uint32_t& prev)
+    {
+        uint64_t z;
+        if (!getVarint(z) || z > UINT32_MAX)
+            return false;
+        uint32_t d = uint32_t(z >> 1) ^ (0u - uint32_t(z & 1));
+        prev += d;
+        memcpy(&value, &prev, sizeof(value));
+        return true;
+    }
+
+    bool getString(String& s)
+    {
+        uint32_t n;
+        if (!get(n) || std::size_t(m_end - m_pos) < n)
+            return false;
+        s = String(m_pos, m_pos + n);
+        m_pos += n;
+        return true;
+    }
+
+private:
+
+    const char* m_pos;
+    const char* m_end;
+};
+
+/*
+ * Decodes the entries of the decoded data of a block.
+ */
+static int decodeEntries(const PBlockHeader& header,
+                         const char* begin,
+                         const char* end,
+                         PEntrySink* out
+                         )
+{
+    PBlockScanner scanner(begin, end);
+    int64_t ticks = 0;
+    uint32_t prev[3][3] = {{0, 0, 0}, {0, 0, 0}, {0, 0, 0}};
+
+    for (uint32_t i = 0; i < header.nentries; i++) {
+        uint8_t type;
+        double time;
+        if (!scanner.get(type))
+            return ERR_INVALID_FILE_FORMAT;
+        if (header.timecoding == BLOCK_TIME_TICKS) {
+            uint64_t z;
+            if (!scanner.getVarint(z))
+                return ERR_INVALID_FILE_FORMAT;
+            ticks += int64_t(z >> 1) ^ -int64_t(z & 1);
+            time = double(ticks) / TICKS_PER_MS;
+        }
+        else if (!scanner.get(time)) {
+            return ERR_INVALID_FILE_FORMAT;
+        }
+
+        entrytype et = entrytype(type);
+        switch (et) {
+            case LGAZE:
+            case RGAZE:
+            case AVGGAZE:
+                {
+                    float x, y, pupil;
+                    uint32_t* eye = prev[eyeIndex(et)];
+                    if (!scanner.getFloat(x, eye[0]) ||
+                        !scanner.getFloat(y, eye[1]) ||
+                        !scanner.getFloat(pupil, eye[2])
+                        )
+                        return ERR_INVALID_FILE_FORMAT;
+                    out->addGaze(et, time, x, y, pupil);
+                }
+                break;
+            case LFIX:
+            case RFIX:
+            case AVGFIX:
+                {
+                    double dur;
+                    float x, y;
+                    if (!scanner.get(dur) || !scanner.get(x) || !scanner.get(y))
+                        return ERR_INVALID_FILE_FORMAT;
+                    out->addEntry(new PFixationEntry(et, time, dur, x, y));
+                }
+                break;
+            case LSAC:
+            case RSAC:
+            case AVGSAC:
+                {
+                    double dur;
+                    float x1, y1, x2, y2;
+                    if (!scanner.get(dur) ||
+                        !scanner.get(x1) || !scanner.get(y1) ||
+                        !scanner.get(x2) || !scanner.get(y2)
+                        )
+                        return ERR_INVALID_FILE_FORMAT;
+                    out->addEntry(
+                            new PSaccadeEntry(et, time, dur, x1, y1, x2, y2)
+                            );
+                }
+                break;
+            case MESSAGE:
+                {
+                    String msg;
+                    if (!scanner.getString(msg))
+                        return ERR_INVALID_FILE_FORMAT;
+                    out->addEntry(new PMessageEntry(time, msg));
+                }
+                break;
+            case TRIAL:
+                {
+                    String identifier, group;
+                    if (!scanner.getString(identifier) ||
+                        !scanner.getString(group)
+                        )
+                        return ERR_INVALID_FILE_FORMAT;
+                    out->addEntry(new PTrialEntry(time, identifier, group));
+                }
+                break;
+            case TRIALSTART:
+                out->addEntry(new PTrialStartEntry(time));
+                break;
+            case TRIALEND:
+                out->addEntry(new PTrialEndEntry(time));
+                break;
+            default:
+                return ERR_INVALID_FILE_FORMAT;
+        }
+    }
+    return scanner.atEnd() ? 0 : ERR_INVALID_FILE_FORMAT;
+}
+
+int decodeBlock(const char* p,
+                std::size_t size,
+                PEntrySink* out,
+                std::vector<char>& scratch
+                )
+{
+    PBlockHeader header = PBlockHeader();
+    int error;
+    if (blockSize(p, size, &header, &error) != size)
+        return ERR_INVALID_FILE_FORMAT;
+
+    const char* data = p + BLOCK_HEADER_SIZE;
+    if (header.codec != CODEC_NONE) {
+        scratch.resize(header.rawsize);
+        if (!decompressData(header, data, scratch.data()))
+            return ERR_INVALID_FILE_FORMAT;
+        data = scratch.data();
+    }
+    return decodeEntries(header, data, data + header.rawsize, out);
+}
@@ -0,0 +1,153 @@
+/*
+ * PCompressedFormat.h
+ *
+ * Private header that describes the blocks of compressed binary logfiles.
+ *
+ * Copyright (c) 2016 M.J.A. Duijndam.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see Licenses at www.gnu.org.
+ */
+
+/**
+ * \file PCompressedFormat.h
+ *
+ * Compressed binary logfiles, FORMAT_BINARY_V2, start with the header of
+ * PBinaryFormat.h with version BINARY_VERSION_BLOCKS and flags 0. The
+ * entries follow in blocks of at most BLOCK_ENTRIES entries, every block
+ * starts with a header of BLOCK_HEADER_SIZE bytes:
+ *
+ *  offset  size    contents
+ *  0       4       uint32_t the size of the stored data
+ *  4       4       uint32_t the size of the data when decoded
+ *  8       4       uint32_t the number of entries
+ *  12      1       uint8_t the block_codec of the stored data
+ *  13      1       uint8_t the time coding, BLOCK_TIME_*
+ *  14      2       reserved, 0
+ *  16      8       double the smallest time in the block
+ *  24      8       double the largest time in the block
+ *
+ * NaN times are left out of the time range, a block with only NaN times
+ * has a range of NaN.
+ *
+ * The stored data follows the header. Once decompressed, the data
+ * contains the entries one after the other, each a uint8_t type, the
+ * time and the fields:
+ *
+ * - With BLOCK_TIME_TICKS the time is a varint of the zigzag encoded
+ *   difference in ticks of 1 / TICKS_PER_MS ms from the time of the
+ *   previous entry of the block, with BLOCK_TIME_DOUBLE it is a double.
+ * - The x, y and pupil of a gaze sample are varints of the zigzag encoded
+ *   difference of their bits, as uint32_t, with the same field of the
+ *   previous sample of the same eye in the block.
+ * - The fields of the other entries are the same as in version 1
+ *   records, see the writeBinary methods of the entries.
+ *
+ * Varints store 7 bits per byte, least significant first, the high bit
+ * tells that another byte follows. Samples at a fixed rate, of which
+ * the coordinates change slowly, take 1 + 2 + 3 * 2 or 3 bytes before
+ * they are compressed, instead of 22.
+ *
+ * Every block only depends on itself, so blocks can be decoded
+ * separately. The block headers form the block directory of the file,
+ * a reader hops from header to header to find the blocks and their time
+ * ranges, see readCompressedBlocks. The blocks can then be decoded in
+ * parallel, or only those that overlap a time range.
+ *
+ * This header is not installed.
+ */
+
+#ifndef PCOMPRESSED_FORMAT_H
+#define PCOMPRESSED_FORMAT_H
+
+#include <cstddef>
+#include <vector>
+#include <stdint.h>
+#include "constants.h"
+#include "PEyeLogEntry.h"
+
+class PEntrySink;
+
+/**
+ * The version in the header of a compressed binary logfile.
+ */
+const uint16_t          BINARY_VERSION_BLOCKS   = 2;
+
+const std::size_t       BLOCK_HEADER_SIZE       = 32;
+
+/**
+ * The maximum number of entries in a block.
+ */
+const std::size_t       BLOCK_ENTRIES           = 4096;
+
+const uint8_t           BLOCK_TIME_DOUBLE       = 0;
+const uint8_t           BLOCK_TIME_TICKS        = 1;
+const double            TICKS_PER_MS            = 1000.0;
+
+struct PBlockHeader {
+    uint32_t    size;       // stored data
+    uint32_t    rawsize;    // decoded data
+    uint32_t    nentries;
+    uint8_t     codec;
+    uint8_t     timecoding;
+    double      tmin;
+    double      tmax;
+};
+
+/**
+ * Tests whether data starts with the header of a compressed binary log.
+ */
+bool isCompressedBinary(const char* data, std::size_t size);
+
+/**
+ * Appends a block with n entries to out.
+ *
+ * @param codec the block_codec, the data is stored uncompressed when
+ *              compression doesn't make it smaller.
+ *
+ * @return 0 or ERR_INVALID_PARAMETER when codec isn't supported.
+ */
+int encodeBlock(const PEyeLogEntry* const* entries,
+                std::size_t n,
+                block_codec codec,
+                std::vector<char>& out
+                );
+
+/**
+ * Reads the header of the block at p.
+ *
+ * @return the size of the block including its header, or 0 when the
+ *         block extends beyond avail bytes. When the header is invalid,
+ *         error is set to ERR_INVALID_FILE_FORMAT.
+ */
+std::size_t blockSize(const char* p,
+                      std::size_t avail,
+                      PBlockHeader* header,
+                      int* error
+                      );
+
+/**
+ * Decodes the block of size bytes at p and passes its entries to out.
+ *
+ * @param scratch   receives the decompressed data, it can be reused for
+ *                  the next block.
+ *
+ * @return 0 or ERR_INVALID_FILE_FORMAT.
+ */
+int decodeBlock(const char* p,
+                std::size_t size,
+                PEntrySink* out,
+                std::vector<char>& scratch
+                );
+
+#endif
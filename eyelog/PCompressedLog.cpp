@@ -0,0 +1,571 @@
+/*
+ * PCompressedLog.cpp
+ *
+ * This file is part of libeye and reads and writes compressed binary
+ * logfiles.
+ *
+ * Copyright (C) 2016  Maarten Duijndam
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cassert>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include "PCompressedLog.h"
+#include "PCompressedFormat.h"
+#include "PBinaryFormat.h"
+#include "PEyeLog.h"
+#include "PMappedFile.h"
+#include "cError.h"
+
+block_codec defaultBlockCodec()
+{
+    const block_codec best[] = {CODEC_ZSTD, CODEC_ZLIB, CODEC_LZ4};
+    for (block_codec codec : best)
+        if (blockCodecSupported(codec))
+            return codec;
+    return CODEC_NONE;
+}
+
+/* **** PCompressedWriter **** */
+
+PCompressedWriter::PCompressedWriter()
+    : m_codec(defaultBlockCodec()),
+      m_stream(nullptr),
+      m_status(0)
+{
+}
+
+PCompressedWriter::~PCompressedWriter()
+{
+    close();
+}
+
+int PCompressedWriter::setCodec(block_codec codec)
+{
+    if (!blockCodecSupported(codec))
+        return ERR_INVALID_PARAMETER;
+    m_codec = codec;
+    return 0;
+}
+
+block_codec PCompressedWriter::getCodec() const
+{
+    return m_codec;
+}
+
+int PCompressedWriter::open(const String& filename)
+{
+    close();
+    m_status = 0;
+
+    m_file.open(filename.c_str(),
+                std::ios::out | std::ios::binary | std::ios::trunc
+                );
+    if (!m_file.is_open())
+        return errno;
+    m_stream = &m_file;
+    return m_status = writeBinaryHeader(m_file, 0, BINARY_VERSION_BLOCKS);
+}
+
+int PCompressedWriter::open(std::ostream& stream)
+{
+    close();
+    m_status = 0;
+    m_stream = &stream;
+
+    if (stream.tellp() == std::ostream::pos_type(0))
+        m_status = writeBinaryHeader(stream, 0, BINARY_VERSION_BLOCKS);
+    return m_status;
+}
+
+int PCompressedWriter::write(const PEyeLogEntry& entry)
+{
+    if (m_status)
+        return m_status;
+    assert(isOpen());
+
+    m_pending.push_back(entry.clone());
+    if (m_pending.size() == BLOCK_ENTRIES)
+        return flush();
+    return 0;
+}
+
+int PCompressedWriter::write(const PEntryVec& entries)
+{
+    std::size_t i = 0, n = entries.size();
+
+    // Complete the current block first.
+    while (!m_pending.empty() && i < n) {
+        int ret = write(*entries[i++]);
+        if (ret)
+            return ret;
+    }
+    for (; n - i >= BLOCK_ENTRIES; i += BLOCK_ENTRIES) {
+        int ret = writeBlock(&entries[i], BLOCK_ENTRIES);
+        if (ret)
+            return ret;
+    }
+    for (; i < n; i++) {
+        int ret = write(*entries[i]);
+        if (ret)
+            return ret;
+    }
+    return m_status;
+}
+
+int PCompressedWriter::flush()
+{
+    if (m_status || m_pending.empty())
+        return m_status;
+    writeBlock(m_pending.data(), m_pending.size());
+    clearPending();
+    return m_status;
+}
+
+int PCompressedWriter::close()
+{
+    if (!isOpen())
+        return m_status;
+
+    flush();
+    if (!m_stream->flush() && m_status == 0)
+        m_status = errno;
+    if (m_stream == &m_file)
+        m_file.close();
+    m_stream = nullptr;
+    clearPending();
+    return m_status;
+}
+
+bool PCompressedWriter::isOpen() const
+{
+    return m_stream != nullptr;
+}
+
+int PCompressedWriter::writeBlock(const PEyeLogEntry* const* entries,
+                                  std::size_t n
+                                  )
+{
+    if (m_status)
+        return m_status;
+    assert(isOpen());
+
+    m_block.clear();
+    m_status = encodeBlock(entries, n, m_codec, m_block);
+    if (m_status == 0 && !m_stream->write(m_block.data(), m_block.size()))
+        m_status = errno ? errno : EIO;
+    return m_status;
+}
+
+void PCompressedWriter::clearPending()
+{
+    for (auto* e : m_pending)
+        delete e;
+    m_pending.clear();
+}
+
+/* **** reading **** */
+
+/*
+ * Checks the header of the file and returns the offset of the first block.
+ */
+static int firstBlock(const char* data, std::size_t size, std::size_t* first)
+{
+    uint16_t flags;
+    if (!isCompressedBinary(data, size))
+        return ERR_INVALID_FILE_FORMAT;
+    memcpy(&flags, data + BINARY_MAGIC_SIZE + sizeof(uint16_t), sizeof(flags));
+    if (flags != 0)
+        return ERR_INVALID_FILE_FORMAT;
+    *first = BINARY_HEADER_SIZE;
+    return 0;
+}
+
+/*
+ * Checks the headers of all blocks from pos to the end, every block is
+ * added to blocks.
+ */
+static int scanBlocks(const char* data,
+                      std::size_t size,
+                      std::size_t pos,
+                      PBlockIndex* blocks
+                      )
+{
+    PBlockHeader header;
+    PBlockIndex::Block b;
+    int error;
+
+    blocks->clear();
+    b.first = 0;
+    while (pos < size) {
+        std::size_t block = blockSize(data + pos, size - pos, &header, &error);
+        if (!block)
+            return ERR_INVALID_FILE_FORMAT;
+        b.offset = pos;
+        b.tmin = header.tmin;
+        b.tmax = header.tmax;
+        blocks->addBlock(b);
+        b.first += header.nentries;
+        pos += block;
+    }
+    return 0;
+}
+
+/*
+ * @return the number of entries in the blocks.
+ */
+static std::size_t countEntries(const PBlockIndex& blocks,
+                                const char* data,
+                                std::size_t size
+                                )
+{
+    PBlockHeader header;
+    int error;
+
+    if (!blocks.size())
+        return 0;
+    std::size_t last = std::size_t(blocks[blocks.size() - 1].offset);
+    blockSize(data + last, size - last, &header, &error);
+    return std::size_t(blocks[blocks.size() - 1].first) + header.nentries;
+}
+
+/*
+ * @return the size of block n, including its header.
+ */
+static std::size_t blockExtent(const PBlockIndex& blocks,
+                               std::size_t n,
+                               std::size_t size
+                               )
+{
+    std::size_t end = n + 1 < blocks.size() ?
+                      std::size_t(blocks[n + 1].offset) : size;
+    return end - std::size_t(blocks[n].offset);
+}
+
+/*
+ * Decodes the blocks from pos to the end.
+ */
+static int decodeBlocks(PEntrySink* out,
+                        const char* data,
+                        std::size_t size,
+                        std::size_t pos
+                        )
+{
+    std::vector<char> scratch;
+    PBlockHeader header;
+    int error;
+
+    while (pos < size) {
+        std::size_t block = blockSize(data + pos, size - pos, &header, &error);
+        if (!block)
+            return ERR_INVALID_FILE_FORMAT;
+        int ret = decodeBlock(data + pos, block, out, scratch);
+        if (ret)
+            return ret;
+        pos += block;
+    }
+    return 0;
+}
+
+/*
+ * One decoded entry, either an entry or a gaze sample.
+ */
+struct BlockItem {
+    PEyeLogEntry*   entry;  // nullptr for a gaze sample.
+    entrytype       eye;
+    double          time;
+    float           x;
+    float           y;
+    float           pupil;
+};
+
+/*
+ * Collects the entries of one block, so that a thread can decode the
+ * block while the entries still reach the real sink in order.
+ */
+class PBlockItems : public PEntrySink {
+
+public:
+
+    PBlockItems() : status(0) {}
+
+    virtual void addGaze(entrytype eye,
+                         double time,
+                         float x,
+                         float y,
+                         float pupil
+                         )
+    {
+        BlockItem item = {nullptr, eye, time, x, y, pupil};
+        items.push_back(item);
+    }
+
+    virtual void addEntry(PEyeLogEntry* entry)
+    {
+        BlockItem item = {entry, LGAZE, 0, 0, 0, 0};
+        items.push_back(item);
+    }
+
+    /*
+     * Passes the items to out, or deletes them when out is nullptr.
+     */
+    void replay(PEntrySink* out)
+    {
+        for (const auto& item : items) {
+            if (!out)
+                delete item.entry;
+            else if (item.entry)
+                out->addEntry(item.entry);
+            else
+                out->addGaze(item.eye, item.time, item.x, item.y, item.pupil);
+        }
+        std::vector<BlockItem>().swap(items);
+    }
+
+    std::vector<BlockItem>  items;
+    int                     status;
+};
+
+/*
+ * The number of blocks per thread that may be decoded ahead of the block
+ * that is passed to the sink.
+ */
+static const std::size_t BLOCKS_AHEAD = 2;
+
+/*
+ * Decodes the blocks with nthreads threads. The threads decode the
+ * blocks into PBlockItems, which the calling thread passes to out in the
+ * order of the file as soon as they are complete. At most BLOCKS_AHEAD
+ * blocks per thread are decoded but not yet passed on, so the memory
+ * used doesn't grow with the file.
+ *
+ * Like the serial decodeBlocks, the entries of an invalid block up to
+ * the error still reach out, the blocks after it are discarded.
+ */
+static int decodeBlocks(PEntrySink* out,
+                        const char* data,
+                        std::size_t size,
+                        const PBlockIndex& blocks,
+                        unsigned nthreads
+                        )
+{
+    if (nthreads == 0)
+        nthreads = std::thread::hardware_concurrency();
+    if (nthreads > blocks.size())
+        nthreads = unsigned(blocks.size());
+    if (nthreads <= 1)
+        return decodeBlocks(out, data, size, std::size_t(blocks[0].offset));
+
+    // Block i is decoded into slot i % window.
+    const std::size_t window = BLOCKS_AHEAD * nthreads;
+    std::vector<PBlockItems> slots(window);
+    std::vector<char> ready(window, 0);
+    std::mutex mutex;
+    std::condition_variable decoded, freed;
+    std::size_t next = 0, replayed = 0;
+    bool stop = false;
+
+    auto work = [&] () {
+        std::vector<char> scratch;
+        for (;;) {
+            std::size_t i;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                freed.wait(lock, [&] () {
+                    return stop || next >= blocks.size() ||
+                           next < replayed + window;
+                });
+                if (stop || next >= blocks.size())
+                    return;
+                i = next++;
+            }
+            PBlockItems& slot = slots[i % window];
+            slot.status = decodeBlock(data + blocks[i].offset,
+                                      blockExtent(blocks, i, size),
+                                      &slot,
+                                      scratch
+                                      );
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                ready[i % window] = 1;
+            }
+            decoded.notify_all();
+        }
+    };
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < nthreads; i++)
+        threads.push_back(std::thread(work));
+
+    int ret = 0;
+    for (std::size_t i = 0; i < blocks.size() && ret == 0; i++) {
+        PBlockItems& slot = slots[i % window];
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            decoded.wait(lock, [&] () {return ready[i % window] != 0;});
+            ready[i % window] = 0;
+        }
+        ret = slot.status;
+        slot.replay(out);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            replayed = i + 1;
+            stop = ret != 0;
+        }
+        freed.notify_all();
+    }
+
+    for (auto& t : threads)
+        t.join();
+    // Blocks after an invalid one that were decoded already.
+    for (auto& slot : slots)
+        slot.replay(nullptr);
+    return ret;
+}
+
+/*
+ * Passes the entries in [t0, t1) to another sink.
+ */
+class PRangeSink : public PEntrySink {
+
+public:
+
+    PRangeSink(PEntrySink* out, double t0, double t1)
+        : m_out(out), m_t0(t0), m_t1(t1)
+    {}
+
+    virtual void addGaze(entrytype eye,
+                         double time,
+                         float x,
+                         float y,
+                         float pupil
+                         )
+    {
+        if (time >= m_t0 && time < m_t1)
+            m_out->addGaze(eye, time, x, y, pupil);
+    }
+
+    virtual void addEntry(PEyeLogEntry* entry)
+    {
+        double time = entry->getTime();
+        if (time >= m_t0 && time < m_t1)
+            m_out->addEntry(entry);
+        else
+            delete entry;
+    }
+
+private:
+
+    PEntrySink* m_out;
+    double      m_t0;
+    double      m_t1;
+};
+
+/*
+ * Opens filename and reads its block directory.
+ */
+static int openBlocks(PMappedFile& file,
+                      const String& filename,
+                      PBlockIndex* blocks
+                      )
+{
+    std::size_t first;
+    int ret = file.open(filename);
+    if (ret)
+        return ret;
+    ret = firstBlock(file.data(), file.size(), &first);
+    if (ret)
+        return ret;
+    return scanBlocks(file.data(), file.size(), first, blocks);
+}
+
+int readCompressedBuffer(PEntrySink* out, const char* data, std::size_t size)
+{
+    std::size_t first;
+    int ret = firstBlock(data, size, &first);
+    if (ret)
+        return ret;
+    return decodeBlocks(out, data, size, first);
+}
+
+int readCompressedLog(PEyeLog* out, const String& filename, unsigned nthreads)
+{
+    PMappedFile file;
+    PBlockIndex blocks;
+    int ret = openBlocks(file, filename, &blocks);
+    if (ret || !blocks.size())
+        return ret;
+
+    // The blocks are only found to be invalid while they are decoded, then
+    // the entries of the file are removed again.
+    std::size_t nold = out->getEntries().size();
+    PTrialIndex trials(out->getTrialIndex());
+    std::size_t n = countEntries(blocks, file.data(), file.size());
+    out->reserve(unsigned(nold + n));
+    ret = decodeBlocks(out, file.data(), file.size(), blocks, nthreads);
+    if (ret)
+        out->truncate(nold, std::move(trials));
+    return ret;
+}
+
+int readCompressedLog(PEntrySink* out,
+                      const String& filename,
+                      unsigned nthreads
+                      )
+{
+    PMappedFile file;
+    PBlockIndex blocks;
+    int ret = openBlocks(file, filename, &blocks);
+    if (ret || !blocks.size())
+        return ret;
+    return decodeBlocks(out, file.data(), file.size(), blocks, nthreads);
+}
+
+int readCompressedRange(PEntrySink* out,
+                        const String& filename,
+                        double t0,
+                        double t1
+                        )
+{
+    PMappedFile file;
+    PBlockIndex blocks;
+    std::vector<char> scratch;
+    PRangeSink range(out, t0, t1);
+    int ret = openBlocks(file, filename, &blocks);
+
+    for (std::size_t i = 0; ret == 0 && i < blocks.size(); i++) {
+        if (!blocks.overlaps(i, t0, t1))
+            continue;
+        ret = decodeBlock(file.data() + blocks[i].offset,
+                          blockExtent(blocks, i, file.size()),
+                          &range,
+                          scratch
+                          );
+    }
+    return ret;
+}
+
+int readCompressedBlocks(PBlockIndex* out, const String& filename)
+{
+    PMappedFile file;
+    int ret = openBlocks(file, filename, out);
+    if (ret)
+        out->clear();
+    return ret;
+}
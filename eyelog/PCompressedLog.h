@@ -0,0 +1,218 @@
+/*
+ * PCompressedLog.h
+ *
+ * Public header that provides reading and writing compressed binary
+ * logfiles.
+ *
+ * Copyright (c) 2016 M.J.A. Duijndam.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see Licenses at www.gnu.org.
+ */
+
+#ifndef PCOMPRESSED_LOG_H
+#define PCOMPRESSED_LOG_H
+
+#include <cstddef>
+#include <fstream>
+#include <ostream>
+#include <vector>
+#include "TypeDefs.h"
+#include "constants.h"
+#include "PEyeLogEntry.h"
+#include "PEntrySink.h"
+#include "PTimeIndex.h"
+
+class PEyeLog;
+
+/**
+ * @return true when libeye was built with codec.
+ */
+EYELOG_EXPORT bool blockCodecSupported(block_codec codec);
+
+/**
+ * @return the codec that PCompressedWriter uses by default, the
+ *         supported codec that compresses best.
+ */
+EYELOG_EXPORT block_codec defaultBlockCodec();
+
+/**
+ * PCompressedWriter writes entries in the compressed binary format,
+ * FORMAT_BINARY_V2.
+ *
+ * The entries are collected in blocks. The times and gaze samples of a
+ * block are stored as small differences with the previous ones, after
+ * which the block is compressed with the codec. A recording at a fixed
+ * sample rate takes a fraction of the space of FORMAT_BINARY.
+ *
+ * Usually PEyeLog::write(FORMAT_BINARY_V2) is all that is needed, the
+ * writer is for entries that don't live in a PEyeLog, and readLog reads
+ * the result.
+ */
+class EYELOG_EXPORT PCompressedWriter {
+
+public:
+
+    PCompressedWriter();
+
+    /**
+     * Closes the writer, the last block is written.
+     */
+    ~PCompressedWriter();
+
+    /**
+     * Selects the codec for the next blocks.
+     *
+     * @return 0 or ERR_INVALID_PARAMETER when codec isn't supported.
+     */
+    int setCodec(block_codec codec);
+    block_codec getCodec() const;
+
+    /**
+     * Creates or truncates filename and writes the header.
+     *
+     * @return 0 or an errno value.
+     */
+    int open(const String& filename);
+
+    /**
+     * Writes to stream, the header is written if stream is at the start.
+     *
+     * The stream must outlive the writer or the call to close().
+     *
+     * @return 0 or an errno value.
+     */
+    int open(std::ostream& stream);
+
+    /**
+     * Adds a copy of entry to the current block, the block is written
+     * when it is full.
+     *
+     * @return 0 or an errno value.
+     */
+    int write(const PEyeLogEntry& entry);
+
+    /**
+     * Writes all entries, full blocks are encoded without copying them.
+     *
+     * @return 0 or an errno value.
+     */
+    int write(const PEntryVec& entries);
+
+    /**
+     * Writes the current block, even when it isn't full.
+     *
+     * @return 0 or an errno value.
+     */
+    int flush();
+
+    /**
+     * Writes the last block and closes the file.
+     *
+     * @return 0 or the first error that occurred since open.
+     */
+    int close();
+
+    /**
+     * @return true if the writer has an open file or stream.
+     */
+    bool isOpen() const;
+
+private:
+
+    PCompressedWriter(const PCompressedWriter&);
+    PCompressedWriter& operator=(const PCompressedWriter&);
+
+    int writeBlock(const PEyeLogEntry* const* entries, std::size_t n);
+    void clearPending();
+
+    block_codec                 m_codec;
+    std::vector<PEyeLogEntry*>  m_pending;  // copies for the next block.
+    std::vector<char>           m_block;    // the encoded block.
+    std::ostream*               m_stream;
+    std::ofstream               m_file;
+    int                         m_status;
+};
+
+/**
+ * Reads a compressed binary logfile in memory.
+ *
+ * @return 0 or ERR_INVALID_FILE_FORMAT, also when a block uses a codec
+ *         libeye was built without. The entries of the blocks before an
+ *         invalid block have been passed to out.
+ */
+EYELOG_EXPORT int readCompressedBuffer(PEntrySink* out,
+                                       const char* data,
+                                       std::size_t size
+                                       );
+
+/**
+ * Reads a compressed binary logfile.
+ *
+ * This is what readLog does for a file in FORMAT_BINARY_V2, the log
+ * reserves room for all entries first. When the file turns out to be
+ * invalid, out is left as it was: the entries that were decoded before
+ * the error are removed again, without copying the entries that out
+ * already had.
+ *
+ * @param nthreads  number of threads that decode blocks, 0 uses one per
+ *                  core. The entries reach out in the order of the file.
+ *
+ * @return 0, an errno value or ERR_INVALID_FILE_FORMAT.
+ */
+EYELOG_EXPORT int readCompressedLog(PEyeLog* out,
+                                    const String& filename,
+                                    unsigned nthreads=0
+                                    );
+
+/**
+ * Reads a compressed binary logfile into a sink.
+ *
+ * @param nthreads  number of threads that decode blocks, 0 uses one per
+ *                  core. The entries reach out in the order of the file.
+ *
+ * @return 0, an errno value or ERR_INVALID_FILE_FORMAT.
+ */
+EYELOG_EXPORT int readCompressedLog(PEntrySink* out,
+                                    const String& filename,
+                                    unsigned nthreads=0
+                                    );
+
+/**
+ * Reads the entries with t0 <= time < t1 of a compressed binary logfile
+ * into a sink.
+ *
+ * Only the blocks of which the time range overlaps [t0, t1) are decoded.
+ *
+ * @return 0, an errno value or ERR_INVALID_FILE_FORMAT.
+ */
+EYELOG_EXPORT int readCompressedRange(PEntrySink* out,
+                                      const String& filename,
+                                      double t0,
+                                      double t1
+                                      );
+
+/**
+ * Reads the block directory of a compressed binary logfile.
+ *
+ * Every block of the file becomes a block of out, with its offset in the
+ * file, the number of its first entry and its time range. Only the
+ * block headers are read, the blocks are not decoded.
+ *
+ * @return 0, an errno value or ERR_INVALID_FILE_FORMAT.
+ */
+EYELOG_EXPORT int readCompressedBlocks(PBlockIndex* out,
+                                       const String& filename
+                                       );
+
+#endif
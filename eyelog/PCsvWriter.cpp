@@ -0,0 +1,245 @@
+/*
+ * PCsvWriter.cpp
+ *
+ * This file is part of libeye and writes csv logfiles.
+ *
+ * Copyright (C) 2016  Maarten Duijndam
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cassert>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <locale>
+#include <sstream>
+#include <stdint.h>
+#include "PCsvWriter.h"
+
+using namespace std;
+
+static const double POW10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8
+};
+
+static const uint64_t IPOW10[] = {
+    1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull,
+    10000000ull, 100000000ull
+};
+
+/*
+ * Below this bound the error of value * 10^precision is smaller than
+ * 2^-13, see formatFixed.
+ */
+static const double MAX_SCALED = 1099511627776.0; // 2^40
+
+/*
+ * Values whose fraction is closer than this to .5 go the slow way.
+ */
+static const double HALFWAY_MARGIN = 1.0 / 4096; // 2^-12
+
+static inline void appendUnsigned(vector<char>& out, uint64_t v)
+{
+    char digits[20];
+    int n = 0;
+    do {
+        digits[n++] = char('0' + v % 10);
+        v /= 10;
+    } while (v);
+    while (n)
+        out.push_back(digits[--n]);
+}
+
+static inline void appendString(vector<char>& out, const char* s)
+{
+    out.insert(out.end(), s, s + strlen(s));
+}
+
+void PCsvWriter::formatFixed(vector<char>& out, double value, unsigned precision)
+{
+    assert(precision < sizeof(POW10) / sizeof(POW10[0]));
+
+    // value * 10^precision is rounded once, the error is at most
+    // scaled * 2^-53 < 2^-13. So if the fraction of scaled is not
+    // within 2^-12 of .5, it is rounded in the same direction as the
+    // exact decimal expansion of value, which is what printf does.
+    double scaled = std::fabs(value) * POW10[precision];
+    double integral = std::floor(scaled);
+    double fraction = scaled - integral;
+
+    if (!std::isfinite(value) ||
+        scaled >= MAX_SCALED ||
+        std::fabs(fraction - 0.5) < HALFWAY_MARGIN
+        )
+    {
+        ostringstream stream;
+        stream.imbue(std::locale::classic());
+        stream.setf(std::ios::fixed);
+        stream.precision(precision);
+        stream << value;
+        string s = stream.str();
+        out.insert(out.end(), s.begin(), s.end());
+        return;
+    }
+
+    uint64_t rounded = uint64_t(integral) + (fraction > 0.5 ? 1 : 0);
+    if (std::signbit(value))
+        out.push_back('-');
+    appendUnsigned(out, rounded / IPOW10[precision]);
+    if (precision) {
+        uint64_t decimals = rounded % IPOW10[precision];
+        out.push_back('.');
+        for (unsigned i = precision; i > 0; i--)
+            out.push_back(char('0' + decimals / IPOW10[i - 1] % 10));
+    }
+}
+
+PCsvWriter::PCsvWriter(std::ostream& stream)
+    : m_stream(stream),
+      m_sep(PEyeLogEntry::getSeparator()[0]),
+      m_precision(PEyeLogEntry::getPrecision()),
+      m_status(0)
+{
+    m_buffer.reserve(BUFFER_SIZE + 1024);
+}
+
+PCsvWriter::PCsvWriter(std::ostream& stream, const PFormatContext& format)
+    : m_stream(stream),
+      m_sep(format.getSeparator()),
+      m_precision(format.getPrecision()),
+      m_status(0)
+{
+    m_buffer.reserve(BUFFER_SIZE + 1024);
+}
+
+PCsvWriter::~PCsvWriter()
+{
+    flush();
+}
+
+int PCsvWriter::write(const PEyeLogEntry& e, bool newline)
+{
+    vector<char>& out = m_buffer;
+    const std::size_t start = out.size();
+
+    if (m_status)
+        return m_status;
+
+    appendUnsigned(out, unsigned(e.getEntryType()));
+
+    switch (e.getEntryType()) {
+        case LGAZE:
+        case RGAZE:
+        case AVGGAZE:
+            {
+                const PGazeEntry& g = static_cast<const PGazeEntry&>(e);
+                out.push_back(m_sep);
+                formatFixed(out, g.getTime(), m_precision);
+                out.push_back(m_sep);
+                formatFixed(out, g.getX(), m_precision);
+                out.push_back(m_sep);
+                formatFixed(out, g.getY(), m_precision);
+                out.push_back(m_sep);
+                formatFixed(out, g.getPupil(), m_precision);
+            }
+            break;
+        case LFIX:
+        case RFIX:
+        case AVGFIX:
+            {
+                const PFixationEntry& f = static_cast<const PFixationEntry&>(e);
+                out.push_back(m_sep);
+                formatFixed(out, f.getTime(), m_precision);
+                out.push_back(m_sep);
+                formatFixed(out, f.getDuration(), m_precision);
+                out.push_back(m_sep);
+                formatFixed(out, f.getX(), m_precision);
+                out.push_back(m_sep);
+                formatFixed(out, f.getY(), m_precision);
+            }
+            break;
+        case LSAC:
+        case RSAC:
+        case AVGSAC:
+            {
+                const PSaccadeEntry& s = static_cast<const PSaccadeEntry&>(e);
+                out.push_back(m_sep);
+                formatFixed(out, s.getTime(), m_precision);
+                out.push_back(m_sep);
+                formatFixed(out, s.getDuration(), m_precision);
+                out.push_back(m_sep);
+                formatFixed(out, s.getX1(), m_precision);
+                out.push_back(m_sep);
+                formatFixed(out, s.getY1(), m_precision);
+                out.push_back(m_sep);
+                formatFixed(out, s.getX2(), m_precision);
+                out.push_back(m_sep);
+                formatFixed(out, s.getY2(), m_precision);
+            }
+            break;
+        case MESSAGE:
+            out.push_back(m_sep);
+            formatFixed(out, e.getTime(), m_precision);
+            out.push_back(m_sep);
+            appendString(
+                    out,
+                    static_cast<const PMessageEntry&>(e).getMessage().c_str()
+                    );
+            break;
+        case TRIAL:
+            {
+                const PTrialEntry& t = static_cast<const PTrialEntry&>(e);
+                out.push_back(m_sep);
+                formatFixed(out, t.getTime(), m_precision);
+                out.push_back(m_sep);
+                appendString(out, t.getIdentifier().c_str());
+                out.push_back(m_sep);
+                appendString(out, t.getGroup().c_str());
+            }
+            break;
+        case TRIALSTART:
+        case TRIALEND:
+            out.push_back(m_sep);
+            formatFixed(out, e.getTime(), m_precision);
+            break;
+        default:
+            // Unknown to this writer, let the entry do it.
+            out.resize(start);
+            appendString(
+                    out,
+                    e.toString(PFormatContext(m_sep, m_precision)).c_str()
+                    );
+    }
+
+    if (newline)
+        out.push_back('\n');
+
+    if (out.size() >= BUFFER_SIZE)
+        return flush();
+    return 0;
+}
+
+int PCsvWriter::flush()
+{
+    if (m_status)
+        return m_status;
+    if (!m_buffer.empty()) {
+        if (!m_stream.write(m_buffer.data(), m_buffer.size()))
+            m_status = errno ? errno : EIO;
+        m_buffer.clear();
+    }
+    return m_status;
+}
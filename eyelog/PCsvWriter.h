@@ -0,0 +1,103 @@
+/*
+ * PCsvWriter.h
+ *
+ * Public header that provides a fast writer for csv logfiles.
+ *
+ * Copyright (c) 2016 M.J.A. Duijndam.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see Licenses at www.gnu.org.
+ */
+
+#ifndef PCSV_WRITER_H
+#define PCSV_WRITER_H
+
+#include <cstddef>
+#include <ostream>
+#include <vector>
+#include "TypeDefs.h"
+#include "PEyeLogEntry.h"
+
+/**
+ * PCsvWriter formats entries exactly like PEyeLogEntry::toString, but
+ * directly into one reusable buffer that is written to a stream in
+ * large blocks.
+ *
+ * The separator and precision come from the PFormatContext of the writer,
+ * by default the one of PEyeLogEntry when the writer is constructed.
+ * Numbers are formatted with integer arithmetic, values for which that
+ * might round differently than iostream (very large values or values
+ * close to halfway between two outputs) are still formatted by a stream.
+ */
+class EYELOG_EXPORT PCsvWriter {
+
+public:
+
+    /**
+     * Size in bytes at which the buffer is written to the stream.
+     */
+    static const std::size_t BUFFER_SIZE = 1 << 16;
+
+    /**
+     * The stream must outlive the writer.
+     */
+    PCsvWriter(std::ostream& stream);
+
+    /**
+     * Creates a writer that formats with format instead of the defaults.
+     */
+    PCsvWriter(std::ostream& stream, const PFormatContext& format);
+
+    /**
+     * Flushes the buffer.
+     */
+    ~PCsvWriter();
+
+    /**
+     * Formats one entry.
+     *
+     * @param newline terminate the line with '\n'.
+     *
+     * @return 0 or an errno value.
+     */
+    int write(const PEyeLogEntry& entry, bool newline=true);
+
+    /**
+     * Writes the buffer to the stream.
+     *
+     * @return 0 or an errno value.
+     */
+    int flush();
+
+    /**
+     * Appends a number in fixed notation with precision decimals to out,
+     * just like iostream with std::ios::fixed does.
+     */
+    static void formatFixed(std::vector<char>& out,
+                            double value,
+                            unsigned precision
+                            );
+
+private:
+
+    PCsvWriter(const PCsvWriter&);
+    PCsvWriter& operator=(const PCsvWriter&);
+
+    std::ostream&       m_stream;
+    std::vector<char>   m_buffer;
+    char                m_sep;
+    unsigned            m_precision;
+    int                 m_status;
+};
+
+#endif
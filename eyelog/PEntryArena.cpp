@@ -0,0 +1,196 @@
+/*
+ * PEntryArena.cpp
+ *
+ * This file is part of libeye and allocates log entries in blocks.
+ *
+ * Copyright (C) 2016  Maarten Duijndam
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <functional>
+#include <iterator>
+#include <stdint.h>
+#include "PEntryArena.h"
+#include "PEyeLogEntry.h"
+
+using namespace std;
+
+const std::size_t PEntryArena::BLOCK_SIZE;
+
+/*
+ * The members of these entries are plain values, their destructors
+ * don't have to run.
+ */
+static bool hasTrivialMembers(entrytype et)
+{
+    switch (et) {
+        case LGAZE:
+        case RGAZE:
+        case AVGGAZE:
+        case LFIX:
+        case RFIX:
+        case AVGFIX:
+        case LSAC:
+        case RSAC:
+        case AVGSAC:
+        case TRIALSTART:
+        case TRIALEND:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool blockBefore(const char* p, const char* begin)
+{
+    return less<const char*>()(p, begin);
+}
+
+PEntryArena::PEntryArena()
+    : m_ptr(nullptr),
+      m_end(nullptr),
+      m_size(0),
+      m_last(0)
+{
+}
+
+PEntryArena::~PEntryArena()
+{
+    clear();
+}
+
+bool PEntryArena::owns(const PEyeLogEntry* entry) const
+{
+    const char* p = reinterpret_cast<const char*>(entry);
+    less<const char*> before;
+
+    // Entries are mostly examined in the order they were created.
+    if (m_last < m_blocks.size()) {
+        const Block& b = m_blocks[m_last];
+        if (!before(p, b.begin) && before(p, b.end))
+            return true;
+    }
+
+    // The first block that starts after p, p is in the one before it.
+    auto it = upper_bound(m_blocks.begin(), m_blocks.end(), p,
+            [](const char* q, const Block& b) {return blockBefore(q, b.begin);}
+            );
+    if (it == m_blocks.begin())
+        return false;
+    --it;
+    if (!before(p, it->end))
+        return false;
+    m_last = std::size_t(it - m_blocks.begin());
+    return true;
+}
+
+void PEntryArena::clear()
+{
+    for (auto* entry : m_destroy)
+        entry->~PEyeLogEntry();
+    m_destroy.clear();
+
+    for (const auto& block : m_blocks)
+        free(block.begin);
+    m_blocks.clear();
+    m_ptr = m_end = nullptr;
+    m_size = 0;
+    m_last = 0;
+}
+
+std::size_t PEntryArena::size() const
+{
+    return m_size;
+}
+
+void PEntryArena::swap(PEntryArena& other)
+{
+    m_blocks.swap(other.m_blocks);
+    m_destroy.swap(other.m_destroy);
+    std::swap(m_ptr, other.m_ptr);
+    std::swap(m_end, other.m_end);
+    std::swap(m_size, other.m_size);
+    std::swap(m_last, other.m_last);
+}
+
+void PEntryArena::adopt(PEntryArena& other)
+{
+    if (&other == this)
+        return;
+
+    vector<Block> blocks;
+    blocks.reserve(m_blocks.size() + other.m_blocks.size());
+    std::merge(m_blocks.begin(), m_blocks.end(),
+               other.m_blocks.begin(), other.m_blocks.end(),
+               back_inserter(blocks),
+               [](const Block& a, const Block& b) {
+                   return blockBefore(a.begin, b.begin);
+               });
+    m_blocks.swap(blocks);
+    m_destroy.insert(m_destroy.end(),
+                     other.m_destroy.begin(),
+                     other.m_destroy.end()
+                     );
+    m_size += other.m_size;
+    m_last = 0;
+    // Continue in the current block, or in that of other if there is none.
+    if (!m_ptr) {
+        m_ptr = other.m_ptr;
+        m_end = other.m_end;
+    }
+
+    other.m_blocks.clear();
+    other.m_destroy.clear();
+    other.m_ptr = other.m_end = nullptr;
+    other.m_size = 0;
+    other.m_last = 0;
+}
+
+void* PEntryArena::allocate(std::size_t size, std::size_t align)
+{
+    assert(align && (align & (align - 1)) == 0);
+
+    uintptr_t p = (reinterpret_cast<uintptr_t>(m_ptr) + align - 1) & ~(align - 1);
+    if (!m_ptr || p + size > reinterpret_cast<uintptr_t>(m_end)) {
+        // malloc aligns for every fundamental type.
+        std::size_t n = std::max(BLOCK_SIZE, size);
+        char* mem = static_cast<char*>(malloc(n));
+        if (!mem)
+            throw std::bad_alloc();
+
+        Block block = {mem, mem + n};
+        auto it = upper_bound(m_blocks.begin(), m_blocks.end(), mem,
+            [](const char* q, const Block& b) {return blockBefore(q, b.begin);}
+            );
+        m_blocks.insert(it, block);
+        m_ptr = mem;
+        m_end = mem + n;
+        p = reinterpret_cast<uintptr_t>(mem);
+    }
+
+    m_ptr = reinterpret_cast<char*>(p + size);
+    m_size += size;
+    return reinterpret_cast<void*>(p);
+}
+
+void PEntryArena::track(PEyeLogEntry* entry)
+{
+    if (!hasTrivialMembers(entry->getEntryType()))
+        m_destroy.push_back(entry);
+}
@@ -0,0 +1,121 @@
+/*
+ * PEntryArena.h
+ *
+ * Public header that provides a region allocator for log entries.
+ *
+ * Copyright (c) 2016 M.J.A. Duijndam.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see Licenses at www.gnu.org.
+ */
+
+#ifndef PENTRY_ARENA_H
+#define PENTRY_ARENA_H
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+#include "eyelog_export.h"
+
+class PEyeLogEntry;
+
+/**
+ * PEntryArena creates entries in large blocks of memory that are
+ * released all at once.
+ *
+ * Allocating an entry is just bumping a pointer and clear() frees the
+ * blocks instead of every entry. Only the destructors of entries that
+ * own resources, such as the String of a PMessageEntry, are run.
+ *
+ * Entries created by an arena belong to the arena, they must never be
+ * deleted. Clones of these entries are created with new as usual.
+ * An arena is not thread safe.
+ */
+class EYELOG_EXPORT PEntryArena {
+
+public:
+
+    /**
+     * The size in bytes of a block.
+     */
+    static const std::size_t BLOCK_SIZE = 1 << 20;
+
+    PEntryArena();
+
+    /**
+     * Destroys all entries of the arena.
+     */
+    ~PEntryArena();
+
+    /**
+     * Constructs a T in the arena.
+     *
+     * @return the new entry, owned by the arena.
+     */
+    template <class T, class... Args>
+    T* create(Args&&... args)
+    {
+        void* p = allocate(sizeof(T), alignof(T));
+        T* entry = new (p) T(std::forward<Args>(args)...);
+        track(entry);
+        return entry;
+    }
+
+    /**
+     * @return true if entry was created by this arena.
+     */
+    bool owns(const PEyeLogEntry* entry) const;
+
+    /**
+     * Destroys all entries and frees the memory.
+     */
+    void clear();
+
+    /**
+     * @return the number of bytes in use by entries.
+     */
+    std::size_t size() const;
+
+    /**
+     * Exchanges the contents of two arenas.
+     */
+    void swap(PEntryArena& other);
+
+    /**
+     * Takes over the entries of other, other is left empty.
+     */
+    void adopt(PEntryArena& other);
+
+private:
+
+    PEntryArena(const PEntryArena&);
+    PEntryArena& operator=(const PEntryArena&);
+
+    struct Block {
+        char*   begin;
+        char*   end;
+    };
+
+    void* allocate(std::size_t size, std::size_t align);
+    void  track(PEyeLogEntry* entry);
+
+    std::vector<Block>          m_blocks;   // sorted on address.
+    std::vector<PEyeLogEntry*>  m_destroy;  // entries with a destructor.
+    char*                       m_ptr;      // free part of the current block.
+    char*                       m_end;
+    std::size_t                 m_size;
+    mutable std::size_t         m_last;     // block of the last owns().
+};
+
+#endif
@@ -0,0 +1,63 @@
+/*
+ * PEntrySink.h
+ *
+ * Public header that provides the interface that receives parsed entries.
+ *
+ * Copyright (c) 2016 M.J.A. Duijndam.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see Licenses at www.gnu.org.
+ */
+
+#ifndef PENTRY_SINK_H
+#define PENTRY_SINK_H
+
+#include "eyelog_export.h"
+#include "constants.h"
+
+class PEyeLogEntry;
+
+/**
+ * PEntrySink is the destination of the log readers.
+ *
+ * The readers hand every entry they parse to a sink. Gaze samples are
+ * by far the most common entries, therefore they are passed by value
+ * through addGaze, so that a sink that stores samples differently
+ * doesn't have to allocate a PGazeEntry first.
+ */
+class EYELOG_EXPORT PEntrySink {
+
+public:
+
+    virtual ~PEntrySink();
+
+    /**
+     * Receives a gaze sample.
+     *
+     * The default implementation creates a PGazeEntry and passes
+     * it to addEntry.
+     */
+    virtual void addGaze(entrytype eye,
+                         double time,
+                         float x,
+                         float y,
+                         float pupil
+                         );
+
+    /**
+     * Receives an entry, the sink takes ownership of the entry.
+     */
+    virtual void addEntry(PEyeLogEntry* entry) = 0;
+};
+
+#endif
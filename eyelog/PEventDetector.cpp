@@ -0,0 +1,393 @@
+/*
+ * PEventDetector.cpp
+ *
+ * This file is part of libeye and detects fixations and saccades in
+ * gaze samples.
+ *
+ * Copyright (C) 2016  Maarten Duijndam
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include "PEventDetector.h"
+
+using namespace std;
+
+/*
+ * About 30 degrees per second and 1 degree with 35 pixels per degree.
+ */
+const double PEventDetector::DEFAULT_VELOCITY       = 1000.0;
+const double PEventDetector::DEFAULT_DISPERSION     = 35.0;
+const double PEventDetector::DEFAULT_MIN_FIXATION   = 60.0;
+const double PEventDetector::DEFAULT_MAX_GAP        = 75.0;
+const std::size_t PEventDetector::BLOCK_SAMPLES;
+
+void PEventDetector::Event::start(const Sample& s)
+{
+    first = last = s;
+    sumx = s.x;
+    sumy = s.y;
+    minx = maxx = s.x;
+    miny = maxy = s.y;
+    n = 1;
+}
+
+void PEventDetector::Event::add(const Sample& s)
+{
+    last = s;
+    sumx += s.x;
+    sumy += s.y;
+    minx = min(minx, s.x);
+    maxx = max(maxx, s.x);
+    miny = min(miny, s.y);
+    maxy = max(maxy, s.y);
+    n++;
+}
+
+float PEventDetector::Event::dispersionWith(const Sample& s) const
+{
+    return max(maxx, s.x) - min(minx, s.x) + max(maxy, s.y) - min(miny, s.y);
+}
+
+void PEventDetector::Extreme::push(std::size_t seq, float v)
+{
+    while (!m_values.empty() &&
+           (m_maximum ? m_values.back().second <= v
+                      : m_values.back().second >= v))
+        m_values.pop_back();
+    m_values.push_back(std::make_pair(seq, v));
+}
+
+void PEventDetector::Extreme::pop(std::size_t seq)
+{
+    if (!m_values.empty() && m_values.front().first == seq)
+        m_values.pop_front();
+}
+
+PEventDetector::PEventDetector(PEntrySink* out, detection_algorithm algorithm)
+    : m_out(out),
+      m_algorithm(algorithm),
+      m_velocity(DEFAULT_VELOCITY),
+      m_dispersion(DEFAULT_DISPERSION),
+      m_minfix(DEFAULT_MIN_FIXATION),
+      m_maxgap(DEFAULT_MAX_GAP)
+{
+    assert(out);
+    const entrytype fix[] = {LFIX, RFIX, AVGFIX};
+    const entrytype sac[] = {LSAC, RSAC, AVGSAC};
+    for (int i = 0; i < 3; i++) {
+        Stream& s = m_streams[i];
+        s.fix = fix[i];
+        s.sac = sac[i];
+        s.hasprev = false;
+        s.open = false;
+        s.saccade = false;
+        s.fixating = false;
+        s.hasfix = false;
+        s.seq = 0;
+        s.maxx = s.maxy = Extreme(true);
+        if (m_algorithm == DETECT_IVT) {
+            s.times.reserve(BLOCK_SAMPLES + 1);
+            s.xs.reserve(BLOCK_SAMPLES + 1);
+            s.ys.reserve(BLOCK_SAMPLES + 1);
+            s.velocities.resize(BLOCK_SAMPLES);
+        }
+    }
+}
+
+PEventDetector::~PEventDetector()
+{
+    flush();
+}
+
+void PEventDetector::setVelocityThreshold(double threshold)
+{
+    m_velocity = threshold;
+}
+
+double PEventDetector::getVelocityThreshold() const
+{
+    return m_velocity;
+}
+
+void PEventDetector::setDispersionThreshold(double threshold)
+{
+    m_dispersion = threshold;
+}
+
+double PEventDetector::getDispersionThreshold() const
+{
+    return m_dispersion;
+}
+
+void PEventDetector::setMinFixationDuration(double duration)
+{
+    m_minfix = duration;
+}
+
+double PEventDetector::getMinFixationDuration() const
+{
+    return m_minfix;
+}
+
+void PEventDetector::setMaxGap(double gap)
+{
+    m_maxgap = gap;
+}
+
+double PEventDetector::getMaxGap() const
+{
+    return m_maxgap;
+}
+
+void PEventDetector::addGaze(entrytype eye,
+                             double time,
+                             float x,
+                             float y,
+                             float pupil
+                             )
+{
+    (void) pupil;
+    Sample sample = {time, x, y};
+    switch (eye) {
+        case LGAZE:
+            addSample(m_streams[0], sample);
+            break;
+        case RGAZE:
+            addSample(m_streams[1], sample);
+            break;
+        case AVGGAZE:
+            addSample(m_streams[2], sample);
+            break;
+        default:
+            break;
+    }
+}
+
+void PEventDetector::addEntry(PEyeLogEntry* entry)
+{
+    entrytype type = entry->getEntryType();
+    if (type == LGAZE || type == RGAZE || type == AVGGAZE) {
+        const PGazeEntry* g = static_cast<const PGazeEntry*>(entry);
+        addGaze(type, g->getTime(), g->getX(), g->getY(), g->getPupil());
+    }
+    delete entry;
+}
+
+void PEventDetector::flush()
+{
+    for (Stream& s : m_streams)
+        endSegment(s);
+}
+
+/*
+ * Ends the segment at a gap or missing data, the next sample starts a
+ * new one.
+ */
+void PEventDetector::addSample(Stream& s, const Sample& sample)
+{
+    if (!std::isfinite(sample.x) || !std::isfinite(sample.y)) {
+        endSegment(s);
+        return;
+    }
+    if (s.hasprev && sample.time - s.prev.time > m_maxgap)
+        endSegment(s);
+
+    if (m_algorithm == DETECT_IVT) {
+        // The first sample of a segment has no velocity, it starts a
+        // fixation, the others wait until their block is complete.
+        if (s.times.empty())
+            classify(s, sample, false);
+        s.times.push_back(sample.time);
+        s.xs.push_back(sample.x);
+        s.ys.push_back(sample.y);
+        if (s.times.size() > BLOCK_SAMPLES)
+            processBlock(s);
+    }
+    else {
+        addIdtSample(s, sample);
+    }
+    s.prev = sample;
+    s.hasprev = true;
+}
+
+/*
+ * Classifies the buffered samples, the first sample has been classified
+ * before and is only needed for the velocity of the second.
+ */
+void PEventDetector::processBlock(Stream& s)
+{
+    std::size_t n = s.times.size();
+    if (n < 2)
+        return;
+
+    computeVelocities(s.times.data(), s.xs.data(), s.ys.data(), n,
+                      s.velocities.data()
+                      );
+    const float threshold = float(m_velocity);
+    for (std::size_t i = 1; i < n; i++) {
+        Sample sample = {s.times[i], s.xs[i], s.ys[i]};
+        bool saccade = s.velocities[i - 1] > threshold;
+        if (s.open && saccade != s.saccade) {
+            // The movement between the samples belongs to the saccade.
+            Sample prev = {s.times[i - 1], s.xs[i - 1], s.ys[i - 1]};
+            endIvtEvent(s);
+            if (saccade) {
+                s.event.start(prev);
+                s.event.add(sample);
+                s.open = true;
+                s.saccade = true;
+                continue;
+            }
+        }
+        classify(s, sample, saccade);
+    }
+
+    s.times.front() = s.times.back();
+    s.xs.front() = s.xs.back();
+    s.ys.front() = s.ys.back();
+    s.times.resize(1);
+    s.xs.resize(1);
+    s.ys.resize(1);
+}
+
+void PEventDetector::classify(Stream& s, const Sample& sample, bool saccade)
+{
+    if (s.open) {
+        s.event.add(sample);
+    }
+    else {
+        s.event.start(sample);
+        s.open = true;
+        s.saccade = saccade;
+    }
+}
+
+void PEventDetector::endIvtEvent(Stream& s)
+{
+    if (!s.open)
+        return;
+    s.open = false;
+    if (s.saccade)
+        emitSaccade(s, s.event.first, s.event.last);
+    else if (s.event.last.time - s.event.first.time >= m_minfix)
+        emitFixation(s, s.event);
+}
+
+void PEventDetector::addIdtSample(Stream& s, const Sample& sample)
+{
+    if (s.fixating) {
+        if (s.event.dispersionWith(sample) <= m_dispersion) {
+            s.event.add(sample);
+            return;
+        }
+        endIdtFixation(s);
+    }
+
+    // Look for samples that stay together for the minimum duration.
+    s.window.push_back(sample);
+    s.seq++;
+    s.minx.push(s.seq, sample.x);
+    s.maxx.push(s.seq, sample.x);
+    s.miny.push(s.seq, sample.y);
+    s.maxy.push(s.seq, sample.y);
+    while (s.window.back().time - s.window.front().time >= m_minfix) {
+        float dispersion = s.maxx.value() - s.minx.value() +
+                           s.maxy.value() - s.miny.value();
+        if (dispersion <= m_dispersion) {
+            if (s.hasfix)
+                emitSaccade(s, s.lastfix, s.window.front());
+            s.event.start(s.window.front());
+            for (std::size_t i = 1; i < s.window.size(); i++)
+                s.event.add(s.window[i]);
+            s.fixating = true;
+            s.hasfix = false;
+            clearWindow(s);
+            break;
+        }
+        std::size_t front = s.seq + 1 - s.window.size();
+        s.minx.pop(front);
+        s.maxx.pop(front);
+        s.miny.pop(front);
+        s.maxy.pop(front);
+        s.window.pop_front();
+    }
+}
+
+void PEventDetector::clearWindow(Stream& s)
+{
+    s.window.clear();
+    s.minx.clear();
+    s.maxx.clear();
+    s.miny.clear();
+    s.maxy.clear();
+}
+
+void PEventDetector::endIdtFixation(Stream& s)
+{
+    if (!s.fixating)
+        return;
+    emitFixation(s, s.event);
+    s.lastfix = s.event.last;
+    s.hasfix = true;
+    s.fixating = false;
+}
+
+void PEventDetector::endSegment(Stream& s)
+{
+    if (m_algorithm == DETECT_IVT) {
+        processBlock(s);
+        endIvtEvent(s);
+        s.times.clear();
+        s.xs.clear();
+        s.ys.clear();
+    }
+    else {
+        endIdtFixation(s);
+        s.hasfix = false;
+        clearWindow(s);
+    }
+    s.hasprev = false;
+}
+
+void PEventDetector::emitFixation(const Stream& s, const Event& e)
+{
+    m_out->addEntry(new PFixationEntry(s.fix,
+                                       e.first.time,
+                                       e.last.time - e.first.time,
+                                       float(e.sumx / e.n),
+                                       float(e.sumy / e.n)
+                                       )
+                    );
+}
+
+void PEventDetector::emitSaccade(const Stream& s,
+                                 const Sample& from,
+                                 const Sample& to
+                                 )
+{
+    m_out->addEntry(new PSaccadeEntry(s.sac,
+                                      from.time,
+                                      to.time - from.time,
+                                      from.x,
+                                      from.y,
+                                      to.x,
+                                      to.y
+                                      )
+                    );
+}
@@ -0,0 +1,254 @@
+/*
+ * PEventDetector.h
+ *
+ * Public header that provides detection of fixations and saccades in
+ * gaze samples.
+ *
+ * Copyright (c) 2016 M.J.A. Duijndam.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see Licenses at www.gnu.org.
+ */
+
+#ifndef PEVENT_DETECTOR_H
+#define PEVENT_DETECTOR_H
+
+#include <cstddef>
+#include <deque>
+#include <utility>
+#include <vector>
+#include "constants.h"
+#include "PEntrySink.h"
+#include "PEyeLogEntry.h"
+#include "PGazeKernels.h"
+
+/**
+ * PEventDetector computes fixations and saccades from gaze samples.
+ *
+ * The detector is a PEntrySink, so the samples can be read straight from
+ * a file with readLog or fed from a PEyeLog. The LGAZE, RGAZE and AVGGAZE
+ * samples are treated as three separate streams, that result in
+ * respectively LFIX/LSAC, RFIX/RSAC and AVGFIX/AVGSAC entries. Other
+ * entries are ignored. Every sample is looked at once, so the memory
+ * used doesn't depend on the length of the recording.
+ *
+ * With DETECT_IVT a sample belongs to a saccade when the velocity from
+ * the previous sample exceeds the velocity threshold, consecutive samples
+ * below the threshold form a fixation. The velocities are computed for
+ * blocks of samples at once with computeVelocities.
+ *
+ * With DETECT_IDT a fixation starts when the samples during the minimum
+ * fixation duration lie within the dispersion threshold, and it lasts as
+ * long as the samples that follow keep it within the threshold. The
+ * samples between two fixations form a saccade.
+ *
+ * The thresholds are in the units of the samples, usually pixels. A
+ * threshold in degrees has to be multiplied by the number of pixels per
+ * degree of the setup. A fixation must last at least the minimum
+ * fixation duration. A pause between two samples that is longer than the
+ * maximum gap, e.g. a blink, ends the current fixation or saccade.
+ *
+ * The events of each stream are passed to the output in order of time,
+ * but the events of the left and right eye are interleaved. Use
+ * sortPEntryVec or PEyeLog::merge to order them with other entries.
+ *
+ * Usage:
+ * \code
+ *  PEyeLog events;
+ *  PEventDetector detector(&events, DETECT_IVT);
+ *  detector.setVelocityThreshold(30 * pixels_per_degree);
+ *  int ret = readLog(&detector, "recording.asc");
+ *  detector.flush();
+ * \endcode
+ */
+class EYELOG_EXPORT PEventDetector : public PEntrySink {
+
+public:
+
+    /**
+     * The default velocity threshold in units per second.
+     */
+    static const double DEFAULT_VELOCITY;
+
+    /**
+     * The default dispersion threshold in units, the sum of the range
+     * of the x and y coordinates.
+     */
+    static const double DEFAULT_DISPERSION;
+
+    /**
+     * The default minimum fixation duration in ms.
+     */
+    static const double DEFAULT_MIN_FIXATION;
+
+    /**
+     * The default maximum time in ms between two samples of an event.
+     */
+    static const double DEFAULT_MAX_GAP;
+
+    /**
+     * Creates a detector that passes the events to out.
+     *
+     * @param out       receives the fixation and saccade entries, must
+     *                  outlive the detector.
+     * @param algorithm DETECT_IVT or DETECT_IDT.
+     */
+    PEventDetector(PEntrySink* out,
+                   detection_algorithm algorithm=DETECT_IVT
+                   );
+
+    /**
+     * Flushes the events that are still open.
+     */
+    ~PEventDetector();
+
+    void    setVelocityThreshold(double threshold);
+    double  getVelocityThreshold() const;
+
+    void    setDispersionThreshold(double threshold);
+    double  getDispersionThreshold() const;
+
+    void    setMinFixationDuration(double duration);
+    double  getMinFixationDuration() const;
+
+    void    setMaxGap(double gap);
+    double  getMaxGap() const;
+
+    /**
+     * Receives a gaze sample.
+     */
+    virtual void addGaze(entrytype eye,
+                         double time,
+                         float x,
+                         float y,
+                         float pupil
+                         );
+
+    /**
+     * Receives an entry, gaze samples are handled like addGaze, the entry
+     * is deleted.
+     */
+    virtual void addEntry(PEyeLogEntry* entry);
+
+    /**
+     * Ends the events that are still open and passes them to the output.
+     *
+     * Call it when all samples have been added, afterwards the detector
+     * starts afresh.
+     */
+    void flush();
+
+    /**
+     * The number of samples that are buffered for a block of velocities.
+     */
+    static const std::size_t BLOCK_SAMPLES = 256;
+
+private:
+
+    PEventDetector(const PEventDetector&);
+    PEventDetector& operator=(const PEventDetector&);
+
+    struct Sample {
+        double  time;
+        float   x;
+        float   y;
+    };
+
+    /*
+     * The samples of an event that hasn't ended.
+     */
+    struct Event {
+        Sample      first;
+        Sample      last;
+        double      sumx;
+        double      sumy;
+        float       minx, maxx, miny, maxy;
+        std::size_t n;
+
+        void start(const Sample& s);
+        void add(const Sample& s);
+        float dispersionWith(const Sample& s) const;
+    };
+
+    /*
+     * The minimum or maximum of a sliding window of values, the values
+     * that can't become the extreme are dropped when they are added.
+     */
+    class Extreme {
+
+    public:
+
+        explicit Extreme(bool maximum=false) : m_maximum(maximum) {}
+
+        void push(std::size_t seq, float v);
+        void pop(std::size_t seq);
+        float value() const {return m_values.front().second;}
+        void clear() {m_values.clear();}
+
+    private:
+
+        bool                                        m_maximum;
+        std::deque<std::pair<std::size_t, float> >  m_values;
+    };
+
+    /*
+     * The state of the detection of one eye.
+     */
+    struct Stream {
+        entrytype           fix;
+        entrytype           sac;
+        bool                hasprev;    // prev is a sample of this segment.
+        Sample              prev;
+
+        // DETECT_IVT
+        std::vector<double> times;      // times[0] is prev when hasprev.
+        std::vector<float>  xs;
+        std::vector<float>  ys;
+        std::vector<float>  velocities;
+        bool                open;       // event is a fixation or saccade.
+        bool                saccade;
+        Event               event;
+
+        // DETECT_IDT
+        std::deque<Sample>  window;     // candidate samples of a fixation.
+        std::size_t         seq;        // the number of window.back().
+        Extreme             minx, maxx, miny, maxy;
+        bool                fixating;
+        bool                hasfix;     // lastfix ended the last fixation.
+        Sample              lastfix;
+    };
+
+    void addSample(Stream& s, const Sample& sample);
+
+    void processBlock(Stream& s);
+    void classify(Stream& s, const Sample& sample, bool saccade);
+    void endIvtEvent(Stream& s);
+
+    void addIdtSample(Stream& s, const Sample& sample);
+    void clearWindow(Stream& s);
+    void endIdtFixation(Stream& s);
+    void endSegment(Stream& s);
+
+    void emitFixation(const Stream& s, const Event& e);
+    void emitSaccade(const Stream& s, const Sample& from, const Sample& to);
+
+    PEntrySink*         m_out;
+    detection_algorithm m_algorithm;
+    double              m_velocity;     // units per second
+    double              m_dispersion;   // units
+    double              m_minfix;       // ms
+    double              m_maxgap;       // ms
+    Stream              m_streams[3];   // LGAZE, RGAZE and AVGGAZE
+};
+
+#endif
@@ -20,110 +20,277 @@
  */
 
 #include <cassert>
+#include <type_traits>
 #include "PExperiment.h"
 #include "PEyeLogEntry.h"
+#include "PLogReader.h"
 
-PTrial::PTrial(const PTrial& rhs)
-    :m_entry(rhs.m_entry)
+/*
+ * A DArray<PTrial> that grows moves its trials, moving the trial entry
+ * takes over its strings instead of allocating copies.
+ */
+static_assert(std::is_nothrow_move_constructible<PTrialEntry>::value &&
+              std::is_nothrow_move_assignable<PTrialEntry>::value,
+              "PTrial moves its PTrialEntry"
+              );
+
+/*
+ * What PTrial::operator[] returns for a type without entries. It is
+ * constructed before main, so concurrent calls don't initialize it.
+ */
+static const PEntryVec no_entries;
+
+/*
+ * What PTrial::getGaze returns for a type that isn't a gaze sample.
+ */
+static const PGazeColumns no_gaze;
+
+/*
+ * The index of the columns of a gaze type, or -1 for other types.
+ */
+static int gazeIndex(entrytype t)
 {
-    for (const auto& pair : rhs.m_entries) {
-        m_entries[pair.first] =  copyPEntryVec(pair.second);
+    switch (t) {
+        case LGAZE:
+            return 0;
+        case RGAZE:
+            return 1;
+        case AVGGAZE:
+            return 2;
+        default:
+            return -1;
     }
 }
 
+PTrial::PTrial(const PTrial& rhs)
+    :m_entry(rhs.m_entry),
+     m_gaze(),
+     m_owning(true)
+{
+    for (unsigned t = 0; t < NTYPES; t++)
+        m_entries[t] = copyPEntryVec(rhs.m_entries[t]);
+}
+
+PTrial::PTrial(PTrial&& rhs) noexcept
+    :m_entry(std::move(rhs.m_entry)),
+     m_gaze(),
+     m_owning(rhs.m_owning)
+{
+    for (unsigned t = 0; t < NTYPES; t++)
+        m_entries[t] = std::move(rhs.m_entries[t]);
+    for (unsigned i = 0; i < NUM_EYES; i++)
+        m_gaze[i] = rhs.m_gaze[i].exchange(nullptr);
+    rhs.m_owning = true;
+}
+
 PTrial::PTrial(const PTrialEntry* entry)
-    : m_entry(*entry)
+    : m_entry(*entry),
+      m_gaze(),
+      m_owning(true)
 {
 }
 
 PTrial::PTrial(const PTrialEntry& entry)
-    : m_entry(entry)
+    : m_entry(entry),
+      m_gaze(),
+      m_owning(true)
 {
 }
 
 PTrial::PTrial()
-    : m_entry()
+    : m_entry(),
+      m_gaze(),
+      m_owning(true)
 {
 }
 
 PTrial& PTrial::operator = (const PTrial& rhs)
 {
+    if (&rhs == this)
+        return *this;
     clear();
+    m_owning = true;
     m_entry = rhs.m_entry;
-    for (const auto& pair : rhs.m_entries) {
-        m_entries[pair.first] =  copyPEntryVec(pair.second);
+    for (unsigned t = 0; t < NTYPES; t++)
+        m_entries[t] = copyPEntryVec(rhs.m_entries[t]);
+    return *this;
+}
+
+PTrial& PTrial::operator = (PTrial&& rhs) noexcept
+{
+    if (&rhs != this) {
+        clear();
+        m_entry = std::move(rhs.m_entry);
+        for (unsigned t = 0; t < NTYPES; t++)
+            m_entries[t] = std::move(rhs.m_entries[t]);
+        for (unsigned i = 0; i < NUM_EYES; i++)
+            m_gaze[i] = rhs.m_gaze[i].exchange(nullptr);
+        m_owning = rhs.m_owning;
+        rhs.m_owning = true;
     }
     return *this;
 }
 
 PTrial::~PTrial()
 {
-    for (auto& pair : m_entries)
-        destroyPEntyVec(pair.second);
+    clear();
 }
 
 void PTrial::addEntry(const PEntryPtr entry)
 {
-    entrytype t = entry->getEntryType();
-    auto it = m_entries.find(t);
-    if (it != m_entries.end()) {
-        it->second.push_back(entry->clone());
+    makeOwning();
+    m_entries[entry->getEntryType()].push_back(entry->clone());
+    dropColumns();
+}
+
+/*
+ * Adds entry without copying it, the trial doesn't own it.
+ */
+void PTrial::borrowEntry(PEyeLogEntry* entry)
+{
+    assert(!m_owning || size() == 0);
+    m_owning = false;
+    m_entries[entry->getEntryType()].push_back(entry);
+    dropColumns();
+}
+
+/*
+ * Adds entry without copying it, the trial owns it from now on.
+ */
+void PTrial::adoptEntry(std::unique_ptr<PEyeLogEntry> entry)
+{
+    makeOwning();
+    m_entries[entry->getEntryType()].push_back(entry.get());
+    entry.release();
+    dropColumns();
+}
+
+/*
+ * Frees the gaze columns, they are made again when they are needed.
+ */
+void PTrial::dropColumns()
+{
+    for (auto& columns : m_gaze)
+        delete columns.exchange(nullptr);
+}
+
+/*
+ * Copies rhs, the entries are only copied when rhs owns them.
+ */
+void PTrial::shareEntries(const PTrial& rhs)
+{
+    if (rhs.m_owning) {
+        *this = rhs;
         return;
     }
-    m_entries[t] = PEntryVec();
-    m_entries[t].push_back(entry->clone());
+    clear();
+    m_entry = rhs.m_entry;
+    for (unsigned t = 0; t < NTYPES; t++)
+        m_entries[t] = rhs.m_entries[t];
+    m_owning = false;
+}
+
+/*
+ * Replaces borrowed entries by copies.
+ */
+void PTrial::makeOwning()
+{
+    if (m_owning)
+        return;
+    for (auto& vec : m_entries)
+        for (auto& entry : vec)
+            entry = entry->clone();
+    m_owning = true;
+}
+
+bool PTrial::ownsEntries() const
+{
+    return m_owning;
 }
 
 const DArray<PEyeLogEntry*>& PTrial::operator[](entrytype t) const
 {
-    const static PEntryVec empty; // empty return value.
-    const auto it = m_entries.find(t);
-    if (it != m_entries.end())
-        return it->second;
+    if (unsigned(t) < NTYPES)
+        return m_entries[t];
     else
-        return empty;
+        return no_entries;
+}
+
+/*
+ * Threads that ask for the columns of an eye at the same time may all
+ * make them, the first one that is done stores them and the others
+ * free theirs.
+ */
+const PGazeColumns& PTrial::getGaze(entrytype eye) const
+{
+    int i = gazeIndex(eye);
+    if (i < 0)
+        return no_gaze;
+    PGazeColumns* columns = m_gaze[i].load(std::memory_order_acquire);
+    if (columns)
+        return *columns;
+
+    const DArray<PEyeLogEntry*>& samples = m_entries[eye];
+    std::unique_ptr<PGazeColumns> made(new PGazeColumns);
+    made->reserve(samples.size());
+    for (const auto* e : samples) {
+        const PGazeEntry* gaze = static_cast<const PGazeEntry*>(e);
+        made->append(gaze->getTime(),
+                     gaze->getX(),
+                     gaze->getY(),
+                     gaze->getPupil()
+                     );
+    }
+    if (m_gaze[i].compare_exchange_strong(columns,
+                                          made.get(),
+                                          std::memory_order_acq_rel,
+                                          std::memory_order_acquire
+                                          ))
+        return *made.release();
+    return *columns;
 }
 
 PEntryVec PTrial::getEntries() const
 {
     PEntryVec vec;
     vec.push_back(m_entry.clone());
-    for (const auto& pair : m_entries)
-        for (const auto* entry: pair.second)
+    for (const auto& entries : m_entries)
+        for (const auto* entry: entries)
             vec.push_back(entry->clone());
     return vec;
 }
 
+std::size_t PTrial::size() const
+{
+    std::size_t n = 0;
+    for (const auto& vec : m_entries)
+        n += vec.size();
+    return n;
+}
+
 void PTrial::clear() 
 {
-    // Destroy all vectors inside the map
-    for(auto& pair: m_entries) {
-        auto& vec = pair.second;
-        destroyPEntyVec(vec);
+    // Destroy all entries of every type
+    for (auto& vec : m_entries) {
+        if (m_owning)
+            destroyPEntyVec(vec);
+        vec.clear();
     }
-    // clear all empty keys.
-    m_entries.clear();
+    dropColumns();
 }
 
 /*
- * Compares fist on m_entry, than it compares the m_entries map
+ * Compares fist on m_entry, than it compares the entries of every type
  */
 bool PTrial::operator==(const PTrial& other) const
 {
     if (m_entry != other.m_entry)
         return false;
 
-    if (m_entries.size() != other.m_entries.size())
-        return false;
-
-    auto it1 = m_entries.cbegin();
-    auto it2 = other.m_entries.cbegin();
-    /* Compare keys and then deep compare the pointers of the logentries */
-    for (; it1 != m_entries.end(); it1++, it2++) {
-        if (it1->first != it2->first)
-            return false;
-        const auto& vec1 = it1->second;
-        const auto& vec2 = it2->second;
+    /* Deep compare the pointers of the logentries */
+    for (unsigned t = 0; t < NTYPES; t++) {
+        const auto& vec1 = m_entries[t];
+        const auto& vec2 = other.m_entries[t];
         if (vec1.size() != vec2.size())
             return false;
         for (unsigned i = 0; i < vec2.size(); i++)
@@ -152,82 +319,184 @@ String PTrial::getGroup() const
 
 PExperiment::PExperiment()
     :
-        m_metadata()
+        m_metadata(),
+        m_trialended(false)
 {
 }
 
 PExperiment::PExperiment(const PExperiment& rhs)
+    : m_trialended(false)
 {
-    m_metadata = copyPEntryVec(rhs.m_metadata);
-    m_trials = rhs.m_trials;
+    copyFrom(rhs);
 }
 
 PExperiment::~PExperiment()
 {
-    destroyPEntyVec(m_metadata);
+    destroy();
 }
 
 PExperiment::PExperiment(const PEntryVec& entries)
+    : m_trialended(false)
 {
     initFromEntryVec(entries);
 }
 
 PExperiment::PExperiment(const PEyeLog& log)
+    : m_trialended(false)
 {
     initFromEntryVec(log.getEntries());
 }
 
+PExperiment::PExperiment(PEyeLog&& log)
+    : m_trialended(false)
+{
+    borrowFrom(std::make_shared<PEyeLog>(std::move(log)));
+}
+
+PExperiment::PExperiment(std::shared_ptr<const PEyeLog> log)
+    : m_trialended(false)
+{
+    borrowFrom(std::move(log));
+}
+
 PExperiment& PExperiment::operator=(const PExperiment& rhs)
 {
-    m_trials.clear();
-    destroyPEntyVec(m_metadata);
-    PEntryVec initvec;
-    initvec.insert(initvec.end(),
-                   rhs.m_metadata.cbegin(),
-                   rhs.m_metadata.cend()
-                   );
-
-    for (unsigned i = 0; i < rhs.nTrials(); i++) {
-        const PEntryVec& tempvec = rhs.m_trials[i].getEntries();
-        initvec.insert(initvec.end(), tempvec.cbegin(), tempvec.cend());
+    if (&rhs != this) {
+        destroy();
+        copyFrom(rhs);
     }
-    
-    sortPEntryVec(initvec);
-    initFromEntryVec(initvec);
-    destroyPEntyVec(initvec);
-
     return *this;
 }
 
 void PExperiment::initFromEntryVec(const PEntryVec& entries)
 {
-    // Used to indicate trial end.
-    bool end(false);
-
-    // The next loop adds all entries prior to the first trial
-    // to m_metadata, and subsequently it creates more trials
-    // and pushes the new entries to those trials.
-    for (const auto& e : entries) {
-        if (m_trials.empty() && e->getEntryType() != TRIAL) {
-            m_metadata.push_back(e->clone());
-            continue;
-        }
-        switch(e->getEntryType()) {
-            case TRIAL:
-                end = false;
-                m_trials.push_back(PTrial(static_cast<PTrialEntry*>(e)));
-                break;
-            case TRIALSTART:
-                m_trials[m_trials.size() - 1].clear();
-                break;
-            case TRIALEND:
-                end = true;
+    for (const auto& e : entries)
+        addEntry(e);
+}
+
+/*
+ * Splits the entries of log in trials without copying them.
+ */
+void PExperiment::borrowFrom(std::shared_ptr<const PEyeLog> log)
+{
+    assert(log);
+    m_source = std::move(log);
+    for (auto* e : m_source->getEntries())
+        insertEntry(e, true);
+}
+
+/*
+ * Copies rhs into this empty experiment, entries that rhs borrows are
+ * shared.
+ */
+void PExperiment::copyFrom(const PExperiment& rhs)
+{
+    m_trialended = rhs.m_trialended;
+    m_source = rhs.m_source;
+    if (m_source)
+        m_metadata = rhs.m_metadata;
+    else
+        m_metadata = copyPEntryVec(rhs.m_metadata);
+
+    m_trials.reserve(rhs.m_trials.size());
+    for (const auto& trial : rhs.m_trials) {
+        m_trials.emplace_back();
+        m_trials[m_trials.size() - 1].shareEntries(trial);
+    }
+}
+
+/*
+ * Replaces all borrowed entries by copies and releases the log.
+ */
+void PExperiment::makeOwning()
+{
+    if (!m_source)
+        return;
+    for (auto& entry : m_metadata)
+        entry = entry->clone();
+    for (auto& trial : m_trials)
+        trial.makeOwning();
+    m_source.reset();
+}
+
+void PExperiment::destroy()
+{
+    if (!m_source)
+        destroyPEntyVec(m_metadata);
+    m_metadata.clear();
+    m_trials.clear();
+    m_source.reset();
+    m_trialended = false;
+}
+
+void PExperiment::addEntry(const PEyeLogEntry* e)
+{
+    makeOwning();
+    insertEntry(const_cast<PEyeLogEntry*>(e), false);
+}
+
+/*
+ * Adds e to the meta data or the current trial, if borrow is true e
+ * itself is stored otherwise a clone.
+ */
+void PExperiment::insertEntry(PEyeLogEntry* e, bool borrow)
+{
+    // All entries prior to the first trial are added to m_metadata,
+    // subsequently a TRIAL creates a new trial and the following
+    // entries are pushed to that trial.
+    if (m_trials.empty() && e->getEntryType() != TRIAL) {
+        m_metadata.push_back(borrow ? e : e->clone());
+        return;
+    }
+    switch(e->getEntryType()) {
+        case TRIAL:
+            m_trialended = false;
+            m_trials.emplace_back(static_cast<const PTrialEntry*>(e));
+            break;
+        case TRIALSTART:
+            m_trials[m_trials.size() - 1].clear();
+            break;
+        case TRIALEND:
+            m_trialended = true;
+            break;
+        default:
+            if (m_trialended)
                 break;
-            default:
-                if(!end)
-                    m_trials[m_trials.size()-1].addEntry(e);
-        }
+            if (borrow)
+                m_trials[m_trials.size()-1].borrowEntry(e);
+            else
+                m_trials[m_trials.size()-1].addEntry(e);
+    }
+}
+
+/*
+ * Adds e like insertEntry(e, false) does, but e itself is stored instead
+ * of a clone. Entries that aren't stored are freed.
+ */
+void PExperiment::insertEntry(std::unique_ptr<PEyeLogEntry> e)
+{
+    entrytype type = e->getEntryType();
+    if (m_trials.empty() && type != TRIAL) {
+        m_metadata.push_back(e.get());
+        e.release();
+        return;
     }
+    if (type == TRIAL || type == TRIALSTART || type == TRIALEND ||
+        m_trialended
+        ) {
+        insertEntry(e.get(), false);
+        return;
+    }
+    m_trials[m_trials.size() - 1].adoptEntry(std::move(e));
+}
+
+int PExperiment::read(PLogReader& reader)
+{
+    PEyeLogEntry* e;
+    makeOwning();
+    while ((e = reader.next()) != nullptr)
+        insertEntry(std::unique_ptr<PEyeLogEntry>(e));
+    return reader.status();
 }
 
 bool PExperiment::operator==(const PExperiment& rhs) const
@@ -260,12 +529,29 @@ const PTrial& PExperiment::operator[] (DArray<PTrial>::size_type n) const
     return m_trials[n];
 }
 
+bool PExperiment::ownsEntries() const
+{
+    return !m_source;
+}
+
 void PExperiment::getLog(PEyeLog& log, bool append)const
 {
-    log.setEntries(m_metadata, !append);
+    if (!append)
+        log.clear();
+
+    std::size_t n = log.getEntries().size() + m_metadata.size();
+    for (const auto& trial : m_trials) {
+        n += 1 + trial.size();
+    }
+    log.reserve(unsigned(n));
+
+    // The same order as PTrial::getEntries, but cloned only once.
+    for (const auto* e : m_metadata)
+        log.addEntry(e->clone());
     for (const auto& trial : m_trials) {
-        PEntryVec temp = trial.getEntries();
-        log.setEntries(temp, false);
-        destroyPEntyVec(temp);
+        log.addEntry(trial.m_entry.clone());
+        for (const auto& entries : trial.m_entries)
+            for (const auto* e : entries)
+                log.addEntry(e->clone());
     }
 }
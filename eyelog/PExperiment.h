@@ -20,12 +20,38 @@
  * License along with this library; if not, see Licenses at www.gnu.org.
  */
 
+#ifndef PEXPERIMENT_H
+#define PEXPERIMENT_H
+
 #include"constants.h"
 #include"PEyeLogEntry.h"
 #include"PEyeLog.h"
 #include"DArray.h"
-#include<map>
+#include"PSampleStore.h"
+#include<atomic>
+#include<memory>
+
+class PLogReader;
+class PExperiment;
 
+/**
+ * A PTrial contains the entries of one trial, sorted on entrytype.
+ *
+ * The entries of every type are kept in an array indexed by entrytype,
+ * so looking up the entries of a type doesn't search. getGaze returns
+ * the gaze samples of an eye column wise, so an analysis of the samples
+ * reads contiguous memory instead of following a pointer per sample. The
+ * columns of an eye are only made on the first call of getGaze, trials
+ * that are never analyzed that way don't hold a second copy of their
+ * samples.
+ *
+ * Normally a trial owns copies of its entries. A trial of a PExperiment
+ * that refers to a PEyeLog only borrows the entries of that log, see
+ * PExperiment(PEyeLog&&). Copies of a trial always own their entries.
+ *
+ * The const methods of a trial may be called from many threads at once,
+ * as long as no thread changes the trial, see PEyeLog.
+ */
 class EYELOG_EXPORT PTrial {
     
     public:
@@ -33,6 +59,12 @@ class EYELOG_EXPORT PTrial {
         PTrial (const PTrialEntry* entry);
         PTrial (const PTrialEntry& entry);
         PTrial (const PTrial& rhs);
+
+        /**
+         * Takes over the entries and the trial entry of rhs, rhs is
+         * left without entries and may only be destroyed or assigned.
+         */
+        PTrial (PTrial&& rhs) noexcept;
         PTrial ();
 
         /**
@@ -42,13 +74,19 @@ class EYELOG_EXPORT PTrial {
          */
         PTrial& operator=(const PTrial& rhs);
 
+        /**
+         * Frees the contained entries and takes over those of rhs.
+         */
+        PTrial& operator=(PTrial&& rhs) noexcept;
+
         virtual ~PTrial();
 
         /**
          * Add a new entry to the entries in this trial.
          *
          * This clones the entry and puts it in the correct
-         * DArray with log entries.
+         * DArray with log entries. A trial that borrows its
+         * entries copies them first.
          */
         void addEntry(const PEntryPtr entry);
 
@@ -61,6 +99,16 @@ class EYELOG_EXPORT PTrial {
          */
         const DArray<PEyeLogEntry*>& operator[](entrytype type) const;
 
+        /**
+         * Returns the gaze samples of an eye as columns.
+         *
+         * Sample i of the columns is the same as trial[eye][i]. For a
+         * type other than LGAZE, RGAZE or AVGGAZE the columns are empty.
+         * The columns are made on the first call and are valid until
+         * the trial is changed.
+         */
+        const PGazeColumns& getGaze(entrytype eye) const;
+
         /**
          * Returns all the entries that belong to this trial.
          *
@@ -68,6 +116,12 @@ class EYELOG_EXPORT PTrial {
          */
         PEntryVec getEntries() const;
 
+        /**
+         * @return the number of entries in this trial, the trial entry
+         *         itself not included.
+         */
+        std::size_t size() const;
+
         /**
          * Clears all logentries.
          */
@@ -99,22 +153,58 @@ class EYELOG_EXPORT PTrial {
          */
         String getGroup()const;
 
+        /**
+         * @return false if the entries are borrowed from a PEyeLog.
+         */
+        bool ownsEntries() const;
+
     private:
 
+        friend class PExperiment;
+
+        void borrowEntry(PEyeLogEntry* entry);
+        void adoptEntry(std::unique_ptr<PEyeLogEntry> entry);
+        void shareEntries(const PTrial& rhs);
+        void makeOwning();
+        void dropColumns();
+
+        static const unsigned NTYPES = TRIALEND + 1;
+        enum {NUM_EYES = 3};
+
         /**
          * The trial entry belonging to this trial.
          */
         PTrialEntry m_entry;
 
         /**
-         * This map contains all entries that belong to this trial.
+         * The entries that belong to this trial, indexed by entrytype.
          */
-        std::map<entrytype, DArray<PEyeLogEntry*> > m_entries;
+        DArray<PEyeLogEntry*> m_entries[NTYPES];
 
+        /**
+         * The samples of m_entries[LGAZE], [RGAZE] and [AVGGAZE] column
+         * wise, or null until getGaze is called for that eye.
+         */
+        mutable std::atomic<PGazeColumns*> m_gaze[NUM_EYES];
+
+        /**
+         * The entries in m_entries are destroyed with this trial.
+         */
+        bool m_owning;
 };
 
 /**
  * An instance of PExperiment contains a number of trials.
+ *
+ * An experiment created from a const PEyeLog& or a DArray copies all
+ * entries. An experiment created from a PEyeLog&& or a shared PEyeLog
+ * keeps that log alive and its trials only refer to the entries of the
+ * log, splitting a log in trials then doesn't copy a single entry.
+ *
+ * The const methods of an experiment and of its trials may be called
+ * from many threads at once, as long as no thread changes the experiment
+ * or the log it borrows from, see PEyeLog. forEachTrial and reduceTrials
+ * of PThreadPool.h process the trials in parallel.
  */
 class EYELOG_EXPORT PExperiment {
 
@@ -127,6 +217,9 @@ class EYELOG_EXPORT PExperiment {
         
         /**
          * Init an experiment from another one.
+         *
+         * Entries that rhs borrows from a log are shared, all others
+         * are copied.
          */
         PExperiment(const PExperiment& rhs);
 
@@ -138,7 +231,8 @@ class EYELOG_EXPORT PExperiment {
         /**
          * copies the right hand side.
          *
-         * All contained PEyelogEntries are copied deeply. All
+         * All contained PEyelogEntries are copied deeply, unless rhs
+         * borrows them from a log, then the log is shared. All
          * contained entries are freed.
          */
         PExperiment& operator= (const PExperiment& rhs);
@@ -153,7 +247,41 @@ class EYELOG_EXPORT PExperiment {
          * Create an experiment from PEyeLog instance
          */
         PExperiment(const PEyeLog& log);
+
+        /**
+         * Create an experiment that takes over the entries of log.
+         *
+         * The trials borrow the entries, log is left empty.
+         */
+        PExperiment(PEyeLog&& log);
+
+        /**
+         * Create an experiment that borrows the entries of log.
+         *
+         * The experiment keeps a reference to log, so the entries
+         * remain valid as long as the experiment or one of its copies
+         * exists. The log must not be changed in the meantime.
+         */
+        PExperiment(std::shared_ptr<const PEyeLog> log);
         
+        /**
+         * Adds one entry to the experiment.
+         *
+         * Entries before the first TRIAL entry are meta data, a TRIAL
+         * entry starts a new trial and subsequent entries are added to
+         * that trial. This makes it possible to build an experiment
+         * incrementally, e.g. from a PLogReader. The entry is cloned.
+         * An experiment that borrows its entries copies them first.
+         */
+        void addEntry(const PEyeLogEntry* entry);
+
+        /**
+         * Adds all entries that remain in reader.
+         *
+         * @return 0 or the status of the reader when reading failed.
+         */
+        int read(PLogReader& reader);
+
         /**
          * compares this experiment to another experiment
          */
@@ -202,6 +330,11 @@ class EYELOG_EXPORT PExperiment {
          * @return a reference to a contained trial.
          */
         const PTrial& operator[] (DArray<PTrial>::size_type n) const;
+
+        /**
+         * @return false if the entries are borrowed from a PEyeLog.
+         */
+        bool ownsEntries() const;
     
     private:
 
@@ -210,6 +343,13 @@ class EYELOG_EXPORT PExperiment {
          */
         void initFromEntryVec(const PEntryVec& entries);
 
+        void insertEntry(PEyeLogEntry* entry, bool borrow);
+        void insertEntry(std::unique_ptr<PEyeLogEntry> entry);
+        void borrowFrom(std::shared_ptr<const PEyeLog> log);
+        void copyFrom(const PExperiment& rhs);
+        void makeOwning();
+        void destroy();
+
         /**
          * Data before the first trial is considered meta data
          */
@@ -219,4 +359,17 @@ class EYELOG_EXPORT PExperiment {
          * All the trials in the experiment.
          */
         DArray<PTrial>         m_trials;
+
+        /**
+         * The last trial has seen its TRIALEND entry.
+         */
+        bool                   m_trialended;
+
+        /**
+         * The log the entries are borrowed from, or null when the
+         * experiment owns its entries.
+         */
+        std::shared_ptr<const PEyeLog> m_source;
 };
+
+#endif
@@ -21,10 +21,21 @@
  */
 
 #include "PEyeLog.h"
+#include "PSampleStore.h"
+#include "PAscReader.h"
+#include "PTextScanner.h"
+#include "PMappedLog.h"
+#include "PBinaryFormat.h"
+#include "PBinaryWriter.h"
+#include "PCompressedFormat.h"
+#include "PCompressedLog.h"
+#include "PCsvWriter.h"
 #include "cError.h"
 #include "TypeDefs.h"
 #include <cassert>
 #include <cerrno>
+#include <cstring>
+#include <stdint.h>
 #include <sstream>
 #include <cctype>
 #include <iostream>
@@ -32,100 +43,10 @@
 
 using namespace std;
 
-/* reading of binary gaze entries */
-
-int readBinaryGaze(ifstream& stream, PEyeLogEntry** out, entrytype et) {
-    double time;
-    float x, y, pupil;
-    
-    assert(et == LGAZE || et == RGAZE);
-    assert(*out == nullptr);
-
-    if (!stream.read(reinterpret_cast<char*>(&time), sizeof(time)))
-        return errno;
-    if (!stream.read(reinterpret_cast<char*>(&x), sizeof(x)))
-        return errno;
-    if (!stream.read(reinterpret_cast<char*>(&y), sizeof(y)))
-        return errno;
-    if (!stream.read(reinterpret_cast<char*>(&pupil), sizeof(pupil)))
-        return errno;
-
-    *out = new PGazeEntry(et, time, x, y, pupil);
-    return 0;
-}
-
-int readBinaryFix(ifstream& stream, PEyeLogEntry** out, entrytype et) {
-    double time;
-    double duration;
-    float x, y;
-    
-    assert(et == LFIX || et == RFIX);
-    assert(*out == NULL);
-
-    if (!stream.read( (char*)&time      , sizeof(time)))
-        return errno;
-    if (!stream.read( (char*)&duration  , sizeof(duration)))
-        return errno;
-    if (!stream.read( (char*)&x         , sizeof(x)))
-        return errno;
-    if (!stream.read( (char*)&y         , sizeof(y)))
-        return errno;
-
-    *out = new PFixationEntry(et, time, duration, x, y);
-
-    return 0;
-}
-
-int readBinaryMessage(ifstream& stream, PEyeLogEntry** out) {
-    double time;
-    uint32_t s;
-    String::size_type size;
-    String msg;
-
-    assert(*out == nullptr);
-    
-    if (!stream.read( (char*)&time  , sizeof(time)))
-        return errno;
-    if (!stream.read( (char*)&s , sizeof(s)))
-        return errno;
-    size = String::size_type(s);
-    msg.resize(size);
-    if (!stream.read(&msg[0], size))
-        return errno;
-
-    *out = new PMessageEntry(time, msg);
-
-    return 0;
-}
-
-int readBinarySac(ifstream& stream, PEyeLogEntry** out, entrytype et) {
-    double time;
-    double duration;
-    float x1, y1, x2, y2;
-    
-    assert(et == LSAC || et == RSAC);
-
-    if (!stream.read( (char*)&time      , sizeof(time)))
-        return errno;
-    if (!stream.read( (char*)&duration  , sizeof(duration)))
-        return errno;
-    if (!stream.read( (char*)&x1        , sizeof(x1)))
-        return errno;
-    if (!stream.read( (char*)&y1        , sizeof(y1)))
-        return errno;
-    if (!stream.read( (char*)&x2        , sizeof(x2)))
-        return errno;
-    if (!stream.read( (char*)&y2        , sizeof(y2)))
-        return errno;
-
-    *out = new PSaccadeEntry(et, time, duration, x1, y1, x2, y2);
-
-    return 0;
-}
-
 PEyeLog::PEyeLog()
     : m_filename(),
-      m_isopen(false)
+      m_isopen(false),
+      m_writebinary(false)
 {
     this->clear();
 }
@@ -135,6 +56,36 @@ PEyeLog::~PEyeLog()
     clear();
 }
 
+PEyeLog::PEyeLog(PEyeLog&& other)
+    : m_entries(std::move(other.m_entries)),
+      m_trialindex(std::move(other.m_trialindex)),
+      m_file(std::move(other.m_file)),
+      m_filename(),
+      m_isopen(other.m_isopen),
+      m_writebinary(other.m_writebinary)
+{
+    // A moved from String has no characters at all.
+    std::swap(m_filename, other.m_filename);
+    m_arena.swap(other.m_arena);
+    other.m_trialindex.clear();
+}
+
+PEyeLog& PEyeLog::operator=(PEyeLog&& other)
+{
+    if (&other != this) {
+        clear();
+        m_entries = std::move(other.m_entries);
+        m_arena.swap(other.m_arena);
+        m_trialindex = std::move(other.m_trialindex);
+        other.m_trialindex.clear();
+        m_file = std::move(other.m_file);
+        std::swap(m_filename, other.m_filename);
+        m_isopen = other.m_isopen;
+        m_writebinary = other.m_writebinary;
+    }
+    return *this;
+}
+
 int PEyeLog::open(const String& fname)
 {
     m_filename = fname;
@@ -152,8 +103,13 @@ void PEyeLog::close()
 
 void PEyeLog::clear()
 {
-    destroyPEntyVec(m_entries);
+    // The entries in the arena are destroyed all at once.
+    for (auto* entry : m_entries)
+        if (!m_arena.owns(entry))
+            delete entry;
     m_entries.clear();
+    m_arena.clear();
+    m_trialindex.clear();
 }
 
 void PEyeLog::reserve(unsigned size)
@@ -164,17 +120,71 @@ void PEyeLog::reserve(unsigned size)
 
 void PEyeLog::addEntry(PEyeLogEntry* p)
 {
+    m_trialindex.addEntry(*p, m_entries.size());
     m_entries.push_back(p);
 }
 
+void PEyeLog::addGaze(entrytype eye,
+                      double time,
+                      float x,
+                      float y,
+                      float pupil
+                      )
+{
+    m_entries.push_back(m_arena.create<PGazeEntry>(eye, time, x, y, pupil));
+}
+
 void PEyeLog::setEntries(const PEntryVec& entries, bool empty)
 {
     if (empty)
         clear();
 
     m_entries.reserve(entries.size() + m_entries.size());
-    for (const auto* entry : entries)
+    for (const auto* entry : entries) {
+        m_trialindex.addEntry(*entry, m_entries.size());
         m_entries.push_back(entry->clone());
+    }
+}
+
+/*
+ * Destroys the entries from position n on and restores the index of the
+ * first n entries, this undoes a read that failed halfway. The gaze
+ * samples in the arena keep their memory until clear().
+ */
+void PEyeLog::truncate(std::size_t n, PTrialIndex&& trials)
+{
+    assert(n <= m_entries.size());
+    for (std::size_t i = n; i < m_entries.size(); i++)
+        if (!m_arena.owns(m_entries[i]))
+            delete m_entries[i];
+    m_entries.resize(n);
+    m_trialindex = std::move(trials);
+}
+
+void PEyeLog::merge(const std::vector<PEyeLog*>& logs)
+{
+    vector<const PEntryVec*> inputs;
+    inputs.push_back(&m_entries);
+    for (const auto* log : logs)
+        if (log != this)
+            inputs.push_back(&log->m_entries);
+
+    PEntryVec merged;
+    mergePEntryVecs(inputs, merged);
+
+    // The entries now belong to this log.
+    for (auto* log : logs) {
+        if (log == this)
+            continue;
+        m_arena.adopt(log->m_arena);
+        log->m_entries.clear();
+        log->m_trialindex.clear();
+    }
+    m_entries = std::move(merged);
+
+    m_trialindex.clear();
+    for (std::size_t i = 0; i < m_entries.size(); i++)
+        m_trialindex.addEntry(*m_entries[i], i);
 }
 
 int PEyeLog::read(const String& file, bool clear_content)
@@ -185,36 +195,107 @@ int PEyeLog::read(const String& file, bool clear_content)
     return readLog(this, file);
 }
 
-int PEyeLog::write(eyelog_format f) const
+/*
+ * Writes the binary format with a PBinaryWriter.
+ */
+int PEyeLog::writeBuffered(unsigned flags) const
+{
+    PBinaryWriter writer;
+    int ret;
+
+    // O_DIRECT needs a file descriptor of its own, only a file that is
+    // still empty can be handed over.
+    if ((flags & WRITE_DIRECT) && m_file.tellp() == ofstream::pos_type(0)) {
+        m_file.close();
+        ret = writer.open(m_filename, WRITE_DIRECT);
+        if (ret == 0)
+            ret = writer.write(m_entries);
+        int closed = writer.close();
+        if (ret == 0)
+            ret = closed;
+        // reopen at the end, so that subsequent writes append.
+        m_file.open(m_filename.c_str(),
+                    fstream::binary | fstream::out | fstream::in | fstream::ate
+                    );
+        if (ret == 0 && !m_file.is_open())
+            ret = errno;
+        return ret;
+    }
+
+    ret = writer.open(m_file);
+    if (ret == 0)
+        ret = writer.write(m_entries);
+    int closed = writer.close();
+    return ret ? ret : closed;
+}
+
+int PEyeLog::write(eyelog_format f, unsigned flags) const
 {
     int ret = 0;
-    if (f == FORMAT_BINARY) {
+    if (f == FORMAT_BINARY && flags != WRITE_STREAM) {
+        ret = writeBuffered(flags);
+    }
+    else if (f == FORMAT_BINARY) {
+        // A new file starts with the header and ends with the index,
+        // appending writes have neither.
+        bool start = m_file.tellp() == ofstream::pos_type(0);
+        PBlockIndex blocks;
+        if (start) {
+            ret = writeBinaryHeader(m_file, BINARY_FLAG_INDEX);
+            if (ret)
+                return ret;
+        }
         for (const auto& entry : m_entries) {
+            if (start)
+                blocks.addEntry(entry->getTime(),
+                                blocks.startsBlock() ? uint64_t(m_file.tellp()) : 0
+                                );
             ret = entry->writeBinary(m_file);
             if (ret)
                 return ret;
         }
-    }
-    else if (f == FORMAT_CSV) {
-        for (unsigned i = 0; i < m_entries.size(); ++i) {
-            String line;
-            // only last line is without lineterminator.
-            if (i == m_entries.size() -1) 
-                line = m_entries[i]->toString();
-            else
-                line = m_entries[i]->toString() + '\n';
-
-            if (!(m_file << line.c_str())) {
+        if (start) {
+            vector<char> record;
+            encodeBinaryIndex(record,
+                              m_trialindex,
+                              blocks,
+                              m_entries.size(),
+                              uint64_t(m_file.tellp())
+                              );
+            if (!m_file.write(record.data(), record.size()))
                 return errno;
-            }
         }
     }
+    else if (f == FORMAT_BINARY_V2) {
+        PCompressedWriter writer;
+        ret = writer.open(m_file);
+        if (ret == 0)
+            ret = writer.write(m_entries);
+        int closed = writer.close();
+        if (ret == 0)
+            ret = closed;
+    }
+    else if (f == FORMAT_CSV) {
+        ret = writeCsv(PFormatContext());
+    }
     else {
         ret = ERR_INVALID_PARAMETER;
     }
     return ret;
 }
 
+int PEyeLog::writeCsv(const PFormatContext& format) const
+{
+    PCsvWriter writer(m_file, format);
+    for (unsigned i = 0; i < m_entries.size(); ++i) {
+        // only last line is without lineterminator.
+        int ret = writer.write(*m_entries[i], i != m_entries.size() - 1);
+        if (ret)
+            return ret;
+    }
+    return writer.flush();
+}
+
 bool PEyeLog::isOpen() const
 {
     return m_file.is_open();
@@ -230,292 +311,104 @@ const DArray<PEyeLogEntry*>& PEyeLog::getEntries()const
     return m_entries;
 }
 
-/* *******
- * Implementation of functions that load a PEyeLog from disk.
- */
-
-/**
- * returns the contents of a file in a String
- */
-String readStreamAsString(ifstream& s)
-{
-    String ret;
-    assert(s.tellg() == ifstream::pos_type(0));
-    s.seekg(0, s.end);
-    streampos size = s.tellg();
-    s.seekg(0);
-    ret.resize(string::size_type(size));
-    s.read(&ret[0], ret.size());
-    return std::move(ret);
-}
-
-/**
- * returns a DArray of Strings.
- */
-DArray<String> getLines(ifstream& stream)
+const PTrialIndex& PEyeLog::getTrialIndex() const
 {
-    DArray<String> output;
-    string buffer;
-
-    assert(stream.good());
-
-    while (getline(stream, buffer,'\n'))
-        output.push_back(String(buffer.c_str()));
-    return output;
+    return m_trialindex;
 }
 
-bool is_a_digit(const String& token)
+PEntryRange PEyeLog::getTrialEntries(const PTrialIndex::Trial& trial) const
 {
-    for (int c: token) {
-        if (c < '0' || c > '9')
-            return false;
-    }
-    return true;
+    std::size_t end = trial.end == PTrialIndex::npos ?
+                      m_entries.size() : trial.end;
+    assert(trial.begin <= end && end <= m_entries.size());
+    return PEntryRange(&m_entries[0] + trial.begin, &m_entries[0] + end);
 }
 
-// deprecated prefer the overload with String instead.
-bool is_a_digit(const std::string& token)
-{
-    for (int c: token) {
-        if (c < '0' || c > '9')
-            return false;
-    }
-    return true;
-}
+/* *******
+ * Implementation of functions that load a PEyeLog from disk.
+ */
 
-int readAscManual(std::ifstream& stream, PEyeLog* plog)
+int readCsvBuffer(PEntrySink* plog, const char* begin, const char* end)
 {
-    DArray<String> lines = getLines(stream);
-    bool isleft = false;
-    DArray<PEyeLogEntry*>::size_type startsize = plog->getEntries().size();
-
-    // loops over all lines ignoring those values it doesn't understand
-    for (const auto& line : lines) {
-        istringstream stream(line.c_str());
-        string token;
-
-        stream >> token;
-
-        if (is_a_digit(token)) { // either bi or monocular sample
-            float x1, y1, p1=0, x2, y2, p2=0;
-            double time = atof(token.c_str());
-            string leftover;
-            std::getline(stream, leftover);
-            int matched = sscanf(leftover.c_str(),
-                    "%f%f%f%f%f%f",
-                    &x1, &y1, &p1, &x2, &y2, &p2
-                    );
-            if (matched >= 3 && matched < 6) { // monocular sample
-                plog->addEntry(
-                        
-                        new PGazeEntry( isleft ? LGAZE : RGAZE,
-                                       time,
-                                       x1,
-                                       y1,
-                                       p1
-                                       )
-                        );
-            }
-            else if (matched == 6) { // binocular sample
-                plog->addEntry(
-                        new PGazeEntry( LGAZE,
-                                       time,
-                                       x1,
-                                       y1,
-                                       p1
-                                       )
-                        );
-                                           
-                plog->addEntry(
-                        new PGazeEntry( RGAZE,
-                                       time,
-                                       x2,
-                                       y2,
-                                       p2
-                                       )
-                        );
-            }
-        }
-        else if (token == "EFIX") {
-            string c;
-			double tstart, tend, dur;
-		    float x, y; 
-            if (stream >> c >> tstart >> tend >> dur >> x >> y) {
-                plog->addEntry(
-                        new PFixationEntry(c == "L" ? LFIX : RFIX,
-                                          tstart,
-                                          dur,
-                                          x,
-                                          y
-                                          )
-                        );
-            }
-        }
-        else if (token == "MSG") {
-            double time;
-            string msg;
-            string leftover;
-            if (! (stream >> time) )
-                continue;
-            std::getline(stream, leftover);
-            
-            // remove leading whitespace
-            string::iterator it;
-            for (it = leftover.begin(); it < leftover.end(); it++)
-                if (! std::isspace(*it))
-                    break;
-            msg = string(it, leftover.end());
-
-            while(msg.size() > 0 && isspace(msg[msg.size()-1]) )//rm trailing whitespace
-                msg.resize(msg.size()-1);
-
-            plog->addEntry(
-                    new PMessageEntry(
-                        time,
-                        String(&msg[0], &msg[0] + msg.size())
-                        )
-                    );
+    PTextScanner scanner(begin, end);
 
-        }
-        else if (token == "SAMPLES") {
-            string gaze, leftorright;
-            if (stream >> gaze >> leftorright) {
-                if (gaze != "GAZE")
-                    continue;
-                isleft = leftorright == "RIGHT" ? true : false;
-            }
-        }
-    }
-    return plog->getEntries().size() > startsize ? 0 : ERR_INVALID_FILE_FORMAT;
-}
-
-int readCsvFormat(std::ifstream& stream, PEyeLog* plog)
-{
-    int result = 0;
-    bool noerror = true;
-    while (stream && noerror) {
+    for (;;) {
         double time, dur;
         float x1, y1, x2, y2, p;
-        string msg;
+        const char *msg, *msgend;
         unsigned type;
         entrytype e;
 
-        if(stream >> type)
+        if (scanner.readUnsigned(type))
             ;
-        else if (stream.eof())
+        else if (scanner.atEnd())
             break;
-        else {
+        else
             return ERR_INVALID_FILE_FORMAT;
-        }
+
         switch (e = entrytype(type)) {
             case LGAZE:
             case RGAZE:
-                if (stream >> time >> x1 >> y1 >> p)
-                    plog->addEntry(new PGazeEntry(e, time, x1, y1, p));
-                else {
-                    noerror = false;
+            case AVGGAZE:
+                if (scanner.readDouble(time) &&
+                    scanner.readFloat(x1) &&
+                    scanner.readFloat(y1) &&
+                    scanner.readFloat(p)
+                    )
+                    plog->addGaze(e, time, x1, y1, p);
+                else
                     return ERR_INVALID_FILE_FORMAT;
-                }
                 break;
             case LFIX:
             case RFIX:
-                if (stream >> time >> dur >> x1 >> y1)
+            case AVGFIX:
+                if (scanner.readDouble(time) &&
+                    scanner.readDouble(dur) &&
+                    scanner.readFloat(x1) &&
+                    scanner.readFloat(y1)
+                    )
                     plog->addEntry(
                             new PFixationEntry(e, time, dur, x1, y1)
                             );
-                else {
-                    noerror = false;
+                else
                     return ERR_INVALID_FILE_FORMAT;
-                }
                 break;
             case STIMULUS:
                 assert(1==0); // not implemented yet.
             case MESSAGE:
-                if (stream >> time) {
-                    char c;
+                if (scanner.readDouble(time)) {
                     // remove leading whitespace.
-                    while (stream >> c) {
-                        if (!std::isspace(c)) {
-                            stream.unget();
-                            break;
-                        }
-                    }
-                    std::getline(stream, msg, '\n');
+                    scanner.skipSpace();
+                    scanner.readLine(msg, msgend);
+                    scanner.skipLine();
                     plog->addEntry(
-                            new PMessageEntry(
-                                time,
-                                String(&msg[0], &msg[0]+msg.size())
-                                )
+                            new PMessageEntry(time, String(msg, msgend))
                             );
                 }
-                else {
-                    noerror = false;
+                else
                     return ERR_INVALID_FILE_FORMAT;
-                }
                 break;
             case LSAC:
             case RSAC:
-                if (stream >> time >> dur >> x1 >> y1 >> x2 >> y2)
+            case AVGSAC:
+                if (scanner.readDouble(time) &&
+                    scanner.readDouble(dur) &&
+                    scanner.readFloat(x1) &&
+                    scanner.readFloat(y1) &&
+                    scanner.readFloat(x2) &&
+                    scanner.readFloat(y2)
+                    )
                     plog->addEntry(
                             new PSaccadeEntry(e, time, dur, x1, y1, x2, y2)
                             );
-                else {
-                    noerror = false;
+                else
                     return ERR_INVALID_FILE_FORMAT;
-                }
                 break;
             default:
-                result = ERR_INVALID_FILE_FORMAT;
-                noerror = false;
+                return ERR_INVALID_FILE_FORMAT;
         };
     }
-    return result;
-}
-
-int readBinary(std::ifstream& stream, PEyeLog* plog)
-{
-    int result = 0;
-    assert(stream.is_open());
-    
-    while (stream) {
-        uint16_t e;
-        entrytype et;
-        
-        stream.read((char*)&e, sizeof(e));
-        if (stream.eof())
-            break;
-
-        et = entrytype(e);
-        PEyeLogEntry* p = nullptr;
-        switch(et) {
-            case LGAZE:
-            case RGAZE:
-                result = readBinaryGaze(stream, &p, et);
-                break;
-            case LFIX:
-            case RFIX:
-                 result = readBinaryFix(stream, &p, et);
-                break;
-            case MESSAGE:
-                 result = readBinaryMessage(stream, &p);
-                break;
-            case LSAC:
-            case RSAC:
-                 result = readBinarySac(stream, &p, et);
-                break;
-            default:
-                return -1;
-        }
-        
-        if (result){
-            plog->clear();
-            return result;
-        }
-
-        if (p)
-            plog->addEntry(p);
-    }
-    return result;
+    return 0;
 }
 
 /**
@@ -536,32 +429,195 @@ int writeBinary(std::ofstream& stream, const PEyeLog& l)
     return result;
 }
 
-int readLog(PEyeLog* out, const String& filename) {
-    ifstream stream;
-    int result; 
-    stream.open(filename.c_str(), ios::in | ios::binary);
+/*
+ * The number of bytes detectLogFormat looks at.
+ */
+static const std::size_t SNIFF_SIZE = 4096;
+
+/*
+ * Checks whether line is a complete line of our csv format.
+ */
+static bool isCsvLine(const char* begin, const char* end)
+{
+    PTextScanner scanner(begin, end);
+    unsigned type;
+    double d;
+    float f;
+    int ndoubles, nfloats;
+
+    if (!scanner.readUnsigned(type))
+        return false;
+
+    switch (type) {
+        case LGAZE:
+        case RGAZE:
+        case AVGGAZE:
+            ndoubles = 1;
+            nfloats = 3;
+            break;
+        case LFIX:
+        case RFIX:
+        case AVGFIX:
+            ndoubles = 2;
+            nfloats = 2;
+            break;
+        case LSAC:
+        case RSAC:
+        case AVGSAC:
+            ndoubles = 2;
+            nfloats = 4;
+            break;
+        case MESSAGE:
+            return scanner.readDouble(d);
+        default:
+            return false;
+    }
+    for (int i = 0; i < ndoubles; i++)
+        if (!scanner.readDouble(d))
+            return false;
+    for (int i = 0; i < nfloats; i++)
+        if (!scanner.readFloat(f))
+            return false;
+    scanner.skipSpace();
+    return scanner.atEnd();
+}
+
+eyelog_format detectLogFormat(const char* data, std::size_t size)
+{
+    if (size > SNIFF_SIZE)
+        size = SNIFF_SIZE;
+
+    if (hasBinaryMagic(data, size))
+        return isCompressedBinary(data, size) ? FORMAT_BINARY_V2 : FORMAT_BINARY;
+
+    // Text doesn't contain '\0', a record of a binary file without
+    // header does, since the entrytype is stored in an uint16_t.
+    if (size && memchr(data, '\0', size)) {
+        uint16_t type;
+        if (size < sizeof(type))
+            return FORMAT_UNKNOWN;
+        memcpy(&type, data, sizeof(type));
+        return isBinaryRecordType(type) ? FORMAT_BINARY : FORMAT_UNKNOWN;
+    }
 
-    if ( !stream.is_open() )
+    // The first line that isn't empty decides between csv and asc.
+    PTextScanner scanner(data, data + size);
+    scanner.skipSpace();
+    if (scanner.atEnd())
+        return FORMAT_UNKNOWN;
+    const char *line, *eol;
+    scanner.readLine(line, eol);
+    return isCsvLine(line, eol) ? FORMAT_CSV : FORMAT_ASC;
+}
+
+int detectLogFormat(const String& filename, eyelog_format* format)
+{
+    char buffer[SNIFF_SIZE];
+    ifstream stream(filename.c_str(), ios::in | ios::binary);
+    if (!stream.is_open())
+        return errno;
+
+    stream.read(buffer, sizeof(buffer));
+    if (stream.bad())
         return errno;
 
-    // First we try to read as binary
-    result = ::readBinary(stream, out);
+    *format = detectLogFormat(buffer, std::size_t(stream.gcount()));
+    return 0;
+}
 
-    /*Clear file status try read in our CsvFormat*/
-    if (result != 0) {
-        stream.seekg(0);
-        stream.clear();
-        assert(stream.good());
-        result = readCsvFormat(stream, out);
+/*
+ * Detects the format of the file and runs the reader for that format.
+ *
+ * The Sink type must be accepted by readMappedLog and readCompressedLog
+ * and provide PEntrySink.
+ */
+template <class Sink>
+static int readFormats(Sink* out,
+                       const String& filename,
+                       eyelog_format* format
+                       )
+{
+    PMappedFile file;
+    int result = file.open(filename);
+    if (result)
+        return result;
+
+    eyelog_format f = detectLogFormat(file.data(), file.size());
+    if (format)
+        *format = f;
+
+    switch (f) {
+        case FORMAT_BINARY:
+            file.close();
+            return readMappedLog(out, filename);
+        case FORMAT_BINARY_V2:
+            file.close();
+            return readCompressedLog(out, filename);
+        case FORMAT_CSV:
+            return readCsvBuffer(out, file.data(), file.data() + file.size());
+        case FORMAT_ASC:
+            return readAscBuffer(out, file.data(), file.data() + file.size());
+        default:
+            // Like before, an empty file is an empty log.
+            return file.size() == 0 ? 0 : ERR_INVALID_FILE_FORMAT;
     }
+}
 
-    /*Clear file status try read in Eyelink EDF format*/
-    if (result != 0) {
-        stream.seekg(0);
-        stream.clear();
-        assert(stream.good());
-        result = readAscManual(stream, out);
+int readLog(PEyeLog* out, const String& filename, eyelog_format* format)
+{
+    return readFormats(out, filename, format);
+}
+
+int readLog(PSampleStore* out, const String& filename, eyelog_format* format)
+{
+    return readFormats(out, filename, format);
+}
+
+int readLog(PEntrySink* out, const String& filename, eyelog_format* format)
+{
+    return readFormats(out, filename, format);
+}
+
+/*
+ * A sink that only indexes the entries.
+ */
+class PIndexSink : public PEntrySink {
+
+public:
+
+    PIndexSink(PTrialIndex* index) : m_index(index), m_count(0) {}
+
+    virtual void addGaze(entrytype, double, float, float, float)
+    {
+        m_count++;
     }
 
-    return result;
+    virtual void addEntry(PEyeLogEntry* entry)
+    {
+        m_index->addEntry(*entry, m_count++);
+        delete entry;
+    }
+
+private:
+
+    PTrialIndex*    m_index;
+    std::size_t     m_count;
+};
+
+int readTrialIndex(PTrialIndex* out, const String& filename)
+{
+    PMappedFile file;
+    const char* payload;
+    std::size_t n;
+
+    out->clear();
+    int ret = file.open(filename);
+    if (ret)
+        return ret;
+    if (findBinaryIndex(file.data(), file.size(), &payload, &n))
+        return decodeBinaryIndex(payload, n, out);
+    file.close();
+
+    PIndexSink sink(out);
+    return readFormats(&sink, filename, nullptr);
 }
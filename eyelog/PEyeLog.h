@@ -25,20 +25,126 @@
 
 #include "TypeDefs.h"
 #include "DArray.h"
+#include <cstddef>
 #include <fstream>
+#include <vector>
 #include "PEyeLogEntry.h"
+#include "PEntrySink.h"
+#include "PEntryArena.h"
+#include "PTrialIndex.h"
 #include "constants.h"
 
+class PSampleStore;
+
+/**
+ * Determines the format of a logfile from the first bytes of the file.
+ *
+ * Binary files are recognized by their header, the version in the header
+ * tells FORMAT_BINARY from FORMAT_BINARY_V2. Binary files written by
+ * older versions of libeye are recognized by the '\0' bytes of the
+ * entrytype. A text file
+ * whose first line matches the csv format is FORMAT_CSV, any other text
+ * is regarded as FORMAT_ASC. Only the first 4096 bytes are examined.
+ *
+ * @param data the first bytes of the file.
+ * @param size the number of bytes in data.
+ *
+ * @return the format, FORMAT_UNKNOWN for empty or unrecognized data.
+ */
+EYELOG_EXPORT eyelog_format detectLogFormat(const char* data, std::size_t size);
+
+/**
+ * Determines the format of a logfile.
+ *
+ * @param filename, the file to examine.
+ * @param [out] format, the format of the file.
+ *
+ * @return 0 or an errno value when the file can't be read.
+ */
+EYELOG_EXPORT int detectLogFormat(const String& filename,
+                                  eyelog_format* format
+                                  );
+
 /**
  * readLog opens a logfile
  *
  * readLog opens a logfile and determines its contents.
- * tries to read the binary format first, if that fails
+ * The format is determined with detectLogFormat, thereafter only the
+ * reader for that format is run.
+ * The entries are appended to out. For the binary formats nothing is
+ * appended when the file is invalid: a FORMAT_BINARY file is validated
+ * before any entry is added, the entries of an invalid FORMAT_BINARY_V2
+ * file are removed again, see readCompressedLog. A text file is read up
+ * to the error.
+ *
+ * @param out, will be initialized.
+ * @param filename, the file to open.
+ * @param format, if not null the detected format is stored here.
+ */
+EYELOG_EXPORT int  readLog(PEyeLog* out,
+                           const String& filename,
+                           eyelog_format* format=nullptr
+                           );
+
+/**
+ * readLog fills a columnar sample store from a logfile.
+ *
+ * This reads the file in the same way as readLog(PEyeLog*, const String&),
+ * but the gaze samples are stored directly in out, without creating
+ * PGazeEntry 's. All other entries are skipped.
+ *
  * @param out, will be initialized.
  * @param filename, the file to open.
+ * @param format, if not null the detected format is stored here.
  */
-EYELOG_EXPORT int  readLog(PEyeLog* out, const String& filename);
+EYELOG_EXPORT int  readLog(PSampleStore* out,
+                           const String& filename,
+                           eyelog_format* format=nullptr
+                           );
 
+/**
+ * readLog passes the entries of a logfile to a sink.
+ *
+ * The entries are handed to out while the file is read, e.g. to a
+ * PEventDetector, so they don't have to be kept in memory.
+ *
+ * @param out, receives the entries.
+ * @param filename, the file to open.
+ * @param format, if not null the detected format is stored here.
+ */
+EYELOG_EXPORT int  readLog(PEntrySink* out,
+                           const String& filename,
+                           eyelog_format* format=nullptr
+                           );
+
+/**
+ * Reads the trials of a logfile.
+ *
+ * The binary files written by libeye end with an index of their trials,
+ * then only the index is read. Otherwise the file is read like readLog
+ * does, without keeping the entries.
+ *
+ * @param out, will be initialized.
+ * @param filename, the file to read.
+ *
+ * @return 0, an errno value or ERR_INVALID_FILE_FORMAT.
+ */
+EYELOG_EXPORT int readTrialIndex(PTrialIndex* out, const String& filename);
+
+/**
+ * Parses the contents of a csv logfile in memory.
+ *
+ * @param out       receives the parsed entries.
+ * @param begin     first character of the buffer.
+ * @param end       one past the last character of the buffer.
+ *
+ * @return 0 or ERR_INVALID_FILE_FORMAT when an entry is invalid, the
+ *         entries before it have been handed to out.
+ */
+EYELOG_EXPORT int readCsvBuffer(PEntrySink* out,
+                                const char* begin,
+                                const char* end
+                                );
 
 /**
  * PEyeLog is a utility to log events. Logged times are in milliseconds
@@ -46,14 +152,41 @@ EYELOG_EXPORT int  readLog(PEyeLog* out, const String& filename);
  * It is possible to generate a Eyelink compatible logfile.
  * The eyelog will destroy all entries that are given to it, either
  * read from disk or via addEntrie(s).
+ * The gaze samples that are read from disk or added with addGaze are
+ * created in an arena of the log, so a large log is freed quickly.
+ * These entries are owned by the log too, so never delete an entry
+ * obtained from getEntries(), clone it when it should outlive the log.
+ * While entries are added the log keeps a PTrialIndex of them, so the
+ * entries of a trial are found without a scan of the log.
+ *
+ * Thread safety: like the standard containers, a PEyeLog, PExperiment or
+ * PTrial may be read by many threads at once through its const methods,
+ * and the entries obtained from it through theirs, including toString.
+ * While one thread changes an object, no other thread may use it. The
+ * write methods are the exception, although const they use the file of
+ * the log, so only one thread may write a log at a time. Different
+ * objects can be used freely from different threads. The defaults of
+ * PEyeLogEntry::setSeparator and setPrecision may be changed at any time,
+ * writers copy them into their PFormatContext when they are created.
+ * PThreadPool runs loops over entries and trials on all cores.
  */
-class EYELOG_EXPORT PEyeLog {
+class EYELOG_EXPORT PEyeLog : public PEntrySink {
 
 public :
 
     PEyeLog();
     ~PEyeLog();
 
+    /**
+     * Takes over the entries and the file of other, other is left empty.
+     */
+    PEyeLog(PEyeLog&& other);
+
+    /**
+     * Destroys the entries of this log and takes over those of other.
+     */
+    PEyeLog& operator=(PEyeLog&& other);
+
     /**
      * open the log file
      * 
@@ -88,14 +221,41 @@ public :
      * log entry, there for you might want to call PEyeLogEntry::clone()
      * to pass this entry.
      */
-    void addEntry(PEyeLogEntry* entry);
+    virtual void addEntry(PEyeLogEntry* entry);
+
+    /**
+     * Adds a gaze sample to this log.
+     *
+     * The PGazeEntry is created in the arena of the log.
+     */
+    virtual void addGaze(entrytype eye,
+                         double time,
+                         float x,
+                         float y,
+                         float pupil
+                         );
 
     /**
      * writes the file in a binary format.
      *
+     * @param f     FORMAT_BINARY, FORMAT_BINARY_V2 or FORMAT_CSV.
+     * @param flags for the binary format one of eyelog_write_flags,
+     *              WRITE_BUFFERED and WRITE_DIRECT write via a
+     *              PBinaryWriter, the output is identical.
+     *              FORMAT_BINARY_V2 is always written by a
+     *              PCompressedWriter with the defaultBlockCodec.
+     *
      * @return returns 0 when succesfull or an value from errno.h when not.
      */
-    int write(eyelog_format f=FORMAT_BINARY)const;
+    int write(eyelog_format f=FORMAT_BINARY, unsigned flags=WRITE_STREAM)const;
+
+    /**
+     * writes the file in FORMAT_CSV with the separator and precision of
+     * format, write(FORMAT_CSV) uses the defaults of PEyeLogEntry.
+     *
+     * @return returns 0 when succesfull or an value from errno.h when not.
+     */
+    int writeCsv(const PFormatContext& format) const;
 
     /**
      * Opens file and reads the contents, before reading
@@ -123,6 +283,17 @@ public :
      */
     const DArray<PEyeLogEntry*>& getEntries()const;
 
+    /**
+     * Gets the index of the trials in the entries.
+     */
+    const PTrialIndex& getTrialIndex() const;
+
+    /**
+     * Gets the entries of a trial of getTrialIndex(), from its
+     * TRIAL entry up to and including the entry that ended it.
+     */
+    PEntryRange getTrialEntries(const PTrialIndex::Trial& trial) const;
+
     /**
      * Sets the logentries and optionally clear the existing.
      *
@@ -135,12 +306,33 @@ public :
                     bool clear=true
                     );
 
+    /**
+     * Merges the entries of other logs into this log.
+     *
+     * This log and the others must be in order of time, the result is
+     * too. The entries are moved instead of cloned, the other logs are
+     * left empty.
+     *
+     * @param logs  the logs to merge, every log at most once.
+     */
+    void merge(const std::vector<PEyeLog*>& logs);
+
 private:
 
+    friend int readCompressedLog(PEyeLog* out,
+                                 const String& filename,
+                                 unsigned nthreads
+                                 );
+
+    int writeBuffered(unsigned flags) const;
+    void truncate(std::size_t n, PTrialIndex&& trials);
+
     PEyeLog(const PEyeLog&);
     PEyeLog& operator=(const PEyeLog&);
 
     DArray<PEyeLogEntry*>   m_entries;
+    PEntryArena             m_arena;
+    PTrialIndex             m_trialindex;
 
     mutable std::ofstream   m_file;
 
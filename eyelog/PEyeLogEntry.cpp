@@ -21,17 +21,75 @@
  */
 
 #include <cassert>
+#include <cmath>
+#include <limits>
 #include <sstream>
 #include <algorithm>
+#include <thread>
+#include <vector>
 #include "PEyeLogEntry.h"
 #include "TypeDefs.h"
 
+using std::vector;
+
+/*
+ * Times closer than this (in ms) are considered equal by compare.
+ */
+static const double TIME_TOLERANCE = 1e-6;
+
+/*
+ * Below this size keys are sorted by one thread, also the minimal
+ * size of the part that each thread sorts.
+ */
+static const std::size_t MIN_PARALLEL_SORT = 1 << 16;
+
+/*
+ * Runs of entries with equal times that are shorter than this are put in
+ * order by insertion, longer ones by std::sort.
+ */
+static const std::size_t MAX_INSERTION_RUN = 16;
+
 struct PEntryPtrSortPredicate {
     bool operator()(const PEntryPtr l, const PEntryPtr r) {
         return l->compare(*r) < 0;
     }
 };
 
+/*
+ * Same as l->compare(*r), but only entries of the same type at the same
+ * time go through the virtual compare.
+ */
+static inline int compareEntries(const PEyeLogEntry* l, const PEyeLogEntry* r)
+{
+    double diff = l->getTime() - r->getTime();
+    if (diff < -TIME_TOLERANCE)
+        return -1;
+    if (diff > TIME_TOLERANCE)
+        return 1;
+    if (l->getEntryType() != r->getEntryType())
+        return l->getEntryType() - r->getEntryType();
+    return l->compare(*r);
+}
+
+/*
+ * What sortPEntryVec sorts on, index is the position of the entry
+ * before sorting.
+ */
+struct PEntrySortKey {
+    double      time;
+    std::size_t index;
+    unsigned    type;
+
+    bool operator<(const PEntrySortKey& rhs) const
+    {
+        if (time != rhs.time)
+            return time < rhs.time;
+        if (type != rhs.type)
+            return type < rhs.type;
+        return index < rhs.index;
+    }
+};
+
 /* ** utility functions * **/
 
 PEntryVec copyPEntryVec(const PEntryVec& entries)
@@ -49,34 +107,233 @@ void destroyPEntyVec(PEntryVec& entries)
         delete entries[i];
 }
 
-void sortPEntryVec(PEntryVec& vec)
+/*
+ * Sorts keys with nthreads threads, each sorts a part of the keys,
+ * thereafter pairs of parts are merged in parallel until one is left.
+ */
+static void sortKeys(vector<PEntrySortKey>& keys, unsigned nthreads)
+{
+    std::size_t n = keys.size();
+    std::size_t nparts = std::min<std::size_t>(nthreads, n / MIN_PARALLEL_SORT);
+    if (nparts <= 1) {
+        std::sort(keys.begin(), keys.end());
+        return;
+    }
+
+    vector<std::size_t> bounds;
+    for (std::size_t i = 0; i <= nparts; i++)
+        bounds.push_back(n * i / nparts);
+
+    vector<std::thread> threads;
+    for (std::size_t i = 0; i < nparts; i++) {
+        PEntrySortKey* first = keys.data() + bounds[i];
+        PEntrySortKey* last = keys.data() + bounds[i + 1];
+        threads.push_back(std::thread([first, last] () {
+            std::sort(first, last);
+        }));
+    }
+    for (auto& t : threads)
+        t.join();
+
+    vector<PEntrySortKey> buffer(n);
+    vector<PEntrySortKey>* in = &keys;
+    vector<PEntrySortKey>* out = &buffer;
+    while (bounds.size() > 2) {
+        vector<std::size_t> merged;
+        threads.clear();
+        for (std::size_t i = 0; i + 1 < bounds.size(); i += 2) {
+            std::size_t b = bounds[i];
+            std::size_t m = bounds[i + 1];
+            std::size_t e = i + 2 < bounds.size() ? bounds[i + 2] : m;
+            PEntrySortKey* src = in->data();
+            PEntrySortKey* dst = out->data();
+            threads.push_back(std::thread([src, dst, b, m, e] () {
+                std::merge(src + b, src + m, src + m, src + e, dst + b);
+            }));
+            merged.push_back(b);
+        }
+        merged.push_back(n);
+        for (auto& t : threads)
+            t.join();
+        bounds.swap(merged);
+        std::swap(in, out);
+    }
+    if (in != &keys)
+        keys.swap(*in);
+}
+
+/*
+ * The keys order entries whose times differ by more than TIME_TOLERANCE
+ * the same way compare does. Entries within the tolerance of their
+ * neighbour are put in the order of compare here.
+ */
+static void sortEqualTimes(PEntryVec& vec)
+{
+    std::size_t n = vec.size();
+    std::size_t begin = 0;
+    while (begin < n) {
+        std::size_t end = begin + 1;
+        while (end < n &&
+               !(vec[end]->getTime() - vec[end - 1]->getTime() > TIME_TOLERANCE))
+            end++;
+
+        if (end - begin <= MAX_INSERTION_RUN) {
+            for (std::size_t i = begin + 1; i < end; i++) {
+                PEntryPtr e = vec[i];
+                std::size_t j = i;
+                for (; j > begin && compareEntries(e, vec[j - 1]) < 0; j--)
+                    vec[j] = vec[j - 1];
+                vec[j] = e;
+            }
+        }
+        else {
+            std::sort(&vec[0] + begin, &vec[0] + end, PEntryPtrSortPredicate());
+        }
+        begin = end;
+    }
+}
+
+void sortPEntryVec(PEntryVec& vec, unsigned nthreads)
+{
+    const std::size_t n = vec.size();
+    if (n < 2)
+        return;
+
+    if (nthreads == 0)
+        nthreads = std::thread::hardware_concurrency();
+    if (nthreads == 0)
+        nthreads = 1;
+
+    vector<PEntrySortKey> keys(n);
+    for (std::size_t i = 0; i < n; i++) {
+        double t = vec[i]->getTime();
+        // NaN would break the order of the keys, compare puts it anywhere.
+        keys[i].time = std::isnan(t) ? std::numeric_limits<double>::infinity() : t;
+        keys[i].index = i;
+        keys[i].type = unsigned(vec[i]->getEntryType());
+    }
+    sortKeys(keys, nthreads);
+
+    vector<PEntryPtr> sorted(n);
+    for (std::size_t i = 0; i < n; i++)
+        sorted[i] = vec[keys[i].index];
+    for (std::size_t i = 0; i < n; i++)
+        vec[i] = sorted[i];
+
+    sortEqualTimes(vec);
+}
+
+/*
+ * A position in one of the inputs of mergePEntryVecs.
+ */
+struct PMergeCursor {
+    const PEntryVec*    entries;
+    std::size_t         pos;
+    std::size_t         input;
+
+    PEntryPtr head() const {return (*entries)[pos];}
+};
+
+/*
+ * Orders the cursors for a heap with the smallest head on top.
+ */
+static bool mergeAfter(const PMergeCursor& a, const PMergeCursor& b)
+{
+    int c = compareEntries(a.head(), b.head());
+    return c ? c > 0 : a.input > b.input;
+}
+
+void mergePEntryVecs(const vector<const PEntryVec*>& inputs, PEntryVec& out)
 {
-    std::sort(vec.begin(), vec.end(), PEntryPtrSortPredicate());
+    vector<PMergeCursor> heap;
+    std::size_t total = out.size();
+
+    for (std::size_t i = 0; i < inputs.size(); i++) {
+        total += inputs[i]->size();
+        if (inputs[i]->size()) {
+            PMergeCursor c = {inputs[i], 0, i};
+            heap.push_back(c);
+        }
+    }
+    out.reserve(total);
+    std::make_heap(heap.begin(), heap.end(), mergeAfter);
+
+    while (heap.size() > 1) {
+        std::pop_heap(heap.begin(), heap.end(), mergeAfter);
+        PMergeCursor& c = heap.back();
+        out.push_back(c.head());
+        if (++c.pos < c.entries->size())
+            std::push_heap(heap.begin(), heap.end(), mergeAfter);
+        else
+            heap.pop_back();
+    }
+    if (heap.size()) {
+        const PMergeCursor& c = heap.front();
+        for (std::size_t i = c.pos; i < c.entries->size(); i++)
+            out.push_back((*c.entries)[i]);
+    }
 }
 
 
+/* ** PFormatContext * **/
+
+const unsigned MAX_PRECISION = 8;
+
+PFormatContext::PFormatContext()
+    : m_sep(PEyeLogEntry::getSeparator()[0]),
+      m_precision(PEyeLogEntry::getPrecision())
+{
+}
+
+PFormatContext::PFormatContext(char sep, unsigned precision)
+    : m_sep(sep),
+      m_precision(precision > MAX_PRECISION ? MAX_PRECISION : precision)
+{
+}
+
+void PFormatContext::setSeparator(char sep) {
+    m_sep = sep;
+}
+
+char PFormatContext::getSeparator() const {
+    return m_sep;
+}
+
+void PFormatContext::setPrecision(unsigned p) {
+    m_precision = p > MAX_PRECISION ? MAX_PRECISION : p;
+}
+
+unsigned PFormatContext::getPrecision() const {
+    return m_precision;
+}
+
 /* ** PEyeLogEntry * **/
 
-char PEyeLogEntry::m_sep = '\t';
+std::atomic<char> PEyeLogEntry::m_sep('\t');
 
-unsigned PEyeLogEntry::m_precision = 2;
+std::atomic<unsigned> PEyeLogEntry::m_precision(2);
 
 PEyeLogEntry::PEyeLogEntry(entrytype etype, double time)
     : m_type(etype), m_time(time)
 {
 }
 
+String PEyeLogEntry::toString() const
+{
+    return toString(PFormatContext());
+}
+
 void PEyeLogEntry::setSeparator(const String& sep) {
     m_sep = sep[0];
 }
 
 String PEyeLogEntry::getSeparator() {
-    return String(m_sep);
+    return String(m_sep.load());
 }
 
 void PEyeLogEntry::setPrecision(unsigned p) {
-    if (p > 8)
-        p = 8;
+    if (p > MAX_PRECISION)
+        p = MAX_PRECISION;
     m_precision = p;
 }
 
@@ -114,9 +371,9 @@ int PEyeLogEntry::compare(const PEyeLogEntry& other) const {
     double diff_float = getTime() - other.getTime();
 
     // allow difference of 1 nano second (getTime returns ms)
-    if      (diff_float < -1e-6)
+    if      (diff_float < -TIME_TOLERANCE)
         return -1;
-    else if (diff_float >  1e-6)
+    else if (diff_float >  TIME_TOLERANCE)
         return 1;
 
     diff = getEntryType() - other.getEntryType();
@@ -186,7 +443,7 @@ PGazeEntry::PGazeEntry(entrytype t,
       m_y(y),
       m_pupil(pupil)
 {
-    assert(t == LGAZE || t == RGAZE);
+    assert(t == LGAZE || t == RGAZE || t == AVGGAZE);
 }
 
 PGazeEntry::PGazeEntry(entrytype t, double time, const PCoordinate& c, float pupil)
@@ -211,12 +468,12 @@ PEyeLogEntry* PGazeEntry::clone() const
     return new PGazeEntry(*this);
 }
 
-String PGazeEntry::toString()const
+String PGazeEntry::toString(const PFormatContext& format) const
 {
     std::stringstream stream;
     stream.setf(std::ios::fixed);
-    stream.precision(m_precision);
-    const char sep = getSeparator()[0];
+    stream.precision(format.getPrecision());
+    const char sep = format.getSeparator();
 
     stream << int(getEntryType()) << sep <<
         getTime() << sep <<
@@ -307,7 +564,7 @@ PFixationEntry::PFixationEntry(entrytype t,
       m_x(x),
       m_y(y)
 {
-    assert(t == LFIX || t == RFIX);
+    assert(t == LFIX || t == RFIX || t == AVGFIX);
 }
 
 PFixationEntry::PFixationEntry(const PFixationEntry& other)
@@ -323,12 +580,12 @@ PEyeLogEntry* PFixationEntry::clone()const
     return new PFixationEntry(*this);
 }
 
-String PFixationEntry::toString() const
+String PFixationEntry::toString(const PFormatContext& format) const
 {
     std::stringstream stream;
     stream.setf(std::ios::fixed);
-    stream.precision(m_precision);
-    const char sep = getSeparator()[0];
+    stream.precision(format.getPrecision());
+    const char sep = format.getSeparator();
 
     stream << int(getEntryType()) << sep <<
               getTime() << sep <<
@@ -431,12 +688,12 @@ PEyeLogEntry* PMessageEntry::clone()const
     return new PMessageEntry(*this);
 }
 
-String PMessageEntry::toString()const
+String PMessageEntry::toString(const PFormatContext& format) const
 {
     std::stringstream stream;
     stream.setf(std::ios::fixed);
-    stream.precision(m_precision);
-    const char sep = getSeparator()[0];
+    stream.precision(format.getPrecision());
+    const char sep = format.getSeparator();
 
     stream << int(getEntryType()) << sep <<
         getTime() << sep <<
@@ -495,7 +752,7 @@ PSaccadeEntry::PSaccadeEntry( entrytype t,
       m_x2(x2),
       m_y2(y2)
 {
-    assert(t == LSAC || t == RSAC);
+    assert(t == LSAC || t == RSAC || t == AVGSAC);
 }
 
 PSaccadeEntry::PSaccadeEntry(const PSaccadeEntry& other)
@@ -513,12 +770,12 @@ PEyeLogEntry* PSaccadeEntry::clone()const
     return new PSaccadeEntry(*this);
 }
 
-String PSaccadeEntry::toString() const
+String PSaccadeEntry::toString(const PFormatContext& format) const
 {
     std::stringstream stream;
     stream.setf(std::ios::fixed);
-    stream.precision(m_precision);
-    const char sep = getSeparator()[0];
+    stream.precision(format.getPrecision());
+    const char sep = format.getSeparator();
 
     stream << int(getEntryType()) << sep <<
               getTime() << sep <<
@@ -687,12 +944,12 @@ String PTrialEntry::getGroup()const
     return m_group;
 }
 
-String PTrialEntry::toString()const
+String PTrialEntry::toString(const PFormatContext& format) const
 {
     std::stringstream stream;
     stream.setf(std::ios::fixed);
-    stream.precision(m_precision);
-    const char sep = getSeparator()[0];
+    stream.precision(format.getPrecision());
+    const char sep = format.getSeparator();
 
     stream << int(getEntryType()) << sep <<
               getTime()           << sep <<
@@ -752,12 +1009,12 @@ PTrialStartEntry::PTrialStartEntry(double time)
 {
 }
 
-String PTrialStartEntry::toString() const
+String PTrialStartEntry::toString(const PFormatContext& format) const
 {
     std::stringstream stream;
     stream.setf(std::ios::fixed);
-    stream.precision(m_precision);
-    const char sep = getSeparator()[0];
+    stream.precision(format.getPrecision());
+    const char sep = format.getSeparator();
 
     stream << int(getEntryType()) << sep <<
               getTime();
@@ -781,12 +1038,12 @@ PTrialEndEntry::PTrialEndEntry(double time)
 {
 }
 
-String PTrialEndEntry::toString() const
+String PTrialEndEntry::toString(const PFormatContext& format) const
 {
     std::stringstream stream;
     stream.setf(std::ios::fixed);
-    stream.precision(m_precision);
-    const char sep = getSeparator()[0];
+    stream.precision(format.getPrecision());
+    const char sep = format.getSeparator();
 
     stream << int(getEntryType()) << sep <<
               getTime();
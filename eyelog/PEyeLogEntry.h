@@ -32,7 +32,9 @@
 #ifndef PEYELOGENTRY_H
 #define PEYELOGENTRY_H
 
+#include <atomic>
 #include <fstream>
+#include <vector>
 #include "TypeDefs.h"
 #include "DArray.h"
 #include "constants.h"
@@ -71,8 +73,69 @@ EYELOG_EXPORT void destroyPEntyVec(PEntryVec& entries);
 
 /**
  * Sorts PEntryVec, sort the pointers as if they were the objects.
+ *
+ * The time and entrytype of the entries are copied into an array of
+ * keys first, the keys are sorted and the pointers are put in their
+ * order once. Only entries whose times are too close to be ordered by
+ * time alone are compared with PEyeLogEntry::compare afterwards.
+ *
+ * @param nthreads  number of threads that sort the keys, 0 uses one per
+ *                  core. Small vectors are sorted by the calling thread.
+ */
+EYELOG_EXPORT void sortPEntryVec(PEntryVec& entries, unsigned nthreads=0);
+
+/**
+ * Merges vectors that are sorted into one sorted vector.
+ *
+ * This is cheaper than sorting when e.g. the samples of the left and
+ * the right eye are sorted separately. Entries that compare equal keep
+ * the order of the inputs. The pointers are appended to out, the
+ * entries are not cloned.
+ *
+ * @param inputs    vectors sorted like sortPEntryVec sorts.
+ * @param out       receives the entries of all inputs.
+ */
+EYELOG_EXPORT void mergePEntryVecs(const std::vector<const PEntryVec*>& inputs,
+                                   PEntryVec& out
+                                   );
+
+/**
+ * PFormatContext holds the separator and precision with which entries
+ * are formatted as text.
+ *
+ * Every writer has a context of its own, so writers in different threads
+ * can use different settings. A default constructed context takes the
+ * defaults of PEyeLogEntry::setSeparator and PEyeLogEntry::setPrecision.
  */
-EYELOG_EXPORT void sortPEntryVec(PEntryVec& entries);
+class EYELOG_EXPORT PFormatContext {
+
+public:
+
+    /**
+     * Creates a context with the current defaults.
+     */
+    PFormatContext();
+
+    /**
+     * @param sep       separates the fields.
+     * @param precision the number of decimals, at most 8.
+     */
+    PFormatContext(char sep, unsigned precision);
+
+    void setSeparator(char sep);
+    char getSeparator() const;
+
+    /**
+     * @param p a number between 0-8, larger numbers are taken as 8.
+     */
+    void setPrecision(unsigned p);
+    unsigned getPrecision() const;
+
+private:
+
+    char        m_sep;
+    unsigned    m_precision;
+};
 
 class EYELOG_EXPORT PEyeLogEntry {
 
@@ -86,10 +149,18 @@ public :
      */
     virtual PEyeLogEntry* clone() const =0;
 
+    /**
+     * \returns a PEyeLogEntry in String form, formatted with the default
+     * PFormatContext.
+     */
+    String toString() const;
+
     /**
      * \returns a PEyeLogEntry in String form.
+     *
+     * \param format the separator and precision to use.
      */
-    virtual String toString()const = 0;
+    virtual String toString(const PFormatContext& format) const = 0;
     
     /**
      * Write this entry to a ofstream.
@@ -130,9 +201,10 @@ public :
     //bool operator >= (const PEyeLogEntry& rhs)const;
 
     /**
-     * set the separator between field in a csv log.
+     * set the default separator between field in a csv log.
      * 
-     * This sets the separator used between the fields in a csv log
+     * This sets the separator used between the fields in a csv log,
+     * writers copy it into their PFormatContext when they are created.
      * \note the separator may not be present in an String.
      */
     static void setSeparator(const String& c);
@@ -143,7 +215,8 @@ public :
     static String getSeparator();
 
     /**
-     * sets precision used in the output(the number of decimals behind the dot).
+     * sets the default precision used in the output(the number of
+     * decimals behind the dot).
      *
      * @param p a number between 0-8.
      */
@@ -170,8 +243,8 @@ private :
     double              m_time;     // time on eyetracker.
 
 protected :
-    static char         m_sep;      // separates field in the output.
-    static unsigned     m_precision;// uses as precision in the output.
+    static std::atomic<char>     m_sep;      // default PFormatContext.
+    static std::atomic<unsigned> m_precision;
 };
 
 class EYELOG_EXPORT PGazeEntry : public PEyeLogEntry {
@@ -188,7 +261,8 @@ public :
     /**
      * @return a String that represents the entry type
      */
-    virtual String toString() const;
+    using PEyeLogEntry::toString;
+    virtual String toString(const PFormatContext& format) const;
 
     /**
      * write an entry to and output stream.
@@ -271,7 +345,8 @@ public:
 
     PEyeLogEntry* clone() const;
     
-    virtual String toString() const;
+    using PEyeLogEntry::toString;
+    virtual String toString(const PFormatContext& format) const;
     
     virtual int writeBinary(std::ofstream& stream) const;
 
@@ -309,7 +384,8 @@ public :
 
     PEyeLogEntry* clone()const;
 
-    virtual String toString() const;
+    using PEyeLogEntry::toString;
+    virtual String toString(const PFormatContext& format) const;
     
     virtual int writeBinary(std::ofstream& stream) const;
 
@@ -344,7 +420,8 @@ public:
 
     PEyeLogEntry* clone()const;
 
-    virtual String toString() const;
+    using PEyeLogEntry::toString;
+    virtual String toString(const PFormatContext& format) const;
     
     virtual int writeBinary(std::ofstream& stream) const;
 
@@ -393,8 +470,19 @@ public:
      * Create an empty PTrialEntry
      */
     PTrialEntry();
+
+    PTrialEntry(const PTrialEntry& other) = default;
+    PTrialEntry& operator=(const PTrialEntry& other) = default;
+
+    /**
+     * Takes over the strings of other, other may only be destroyed or
+     * assigned.
+     */
+    PTrialEntry(PTrialEntry&& other) noexcept = default;
+    PTrialEntry& operator=(PTrialEntry&& other) noexcept = default;
     
-    virtual String toString()const;
+    using PEyeLogEntry::toString;
+    virtual String toString(const PFormatContext& format) const;
     virtual PEntryPtr clone()const;
     virtual int writeBinary(std::ofstream& stream)const;
 
@@ -446,7 +534,8 @@ public:
      */
     PTrialStartEntry(double time);
 
-    virtual String toString()const;
+    using PEyeLogEntry::toString;
+    virtual String toString(const PFormatContext& format) const;
     virtual PEntryPtr clone()const;
 private:
     /**
@@ -467,7 +556,8 @@ public:
      */
     PTrialEndEntry(double time);
     
-    virtual String toString()const;
+    using PEyeLogEntry::toString;
+    virtual String toString(const PFormatContext& format) const;
     virtual PEntryPtr clone()const;
 private:
     /**
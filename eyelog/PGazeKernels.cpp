@@ -0,0 +1,532 @@
+/*
+ * PGazeKernels.cpp
+ *
+ * This file is part of libeye and computes per sample quantities over
+ * columns of gaze samples.
+ *
+ * Copyright (C) 2016  Maarten Duijndam
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <atomic>
+#include <cmath>
+#include "PGazeKernels.h"
+#include "cError.h"
+
+/*
+ * The SSE2 and AVX2 kernels are compiled with the target attribute, so
+ * the library itself doesn't require those instructions.
+ */
+#if (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#   define HAVE_X86_KERNELS 1
+#   include <immintrin.h>
+#   define TARGET_SSE2 __attribute__((target("sse2")))
+#   define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+using namespace std;
+
+/*
+ * The implementations of the kernels for one instruction set.
+ */
+struct PKernelTable {
+    gaze_kernel_isa isa;
+    void (*velocities)(const double*, const float*, const float*,
+                       std::size_t, float*);
+    void (*accelerations)(const double*, const float*, std::size_t, float*);
+    void (*average)(const float*, const float*, std::size_t, float*);
+    void (*scale)(const float*, std::size_t, float, float, float*);
+    void (*moments)(const float*, std::size_t, float, double*, double*);
+};
+
+/* **** scalar **** */
+
+static void velocitiesScalar(const double* t,
+                             const float* x,
+                             const float* y,
+                             std::size_t n,
+                             float* v
+                             )
+{
+    for (std::size_t i = 0; i + 1 < n; i++) {
+        float dt = float(t[i + 1] - t[i]);
+        float dx = x[i + 1] - x[i];
+        float dy = y[i + 1] - y[i];
+        float d = std::sqrt(dx * dx + dy * dy);
+        v[i] = dt > 0 ? d * 1000.0f / dt : 0.0f;
+    }
+}
+
+static void accelerationsScalar(const double* t,
+                                const float* v,
+                                std::size_t n,
+                                float* a
+                                )
+{
+    for (std::size_t i = 0; i + 2 < n; i++) {
+        float dt = float(t[i + 2] - t[i]);
+        float dv = v[i + 1] - v[i];
+        a[i] = dt > 0 ? dv * 2000.0f / dt : 0.0f;
+    }
+}
+
+static void averageScalar(const float* l,
+                          const float* r,
+                          std::size_t n,
+                          float* out
+                          )
+{
+    for (std::size_t i = 0; i < n; i++) {
+        float a = l[i], b = r[i];
+        out[i] = a != a ? b : b != b ? a : (a + b) * 0.5f;
+    }
+}
+
+static void scaleScalar(const float* in,
+                        std::size_t n,
+                        float offset,
+                        float scale,
+                        float* out
+                        )
+{
+    for (std::size_t i = 0; i < n; i++)
+        out[i] = (in[i] - offset) * scale;
+}
+
+/*
+ * Sums the values and their squares after subtracting shift, which
+ * keeps the variance accurate when it is small compared to the mean.
+ */
+static void momentsScalar(const float* in,
+                          std::size_t n,
+                          float shift,
+                          double* sum,
+                          double* sumsq
+                          )
+{
+    double s = 0, ss = 0;
+    for (std::size_t i = 0; i < n; i++) {
+        double d = double(in[i]) - shift;
+        s += d;
+        ss += d * d;
+    }
+    *sum = s;
+    *sumsq = ss;
+}
+
+static const PKernelTable scalar_kernels = {
+    KERNEL_SCALAR,
+    velocitiesScalar,
+    accelerationsScalar,
+    averageScalar,
+    scaleScalar,
+    momentsScalar
+};
+
+#if defined(HAVE_X86_KERNELS)
+
+/* **** SSE2, 4 floats at a time **** */
+
+TARGET_SSE2
+static void velocitiesSse2(const double* t,
+                           const float* x,
+                           const float* y,
+                           std::size_t n,
+                           float* v
+                           )
+{
+    if (n < 2)
+        return;
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 thousand = _mm_set1_ps(1000.0f);
+    std::size_t i = 0;
+    for (; i + 4 <= n - 1; i += 4) {
+        __m128d dtlo = _mm_sub_pd(_mm_loadu_pd(t + i + 1), _mm_loadu_pd(t + i));
+        __m128d dthi = _mm_sub_pd(_mm_loadu_pd(t + i + 3),
+                                  _mm_loadu_pd(t + i + 2)
+                                  );
+        __m128 dt = _mm_movelh_ps(_mm_cvtpd_ps(dtlo), _mm_cvtpd_ps(dthi));
+        __m128 dx = _mm_sub_ps(_mm_loadu_ps(x + i + 1), _mm_loadu_ps(x + i));
+        __m128 dy = _mm_sub_ps(_mm_loadu_ps(y + i + 1), _mm_loadu_ps(y + i));
+        __m128 d = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx),
+                                          _mm_mul_ps(dy, dy)
+                                          )
+                               );
+        __m128 vel = _mm_div_ps(_mm_mul_ps(d, thousand), dt);
+        _mm_storeu_ps(v + i, _mm_and_ps(_mm_cmpgt_ps(dt, zero), vel));
+    }
+    velocitiesScalar(t + i, x + i, y + i, n - i, v + i);
+}
+
+TARGET_SSE2
+static void accelerationsSse2(const double* t,
+                              const float* v,
+                              std::size_t n,
+                              float* a
+                              )
+{
+    if (n < 3)
+        return;
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 scale = _mm_set1_ps(2000.0f);
+    std::size_t i = 0;
+    for (; i + 4 <= n - 2; i += 4) {
+        __m128d dtlo = _mm_sub_pd(_mm_loadu_pd(t + i + 2), _mm_loadu_pd(t + i));
+        __m128d dthi = _mm_sub_pd(_mm_loadu_pd(t + i + 4),
+                                  _mm_loadu_pd(t + i + 2)
+                                  );
+        __m128 dt = _mm_movelh_ps(_mm_cvtpd_ps(dtlo), _mm_cvtpd_ps(dthi));
+        __m128 dv = _mm_sub_ps(_mm_loadu_ps(v + i + 1), _mm_loadu_ps(v + i));
+        __m128 acc = _mm_div_ps(_mm_mul_ps(dv, scale), dt);
+        _mm_storeu_ps(a + i, _mm_and_ps(_mm_cmpgt_ps(dt, zero), acc));
+    }
+    accelerationsScalar(t + i, v + i, n - i, a + i);
+}
+
+TARGET_SSE2
+static void averageSse2(const float* l,
+                        const float* r,
+                        std::size_t n,
+                        float* out
+                        )
+{
+    const __m128 half = _mm_set1_ps(0.5f);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 a = _mm_loadu_ps(l + i);
+        __m128 b = _mm_loadu_ps(r + i);
+        __m128 avg = _mm_mul_ps(_mm_add_ps(a, b), half);
+        __m128 nanb = _mm_cmpunord_ps(b, b);
+        __m128 nana = _mm_cmpunord_ps(a, a);
+        avg = _mm_or_ps(_mm_and_ps(nanb, a), _mm_andnot_ps(nanb, avg));
+        avg = _mm_or_ps(_mm_and_ps(nana, b), _mm_andnot_ps(nana, avg));
+        _mm_storeu_ps(out + i, avg);
+    }
+    averageScalar(l + i, r + i, n - i, out + i);
+}
+
+TARGET_SSE2
+static void scaleSse2(const float* in,
+                      std::size_t n,
+                      float offset,
+                      float scale,
+                      float* out
+                      )
+{
+    const __m128 o = _mm_set1_ps(offset);
+    const __m128 s = _mm_set1_ps(scale);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(in + i), o), s));
+    scaleScalar(in + i, n - i, offset, scale, out + i);
+}
+
+TARGET_SSE2
+static void momentsSse2(const float* in,
+                        std::size_t n,
+                        float shift,
+                        double* sum,
+                        double* sumsq
+                        )
+{
+    const __m128d k = _mm_set1_pd(shift);
+    __m128d s = _mm_setzero_pd(), ss = _mm_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 f = _mm_loadu_ps(in + i);
+        __m128d lo = _mm_sub_pd(_mm_cvtps_pd(f), k);
+        __m128d hi = _mm_sub_pd(_mm_cvtps_pd(_mm_movehl_ps(f, f)), k);
+        s = _mm_add_pd(s, _mm_add_pd(lo, hi));
+        ss = _mm_add_pd(ss, _mm_add_pd(_mm_mul_pd(lo, lo), _mm_mul_pd(hi, hi)));
+    }
+    double ts, tss;
+    momentsScalar(in + i, n - i, shift, &ts, &tss);
+    double vs[2], vss[2];
+    _mm_storeu_pd(vs, s);
+    _mm_storeu_pd(vss, ss);
+    *sum = vs[0] + vs[1] + ts;
+    *sumsq = vss[0] + vss[1] + tss;
+}
+
+static const PKernelTable sse2_kernels = {
+    KERNEL_SSE2,
+    velocitiesSse2,
+    accelerationsSse2,
+    averageSse2,
+    scaleSse2,
+    momentsSse2
+};
+
+/* **** AVX2, 8 floats at a time **** */
+
+/*
+ * Subtracts 8 doubles from 8 others and returns the differences as floats.
+ */
+TARGET_AVX2
+static inline __m256 diff8(const double* a, const double* b)
+{
+    __m128 lo = _mm256_cvtpd_ps(_mm256_sub_pd(_mm256_loadu_pd(a),
+                                              _mm256_loadu_pd(b)
+                                              )
+                                );
+    __m128 hi = _mm256_cvtpd_ps(_mm256_sub_pd(_mm256_loadu_pd(a + 4),
+                                              _mm256_loadu_pd(b + 4)
+                                              )
+                                );
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1);
+}
+
+TARGET_AVX2
+static void velocitiesAvx2(const double* t,
+                           const float* x,
+                           const float* y,
+                           std::size_t n,
+                           float* v
+                           )
+{
+    if (n < 2)
+        return;
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 thousand = _mm256_set1_ps(1000.0f);
+    std::size_t i = 0;
+    for (; i + 8 <= n - 1; i += 8) {
+        __m256 dt = diff8(t + i + 1, t + i);
+        __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(x + i + 1),
+                                  _mm256_loadu_ps(x + i)
+                                  );
+        __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(y + i + 1),
+                                  _mm256_loadu_ps(y + i)
+                                  );
+        __m256 d = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx),
+                                                _mm256_mul_ps(dy, dy)
+                                                )
+                                  );
+        __m256 vel = _mm256_div_ps(_mm256_mul_ps(d, thousand), dt);
+        __m256 valid = _mm256_cmp_ps(dt, zero, _CMP_GT_OQ);
+        _mm256_storeu_ps(v + i, _mm256_and_ps(valid, vel));
+    }
+    velocitiesScalar(t + i, x + i, y + i, n - i, v + i);
+}
+
+TARGET_AVX2
+static void accelerationsAvx2(const double* t,
+                              const float* v,
+                              std::size_t n,
+                              float* a
+                              )
+{
+    if (n < 3)
+        return;
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 scale = _mm256_set1_ps(2000.0f);
+    std::size_t i = 0;
+    for (; i + 8 <= n - 2; i += 8) {
+        __m256 dt = diff8(t + i + 2, t + i);
+        __m256 dv = _mm256_sub_ps(_mm256_loadu_ps(v + i + 1),
+                                  _mm256_loadu_ps(v + i)
+                                  );
+        __m256 acc = _mm256_div_ps(_mm256_mul_ps(dv, scale), dt);
+        __m256 valid = _mm256_cmp_ps(dt, zero, _CMP_GT_OQ);
+        _mm256_storeu_ps(a + i, _mm256_and_ps(valid, acc));
+    }
+    accelerationsScalar(t + i, v + i, n - i, a + i);
+}
+
+TARGET_AVX2
+static void averageAvx2(const float* l,
+                        const float* r,
+                        std::size_t n,
+                        float* out
+                        )
+{
+    const __m256 half = _mm256_set1_ps(0.5f);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 a = _mm256_loadu_ps(l + i);
+        __m256 b = _mm256_loadu_ps(r + i);
+        __m256 avg = _mm256_mul_ps(_mm256_add_ps(a, b), half);
+        avg = _mm256_blendv_ps(avg, a, _mm256_cmp_ps(b, b, _CMP_UNORD_Q));
+        avg = _mm256_blendv_ps(avg, b, _mm256_cmp_ps(a, a, _CMP_UNORD_Q));
+        _mm256_storeu_ps(out + i, avg);
+    }
+    averageScalar(l + i, r + i, n - i, out + i);
+}
+
+TARGET_AVX2
+static void scaleAvx2(const float* in,
+                      std::size_t n,
+                      float offset,
+                      float scale,
+                      float* out
+                      )
+{
+    const __m256 o = _mm256_set1_ps(offset);
+    const __m256 s = _mm256_set1_ps(scale);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(out + i,
+                         _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(in + i), o),
+                                       s
+                                       )
+                         );
+    scaleScalar(in + i, n - i, offset, scale, out + i);
+}
+
+TARGET_AVX2
+static void momentsAvx2(const float* in,
+                        std::size_t n,
+                        float shift,
+                        double* sum,
+                        double* sumsq
+                        )
+{
+    const __m256d k = _mm256_set1_pd(shift);
+    __m256d s = _mm256_setzero_pd(), ss = _mm256_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256d lo = _mm256_sub_pd(_mm256_cvtps_pd(_mm_loadu_ps(in + i)), k);
+        __m256d hi = _mm256_sub_pd(_mm256_cvtps_pd(_mm_loadu_ps(in + i + 4)), k);
+        s = _mm256_add_pd(s, _mm256_add_pd(lo, hi));
+        ss = _mm256_add_pd(ss, _mm256_add_pd(_mm256_mul_pd(lo, lo),
+                                             _mm256_mul_pd(hi, hi)
+                                             )
+                           );
+    }
+    double ts, tss;
+    momentsScalar(in + i, n - i, shift, &ts, &tss);
+    double vs[4], vss[4];
+    _mm256_storeu_pd(vs, s);
+    _mm256_storeu_pd(vss, ss);
+    *sum = vs[0] + vs[1] + vs[2] + vs[3] + ts;
+    *sumsq = vss[0] + vss[1] + vss[2] + vss[3] + tss;
+}
+
+static const PKernelTable avx2_kernels = {
+    KERNEL_AVX2,
+    velocitiesAvx2,
+    accelerationsAvx2,
+    averageAvx2,
+    scaleAvx2,
+    momentsAvx2
+};
+
+#endif // HAVE_X86_KERNELS
+
+/* **** dispatch **** */
+
+static const PKernelTable* kernelTable(gaze_kernel_isa isa)
+{
+    switch (isa) {
+        case KERNEL_SCALAR:
+            return &scalar_kernels;
+#if defined(HAVE_X86_KERNELS)
+        case KERNEL_SSE2:
+            return __builtin_cpu_supports("sse2") ? &sse2_kernels : nullptr;
+        case KERNEL_AVX2:
+            return __builtin_cpu_supports("avx2") ? &avx2_kernels : nullptr;
+#endif
+        default:
+            return nullptr;
+    }
+}
+
+static std::atomic<const PKernelTable*> g_kernels(nullptr);
+
+static const PKernelTable* kernels()
+{
+    const PKernelTable* table = g_kernels.load(std::memory_order_acquire);
+    if (!table) {
+        const gaze_kernel_isa best[] = {KERNEL_AVX2, KERNEL_SSE2, KERNEL_SCALAR};
+        for (gaze_kernel_isa isa : best)
+            if ((table = kernelTable(isa)) != nullptr)
+                break;
+        g_kernels.store(table, std::memory_order_release);
+    }
+    return table;
+}
+
+void computeVelocities(const double* t,
+                       const float* x,
+                       const float* y,
+                       std::size_t n,
+                       float* v
+                       )
+{
+    kernels()->velocities(t, x, y, n, v);
+}
+
+void computeAccelerations(const double* t,
+                          const float* v,
+                          std::size_t n,
+                          float* a
+                          )
+{
+    kernels()->accelerations(t, v, n, a);
+}
+
+void averageEyes(const float* left,
+                 const float* right,
+                 std::size_t n,
+                 float* out
+                 )
+{
+    kernels()->average(left, right, n, out);
+}
+
+void pixelsToDegrees(const float* px,
+                     std::size_t n,
+                     float center,
+                     float pixels_per_degree,
+                     float* out
+                     )
+{
+    kernels()->scale(px, n, center, 1.0f / pixels_per_degree, out);
+}
+
+void normalizePupil(const float* pupil, std::size_t n, float* out)
+{
+    if (n == 0)
+        return;
+    const PKernelTable* table = kernels();
+    double sum, sumsq;
+    table->moments(pupil, n, pupil[0], &sum, &sumsq);
+    double mean = sum / n;
+    double var = sumsq / n - mean * mean;
+    double sd = var > 0 ? std::sqrt(var) : 0;
+    table->scale(pupil, n, float(mean + pupil[0]), sd > 0 ? float(1 / sd) : 0.0f,
+                 out
+                 );
+}
+
+gaze_kernel_isa getGazeKernelIsa()
+{
+    return kernels()->isa;
+}
+
+int setGazeKernelIsa(gaze_kernel_isa isa)
+{
+    const PKernelTable* table = kernelTable(isa);
+    if (!table)
+        return ERR_INVALID_PARAMETER;
+    g_kernels.store(table, std::memory_order_release);
+    return 0;
+}
+
+bool gazeKernelIsaSupported(gaze_kernel_isa isa)
+{
+    return kernelTable(isa) != nullptr;
+}
@@ -0,0 +1,145 @@
+/*
+ * PGazeKernels.h
+ *
+ * Public header that provides computations over columns of gaze samples.
+ *
+ * Copyright (c) 2016 M.J.A. Duijndam.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see Licenses at www.gnu.org.
+ */
+
+/**
+ * \file PGazeKernels.h
+ *
+ * The functions in this file compute per sample quantities over the
+ * contiguous columns of a PGazeColumns, e.g.:
+ *
+ * \code
+ *  const PGazeColumns& eye = store[LGAZE];
+ *  DArray<float> v(eye.size() - 1);
+ *  computeVelocities(eye.getTime().begin(),
+ *                    eye.getX().begin(),
+ *                    eye.getY().begin(),
+ *                    eye.size(),
+ *                    v.begin()
+ *                    );
+ * \endcode
+ *
+ * Every function has a scalar, an SSE2 and an AVX2 implementation. The
+ * first time one of them is called, the best instruction set the
+ * processor supports is selected, setGazeKernelIsa selects another one.
+ * The SSE2 and AVX2 versions are only available on x86 with gcc or
+ * clang. The output arrays may not overlap the inputs, unless stated
+ * otherwise.
+ */
+
+#ifndef PGAZE_KERNELS_H
+#define PGAZE_KERNELS_H
+
+#include <cstddef>
+#include "eyelog_export.h"
+#include "constants.h"
+
+/**
+ * Computes the velocity in units per second from each sample to the next.
+ *
+ * @param t     n times in ms
+ * @param x     n x coordinates
+ * @param y     n y coordinates
+ * @param v     receives n - 1 velocities, v[i] is from sample i to i + 1.
+ *              A velocity between samples with the same time is 0.
+ */
+EYELOG_EXPORT void computeVelocities(const double* t,
+                                     const float* x,
+                                     const float* y,
+                                     std::size_t n,
+                                     float* v
+                                     );
+
+/**
+ * Computes the acceleration in units per second squared from the
+ * velocities of computeVelocities.
+ *
+ * @param t     n times in ms
+ * @param v     the n - 1 velocities between the samples.
+ * @param a     receives n - 2 accelerations, a[i] is the change from v[i]
+ *              to v[i + 1] at sample i + 1.
+ */
+EYELOG_EXPORT void computeAccelerations(const double* t,
+                                        const float* v,
+                                        std::size_t n,
+                                        float* a
+                                        );
+
+/**
+ * Averages a column of the left and the right eye, e.g. the x
+ * coordinates of samples taken at the same time.
+ *
+ * When one of the eyes is missing, NaN, the other one is used.
+ * out may be the same array as left or right.
+ */
+EYELOG_EXPORT void averageEyes(const float* left,
+                               const float* right,
+                               std::size_t n,
+                               float* out
+                               );
+
+/**
+ * Converts coordinates in pixels to degrees of visual angle.
+ *
+ * The conversion is linear, which is accurate for the central part of
+ * the screen: out[i] = (px[i] - center) / pixels_per_degree.
+ * out may be the same array as px.
+ *
+ * @param center            the coordinate straight ahead of the eye.
+ * @param pixels_per_degree the number of pixels in one degree.
+ */
+EYELOG_EXPORT void pixelsToDegrees(const float* px,
+                                   std::size_t n,
+                                   float center,
+                                   float pixels_per_degree,
+                                   float* out
+                                   );
+
+/**
+ * Normalizes the pupil sizes of a recording to z-scores.
+ *
+ * out[i] = (pupil[i] - mean) / sd, where mean and sd are computed over
+ * all samples. When all sizes are equal, out is 0. out may be the same
+ * array as pupil.
+ */
+EYELOG_EXPORT void normalizePupil(const float* pupil,
+                                  std::size_t n,
+                                  float* out
+                                  );
+
+/**
+ * @return the instruction set the kernels use.
+ */
+EYELOG_EXPORT gaze_kernel_isa getGazeKernelIsa();
+
+/**
+ * Selects the instruction set for the kernels, e.g. to compare them.
+ *
+ * @return 0 or ERR_INVALID_PARAMETER when the processor or the build
+ *         doesn't support isa.
+ */
+EYELOG_EXPORT int setGazeKernelIsa(gaze_kernel_isa isa);
+
+/**
+ * @return true when the kernels can use isa.
+ */
+EYELOG_EXPORT bool gazeKernelIsaSupported(gaze_kernel_isa isa);
+
+#endif
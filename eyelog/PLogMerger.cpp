@@ -0,0 +1,240 @@
+/*
+ * PLogMerger.cpp
+ *
+ * This file is part of libeye and merges logfiles in order of time.
+ *
+ * Copyright (C) 2016  Maarten Duijndam
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "libeye-config.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include "PLogMerger.h"
+#include "PBinaryWriter.h"
+#include "PCsvWriter.h"
+#include "cError.h"
+
+#if defined(HAVE_UNISTD_H)
+#   include <sys/stat.h>
+#endif
+
+using namespace std;
+
+PLogMerger::PLogMerger()
+    : m_started(false),
+      m_status(0)
+{
+}
+
+PLogMerger::~PLogMerger()
+{
+    close();
+}
+
+int PLogMerger::addFile(const String& filename)
+{
+    if (m_started)
+        return ERR_INVALID_PARAMETER;
+
+    std::unique_ptr<PLogReader> reader(new PLogReader);
+    int ret = reader->open(filename);
+    if (ret)
+        return ret;
+    return addReader(std::move(reader));
+}
+
+int PLogMerger::addReader(std::unique_ptr<PLogReader> reader)
+{
+    if (m_started || !reader || !reader->isOpen())
+        return ERR_INVALID_PARAMETER;
+
+    Input input;
+    input.reader = std::move(reader);
+    input.head = nullptr;
+    m_inputs.push_back(std::move(input));
+    return 0;
+}
+
+PEyeLogEntry* PLogMerger::next()
+{
+    auto after = [this](std::size_t a, std::size_t b) {return this->after(a, b);};
+
+    if (!m_started)
+        start();
+    if (m_status || m_heap.empty())
+        return nullptr;
+
+    pop_heap(m_heap.begin(), m_heap.end(), after);
+    Input& input = m_inputs[m_heap.back()];
+    PEyeLogEntry* entry = input.head;
+
+    input.head = input.reader->next();
+    if (input.head) {
+        push_heap(m_heap.begin(), m_heap.end(), after);
+    }
+    else {
+        m_status = input.reader->status();
+        m_heap.pop_back();
+    }
+    return entry;
+}
+
+int PLogMerger::status() const
+{
+    return m_status;
+}
+
+void PLogMerger::close()
+{
+    for (auto& input : m_inputs)
+        delete input.head;
+    m_inputs.clear();
+    m_heap.clear();
+    m_started = false;
+    m_status = 0;
+}
+
+/*
+ * Orders the heap with the smallest head on top, equal heads are taken
+ * from the input that was added first.
+ */
+bool PLogMerger::after(std::size_t a, std::size_t b) const
+{
+    int c = m_inputs[a].head->compare(*m_inputs[b].head);
+    return c ? c > 0 : a > b;
+}
+
+/*
+ * Reads the first entry of every input.
+ */
+void PLogMerger::start()
+{
+    m_started = true;
+    for (std::size_t i = 0; i < m_inputs.size(); i++) {
+        m_inputs[i].head = m_inputs[i].reader->next();
+        if (m_inputs[i].head)
+            m_heap.push_back(i);
+        else if (!m_status)
+            m_status = m_inputs[i].reader->status();
+    }
+    make_heap(m_heap.begin(), m_heap.end(),
+              [this](std::size_t a, std::size_t b) {return after(a, b);}
+              );
+}
+
+/*
+ * @return true if output is one of the inputs, e.g. under another name.
+ */
+static bool isInput(const std::vector<String>& inputs, const String& output)
+{
+#if defined(HAVE_UNISTD_H)
+    struct stat out, in;
+    if (stat(output.c_str(), &out) != 0)
+        return false;
+    for (const auto& filename : inputs)
+        if (stat(filename.c_str(), &in) == 0 &&
+            in.st_dev == out.st_dev && in.st_ino == out.st_ino)
+            return true;
+#else
+    for (const auto& filename : inputs)
+        if (strcmp(filename.c_str(), output.c_str()) == 0)
+            return true;
+#endif
+    return false;
+}
+
+/*
+ * Writes the entries of merger to filename.
+ */
+static int writeMerged(PLogMerger& merger,
+                       const String& filename,
+                       eyelog_format format
+                       )
+{
+    PEyeLogEntry* entry;
+    int ret = 0;
+
+    if (format == FORMAT_BINARY) {
+        PBinaryWriter writer;
+        ret = writer.open(filename);
+        while (ret == 0 && (entry = merger.next()) != nullptr) {
+            ret = writer.write(*entry);
+            delete entry;
+        }
+        int closed = writer.close();
+        if (ret == 0)
+            ret = closed;
+    }
+    else {
+        ofstream stream(filename.c_str(), ios::out | ios::binary);
+        if (!stream.is_open())
+            return errno;
+        PCsvWriter writer(stream);
+        // Like PEyeLog::write, the last line is without lineterminator.
+        entry = merger.next();
+        while (ret == 0 && entry) {
+            PEyeLogEntry* next = merger.next();
+            ret = writer.write(*entry, next != nullptr);
+            delete entry;
+            entry = next;
+        }
+        delete entry;
+        if (ret == 0)
+            ret = writer.flush();
+    }
+    return ret ? ret : merger.status();
+}
+
+/*
+ * The output is written under a temporary name first, so that a failed
+ * merge leaves no partial output and an existing output stays intact.
+ */
+int mergeLogFiles(const std::vector<String>& inputs,
+                  const String& output,
+                  eyelog_format format
+                  )
+{
+    PLogMerger merger;
+    String temp = output + String(".tmp");
+    int ret = 0;
+
+    if (format != FORMAT_BINARY && format != FORMAT_CSV)
+        return ERR_INVALID_PARAMETER;
+    if (isInput(inputs, output) || isInput(inputs, temp))
+        return ERR_INVALID_PARAMETER;
+
+    for (const auto& filename : inputs) {
+        ret = merger.addFile(filename);
+        if (ret)
+            return ret;
+    }
+
+    ret = writeMerged(merger, temp, format);
+    merger.close();
+    if (ret == 0 && rename(temp.c_str(), output.c_str())) {
+        // Not every system replaces an existing file.
+        remove(output.c_str());
+        if (rename(temp.c_str(), output.c_str()))
+            ret = errno;
+    }
+    if (ret)
+        remove(temp.c_str());
+    return ret;
+}
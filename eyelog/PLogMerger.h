@@ -0,0 +1,143 @@
+/*
+ * PLogMerger.h
+ *
+ * Public header that provides a merge of logfiles in order of time.
+ *
+ * Copyright (c) 2016 M.J.A. Duijndam.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see Licenses at www.gnu.org.
+ */
+
+#ifndef PLOG_MERGER_H
+#define PLOG_MERGER_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "TypeDefs.h"
+#include "constants.h"
+#include "PEyeLogEntry.h"
+#include "PLogReader.h"
+
+/**
+ * PLogMerger reads several logfiles at once and returns their entries
+ * in order of time.
+ *
+ * Every file must be in order of time itself, e.g. the log of the
+ * eyetracker and a log of the stimuli. Each file is read with a
+ * PLogReader, so the memory used doesn't depend on the size of the
+ * files. A reader that is already open can be added as well, it is
+ * merged from the entry it would return next. A heap keeps the next entry of every file, the smallest one
+ * is returned. Entries that compare equal are returned in the order in
+ * which their files were added.
+ *
+ * Usage:
+ * \code
+ *  PLogMerger merger;
+ *  PEyeLogEntry* entry;
+ *  if (merger.addFile("tracker.bin") == 0 &&
+ *      merger.addFile("stimuli.csv") == 0)
+ *      while ((entry = merger.next()) != nullptr) {
+ *          ...
+ *          delete entry;
+ *      }
+ *  if (merger.status())
+ *      ; // one of the files is invalid.
+ * \endcode
+ */
+class EYELOG_EXPORT PLogMerger {
+
+public:
+
+    PLogMerger();
+    ~PLogMerger();
+
+    /**
+     * Opens a logfile and adds it to the inputs, see addReader.
+     *
+     * @return 0, an errno value, ERR_INVALID_FILE_FORMAT or
+     *         ERR_INVALID_PARAMETER when next() has been called.
+     */
+    int addFile(const String& filename);
+
+    /**
+     * Adds an open reader to the inputs, the merger takes it over.
+     *
+     * Readers can't be added once next() has been called.
+     *
+     * @return 0 or ERR_INVALID_PARAMETER when next() has been called or
+     *         reader isn't open, then reader is deleted.
+     */
+    int addReader(std::unique_ptr<PLogReader> reader);
+
+    /**
+     * Returns the next entry of all files.
+     *
+     * @return the entry, the caller owns it, or nullptr when all files
+     *         have been read or an error has occurred, status() tells
+     *         which of the two.
+     */
+    PEyeLogEntry* next();
+
+    /**
+     * @return 0 or the first error of one of the readers.
+     */
+    int status() const;
+
+    /**
+     * Closes all files.
+     */
+    void close();
+
+private:
+
+    PLogMerger(const PLogMerger&);
+    PLogMerger& operator=(const PLogMerger&);
+
+    struct Input {
+        std::unique_ptr<PLogReader> reader;
+        PEyeLogEntry*               head;   // the next entry of reader.
+    };
+
+    bool after(std::size_t a, std::size_t b) const;
+    void start();
+
+    std::vector<Input>          m_inputs;
+    std::vector<std::size_t>    m_heap;     // inputs with a head.
+    bool                        m_started;
+    int                         m_status;
+};
+
+/**
+ * Merges logfiles into a new logfile in order of time.
+ *
+ * The files are read with a PLogMerger and written while they are read,
+ * so logs larger than the memory can be merged. The output is written to
+ * output + ".tmp" and renamed when all went well, on error it is removed
+ * and an existing output is left as it was.
+ *
+ * @param inputs    logfiles in a format readLog accepts, each in order
+ *                  of time.
+ * @param output    the file to create, it may not be one of the inputs.
+ * @param format    FORMAT_BINARY or FORMAT_CSV.
+ *
+ * @return 0, an errno value, ERR_INVALID_PARAMETER or
+ *         ERR_INVALID_FILE_FORMAT.
+ */
+EYELOG_EXPORT int mergeLogFiles(const std::vector<String>& inputs,
+                                const String& output,
+                                eyelog_format format=FORMAT_BINARY
+                                );
+
+#endif
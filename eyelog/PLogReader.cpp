@@ -0,0 +1,307 @@
+/*
+ * PLogReader.cpp
+ *
+ * This file is part of libeye and reads logfiles piece by piece.
+ *
+ * Copyright (C) 2016  Maarten Duijndam
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include "PLogReader.h"
+#include "PEyeLog.h"
+#include "PMappedLog.h"
+#include "PAscReader.h"
+#include "PBinaryFormat.h"
+#include "PCompressedFormat.h"
+#include "cError.h"
+
+using namespace std;
+
+/*
+ * Collects the decoded entries of one piece of the file.
+ */
+class PEntryQueue : public PEntrySink {
+
+public:
+
+    PEntryQueue(vector<PEyeLogEntry*>& queue) : m_queue(queue) {}
+
+    virtual void addEntry(PEyeLogEntry* entry)
+    {
+        m_queue.push_back(entry);
+    }
+
+private:
+
+    vector<PEyeLogEntry*>& m_queue;
+};
+
+PLogReader::PLogReader()
+    : m_format(FORMAT_UNKNOWN),
+      m_status(0),
+      m_eof(false),
+      m_isleft(false),
+      m_begin(0),
+      m_end(0),
+      m_ndecoded(0),
+      m_next(0)
+{
+}
+
+PLogReader::~PLogReader()
+{
+    close();
+}
+
+int PLogReader::open(const String& filename)
+{
+    close();
+
+    m_stream.open(filename.c_str(), ios::in | ios::binary);
+    if (!m_stream.is_open())
+        return errno;
+
+    m_buffer.resize(BUFFER_SIZE);
+    refill();
+    if (m_status) {
+        int ret = m_status;
+        close();
+        return ret;
+    }
+
+    m_format = detectLogFormat(&m_buffer[0], m_end);
+    if (m_format == FORMAT_BINARY) {
+        PBinaryHeader header;
+        int ret = readBinaryHeader(&m_buffer[0], m_end, &header, &m_begin);
+        if (ret) {
+            close();
+            return ret;
+        }
+    }
+    else if (m_format == FORMAT_BINARY_V2) {
+        m_begin = BINARY_HEADER_SIZE;
+    }
+    else if (m_format == FORMAT_UNKNOWN && m_end > 0) {
+        close();
+        return ERR_INVALID_FILE_FORMAT;
+    }
+    return 0;
+}
+
+void PLogReader::close()
+{
+    clearQueue();
+    if (m_stream.is_open())
+        m_stream.close();
+    m_stream.clear();
+    vector<char>().swap(m_buffer);
+    vector<char>().swap(m_scratch);
+    m_format    = FORMAT_UNKNOWN;
+    m_status    = 0;
+    m_eof       = false;
+    m_isleft    = false;
+    m_begin     = 0;
+    m_end       = 0;
+    m_ndecoded  = 0;
+}
+
+bool PLogReader::isOpen() const
+{
+    return m_stream.is_open();
+}
+
+eyelog_format PLogReader::getFormat() const
+{
+    return m_format;
+}
+
+PEyeLogEntry* PLogReader::next()
+{
+    if (!fill())
+        return nullptr;
+    PEyeLogEntry* entry = m_queue[m_next];
+    m_queue[m_next++] = nullptr;
+    return entry;
+}
+
+std::size_t PLogReader::readBatch(PEntrySink* out, std::size_t n)
+{
+    std::size_t count = 0;
+    while (count < n && fill()) {
+        for (; m_next < m_queue.size() && count < n; ++count) {
+            out->addEntry(m_queue[m_next]);
+            m_queue[m_next++] = nullptr;
+        }
+    }
+    return count;
+}
+
+int PLogReader::status() const
+{
+    return m_status;
+}
+
+/*
+ * Makes sure there is an entry in the queue, returns false at the end
+ * of the file or on error.
+ */
+bool PLogReader::fill()
+{
+    if (m_next < m_queue.size())
+        return true;
+    if (!isOpen())
+        return false;
+
+    clearQueue();
+    while (m_status == 0) {
+        if (m_format == FORMAT_BINARY)
+            decodeBinary();
+        else if (m_format == FORMAT_BINARY_V2)
+            decodeBlocks();
+        else
+            decodeText();
+
+        if (m_next < m_queue.size())
+            return true;
+        if (m_status || m_eof)
+            break;
+        refill();
+    }
+
+    if (m_status == 0 && m_begin < m_end) // a truncated record.
+        m_status = ERR_INVALID_FILE_FORMAT;
+    if (m_status == 0 && m_format == FORMAT_ASC && m_ndecoded == 0)
+        m_status = ERR_INVALID_FILE_FORMAT;
+    return false;
+}
+
+/*
+ * Moves the bytes that aren't decoded to the front of the buffer and
+ * appends as much of the file as fits. The buffer grows when it is full
+ * with a single record or line.
+ */
+bool PLogReader::refill()
+{
+    if (m_begin > 0) {
+        memmove(&m_buffer[0], &m_buffer[m_begin], m_end - m_begin);
+        m_end -= m_begin;
+        m_begin = 0;
+    }
+    if (m_end == m_buffer.size())
+        m_buffer.resize(m_buffer.size() * 2);
+
+    m_stream.read(&m_buffer[m_end], m_buffer.size() - m_end);
+    std::size_t n = std::size_t(m_stream.gcount());
+    m_end += n;
+    if (!m_stream) {
+        if (m_stream.bad())
+            m_status = errno ? errno : ERR_INVALID_FILE_FORMAT;
+        m_eof = true;
+    }
+    return n > 0;
+}
+
+void PLogReader::decodeBinary()
+{
+    PEntryView view;
+    while (m_begin < m_end) {
+        const char* p = &m_buffer[m_begin];
+        std::size_t avail = m_end - m_begin;
+        entrytype et;
+        std::size_t size = binaryRecordSize(p, avail, &et);
+        if (!size) {
+            if (avail >= RECORD_TYPE_SIZE &&
+                !isBinaryRecordType(et) &&
+                uint16_t(et) != INDEX_RECORD_TYPE
+                )
+                m_status = ERR_INVALID_FILE_FORMAT;
+            break;
+        }
+        if (isIndexRecord(p)) {
+            m_begin += size;
+            continue;
+        }
+        view.m_record   = p;
+        view.m_size     = size;
+        view.m_type     = et;
+        memcpy(&view.m_time, p + RECORD_TYPE_SIZE, sizeof(view.m_time));
+        m_queue.push_back(view.toEntry());
+        m_begin += size;
+    }
+    m_ndecoded += m_queue.size();
+}
+
+/*
+ * Decodes the complete blocks in the buffer.
+ */
+void PLogReader::decodeBlocks()
+{
+    PEntryQueue queue(m_queue);
+    PBlockHeader header;
+    int error;
+    while (m_begin < m_end) {
+        const char* p = &m_buffer[m_begin];
+        std::size_t size = blockSize(p, m_end - m_begin, &header, &error);
+        if (!size) {
+            m_status = error;
+            break;
+        }
+        m_status = decodeBlock(p, size, &queue, m_scratch);
+        if (m_status)
+            break;
+        m_begin += size;
+    }
+    m_ndecoded += m_queue.size();
+}
+
+/*
+ * Decodes the complete lines in the buffer, at the end of the file
+ * the last line doesn't need a newline.
+ */
+void PLogReader::decodeText()
+{
+    const char* begin = m_buffer.data() + m_begin;
+    const char* end = m_buffer.data() + m_end;
+
+    if (!m_eof) {
+        while (end > begin && end[-1] != '\n')
+            --end;
+        if (end == begin)
+            return;
+    }
+
+    PEntryQueue queue(m_queue);
+    if (m_format == FORMAT_CSV) {
+        m_status = readCsvBuffer(&queue, begin, end);
+    }
+    else {
+        // A piece with only header lines isn't an error.
+        readAscBuffer(&queue, begin, end, 1, &m_isleft);
+    }
+    m_begin += end - begin;
+    m_ndecoded += m_queue.size();
+}
+
+void PLogReader::clearQueue()
+{
+    for (; m_next < m_queue.size(); ++m_next)
+        delete m_queue[m_next];
+    m_queue.clear();
+    m_next = 0;
+}
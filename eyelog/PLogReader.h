@@ -0,0 +1,146 @@
+/*
+ * PLogReader.h
+ *
+ * Public header that provides a streaming reader for logfiles.
+ *
+ * Copyright (c) 2016 M.J.A. Duijndam.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see Licenses at www.gnu.org.
+ */
+
+#ifndef PLOG_READER_H
+#define PLOG_READER_H
+
+#include <cstddef>
+#include <fstream>
+#include <vector>
+#include "TypeDefs.h"
+#include "constants.h"
+#include "PEyeLogEntry.h"
+#include "PEntrySink.h"
+
+/**
+ * PLogReader reads a logfile one entry or one batch of entries at a time.
+ *
+ * The reader accepts the same formats as readLog. The file is read
+ * through a buffer of a fixed size, so the memory used doesn't depend on
+ * the size of the file. Only when a single record or line doesn't fit,
+ * the buffer grows to hold it.
+ *
+ * Usage:
+ * \code
+ *  PLogReader reader;
+ *  PEyeLogEntry* entry;
+ *  if (reader.open("session.asc") == 0)
+ *      while ((entry = reader.next()) != nullptr) {
+ *          if (entry->getTime() > tend) {
+ *              delete entry;
+ *              break;
+ *          }
+ *          ...
+ *          delete entry;
+ *      }
+ *  if (reader.status())
+ *      ; // the file is invalid.
+ * \endcode
+ */
+class EYELOG_EXPORT PLogReader {
+
+public:
+
+    /**
+     * Size of the read buffer in bytes.
+     */
+    static const std::size_t BUFFER_SIZE = 1 << 20;
+
+    PLogReader();
+    ~PLogReader();
+
+    /**
+     * Opens a logfile and determines its format.
+     *
+     * A file that is currently open is closed first.
+     *
+     * @return 0, an errno value or ERR_INVALID_FILE_FORMAT.
+     */
+    int open(const String& filename);
+
+    /**
+     * Closes the file and discards the entries that haven't been read.
+     */
+    void close();
+
+    /**
+     * @return true if a file is open.
+     */
+    bool isOpen() const;
+
+    /**
+     * @return the format of the open file.
+     */
+    eyelog_format getFormat() const;
+
+    /**
+     * Reads the next entry.
+     *
+     * @return the next entry, the caller owns it, or nullptr at the end
+     *         of the file or when an error has occurred, status() tells
+     *         which of the two.
+     */
+    PEyeLogEntry* next();
+
+    /**
+     * Hands at most n entries to out.
+     *
+     * @return the number of entries handed to out, less than n only at
+     *         the end of the file or on error.
+     */
+    std::size_t readBatch(PEntrySink* out, std::size_t n);
+
+    /**
+     * @return 0, an errno value or ERR_INVALID_FILE_FORMAT when reading
+     *         failed.
+     */
+    int status() const;
+
+private:
+
+    PLogReader(const PLogReader&);
+    PLogReader& operator=(const PLogReader&);
+
+    bool fill();
+    bool refill();
+    void decodeBinary();
+    void decodeBlocks();
+    void decodeText();
+    void clearQueue();
+
+    std::ifstream               m_stream;
+    eyelog_format               m_format;
+    int                         m_status;
+    bool                        m_eof;      // everything is in m_buffer.
+    bool                        m_isleft;   // SAMPLES setting in .asc files.
+
+    std::vector<char>           m_buffer;
+    std::size_t                 m_begin;    // first byte not decoded.
+    std::size_t                 m_end;      // one past the last byte read.
+    std::size_t                 m_ndecoded; // entries decoded so far.
+
+    std::vector<char>           m_scratch;  // a decompressed block.
+
+    std::vector<PEyeLogEntry*>  m_queue;    // decoded, but not yet read.
+    std::size_t                 m_next;     // next entry of m_queue.
+};
+
+#endif
@@ -0,0 +1,191 @@
+/*
+ * PMappedFile.cpp
+ *
+ * This file is part of libeye and maps files into memory.
+ *
+ * Copyright (C) 2016  Maarten Duijndam
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "libeye-config.h"
+#include "PMappedFile.h"
+#include <cerrno>
+#include <fstream>
+
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_UNISTD_H)
+#   define USE_POSIX_MMAP 1
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <fcntl.h>
+#   include <unistd.h>
+#elif defined(HAVE_WINDOWS_H)
+#   define USE_WINDOWS_MMAP 1
+#   include <windows.h>
+#endif
+
+PMappedFile::PMappedFile()
+    : m_data(nullptr),
+      m_size(0),
+      m_isopen(false),
+      m_heap(false)
+{
+}
+
+PMappedFile::~PMappedFile()
+{
+    close();
+}
+
+/*
+ * Fallback for when the file cannot be mapped, reads it into a heap buffer.
+ */
+static int readIntoBuffer(const String& filename,
+                          const char** data,
+                          std::size_t* size
+                          )
+{
+    std::ifstream stream(filename.c_str(), std::ios::in | std::ios::binary);
+    if (!stream.is_open())
+        return errno ? errno : ENOENT;
+
+    stream.seekg(0, stream.end);
+    std::streampos end = stream.tellg();
+    stream.seekg(0);
+
+    std::size_t n = std::size_t(end);
+    char* buffer = n ? new char[n] : nullptr;
+    if (n && !stream.read(buffer, n)) {
+        delete[] buffer;
+        return errno ? errno : EIO;
+    }
+    *data = buffer;
+    *size = n;
+    return 0;
+}
+
+int PMappedFile::open(const String& filename)
+{
+    close();
+
+#if defined(USE_POSIX_MMAP)
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return errno;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        int ret = errno;
+        ::close(fd);
+        return ret;
+    }
+
+    m_size = std::size_t(info.st_size);
+    if (m_size) {
+        void* p = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            ::close(fd);
+            m_size = 0;
+            int ret = readIntoBuffer(filename, &m_data, &m_size);
+            m_heap = ret == 0;
+            m_isopen = ret == 0;
+            return ret;
+        }
+        // The log readers walk the records front to back.
+        madvise(p, m_size, MADV_SEQUENTIAL);
+        m_data = static_cast<const char*>(p);
+    }
+    ::close(fd); // the mapping keeps a reference to the file.
+#elif defined(USE_WINDOWS_MMAP)
+    HANDLE file = CreateFileA(filename.c_str(),
+                              GENERIC_READ,
+                              FILE_SHARE_READ,
+                              NULL,
+                              OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN,
+                              NULL
+                              );
+    if (file == INVALID_HANDLE_VALUE)
+        return ENOENT;
+
+    LARGE_INTEGER filesize;
+    if (!GetFileSizeEx(file, &filesize)) {
+        CloseHandle(file);
+        return EIO;
+    }
+    m_size = std::size_t(filesize.QuadPart);
+    if (m_size) {
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (!mapping) {
+            CloseHandle(file);
+            m_size = 0;
+            return EIO;
+        }
+        m_data = static_cast<const char*>(
+                MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)
+                );
+        // The view keeps the mapping and file alive.
+        CloseHandle(mapping);
+        if (!m_data) {
+            CloseHandle(file);
+            m_size = 0;
+            return EIO;
+        }
+    }
+    CloseHandle(file);
+#else
+    int ret = readIntoBuffer(filename, &m_data, &m_size);
+    if (ret)
+        return ret;
+    m_heap = true;
+#endif
+    m_isopen = true;
+    return 0;
+}
+
+void PMappedFile::close()
+{
+    if (m_data) {
+        if (m_heap) {
+            delete[] m_data;
+        }
+        else {
+#if defined(USE_POSIX_MMAP)
+            munmap(const_cast<char*>(m_data), m_size);
+#elif defined(USE_WINDOWS_MMAP)
+            UnmapViewOfFile(m_data);
+#endif
+        }
+    }
+    m_data = nullptr;
+    m_size = 0;
+    m_isopen = false;
+    m_heap = false;
+}
+
+bool PMappedFile::isOpen() const
+{
+    return m_isopen;
+}
+
+const char* PMappedFile::data() const
+{
+    return m_data;
+}
+
+std::size_t PMappedFile::size() const
+{
+    return m_size;
+}
@@ -0,0 +1,84 @@
+/*
+ * PMappedFile.h
+ *
+ * Public header that provides read only memory mapped files, PMappedLog
+ * reads binary logs through them.
+ *
+ * Copyright (c) 2016 M.J.A. Duijndam.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see Licenses at www.gnu.org.
+ */
+
+#ifndef PMAPPED_FILE_H
+#define PMAPPED_FILE_H
+
+#include <cstddef>
+#include "TypeDefs.h"
+
+/**
+ * PMappedFile maps a complete file read only into memory.
+ *
+ * On POSIX systems the file is mapped with mmap, on windows with
+ * CreateFileMapping. On platforms that support neither the file
+ * is read into a heap buffer, so the interface behaves identical
+ * everywhere.
+ */
+class EYELOG_EXPORT PMappedFile {
+
+public:
+
+    PMappedFile();
+    ~PMappedFile();
+
+    /**
+     * Maps the file in memory.
+     *
+     * A file that is currently mapped is unmapped first.
+     *
+     * @return 0 if successful, or an errno value otherwise.
+     */
+    int open(const String& filename);
+
+    /**
+     * Unmaps the file.
+     */
+    void close();
+
+    /**
+     * @return true if a file is mapped.
+     */
+    bool isOpen() const;
+
+    /**
+     * @return the first byte of the file or nullptr for an empty file.
+     */
+    const char* data() const;
+
+    /**
+     * @return the size of the mapped file in bytes.
+     */
+    std::size_t size() const;
+
+private:
+
+    PMappedFile(const PMappedFile&);
+    PMappedFile& operator=(const PMappedFile&);
+
+    const char*     m_data;
+    std::size_t     m_size;
+    bool            m_isopen;
+    bool            m_heap;     // m_data is a heap buffer instead of a map.
+};
+
+#endif
@@ -0,0 +1,437 @@
+/*
+ * PMappedLog.cpp
+ *
+ * This file is part of libeye and reads binary logs from a memory map.
+ *
+ * Copyright (C) 2016  Maarten Duijndam
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cassert>
+#include <cstring>
+#include <stdint.h>
+#include "PMappedLog.h"
+#include "PEyeLog.h"
+#include "PBinaryFormat.h"
+#include "PCompressedLog.h"
+#include "cError.h"
+
+/* **** PEntryView **** */
+
+PEntryView::PEntryView()
+    : m_record(nullptr),
+      m_size(0),
+      m_type(LGAZE),
+      m_time(0)
+{
+}
+
+float PEntryView::m_float(std::size_t offset) const
+{
+    float f;
+    assert(offset + sizeof(f) <= m_size);
+    memcpy(&f, m_record + offset, sizeof(f));
+    return f;
+}
+
+double PEntryView::m_double(std::size_t offset) const
+{
+    double d;
+    assert(offset + sizeof(d) <= m_size);
+    memcpy(&d, m_record + offset, sizeof(d));
+    return d;
+}
+
+String PEntryView::m_string(std::size_t offset) const
+{
+    uint32_t n;
+    memcpy(&n, m_record + offset, sizeof(n));
+    const char* begin = m_record + offset + sizeof(n);
+    return String(begin, begin + n);
+}
+
+entrytype PEntryView::getEntryType() const
+{
+    return m_type;
+}
+
+double PEntryView::getTime() const
+{
+    return m_time;
+}
+
+float PEntryView::getX() const
+{
+    if (m_type == LFIX || m_type == RFIX || m_type == AVGFIX)
+        return m_float(RECORD_HEADER_SIZE + sizeof(double));
+    return m_float(RECORD_HEADER_SIZE);
+}
+
+float PEntryView::getY() const
+{
+    if (m_type == LFIX || m_type == RFIX || m_type == AVGFIX)
+        return m_float(RECORD_HEADER_SIZE + sizeof(double) + sizeof(float));
+    return m_float(RECORD_HEADER_SIZE + sizeof(float));
+}
+
+float PEntryView::getPupil() const
+{
+    return m_float(RECORD_HEADER_SIZE + 2 * sizeof(float));
+}
+
+double PEntryView::getDuration() const
+{
+    return m_double(RECORD_HEADER_SIZE);
+}
+
+float PEntryView::getX1() const
+{
+    return m_float(RECORD_HEADER_SIZE + sizeof(double));
+}
+
+float PEntryView::getY1() const
+{
+    return m_float(RECORD_HEADER_SIZE + sizeof(double) + sizeof(float));
+}
+
+float PEntryView::getX2() const
+{
+    return m_float(RECORD_HEADER_SIZE + sizeof(double) + 2 * sizeof(float));
+}
+
+float PEntryView::getY2() const
+{
+    return m_float(RECORD_HEADER_SIZE + sizeof(double) + 3 * sizeof(float));
+}
+
+String PEntryView::getMessage() const
+{
+    assert(m_type == MESSAGE);
+    return m_string(RECORD_HEADER_SIZE);
+}
+
+String PEntryView::getIdentifier() const
+{
+    assert(m_type == TRIAL);
+    return m_string(RECORD_HEADER_SIZE);
+}
+
+String PEntryView::getGroup() const
+{
+    uint32_t n;
+    assert(m_type == TRIAL);
+    memcpy(&n, m_record + RECORD_HEADER_SIZE, sizeof(n));
+    return m_string(RECORD_HEADER_SIZE + sizeof(n) + n);
+}
+
+std::size_t PEntryView::size() const
+{
+    return m_size;
+}
+
+PEyeLogEntry* PEntryView::toEntry() const
+{
+    switch (m_type) {
+        case LGAZE:
+        case RGAZE:
+        case AVGGAZE:
+            return new PGazeEntry(m_type, m_time, getX(), getY(), getPupil());
+        case LFIX:
+        case RFIX:
+        case AVGFIX:
+            return new PFixationEntry(
+                    m_type, m_time, getDuration(), getX(), getY()
+                    );
+        case LSAC:
+        case RSAC:
+        case AVGSAC:
+            return new PSaccadeEntry(
+                    m_type, m_time, getDuration(),
+                    getX1(), getY1(), getX2(), getY2()
+                    );
+        case MESSAGE:
+            return new PMessageEntry(m_time, getMessage());
+        case TRIAL:
+            return new PTrialEntry(m_time, getIdentifier(), getGroup());
+        case TRIALSTART:
+            return new PTrialStartEntry(m_time);
+        case TRIALEND:
+            return new PTrialEndEntry(m_time);
+        default:
+            assert(false); // recordSize doesn't accept other types.
+            return nullptr;
+    }
+}
+
+/* **** PMappedLog **** */
+
+PMappedLog::PMappedLog()
+    : m_first(0),
+      m_pos(0),
+      m_status(0),
+      m_block(0)
+{
+}
+
+PMappedLog::~PMappedLog()
+{
+    close();
+}
+
+int PMappedLog::open(const String& filename)
+{
+    PBinaryHeader header;
+    m_first = 0;
+    m_pos = 0;
+    m_status = 0;
+    int ret = m_file.open(filename);
+    if (ret)
+        return ret;
+    ret = readBinaryHeader(m_file.data(), m_file.size(), &header, &m_first);
+    if (ret) {
+        close();
+        return ret;
+    }
+    m_pos = m_first;
+    readBlockIndex();
+    return 0;
+}
+
+void PMappedLog::close()
+{
+    m_file.close();
+    m_first = 0;
+    m_pos = 0;
+    m_status = 0;
+    m_blocks.clear();
+    m_block = 0;
+}
+
+bool PMappedLog::isOpen() const
+{
+    return m_file.isOpen();
+}
+
+bool PMappedLog::next(PEntryView& view)
+{
+    const char* p;
+    entrytype et;
+    std::size_t size;
+
+    // Index records are not entries.
+    do {
+        if (m_status || m_pos >= m_file.size())
+            return false;
+
+        p = m_file.data() + m_pos;
+        size = binaryRecordSize(p, m_file.size() - m_pos, &et);
+        if (!size) {
+            m_status = ERR_INVALID_FILE_FORMAT;
+            return false;
+        }
+        if (isIndexRecord(p))
+            m_pos += size;
+    } while (isIndexRecord(p));
+
+    view.m_record   = p;
+    view.m_size     = size;
+    view.m_type     = et;
+    memcpy(&view.m_time, p + RECORD_TYPE_SIZE, sizeof(view.m_time));
+
+    m_pos += size;
+    return true;
+}
+
+bool PMappedLog::nextInRange(PEntryView& view, double t0, double t1)
+{
+    for (;;) {
+        if (m_blocks.size())
+            skipBlocks(t0, t1);
+        if (!next(view))
+            return false;
+        if (view.getTime() >= t0 && view.getTime() < t1)
+            return true;
+    }
+}
+
+void PMappedLog::rewind()
+{
+    m_pos = m_first;
+    m_status = 0;
+}
+
+int PMappedLog::status() const
+{
+    return m_status;
+}
+
+const PBlockIndex& PMappedLog::getBlockIndex() const
+{
+    return m_blocks;
+}
+
+/*
+ * Loads the block index at the end of the file, an index that doesn't
+ * fit the file is ignored, the records can still be read without it.
+ */
+void PMappedLog::readBlockIndex()
+{
+    const char* payload;
+    std::size_t n;
+
+    m_blocks.clear();
+    m_block = 0;
+    if (!findBinaryIndex(m_file.data(), m_file.size(), &payload, &n))
+        return;
+    if (decodeBinaryBlocks(payload, n, &m_blocks) != 0)
+        return;
+
+    std::size_t end = std::size_t(payload - m_file.data());
+    for (std::size_t i = 0; i < m_blocks.size(); i++) {
+        if (m_blocks[i].offset < m_first || m_blocks[i].offset >= end) {
+            m_blocks.clear();
+            return;
+        }
+    }
+}
+
+/*
+ * Moves m_pos past the blocks that have no times in [t0, t1).
+ */
+void PMappedLog::skipBlocks(double t0, double t1)
+{
+    if (m_block >= m_blocks.size() || m_pos < m_blocks[m_block].offset)
+        m_block = 0;
+
+    while (m_block < m_blocks.size()) {
+        std::size_t next = m_block + 1 < m_blocks.size() ?
+                           std::size_t(m_blocks[m_block + 1].offset) :
+                           m_file.size();
+        if (m_pos >= next) {
+            m_block++;
+            continue;
+        }
+        if (m_pos < m_blocks[m_block].offset ||
+            m_blocks.overlaps(m_block, t0, t1)
+            )
+            return;
+        m_pos = next;
+        m_block++;
+    }
+}
+
+long PMappedLog::count() const
+{
+    long n = 0;
+    std::size_t pos = m_first;
+    const char* data = m_file.data();
+    const std::size_t end = m_file.size();
+    entrytype et;
+
+    while (pos < end) {
+        std::size_t size = binaryRecordSize(data + pos, end - pos, &et);
+        if (!size)
+            return -1;
+        if (!isIndexRecord(data + pos))
+            ++n;
+        pos += size;
+    }
+    return n;
+}
+
+/*
+ * Validates the complete file first, so that nothing is appended to
+ * out when the file turns out to be invalid.
+ */
+static int openMappedLog(PMappedLog& log, const String& filename, long* n)
+{
+    int ret = log.open(filename);
+    if (ret)
+        return ret;
+    *n = log.count();
+    if (*n < 0)
+        return ERR_INVALID_FILE_FORMAT;
+    return 0;
+}
+
+/*
+ * Passes the entries of log from its current position on to out, when
+ * inrange is true only those in [t0, t1).
+ */
+static int addViews(PMappedLog& log,
+                    PEntrySink* out,
+                    bool inrange=false,
+                    double t0=0,
+                    double t1=0
+                    )
+{
+    PEntryView view;
+    while (inrange ? log.nextInRange(view, t0, t1) : log.next(view)) {
+        entrytype et = view.getEntryType();
+        if (et == LGAZE || et == RGAZE || et == AVGGAZE)
+            out->addGaze(et,
+                         view.getTime(),
+                         view.getX(),
+                         view.getY(),
+                         view.getPupil()
+                         );
+        else
+            out->addEntry(view.toEntry());
+    }
+    return log.status();
+}
+
+int readMappedLog(PEyeLog* out, const String& filename)
+{
+    PMappedLog log;
+    long n;
+    int ret = openMappedLog(log, filename, &n);
+    if (ret)
+        return ret;
+
+    out->reserve(unsigned(out->getEntries().size() + n));
+    return addViews(log, out);
+}
+
+int readMappedLog(PEntrySink* out, const String& filename)
+{
+    PMappedLog log;
+    long n;
+    int ret = openMappedLog(log, filename, &n);
+    if (ret)
+        return ret;
+    return addViews(log, out);
+}
+
+int readMappedRange(PEntrySink* out,
+                    const String& filename,
+                    double t0,
+                    double t1
+                    )
+{
+    PMappedLog log;
+    eyelog_format format;
+    int ret = detectLogFormat(filename, &format);
+    if (ret)
+        return ret;
+    if (format == FORMAT_BINARY_V2)
+        return readCompressedRange(out, filename, t0, t1);
+
+    ret = log.open(filename);
+    if (ret)
+        return ret;
+    return addViews(log, out, true, t0, t1);
+}
@@ -0,0 +1,272 @@
+/*
+ * PMappedLog.h
+ *
+ * Provides zero copy access to binary eyelog files.
+ *
+ * Copyright (c) 2016 M.J.A. Duijndam.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see Licenses at www.gnu.org.
+ */
+
+/**
+ * \file PMappedLog.h
+ *
+ * The binary format of a PEyeLog is a plain stream of records. This file
+ * provides a reader that maps such a file into memory and walks the
+ * records in place. Every record is presented as a PEntryView, a small
+ * value that points into the mapped file. The view decodes the fields on
+ * request, nothing is allocated unless one asks for a PEyeLogEntry.
+ */
+
+#ifndef PMAPPED_LOG_H
+#define PMAPPED_LOG_H
+
+#include <cstddef>
+#include "TypeDefs.h"
+#include "constants.h"
+#include "PEyeLogEntry.h"
+#include "PMappedFile.h"
+#include "PEntrySink.h"
+#include "PTimeIndex.h"
+
+/**
+ * A read only view on one record of a binary eyelog.
+ *
+ * A PEntryView is only valid as long as the PMappedLog it came from
+ * is open. The getters are only meaningful for the entry types that
+ * have such a field, e.g. getPupil() for LGAZE or RGAZE.
+ */
+class EYELOG_EXPORT PEntryView {
+    friend class PMappedLog;
+    friend class PLogReader;
+
+public:
+
+    PEntryView();
+
+    /**
+     * Obtains the type of the record.
+     */
+    entrytype getEntryType() const;
+
+    /**
+     * Returns the time when the entry was sampled.
+     */
+    double getTime() const;
+
+    /**
+     * x coordinate of a gaze sample or fixation.
+     */
+    float getX() const;
+
+    /**
+     * y coordinate of a gaze sample or fixation.
+     */
+    float getY() const;
+
+    /**
+     * pupil size of a gaze sample.
+     */
+    float getPupil() const;
+
+    /**
+     * duration of a fixation or saccade.
+     */
+    double getDuration() const;
+
+    /**
+     * start and end coordinates of a saccade.
+     */
+    float getX1() const;
+    float getY1() const;
+    float getX2() const;
+    float getY2() const;
+
+    /**
+     * Returns the message of a MESSAGE record.
+     */
+    String getMessage() const;
+
+    /**
+     * Returns the identifier and group of a TRIAL record.
+     */
+    String getIdentifier() const;
+    String getGroup() const;
+
+    /**
+     * @return the number of bytes the record occupies in the file.
+     */
+    std::size_t size() const;
+
+    /**
+     * Creates a heap allocated PEyeLogEntry from this view.
+     *
+     * The caller owns the returned entry.
+     */
+    PEyeLogEntry* toEntry() const;
+
+private:
+
+    float       m_float(std::size_t offset) const;
+    double      m_double(std::size_t offset) const;
+    String      m_string(std::size_t offset) const;
+
+    const char* m_record;   // first byte of the record (the type).
+    std::size_t m_size;     // size of the record in bytes.
+    entrytype   m_type;
+    double      m_time;
+};
+
+/**
+ * PMappedLog walks the records of a binary eyelog inside a memory map.
+ *
+ * Usage:
+ * \code
+ *  PMappedLog log;
+ *  PEntryView view;
+ *  if (log.open("session.bin") == 0)
+ *      while (log.next(view))
+ *          if (view.getEntryType() == LGAZE)
+ *              sum += view.getX();
+ *  if (log.status())
+ *      ; // the file contains an invalid record.
+ * \endcode
+ */
+class EYELOG_EXPORT PMappedLog {
+
+public:
+
+    PMappedLog();
+    ~PMappedLog();
+
+    /**
+     * Maps a binary logfile.
+     *
+     * The header of the file, if any, is checked and skipped.
+     *
+     * @return 0 if successful, ERR_INVALID_FILE_FORMAT if the header is
+     *         not supported or an errno value otherwise.
+     */
+    int open(const String& filename);
+
+    /**
+     * Unmaps the logfile, all views become invalid.
+     */
+    void close();
+
+    /**
+     * Checks whether a file is mapped.
+     */
+    bool isOpen() const;
+
+    /**
+     * Moves to the next record.
+     *
+     * @param [out] view is set to the next record.
+     * @return false at the end of the file or when a record is invalid,
+     *         status() tells which of the two.
+     */
+    bool next(PEntryView& view);
+
+    /**
+     * Moves to the next record with t0 <= time < t1.
+     *
+     * When the file has a block index, the blocks without such records
+     * are skipped, otherwise every record is examined.
+     *
+     * @param [out] view is set to the next record in the range.
+     * @return false at the end of the file or when a record is invalid,
+     *         status() tells which of the two.
+     */
+    bool nextInRange(PEntryView& view, double t0, double t1);
+
+    /**
+     * Restarts at the first record.
+     */
+    void rewind();
+
+    /**
+     * @return the block index at the end of the file, empty when the
+     *         file doesn't have one.
+     */
+    const PBlockIndex& getBlockIndex() const;
+
+    /**
+     * @return 0 or ERR_INVALID_FILE_FORMAT when an invalid record has
+     *         been encountered.
+     */
+    int status() const;
+
+    /**
+     * Counts the records in the file.
+     *
+     * The current position is not affected.
+     *
+     * @return the number of records or -1 if the file is invalid.
+     */
+    long count() const;
+
+private:
+
+    PMappedLog(const PMappedLog&);
+    PMappedLog& operator=(const PMappedLog&);
+
+    void readBlockIndex();
+    void skipBlocks(double t0, double t1);
+
+    PMappedFile     m_file;
+    std::size_t     m_first;    // offset of the first record.
+    std::size_t     m_pos;
+    int             m_status;
+    PBlockIndex     m_blocks;
+    std::size_t     m_block;    // the block that contains m_pos.
+};
+
+/**
+ * Reads a binary logfile through a memory map.
+ *
+ * This is a faster alternative for readLog when the file is known to be in
+ * the binary format. Entries are appended to out. The whole file is
+ * validated first, so nothing is appended when the file is invalid.
+ *
+ * @return 0, an errno value or ERR_INVALID_FILE_FORMAT.
+ */
+EYELOG_EXPORT int readMappedLog(PEyeLog* out, const String& filename);
+
+/**
+ * Reads a binary logfile through a memory map into a sink.
+ *
+ * Gaze samples are handed to PEntrySink::addGaze, so a sink that
+ * doesn't need PGazeEntry 's doesn't get them.
+ *
+ * @return 0, an errno value or ERR_INVALID_FILE_FORMAT.
+ */
+EYELOG_EXPORT int readMappedLog(PEntrySink* out, const String& filename);
+
+/**
+ * Reads the entries with t0 <= time < t1 of a binary logfile into a sink.
+ *
+ * The block index of the file is used to skip the parts of the file
+ * outside of the range. A compressed binary logfile is read with
+ * readCompressedRange.
+ *
+ * @return 0, an errno value or ERR_INVALID_FILE_FORMAT.
+ */
+EYELOG_EXPORT int readMappedRange(PEntrySink* out,
+                                  const String& filename,
+                                  double t0,
+                                  double t1
+                                  );
+
+#endif
@@ -0,0 +1,291 @@
+/*
+ * PSampleStore.cpp
+ *
+ * This file is part of libeye and implements columnar gaze storage.
+ *
+ * Copyright (C) 2016  Maarten Duijndam
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cassert>
+#include <cmath>
+#include <vector>
+#include "PSampleStore.h"
+#include "PBinocularAverager.h"
+#include "PEyeLog.h"
+#include "PEyeLogEntry.h"
+#include "PGazeKernels.h"
+
+/* **** PGazeColumns **** */
+
+PGazeColumns::PGazeColumns()
+{
+}
+
+void PGazeColumns::append(double time, float x, float y, float pupil)
+{
+    m_time.push_back(time);
+    m_x.push_back(x);
+    m_y.push_back(y);
+    m_pupil.push_back(pupil);
+}
+
+void PGazeColumns::reserve(size_type n)
+{
+    m_time.reserve(n);
+    m_x.reserve(n);
+    m_y.reserve(n);
+    m_pupil.reserve(n);
+}
+
+void PGazeColumns::clear()
+{
+    m_time.clear();
+    m_x.clear();
+    m_y.clear();
+    m_pupil.clear();
+}
+
+PGazeColumns::size_type PGazeColumns::size() const
+{
+    return m_time.size();
+}
+
+bool PGazeColumns::empty() const
+{
+    return m_time.empty();
+}
+
+const DArray<double>& PGazeColumns::getTime() const
+{
+    return m_time;
+}
+
+const DArray<float>& PGazeColumns::getX() const
+{
+    return m_x;
+}
+
+const DArray<float>& PGazeColumns::getY() const
+{
+    return m_y;
+}
+
+const DArray<float>& PGazeColumns::getPupil() const
+{
+    return m_pupil;
+}
+
+/* **** PSampleStore **** */
+
+PSampleStore::PSampleStore()
+{
+}
+
+PSampleStore::PSampleStore(const PEyeLog& log)
+{
+    fromLog(log);
+}
+
+unsigned PSampleStore::eyeIndex(entrytype eye)
+{
+    assert(eye == LGAZE || eye == RGAZE || eye == AVGGAZE);
+    return eye == LGAZE ? 0 : eye == RGAZE ? 1 : 2;
+}
+
+void PSampleStore::clear()
+{
+    for (auto& eye : m_eyes)
+        eye.clear();
+}
+
+PGazeColumns& PSampleStore::operator[](entrytype eye)
+{
+    return m_eyes[eyeIndex(eye)];
+}
+
+const PGazeColumns& PSampleStore::operator[](entrytype eye) const
+{
+    return m_eyes[eyeIndex(eye)];
+}
+
+PGazeColumns::size_type PSampleStore::size() const
+{
+    PGazeColumns::size_type n = 0;
+    for (const auto& eye : m_eyes)
+        n += eye.size();
+    return n;
+}
+
+void PSampleStore::addGaze(entrytype eye,
+                           double time,
+                           float x,
+                           float y,
+                           float pupil
+                           )
+{
+    m_eyes[eyeIndex(eye)].append(time, x, y, pupil);
+}
+
+void PSampleStore::addEntry(PEyeLogEntry* entry)
+{
+    entrytype et = entry->getEntryType();
+    if (et == LGAZE || et == RGAZE || et == AVGGAZE) {
+        const PGazeEntry* g = static_cast<const PGazeEntry*>(entry);
+        addGaze(et, g->getTime(), g->getX(), g->getY(), g->getPupil());
+    }
+    delete entry;
+}
+
+void PSampleStore::fromLog(const PEyeLog& log, bool empty)
+{
+    if (empty)
+        clear();
+
+    const PEntryVec& entries = log.getEntries();
+    for (const auto* e : entries) {
+        entrytype et = e->getEntryType();
+        if (et == LGAZE || et == RGAZE || et == AVGGAZE) {
+            const PGazeEntry* g = static_cast<const PGazeEntry*>(e);
+            addGaze(et, g->getTime(), g->getX(), g->getY(), g->getPupil());
+        }
+    }
+}
+
+static void appendSample(const PGazeColumns& from,
+                         PGazeColumns::size_type i,
+                         PGazeColumns& to
+                         )
+{
+    to.append(from.getTime()[i],
+              from.getX()[i],
+              from.getY()[i],
+              from.getPupil()[i]
+              );
+}
+
+/*
+ * An eye is missing when x or y is NaN, its pupil is often 0.
+ */
+static bool missingEye(const PGazeColumns& eye, PGazeColumns::size_type i)
+{
+    return std::isnan(eye.getX()[i]) || std::isnan(eye.getY()[i]);
+}
+
+/*
+ * Appends the samples [il, il + n) of l and [ir, ir + n) of r, which are
+ * taken at the same times, averaged to avg. Where one eye is missing the
+ * sample of the other eye is used, like averageSample does.
+ */
+static void appendAverage(const PGazeColumns& l,
+                          PGazeColumns::size_type il,
+                          const PGazeColumns& r,
+                          PGazeColumns::size_type ir,
+                          PGazeColumns::size_type n,
+                          PGazeColumns& avg
+                          )
+{
+    std::vector<float> x(n), y(n), pupil(n);
+    averageEyes(l.getX().begin() + il, r.getX().begin() + ir, n, x.data());
+    averageEyes(l.getY().begin() + il, r.getY().begin() + ir, n, y.data());
+    averageEyes(l.getPupil().begin() + il, r.getPupil().begin() + ir, n,
+                pupil.data()
+                );
+    for (PGazeColumns::size_type i = 0; i < n; i++) {
+        bool noleft = missingEye(l, il + i);
+        if (noleft != missingEye(r, ir + i)) {
+            const PGazeColumns& eye = noleft ? r : l;
+            PGazeColumns::size_type j = noleft ? ir + i : il + i;
+            x[i] = eye.getX()[j];
+            y[i] = eye.getY()[j];
+            pupil[i] = eye.getPupil()[j];
+        }
+        avg.append(l.getTime()[il + i], x[i], y[i], pupil[i]);
+    }
+}
+
+void PSampleStore::average()
+{
+    const PGazeColumns& l = (*this)[LGAZE];
+    const PGazeColumns& r = (*this)[RGAZE];
+    PGazeColumns& avg = (*this)[AVGGAZE];
+    const double tolerance = PBinocularAverager::PAIR_TOLERANCE;
+    PGazeColumns::size_type il = 0, ir = 0;
+
+    avg.clear();
+    avg.reserve(l.size() > r.size() ? l.size() : r.size());
+
+    // Binocular recordings have long runs of samples of both eyes at the
+    // same times, those runs are averaged at once.
+    while (il < l.size() && ir < r.size()) {
+        double dt = l.getTime()[il] - r.getTime()[ir];
+        if (dt < -tolerance) {
+            appendSample(l, il++, avg);
+        }
+        else if (dt > tolerance) {
+            appendSample(r, ir++, avg);
+        }
+        else {
+            PGazeColumns::size_type n = 1;
+            while (il + n < l.size() && ir + n < r.size() &&
+                   std::fabs(l.getTime()[il + n] - r.getTime()[ir + n]) <=
+                        tolerance
+                   )
+                n++;
+            appendAverage(l, il, r, ir, n, avg);
+            il += n;
+            ir += n;
+        }
+    }
+    while (il < l.size())
+        appendSample(l, il++, avg);
+    while (ir < r.size())
+        appendSample(r, ir++, avg);
+}
+
+void PSampleStore::toLog(PEyeLog& log, bool append) const
+{
+    if (!append)
+        log.clear();
+    log.reserve(unsigned(log.getEntries().size() + size()));
+
+    // Merge the columns on time, on equal times the left eye goes first,
+    // then the right eye and the average, just like PEyeLogEntry::compare
+    // orders them.
+    const entrytype eyes[NUM_EYES] = {LGAZE, RGAZE, AVGGAZE};
+    PGazeColumns::size_type pos[NUM_EYES] = {0, 0, 0};
+    for (;;) {
+        int next = -1;
+        for (int e = 0; e < NUM_EYES; e++) {
+            const PGazeColumns& c = m_eyes[e];
+            if (pos[e] < c.size() &&
+                (next < 0 ||
+                 c.getTime()[pos[e]] < m_eyes[next].getTime()[pos[next]])
+                )
+                next = e;
+        }
+        if (next < 0)
+            break;
+        const PGazeColumns& c = m_eyes[next];
+        PGazeColumns::size_type i = pos[next]++;
+        log.addGaze(eyes[next],
+                    c.getTime()[i],
+                    c.getX()[i],
+                    c.getY()[i],
+                    c.getPupil()[i]
+                    );
+    }
+}
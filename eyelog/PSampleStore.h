@@ -0,0 +1,190 @@
+/*
+ * PSampleStore.h
+ *
+ * Public header that provides columnar storage for gaze samples.
+ *
+ * Copyright (c) 2016 M.J.A. Duijndam.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see Licenses at www.gnu.org.
+ */
+
+/**
+ * \file PSampleStore.h
+ *
+ * A PEyeLog stores every gaze sample as a separately allocated PGazeEntry.
+ * This is flexible, but scanning a million samples means chasing a million
+ * pointers. The classes in this file store the samples of one eye as a
+ * structure of arrays instead: one contiguous array per field. The arrays
+ * can be handed to other libraries (e.g. numpy) without copying.
+ */
+
+#ifndef PSAMPLE_STORE_H
+#define PSAMPLE_STORE_H
+
+#include "TypeDefs.h"
+#include "DArray.h"
+#include "constants.h"
+#include "PEntrySink.h"
+
+class PEyeLog;
+
+/**
+ * The gaze samples of one eye, stored column wise.
+ *
+ * All columns always have the same size, sample i consists of
+ * getTime()[i], getX()[i], getY()[i] and getPupil()[i].
+ */
+class EYELOG_EXPORT PGazeColumns {
+
+public:
+
+    typedef DArray<double>::size_type size_type;
+
+    PGazeColumns();
+
+    /**
+     * Appends one sample to the columns.
+     */
+    void append(double time, float x, float y, float pupil);
+
+    /**
+     * Reserves space for n samples in every column.
+     */
+    void reserve(size_type n);
+
+    /**
+     * Removes all samples.
+     */
+    void clear();
+
+    /**
+     * @return the number of samples.
+     */
+    size_type size() const;
+
+    /**
+     * @return true if there are no samples.
+     */
+    bool empty() const;
+
+    /**
+     * The columns with the sample times, coordinates and pupil sizes.
+     */
+    const DArray<double>& getTime() const;
+    const DArray<float>&  getX() const;
+    const DArray<float>&  getY() const;
+    const DArray<float>&  getPupil() const;
+
+private:
+
+    DArray<double>  m_time;
+    DArray<float>   m_x;
+    DArray<float>   m_y;
+    DArray<float>   m_pupil;
+};
+
+/**
+ * PSampleStore contains the gaze samples of both eyes and their average
+ * in columnar form.
+ *
+ * The store is a PEntrySink, so the log readers can fill it directly
+ * (see readLog(PSampleStore*, const String&)). Entries that are not a gaze
+ * sample are ignored by the store.
+ */
+class EYELOG_EXPORT PSampleStore : public PEntrySink {
+
+public:
+
+    PSampleStore();
+
+    /**
+     * Creates a store with the gaze samples of log.
+     */
+    explicit PSampleStore(const PEyeLog& log);
+
+    /**
+     * Removes all samples.
+     */
+    void clear();
+
+    /**
+     * Returns the columns of an eye.
+     *
+     * @param eye LGAZE, RGAZE or AVGGAZE.
+     */
+    PGazeColumns&       operator[](entrytype eye);
+    const PGazeColumns& operator[](entrytype eye) const;
+
+    /**
+     * @return the total number of samples of both eyes and the average.
+     */
+    PGazeColumns::size_type size() const;
+
+    /**
+     * Appends a gaze sample to the columns of eye.
+     */
+    virtual void addGaze(entrytype eye,
+                         double time,
+                         float x,
+                         float y,
+                         float pupil
+                         );
+
+    /**
+     * Appends entry when it is a gaze sample.
+     *
+     * The store takes ownership of entry as required by PEntrySink and
+     * deletes it directly.
+     */
+    virtual void addEntry(PEyeLogEntry* entry);
+
+    /**
+     * Extracts the gaze samples of a log.
+     *
+     * @param log       the log with the samples.
+     * @param clear     remove the current samples first.
+     */
+    void fromLog(const PEyeLog& log, bool clear=true);
+
+    /**
+     * Computes the AVGGAZE columns from the LGAZE and RGAZE columns.
+     *
+     * The samples of the eyes are paired on time in one pass, so both
+     * columns must be sorted. A sample of which the other eye is
+     * missing, or of which x or y of the other eye is NaN, is used as it
+     * is, see averageSample. The current average is replaced.
+     */
+    void average();
+
+    /**
+     * Adds the samples to a log.
+     *
+     * The samples of both eyes and the average are merged on time, so
+     * when the columns are sorted the log is sorted as well.
+     *
+     * @param [out] log the log that receives new PGazeEntry 's.
+     * @param append    if false the log is cleared first.
+     */
+    void toLog(PEyeLog& log, bool append=false) const;
+
+private:
+
+    static unsigned eyeIndex(entrytype eye);
+
+    enum {NUM_EYES = 3};
+
+    PGazeColumns m_eyes[NUM_EYES];
+};
+
+#endif
@@ -0,0 +1,301 @@
+/*
+ * PTextScanner.cpp
+ *
+ * This file is part of libeye and scans numbers from text.
+ *
+ * Copyright (C) 2016  Maarten Duijndam
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <locale>
+#include <sstream>
+#include <string>
+#include "PTextScanner.h"
+
+using namespace std;
+
+/*
+ * Powers of ten that are exactly representable in a double or float.
+ */
+static const double DOUBLE_POW10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+static const int DOUBLE_MAX_POW10 = 22;
+static const uint64_t DOUBLE_MAX_MANTISSA = uint64_t(1) << 53;
+
+static const float FLOAT_POW10[] = {
+    1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+};
+static const int FLOAT_MAX_POW10 = 10;
+static const uint64_t FLOAT_MAX_MANTISSA = uint64_t(1) << 24;
+
+/*
+ * A uint64_t holds 19 decimal digits without overflowing.
+ */
+static const int MAX_DIGITS = 19;
+
+/*
+ * The decimal number as it is written: mantissa * 10^exponent.
+ */
+struct PDecimal {
+    uint64_t    mantissa;
+    int         exponent;
+    bool        negative;
+    bool        exact;      // false when digits were dropped or the exponent
+                            // is malformed or out of range.
+};
+
+static inline bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+/*
+ * Scans a decimal number starting at p. On success end points
+ * one past the last character that belongs to the number.
+ */
+static bool scanDecimal(const char* p,
+                        const char* last,
+                        PDecimal& dec,
+                        const char*& end
+                        )
+{
+    int ndigits = 0;
+    bool anydigit = false;
+
+    dec.mantissa = 0;
+    dec.exponent = 0;
+    dec.negative = false;
+    dec.exact = true;
+
+    if (p < last && (*p == '-' || *p == '+')) {
+        dec.negative = *p == '-';
+        p++;
+    }
+
+    for (; p < last && isDigit(*p); p++) {
+        anydigit = true;
+        if (ndigits < MAX_DIGITS) {
+            dec.mantissa = dec.mantissa * 10 + unsigned(*p - '0');
+            if (dec.mantissa)
+                ndigits++;
+        }
+        else {
+            dec.exponent++;
+            if (*p != '0')
+                dec.exact = false;
+        }
+    }
+
+    if (p < last && *p == '.') {
+        p++;
+        for (; p < last && isDigit(*p); p++) {
+            anydigit = true;
+            if (ndigits < MAX_DIGITS) {
+                dec.mantissa = dec.mantissa * 10 + unsigned(*p - '0');
+                dec.exponent--;
+                if (dec.mantissa)
+                    ndigits++;
+            }
+            else if (*p != '0')
+                dec.exact = false;
+        }
+    }
+
+    if (!anydigit)
+        return false;
+
+    if (p < last && (*p == 'e' || *p == 'E')) {
+        const char* q = p + 1;
+        bool negexp = false;
+        int exp = 0;
+        if (q < last && (*q == '-' || *q == '+')) {
+            negexp = *q == '-';
+            q++;
+        }
+        if (q < last && isDigit(*q)) {
+            for (; q < last && isDigit(*q); q++) {
+                if (exp < 10000)
+                    exp = exp * 10 + (*q - '0');
+            }
+            dec.exponent += negexp ? -exp : exp;
+        }
+        else {
+            // Let the stream decide what a dangling exponent means.
+            dec.exact = false;
+        }
+        p = q;
+    }
+
+    end = p;
+    return true;
+}
+
+/*
+ * The slow but always correct path.
+ */
+template <class T>
+static bool classicConvert(const char* begin, const char* end, T& value)
+{
+    istringstream stream(string(begin, end));
+    stream.imbue(std::locale::classic());
+    T temp;
+    if (stream >> temp) {
+        value = temp;
+        return true;
+    }
+    return false;
+}
+
+PTextScanner::PTextScanner(const char* begin, const char* end)
+    : m_pos(begin), m_end(end)
+{
+}
+
+void PTextScanner::skipSpace()
+{
+    while (m_pos < m_end && isSpace(*m_pos))
+        m_pos++;
+}
+
+void PTextScanner::skipBlank()
+{
+    while (m_pos < m_end && *m_pos != '\n' && isSpace(*m_pos))
+        m_pos++;
+}
+
+void PTextScanner::skipLine()
+{
+    if (m_pos >= m_end)
+        return;
+    const char* eol = static_cast<const char*>(
+            memchr(m_pos, '\n', m_end - m_pos)
+            );
+    m_pos = eol ? eol + 1 : m_end;
+}
+
+bool PTextScanner::atEnd() const
+{
+    return m_pos >= m_end;
+}
+
+const char* PTextScanner::position() const
+{
+    return m_pos;
+}
+
+bool PTextScanner::readToken(const char*& begin, const char*& end)
+{
+    skipSpace();
+    begin = m_pos;
+    while (m_pos < m_end && !isSpace(*m_pos))
+        m_pos++;
+    end = m_pos;
+    return begin != end;
+}
+
+void PTextScanner::readLine(const char*& begin, const char*& end)
+{
+    begin = m_pos;
+    const char* eol = nullptr;
+    if (m_pos < m_end)
+        eol = static_cast<const char*>(memchr(m_pos, '\n', m_end - m_pos));
+    end = eol ? eol : m_end;
+    m_pos = end;
+}
+
+bool PTextScanner::readUnsigned(unsigned& value)
+{
+    skipSpace();
+    const char* p = m_pos;
+    uint64_t v = 0;
+
+    if (p < m_end && *p == '+')
+        p++;
+    if (p >= m_end || !isDigit(*p))
+        return false;
+    for (; p < m_end && isDigit(*p); p++) {
+        v = v * 10 + unsigned(*p - '0');
+        if (v > 0xFFFFFFFFu)
+            return false;
+    }
+    value = unsigned(v);
+    m_pos = p;
+    return true;
+}
+
+bool PTextScanner::readDouble(double& value)
+{
+    PDecimal dec;
+    const char* end;
+
+    skipSpace();
+    if (!scanDecimal(m_pos, m_end, dec, end))
+        return false;
+
+    if (dec.exact &&
+        dec.mantissa <= DOUBLE_MAX_MANTISSA &&
+        dec.exponent >= -DOUBLE_MAX_POW10 &&
+        dec.exponent <= DOUBLE_MAX_POW10
+        )
+    {
+        // Both operands are exact, so IEEE arithmetic rounds correctly.
+        double d = double(dec.mantissa);
+        if (dec.exponent < 0)
+            d /= DOUBLE_POW10[-dec.exponent];
+        else
+            d *= DOUBLE_POW10[dec.exponent];
+        value = dec.negative ? -d : d;
+    }
+    else if (!classicConvert(m_pos, end, value))
+        return false;
+
+    m_pos = end;
+    return true;
+}
+
+bool PTextScanner::readFloat(float& value)
+{
+    PDecimal dec;
+    const char* end;
+
+    skipSpace();
+    if (!scanDecimal(m_pos, m_end, dec, end))
+        return false;
+
+    if (dec.exact &&
+        dec.mantissa <= FLOAT_MAX_MANTISSA &&
+        dec.exponent >= -FLOAT_MAX_POW10 &&
+        dec.exponent <= FLOAT_MAX_POW10
+        )
+    {
+        // Don't take a detour through double, that would round twice.
+        float f = float(dec.mantissa);
+        if (dec.exponent < 0)
+            f /= FLOAT_POW10[-dec.exponent];
+        else
+            f *= FLOAT_POW10[dec.exponent];
+        value = dec.negative ? -f : f;
+    }
+    else if (!classicConvert(m_pos, end, value))
+        return false;
+
+    m_pos = end;
+    return true;
+}
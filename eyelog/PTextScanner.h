@@ -0,0 +1,121 @@
+/*
+ * PTextScanner.h
+ *
+ * Public header that provides a fast scanner for numbers in text.
+ *
+ * Copyright (c) 2016 M.J.A. Duijndam.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see Licenses at www.gnu.org.
+ */
+
+#ifndef PTEXT_SCANNER_H
+#define PTEXT_SCANNER_H
+
+#include "TypeDefs.h"
+
+/**
+ * PTextScanner reads whitespace separated tokens and numbers from
+ * a buffer of characters.
+ *
+ * The scanner doesn't depend on the global locale and doesn't allocate
+ * memory for ordinary decimal numbers. It accepts the numbers the
+ * classic "C" locale accepts: an optional sign, digits with an optional
+ * decimal point and an optional exponent. Whitespace is what isspace
+ * considers whitespace in the "C" locale. Numbers that can't be converted
+ * exactly with a few floating point operations are handed to a stream
+ * imbued with the classic locale, so the results are identical to
+ * those of operator>> in the "C" locale.
+ *
+ * Every read method skips leading whitespace, on failure the position of
+ * the scanner is not advanced past the offending characters.
+ */
+class EYELOG_EXPORT PTextScanner {
+
+public:
+
+    PTextScanner(const char* begin, const char* end);
+
+    /**
+     * Skips spaces, tabs, newlines etc.
+     */
+    void skipSpace();
+
+    /**
+     * Skips spaces and tabs, but stops at a newline.
+     */
+    void skipBlank();
+
+    /**
+     * Skips everything up to and including the next newline.
+     */
+    void skipLine();
+
+    /**
+     * @return true when the end of the buffer is reached.
+     */
+    bool atEnd() const;
+
+    /**
+     * @return the current position in the buffer.
+     */
+    const char* position() const;
+
+    /**
+     * Reads a sequence of non whitespace characters.
+     *
+     * @param [out] begin the first character of the token.
+     * @param [out] end one past the last character of the token.
+     *
+     * @return false if there is no token before the end of the buffer.
+     */
+    bool readToken(const char*& begin, const char*& end);
+
+    /**
+     * Reads the remainder of the line without the newline.
+     *
+     * @param [out] begin the first character after the current position.
+     * @param [out] end the newline or the end of the buffer.
+     */
+    void readLine(const char*& begin, const char*& end);
+
+    /**
+     * Reads a non negative integer.
+     */
+    bool readUnsigned(unsigned& value);
+
+    /**
+     * Reads a floating point number.
+     */
+    bool readDouble(double& value);
+
+    /**
+     * Reads a floating point number.
+     */
+    bool readFloat(float& value);
+
+    /**
+     * Tests whether a character is whitespace in the "C" locale.
+     */
+    static bool isSpace(char c)
+    {
+        return c == ' ' || (c >= '\t' && c <= '\r');
+    }
+
+private:
+
+    const char*     m_pos;
+    const char*     m_end;
+};
+
+#endif
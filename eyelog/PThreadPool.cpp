@@ -0,0 +1,212 @@
+/*
+ * PThreadPool.cpp
+ *
+ * This file is part of libeye and runs parallel loops on a pool of
+ * threads.
+ *
+ * Copyright (C) 2016  Maarten Duijndam
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cassert>
+#include "PThreadPool.h"
+
+/*
+ * The pool of which the current thread runs a loop, a loop it starts
+ * on the same pool runs in the thread itself.
+ */
+static thread_local const PThreadPool* current_pool = nullptr;
+
+PThreadPool::PThreadPool(unsigned nthreads)
+    : m_size(nthreads),
+      m_body(nullptr),
+      m_grain(1),
+      m_generation(0),
+      m_active(0),
+      m_stop(false),
+      m_remaining(0)
+{
+    if (m_size == 0)
+        m_size = std::thread::hardware_concurrency();
+    if (m_size == 0)
+        m_size = 1;
+
+    m_parts.reset(new Part[m_size]);
+    for (unsigned i = 0; i < m_size; i++)
+        m_parts[i].begin = m_parts[i].end = 0;
+    for (unsigned i = 1; i < m_size; i++)
+        m_threads.push_back(std::thread(&PThreadPool::work, this, i));
+}
+
+PThreadPool::~PThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_start.notify_all();
+    for (auto& t : m_threads)
+        t.join();
+}
+
+unsigned PThreadPool::size() const
+{
+    return m_size;
+}
+
+void PThreadPool::forEach(std::size_t n, const Body& body, std::size_t grain)
+{
+    if (n == 0)
+        return;
+    if (grain == 0)
+        grain = 1;
+    if (m_size == 1 || n <= grain || current_pool == this) {
+        body(0, n);
+        return;
+    }
+
+    std::lock_guard<std::mutex> loop(m_loop);
+    {
+        // Threads that are still leaving the previous loop must not see
+        // the parts of this one.
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_finish.wait(lock, [this] () {return m_active == 0;});
+
+        std::size_t part = n / m_size, rest = n % m_size, begin = 0;
+        for (unsigned i = 0; i < m_size; i++) {
+            std::lock_guard<std::mutex> partlock(m_parts[i].mutex);
+            m_parts[i].begin = begin;
+            begin += part + (i < rest ? 1 : 0);
+            m_parts[i].end = begin;
+        }
+        assert(begin == n);
+        m_body = &body;
+        m_grain = grain;
+        m_remaining = n;
+        m_generation++;
+        m_active++;
+    }
+    m_start.notify_all();
+
+    const PThreadPool* previous = current_pool;
+    current_pool = this;
+    runLoop(0);
+    current_pool = previous;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_active--;
+    m_finish.wait(lock, [this] () {
+        return m_remaining == 0 && m_active == 0;
+    });
+    m_body = nullptr;
+}
+
+/*
+ * The loop of the threads of the pool, they join every loop that starts.
+ */
+void PThreadPool::work(unsigned id)
+{
+    unsigned long seen = 0;
+    current_pool = this;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_start.wait(lock, [this, seen] () {
+                return m_stop || m_generation != seen;
+            });
+            if (m_stop)
+                return;
+            seen = m_generation;
+            m_active++;
+        }
+        runLoop(id);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_active--;
+        }
+        m_finish.notify_all();
+    }
+}
+
+/*
+ * Runs chunks of the own part, and of stolen parts, until no work is left.
+ */
+void PThreadPool::runLoop(unsigned id)
+{
+    std::size_t begin, end;
+    do {
+        while (takeChunk(id, &begin, &end)) {
+            (*m_body)(begin, end);
+            m_remaining -= end - begin;
+        }
+    } while (steal(id));
+}
+
+bool PThreadPool::takeChunk(unsigned id, std::size_t* begin, std::size_t* end)
+{
+    Part& part = m_parts[id];
+    std::lock_guard<std::mutex> lock(part.mutex);
+    if (part.begin >= part.end)
+        return false;
+    *begin = part.begin;
+    *end = part.begin + std::min(m_grain, part.end - part.begin);
+    part.begin = *end;
+    return true;
+}
+
+/*
+ * Moves the back half of the part with most work left to part id, a
+ * part of at most one chunk is taken completely.
+ *
+ * @return false when no work is left.
+ */
+bool PThreadPool::steal(unsigned id)
+{
+    for (;;) {
+        unsigned victim = id;
+        std::size_t most = 0;
+        for (unsigned i = 0; i < m_size; i++) {
+            if (i == id)
+                continue;
+            std::lock_guard<std::mutex> lock(m_parts[i].mutex);
+            std::size_t left = m_parts[i].end - m_parts[i].begin;
+            if (left > most) {
+                most = left;
+                victim = i;
+            }
+        }
+        if (victim == id)
+            return false;
+
+        std::size_t begin, end;
+        {
+            Part& part = m_parts[victim];
+            std::lock_guard<std::mutex> lock(part.mutex);
+            std::size_t left = part.end - part.begin;
+            if (left == 0)
+                continue; // finished in the meantime, look again.
+            std::size_t take = left > m_grain ? left / 2 : left;
+            end = part.end;
+            begin = end - take;
+            part.end = begin;
+        }
+        Part& own = m_parts[id];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        own.begin = begin;
+        own.end = end;
+        return true;
+    }
+}
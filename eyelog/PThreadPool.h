@@ -0,0 +1,258 @@
+/*
+ * PThreadPool.h
+ *
+ * Public header that provides a pool of threads that run parallel loops
+ * over entries, trials or any other range of indices.
+ *
+ * Copyright (c) 2016 M.J.A. Duijndam.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see Licenses at www.gnu.org.
+ */
+
+#ifndef PTHREAD_POOL_H
+#define PTHREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "eyelog_export.h"
+#include "PEyeLogEntry.h"
+#include "PExperiment.h"
+
+/**
+ * PThreadPool runs parallel loops over a range of indices.
+ *
+ * At the start of a loop every thread gets an equal part of the range, it
+ * takes chunks of grain indices from the front of its part. A thread that
+ * runs out of work steals the back half of the part of the thread that
+ * has most work left. So trials that take long don't keep the other
+ * threads idle, while a thread usually works on consecutive indices.
+ *
+ * The thread that calls forEach or reduce takes part in the loop, a pool
+ * of n threads starts n - 1 threads of its own. Loops that are started
+ * from several threads at once run one after the other. A loop started
+ * from a body, by a thread of the same pool, runs in that thread.
+ *
+ * The bodies of a loop run concurrently, they may only read shared data,
+ * e.g. with the const methods of a PEyeLog, PExperiment or PTrial, see
+ * PEyeLog about the thread safety of the library. A body must not throw.
+ */
+class EYELOG_EXPORT PThreadPool {
+
+public:
+
+    /**
+     * The body of a loop, it handles the indices in [begin, end).
+     */
+    typedef std::function<void(std::size_t begin, std::size_t end)> Body;
+
+    /**
+     * Starts the threads.
+     *
+     * @param nthreads  number of threads including the caller of the
+     *                  loops, 0 uses one per core.
+     */
+    explicit PThreadPool(unsigned nthreads=0);
+
+    /**
+     * Stops the threads.
+     */
+    ~PThreadPool();
+
+    /**
+     * @return the number of threads that run a loop.
+     */
+    unsigned size() const;
+
+    /**
+     * Calls body for chunks of indices until all of [0, n) are handled
+     * and returns when the last chunk has finished.
+     *
+     * @param grain the number of indices a thread takes at once, the last
+     *              chunk of a part may be smaller. A loop that runs in
+     *              the calling thread alone gets [0, n) in one call.
+     */
+    void forEach(std::size_t n, const Body& body, std::size_t grain=1);
+
+    /**
+     * Combines map(i) for every i in [0, n).
+     *
+     * Every chunk is reduced on its own, starting from identity, and the
+     * results of the chunks are combined in the order of the indices. So
+     * combine must be associative, but need not be commutative. The
+     * chunks vary from run to run, a floating point sum may therefore
+     * differ in the last bits.
+     */
+    template <class T, class Map, class Combine>
+    T reduce(std::size_t n,
+             T identity,
+             Map map,
+             Combine combine,
+             std::size_t grain=1
+             );
+
+private:
+
+    PThreadPool(const PThreadPool&);
+    PThreadPool& operator=(const PThreadPool&);
+
+    struct Part {
+        std::mutex  mutex;
+        std::size_t begin;
+        std::size_t end;
+    };
+
+    void work(unsigned id);
+    void runLoop(unsigned id);
+    bool takeChunk(unsigned id, std::size_t* begin, std::size_t* end);
+    bool steal(unsigned id);
+
+    unsigned                    m_size;
+    std::unique_ptr<Part[]>     m_parts;
+    std::vector<std::thread>    m_threads;
+
+    std::mutex                  m_loop;     // one loop at a time.
+    std::mutex                  m_mutex;    // protects the state below.
+    std::condition_variable     m_start;
+    std::condition_variable     m_finish;
+    const Body*                 m_body;
+    std::size_t                 m_grain;
+    unsigned long               m_generation;
+    unsigned                    m_active;   // threads in the loop.
+    bool                        m_stop;
+    std::atomic<std::size_t>    m_remaining;
+};
+
+template <class T, class Map, class Combine>
+T PThreadPool::reduce(std::size_t n,
+                      T identity,
+                      Map map,
+                      Combine combine,
+                      std::size_t grain
+                      )
+{
+    std::mutex mutex;
+    std::vector<std::pair<std::size_t, T> > partials;
+    forEach(n,
+            [&] (std::size_t begin, std::size_t end) {
+                T result = identity;
+                for (std::size_t i = begin; i < end; i++)
+                    result = combine(result, map(i));
+                std::lock_guard<std::mutex> lock(mutex);
+                partials.push_back(std::make_pair(begin, std::move(result)));
+            },
+            grain
+            );
+
+    std::sort(partials.begin(), partials.end(),
+              [] (const std::pair<std::size_t, T>& a,
+                  const std::pair<std::size_t, T>& b) {
+                  return a.first < b.first;
+              });
+    T result = identity;
+    for (auto& p : partials)
+        result = combine(result, p.second);
+    return result;
+}
+
+/**
+ * The number of entries a thread takes at once by default, entries are
+ * cheap to handle.
+ */
+const std::size_t ENTRY_GRAIN = 4096;
+
+/**
+ * Calls func(entry, i) for every entry of entries on the threads of pool.
+ */
+template <class Func>
+void forEachEntry(PThreadPool& pool,
+                  const PEntryVec& entries,
+                  Func func,
+                  std::size_t grain=ENTRY_GRAIN
+                  )
+{
+    pool.forEach(entries.size(),
+                 [&] (std::size_t begin, std::size_t end) {
+                     for (std::size_t i = begin; i < end; i++)
+                         func(static_cast<const PEyeLogEntry&>(*entries[i]), i);
+                 },
+                 grain
+                 );
+}
+
+/**
+ * Combines map(entry) of all entries, see PThreadPool::reduce.
+ */
+template <class T, class Map, class Combine>
+T reduceEntries(PThreadPool& pool,
+                const PEntryVec& entries,
+                T identity,
+                Map map,
+                Combine combine,
+                std::size_t grain=ENTRY_GRAIN
+                )
+{
+    return pool.reduce(entries.size(),
+                       identity,
+                       [&] (std::size_t i) {
+                           return map(
+                                static_cast<const PEyeLogEntry&>(*entries[i])
+                                );
+                       },
+                       combine,
+                       grain
+                       );
+}
+
+/**
+ * Calls func(trial, i) for every trial of experiment on the threads of
+ * pool, a thread takes one trial at a time.
+ */
+template <class Func>
+void forEachTrial(PThreadPool& pool, const PExperiment& experiment, Func func)
+{
+    pool.forEach(experiment.nTrials(),
+                 [&] (std::size_t begin, std::size_t end) {
+                     for (std::size_t i = begin; i < end; i++)
+                         func(experiment[i], i);
+                 }
+                 );
+}
+
+/**
+ * Combines map(trial) of all trials, see PThreadPool::reduce.
+ */
+template <class T, class Map, class Combine>
+T reduceTrials(PThreadPool& pool,
+               const PExperiment& experiment,
+               T identity,
+               Map map,
+               Combine combine
+               )
+{
+    return pool.reduce(experiment.nTrials(),
+                       identity,
+                       [&] (std::size_t i) {return map(experiment[i]);},
+                       combine
+                       );
+}
+
+#endif
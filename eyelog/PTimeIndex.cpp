@@ -0,0 +1,254 @@
+/*
+ * PTimeIndex.cpp
+ *
+ * This file is part of libeye and finds the entries of a log by time.
+ *
+ * Copyright (C) 2016  Maarten Duijndam
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+#include "PTimeIndex.h"
+
+using namespace std;
+
+const unsigned PTimeIndex::NTYPES;
+const std::size_t PBlockIndex::BLOCK_ENTRIES;
+
+/*
+ * The number of interpolation steps before lowerBound bisects.
+ */
+static const int MAX_INTERPOLATIONS = 4;
+
+/* **** PTimeIndex **** */
+
+PTimeIndex::PTimeIndex()
+{
+}
+
+PTimeIndex::PTimeIndex(const PEntryVec& entries)
+{
+    build(entries);
+}
+
+void PTimeIndex::build(const PEntryVec& entries)
+{
+    bool sorted[NTYPES];
+
+    clear();
+    for (unsigned i = 0; i < NTYPES; i++)
+        sorted[i] = true;
+
+    for (std::size_t pos = 0; pos < entries.size(); pos++) {
+        unsigned type = unsigned(entries[pos]->getEntryType());
+        if (type >= NTYPES)
+            continue;
+        Column& c = m_columns[type];
+        double time = entries[pos]->getTime();
+        if (!c.times.empty() && time < c.times.back())
+            sorted[type] = false;
+        c.times.push_back(time);
+        c.positions.push_back(pos);
+    }
+
+    // Logs are mostly in order of time, only a column that isn't is sorted.
+    for (unsigned type = 0; type < NTYPES; type++) {
+        if (sorted[type])
+            continue;
+        Column& c = m_columns[type];
+        vector<pair<double, std::size_t> > items(c.times.size());
+        for (std::size_t i = 0; i < items.size(); i++)
+            items[i] = make_pair(c.times[i], c.positions[i]);
+        stable_sort(items.begin(), items.end(),
+                    [](const pair<double, std::size_t>& a,
+                       const pair<double, std::size_t>& b) {
+                        return a.first < b.first;
+                    });
+        for (std::size_t i = 0; i < items.size(); i++) {
+            c.times[i] = items[i].first;
+            c.positions[i] = items[i].second;
+        }
+    }
+}
+
+void PTimeIndex::clear()
+{
+    for (auto& c : m_columns) {
+        c.times.clear();
+        c.positions.clear();
+    }
+}
+
+std::size_t PTimeIndex::size(entrytype type) const
+{
+    assert(unsigned(type) < NTYPES);
+    return m_columns[type].times.size();
+}
+
+PTimeIndex::Positions PTimeIndex::find(entrytype type,
+                                       double t0,
+                                       double t1
+                                       ) const
+{
+    assert(unsigned(type) < NTYPES);
+    const Column& c = m_columns[type];
+    if (c.times.empty() || !(t0 < t1))
+        return Positions();
+
+    std::size_t first = lowerBound(c.times, t0);
+    std::size_t last = lowerBound(c.times, t1);
+    const std::size_t* p = c.positions.data();
+    return Positions(p + first, p + last);
+}
+
+std::vector<std::size_t> PTimeIndex::findAll(double t0, double t1) const
+{
+    std::vector<std::size_t> out;
+    for (unsigned type = 0; type < NTYPES; type++) {
+        Positions p = find(entrytype(type), t0, t1);
+        out.insert(out.end(), p.begin(), p.end());
+    }
+    sort(out.begin(), out.end());
+    return out;
+}
+
+void PTimeIndex::select(const PEntryVec& entries,
+                        entrytype type,
+                        double t0,
+                        double t1,
+                        PEntryVec* out
+                        ) const
+{
+    Positions p = find(type, t0, t1);
+    out->reserve(out->size() + p.size());
+    for (std::size_t pos : p) {
+        assert(pos < entries.size());
+        out->push_back(entries[pos]);
+    }
+}
+
+/*
+ * Returns the first i with times[i] >= t, like std::lower_bound.
+ *
+ * Everything before lo is smaller than t and everything from hi on
+ * isn't. The first probes are placed where t would be if the times are
+ * evenly spaced, which for samples finds t in a few steps.
+ */
+std::size_t PTimeIndex::lowerBound(const std::vector<double>& times, double t)
+{
+    std::size_t lo = 0, hi = times.size();
+    int ninterpolations = 0;
+
+    while (lo < hi) {
+        std::size_t mid = lo + (hi - lo) / 2;
+        double tlo = times[lo], thi = times[hi - 1];
+        if (ninterpolations < MAX_INTERPOLATIONS && tlo < thi) {
+            ninterpolations++;
+            double f = (t - tlo) / (thi - tlo);
+            if (f <= 0)
+                mid = lo;
+            else if (f < 1)
+                mid = lo + std::size_t(f * double(hi - 1 - lo));
+            else
+                mid = hi - 1;
+        }
+        if (times[mid] < t)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/* **** PBlockIndex **** */
+
+PBlockIndex::PBlockIndex()
+    : m_count(0)
+{
+}
+
+void PBlockIndex::clear()
+{
+    m_blocks.clear();
+    m_count = 0;
+}
+
+bool PBlockIndex::startsBlock() const
+{
+    return m_count % BLOCK_ENTRIES == 0;
+}
+
+void PBlockIndex::addEntry(double time, uint64_t offset)
+{
+    if (startsBlock()) {
+        Block b;
+        b.offset = offset;
+        b.first = m_count;
+        b.tmin = b.tmax = time;
+        m_blocks.push_back(b);
+    }
+    else {
+        Block& b = m_blocks.back();
+        if (time < b.tmin)
+            b.tmin = time;
+        if (time > b.tmax)
+            b.tmax = time;
+    }
+    m_count++;
+}
+
+void PBlockIndex::addBlock(const Block& block)
+{
+    m_blocks.push_back(block);
+}
+
+std::size_t PBlockIndex::size() const
+{
+    return m_blocks.size();
+}
+
+const PBlockIndex::Block& PBlockIndex::operator[](std::size_t n) const
+{
+    assert(n < m_blocks.size());
+    return m_blocks[n];
+}
+
+bool PBlockIndex::overlaps(std::size_t n, double t0, double t1) const
+{
+    assert(n < m_blocks.size());
+    return m_blocks[n].tmax >= t0 && m_blocks[n].tmin < t1;
+}
+
+bool PBlockIndex::operator==(const PBlockIndex& rhs) const
+{
+    if (m_blocks.size() != rhs.m_blocks.size())
+        return false;
+    for (std::size_t i = 0; i < m_blocks.size(); i++) {
+        const Block& a = m_blocks[i];
+        const Block& b = rhs.m_blocks[i];
+        if (a.offset != b.offset || a.first != b.first ||
+            a.tmin != b.tmin || a.tmax != b.tmax)
+            return false;
+    }
+    return true;
+}
+
+bool PBlockIndex::operator!=(const PBlockIndex& rhs) const
+{
+    return !(*this == rhs);
+}
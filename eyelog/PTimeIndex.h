@@ -0,0 +1,223 @@
+/*
+ * PTimeIndex.h
+ *
+ * Public header that provides indices on the time of the entries in a log.
+ *
+ * Copyright (c) 2016 M.J.A. Duijndam.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see Licenses at www.gnu.org.
+ */
+
+#ifndef PTIME_INDEX_H
+#define PTIME_INDEX_H
+
+#include <cstddef>
+#include <vector>
+#include <stdint.h>
+#include "TypeDefs.h"
+#include "constants.h"
+#include "PEyeLogEntry.h"
+
+/**
+ * PTimeIndex finds the entries of a log by time.
+ *
+ * For every entrytype the index holds the times of the entries of that
+ * type sorted, together with their positions in the log. A query is a
+ * search in the sorted times, so selecting e.g. the samples around a
+ * message doesn't need a scan of the log. Gaze samples are recorded at
+ * a fixed rate, so their times are close to evenly spaced, the search
+ * starts by interpolation and switches to bisection when that doesn't
+ * converge quickly.
+ *
+ * The index refers to the entries by position, it must be rebuilt when
+ * the log changes.
+ *
+ * Usage:
+ * \code
+ *  PTimeIndex index(log.getEntries());
+ *  PTimeIndex::Positions p = index.find(LGAZE, t - 100, t + 500);
+ *  for (std::size_t pos : p)
+ *      use(log.getEntries()[pos]);
+ * \endcode
+ */
+class EYELOG_EXPORT PTimeIndex {
+
+public:
+
+    /**
+     * The number of entrytypes.
+     */
+    static const unsigned NTYPES = TRIALEND + 1;
+
+    /**
+     * The positions in the log of the entries that match a query,
+     * ordered by time.
+     */
+    class Positions {
+
+    public:
+
+        typedef const std::size_t* const_iterator;
+
+        Positions() : m_begin(nullptr), m_end(nullptr) {}
+        Positions(const_iterator begin, const_iterator end)
+            : m_begin(begin), m_end(end) {}
+
+        const_iterator  begin() const {return m_begin;}
+        const_iterator  end() const {return m_end;}
+        std::size_t     size() const {return std::size_t(m_end - m_begin);}
+        bool            empty() const {return m_begin == m_end;}
+
+        std::size_t operator[](std::size_t n) const {return m_begin[n];}
+
+    private:
+
+        const_iterator m_begin;
+        const_iterator m_end;
+    };
+
+    PTimeIndex();
+
+    /**
+     * Builds the index of entries.
+     */
+    explicit PTimeIndex(const PEntryVec& entries);
+
+    /**
+     * Replaces the index by one of entries.
+     */
+    void build(const PEntryVec& entries);
+
+    /**
+     * Removes everything from the index.
+     */
+    void clear();
+
+    /**
+     * @return the number of entries of type.
+     */
+    std::size_t size(entrytype type) const;
+
+    /**
+     * Finds the entries of type with t0 <= time < t1.
+     */
+    Positions find(entrytype type, double t0, double t1) const;
+
+    /**
+     * Finds the entries of all types with t0 <= time < t1.
+     *
+     * @return the positions in the order of the log.
+     */
+    std::vector<std::size_t> findAll(double t0, double t1) const;
+
+    /**
+     * Appends the entries of type with t0 <= time < t1 to out.
+     *
+     * @param entries   the entries of which the index was built.
+     */
+    void select(const PEntryVec& entries,
+                entrytype type,
+                double t0,
+                double t1,
+                PEntryVec* out
+                ) const;
+
+private:
+
+    struct Column {
+        std::vector<double>         times;
+        std::vector<std::size_t>    positions;
+    };
+
+    static std::size_t lowerBound(const std::vector<double>& times, double t);
+
+    Column m_columns[NTYPES];
+};
+
+/**
+ * PBlockIndex is the sparse time index of a binary logfile.
+ *
+ * The records of the file are divided into blocks of BLOCK_ENTRIES
+ * records. For every block the index holds the offset of its first
+ * record and the lowest and highest time in it, so a reader can skip
+ * the blocks that are outside of a time range. The binary files written
+ * by libeye store the block index at their end, see PMappedLog::nextInRange.
+ */
+class EYELOG_EXPORT PBlockIndex {
+
+public:
+
+    /**
+     * The number of records in a block.
+     */
+    static const std::size_t BLOCK_ENTRIES = 4096;
+
+    struct Block {
+        uint64_t    offset; //!< of the first record in the file.
+        uint64_t    first;  //!< the number of the first record.
+        double      tmin;   //!< the lowest time in the block.
+        double      tmax;   //!< the highest time in the block.
+    };
+
+    PBlockIndex();
+
+    /**
+     * Removes all blocks.
+     */
+    void clear();
+
+    /**
+     * Checks whether the next record starts a new block, only then
+     * addEntry needs its offset.
+     */
+    bool startsBlock() const;
+
+    /**
+     * Adds the next record of the file.
+     *
+     * @param time      the time of the record.
+     * @param offset    the offset of the record in the file.
+     */
+    void addEntry(double time, uint64_t offset);
+
+    /**
+     * Appends a block that was recorded elsewhere.
+     */
+    void addBlock(const Block& block);
+
+    /**
+     * @return the number of blocks.
+     */
+    std::size_t size() const;
+
+    /**
+     * @return block n, n < size().
+     */
+    const Block& operator[](std::size_t n) const;
+
+    /**
+     * @return true if block n contains times in [t0, t1).
+     */
+    bool overlaps(std::size_t n, double t0, double t1) const;
+
+    bool operator==(const PBlockIndex& rhs) const;
+    bool operator!=(const PBlockIndex& rhs) const;
+
+private:
+
+    std::vector<Block>  m_blocks;
+    uint64_t            m_count;    // records added with addEntry.
+};
+
+#endif
@@ -0,0 +1,59 @@
+/*
+ * PTrialAnalysis.cpp
+ *
+ * This file is part of libeye and splits the trials of an experiment in
+ * chunks of about the same cost.
+ *
+ * Copyright (C) 2016  Maarten Duijndam
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "PTrialAnalysis.h"
+
+std::vector<std::size_t>
+chunkByCost(const std::vector<std::size_t>& costs, unsigned nchunks)
+{
+    const std::size_t n = costs.size();
+    std::vector<std::size_t> bounds(1, 0);
+    if (n == 0)
+        return bounds;
+    if (nchunks == 0)
+        nchunks = 1;
+
+    // Items without a cost count as one, so they still spread evenly.
+    double total = 0;
+    for (std::size_t c : costs)
+        total += c ? c : 1;
+
+    // Chunk k ends where the running cost passes k / nchunks of the total,
+    // measuring from the start keeps rounding errors from adding up.
+    const double target = total / nchunks;
+    double sum = 0;
+    unsigned k = 1;
+    for (std::size_t i = 0; i < n; i++) {
+        const double c = costs[i] ? costs[i] : 1;
+        // An expensive item starts a chunk of its own.
+        if (c >= target && bounds.back() < i && bounds.size() < nchunks)
+            bounds.push_back(i);
+        sum += c;
+        if (i + 1 < n && bounds.size() < nchunks && sum * nchunks >= total * k)
+            bounds.push_back(i + 1);
+        while (k < nchunks && sum * nchunks >= total * k)
+            k++;
+    }
+    bounds.push_back(n);
+    return bounds;
+}
@@ -0,0 +1,107 @@
+/*
+ * PTrialAnalysis.h
+ *
+ * Public header that runs an analysis of every trial of an experiment
+ * on a pool of threads.
+ *
+ * Copyright (c) 2016 M.J.A. Duijndam.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see Licenses at www.gnu.org.
+ */
+
+#ifndef PTRIAL_ANALYSIS_H
+#define PTRIAL_ANALYSIS_H
+
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+#include "eyelog_export.h"
+#include "PExperiment.h"
+#include "PThreadPool.h"
+
+/**
+ * The number of chunks per thread analyzeTrials makes, more chunks than
+ * threads leave room to balance estimates of the cost that are off.
+ */
+const unsigned TRIAL_CHUNKS_PER_THREAD = 4;
+
+/**
+ * Splits items with the given costs into at most nchunks chunks of
+ * consecutive items of about the same total cost. An item that costs more
+ * than a chunk should gets a chunk of its own.
+ *
+ * @return the bounds of the chunks, chunk i holds the items in
+ *         [bounds[i], bounds[i + 1]).
+ */
+EYELOG_EXPORT std::vector<std::size_t>
+chunkByCost(const std::vector<std::size_t>& costs, unsigned nchunks);
+
+/**
+ * The estimated cost of analyzing a trial: the number of its entries.
+ */
+struct PTrialCost {
+    std::size_t operator()(const PTrial& trial) const
+    {
+        return trial.size() + 1;
+    }
+};
+
+/**
+ * Calls kernel(trial) for every trial of experiment on the threads of pool
+ * and returns the results in the order of the trials.
+ *
+ * The trials are split in chunks of consecutive trials of about the same
+ * cost, so a few long trials don't leave the other threads waiting. The
+ * kernel gets a const PTrial&, it may use operator[] to get the entries
+ * of one type, but must not change the trial.
+ *
+ * @param cost      estimates the cost of a trial, by default the number
+ *                  of entries of the trial.
+ *
+ * The result of kernel must be default constructible, and other than bool
+ * because the elements of a std::vector<bool> can't be written at once.
+ */
+template <class Kernel, class Cost=PTrialCost>
+std::vector<typename std::result_of<Kernel(const PTrial&)>::type>
+analyzeTrials(PThreadPool& pool,
+              const PExperiment& experiment,
+              Kernel kernel,
+              Cost cost=Cost()
+              )
+{
+    typedef typename std::result_of<Kernel(const PTrial&)>::type Result;
+    static_assert(!std::is_same<Result, bool>::value,
+                  "analyzeTrials can't return std::vector<bool>"
+                  );
+
+    const std::size_t ntrials = experiment.nTrials();
+    std::vector<Result> results(ntrials);
+
+    std::vector<std::size_t> costs(ntrials);
+    for (std::size_t i = 0; i < ntrials; i++)
+        costs[i] = cost(experiment[i]);
+    const std::vector<std::size_t> bounds =
+        chunkByCost(costs, pool.size() * TRIAL_CHUNKS_PER_THREAD);
+
+    pool.forEach(bounds.size() - 1,
+                 [&] (std::size_t begin, std::size_t end) {
+                     for (std::size_t c = begin; c < end; c++)
+                         for (std::size_t i = bounds[c]; i < bounds[c + 1]; i++)
+                             results[i] = kernel(experiment[i]);
+                 }
+                 );
+    return results;
+}
+
+#endif
@@ -0,0 +1,184 @@
+/*
+ * PTrialIndex.cpp
+ *
+ * This file is part of libeye and records where the trials in a log are.
+ *
+ * Copyright (C) 2016  Maarten Duijndam
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cassert>
+#include <cstring>
+#include "PTrialIndex.h"
+#include "PTextScanner.h"
+
+using namespace std;
+
+const std::size_t PTrialIndex::npos;
+
+static const char TRIALBEG_MARKER[] = "trialbeg";
+static const char TRIALEND_MARKER[] = "trialend";
+
+/*
+ * Tests whether msg is word followed by whitespace or nothing, if so rest
+ * points at the remainder.
+ */
+static bool isMarker(const char* msg, const char* word, const char** rest)
+{
+    std::size_t n = strlen(word);
+    if (strncmp(msg, word, n) != 0)
+        return false;
+    if (msg[n] != '\0' && !PTextScanner::isSpace(msg[n]))
+        return false;
+    *rest = msg + n;
+    return true;
+}
+
+PTrialIndex::PTrialIndex()
+{
+}
+
+void PTrialIndex::clear()
+{
+    m_trials.clear();
+    m_identifiers.clear();
+    m_groups.clear();
+}
+
+void PTrialIndex::addEntry(const PEyeLogEntry& entry, std::size_t pos)
+{
+    switch (entry.getEntryType()) {
+        case TRIAL:
+            {
+                const PTrialEntry& t = static_cast<const PTrialEntry&>(entry);
+                beginTrial(t.getIdentifier(), t.getGroup(), t.getTime(), pos);
+            }
+            break;
+        case TRIALSTART:
+            if (!m_trials.empty()) {
+                Trial& t = m_trials.back();
+                if (t.end == npos && t.start == npos)
+                    t.start = pos;
+            }
+            break;
+        case TRIALEND:
+            endTrial(pos + 1);
+            break;
+        case MESSAGE:
+            {
+                String msg = static_cast<const PMessageEntry&>(entry).getMessage();
+                const char* rest;
+                if (isMarker(msg.c_str(), TRIALBEG_MARKER, &rest)) {
+                    // e.g. "trialbeg 004 1 004 CNDB"
+                    PTextScanner words(rest, rest + strlen(rest));
+                    const char *b, *e;
+                    String identifier, group;
+                    if (words.readToken(b, e))
+                        identifier = String(b, e);
+                    while (words.readToken(b, e))
+                        group = String(b, e);
+                    beginTrial(identifier, group, entry.getTime(), pos);
+                }
+                else if (isMarker(msg.c_str(), TRIALEND_MARKER, &rest)) {
+                    endTrial(pos + 1);
+                }
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void PTrialIndex::addTrial(const Trial& trial)
+{
+    std::size_t n = m_trials.size();
+    m_trials.push_back(trial);
+    m_identifiers[trial.identifier.c_str()].push_back(n);
+    m_groups[trial.group.c_str()].push_back(n);
+}
+
+std::size_t PTrialIndex::size() const
+{
+    return m_trials.size();
+}
+
+const PTrialIndex::Trial& PTrialIndex::operator[](std::size_t n) const
+{
+    assert(n < m_trials.size());
+    return m_trials[n];
+}
+
+const PTrialIndex::Trial* PTrialIndex::find(const String& identifier) const
+{
+    auto it = m_identifiers.find(identifier.c_str());
+    if (it == m_identifiers.end())
+        return nullptr;
+    return &m_trials[it->second.front()];
+}
+
+std::vector<std::size_t> PTrialIndex::findGroup(const String& group) const
+{
+    auto it = m_groups.find(group.c_str());
+    if (it == m_groups.end())
+        return std::vector<std::size_t>();
+    return it->second;
+}
+
+bool PTrialIndex::operator==(const PTrialIndex& rhs) const
+{
+    if (m_trials.size() != rhs.m_trials.size())
+        return false;
+    for (std::size_t i = 0; i < m_trials.size(); i++) {
+        const Trial& a = m_trials[i];
+        const Trial& b = rhs.m_trials[i];
+        if (a.identifier != b.identifier || a.group != b.group ||
+            a.time != b.time || a.begin != b.begin ||
+            a.start != b.start || a.end != b.end)
+            return false;
+    }
+    return true;
+}
+
+bool PTrialIndex::operator!=(const PTrialIndex& rhs) const
+{
+    return !(*this == rhs);
+}
+
+/*
+ * Ends the current trial, if any, and starts a new one at pos.
+ */
+void PTrialIndex::beginTrial(const String& identifier,
+                             const String& group,
+                             double time,
+                             std::size_t pos
+                             )
+{
+    endTrial(pos);
+    Trial t;
+    t.identifier = identifier;
+    t.group = group;
+    t.time = time;
+    t.begin = pos;
+    t.start = npos;
+    t.end = npos;
+    addTrial(t);
+}
+
+void PTrialIndex::endTrial(std::size_t end)
+{
+    if (!m_trials.empty() && m_trials.back().end == npos)
+        m_trials.back().end = end;
+}
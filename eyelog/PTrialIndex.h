@@ -0,0 +1,153 @@
+/*
+ * PTrialIndex.h
+ *
+ * Public header that provides an index of the trials in a log.
+ *
+ * Copyright (c) 2016 M.J.A. Duijndam.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see Licenses at www.gnu.org.
+ */
+
+#ifndef PTRIAL_INDEX_H
+#define PTRIAL_INDEX_H
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "TypeDefs.h"
+#include "PEyeLogEntry.h"
+
+/**
+ * A random access range of entries, the entries are not owned by the
+ * range.
+ */
+class PEntryRange {
+
+public:
+
+    typedef PEyeLogEntry* const*    const_iterator;
+    typedef const_iterator          iterator;
+    typedef std::size_t             size_type;
+
+    PEntryRange() : m_begin(nullptr), m_end(nullptr) {}
+    PEntryRange(const_iterator begin, const_iterator end)
+        : m_begin(begin), m_end(end) {}
+
+    const_iterator  begin() const {return m_begin;}
+    const_iterator  end() const {return m_end;}
+    size_type       size() const {return size_type(m_end - m_begin);}
+    bool            empty() const {return m_begin == m_end;}
+
+    PEyeLogEntry* operator[](size_type n) const {return m_begin[n];}
+
+private:
+
+    const_iterator m_begin;
+    const_iterator m_end;
+};
+
+/**
+ * PTrialIndex records where the trials of a log are.
+ *
+ * The index is fed with the entries of a log in order of the log, every
+ * entry with its position in the log. A trial starts at a TRIAL entry
+ * or at a MESSAGE that starts with "trialbeg", as EyeLink .asc files
+ * written by Zep contain. For such a message the first word after
+ * "trialbeg" is the identifier and the last word the group. A trial ends
+ * with a TRIALEND entry or a "trialend" message, otherwise at the next
+ * trial.
+ *
+ * A PEyeLog maintains an index of its entries, the binary files written
+ * by libeye store it at their end, see readTrialIndex.
+ */
+class EYELOG_EXPORT PTrialIndex {
+
+public:
+
+    /**
+     * A position that is not known (yet).
+     */
+    static const std::size_t npos = std::size_t(-1);
+
+    struct Trial {
+        String      identifier;
+        String      group;
+        double      time;   //!< time of the entry that starts the trial.
+        std::size_t begin;  //!< position of the entry that starts the trial.
+        std::size_t start;  //!< position of the TRIALSTART or npos.
+        std::size_t end;    //!< one past the end, npos for an open trial.
+    };
+
+    PTrialIndex();
+
+    /**
+     * Removes all trials.
+     */
+    void clear();
+
+    /**
+     * Examines the entry at position pos of the log.
+     */
+    void addEntry(const PEyeLogEntry& entry, std::size_t pos);
+
+    /**
+     * Appends a trial that was recorded elsewhere.
+     */
+    void addTrial(const Trial& trial);
+
+    /**
+     * @return the number of trials.
+     */
+    std::size_t size() const;
+
+    /**
+     * @return trial n, n < size().
+     */
+    const Trial& operator[](std::size_t n) const;
+
+    /**
+     * Finds a trial by identifier.
+     *
+     * @return the first trial with identifier or nullptr.
+     */
+    const Trial* find(const String& identifier) const;
+
+    /**
+     * Finds the trials of a group.
+     *
+     * @return the numbers of the trials in group, in the order of the log.
+     */
+    std::vector<std::size_t> findGroup(const String& group) const;
+
+    bool operator==(const PTrialIndex& rhs) const;
+    bool operator!=(const PTrialIndex& rhs) const;
+
+private:
+
+    void beginTrial(const String& identifier,
+                    const String& group,
+                    double time,
+                    std::size_t pos
+                    );
+    void endTrial(std::size_t end);
+
+    typedef std::unordered_map<std::string, std::vector<std::size_t> > Lookup;
+
+    std::vector<Trial>  m_trials;
+    Lookup              m_identifiers;
+    Lookup              m_groups;
+};
+
+#endif
@@ -55,10 +55,77 @@ enum entrytype {
 
 /**
  * eyelog_format
+ *
+ * FORMAT_ASC and FORMAT_UNKNOWN are only reported by detectLogFormat,
+ * logs can't be written in those formats. FORMAT_BINARY_V2 comes last, so
+ * that the values of the others remain the same.
  */
 enum eyelog_format {
-    FORMAT_BINARY,  //!< Used when writing a binary version of the log
-    FORMAT_CSV      //!< Used when writing a CSV version of the log
+    FORMAT_BINARY,      //!< Used when writing a binary version of the log
+    FORMAT_CSV,         //!< Used when writing a CSV version of the log
+    FORMAT_ASC,         //!< An EyeLink .asc file
+    FORMAT_UNKNOWN,     //!< The format could not be determined
+    FORMAT_BINARY_V2    //!< Binary blocks of compressed entries
+};
+
+/**
+ * eyelog_write_flags
+ *
+ * Flags that select how PEyeLog::write writes a binary log.
+ */
+enum eyelog_write_flags {
+    WRITE_STREAM    = 0,    //!< Every field is written to the ofstream.
+    WRITE_BUFFERED  = 1,    //!< Records are serialized in a large buffer
+                            //!< that is written in big blocks.
+    WRITE_DIRECT    = 2     //!< Implies WRITE_BUFFERED, the blocks bypass
+                            //!< the page cache (O_DIRECT) where supported.
+};
+
+/**
+ * block_codec
+ *
+ * The codecs that compress the blocks of a FORMAT_BINARY_V2 log. Only
+ * CODEC_NONE is always available, the others depend on the libraries
+ * that were found when libeye was built, see blockCodecSupported.
+ */
+enum block_codec {
+    CODEC_NONE  = 0,    //!< The blocks are only delta encoded.
+    CODEC_ZLIB  = 1,    //!< The blocks are compressed with zlib.
+    CODEC_LZ4   = 2,    //!< The blocks are compressed with LZ4.
+    CODEC_ZSTD  = 3     //!< The blocks are compressed with zstd.
+};
+
+/**
+ * asc_read_flags
+ *
+ * Flags that select how readAscBuffer and readAscLog read the samples.
+ */
+enum asc_read_flags {
+    ASC_DEFAULT         = 0,    //!< LGAZE and RGAZE samples as in the file.
+    ASC_AVERAGE_EYES    = 1     //!< Only AVGGAZE samples, a binocular line
+                                //!< is averaged while it is parsed.
+};
+
+/**
+ * detection_algorithm
+ *
+ * Selects how a PEventDetector finds fixations and saccades.
+ */
+enum detection_algorithm {
+    DETECT_IVT,     //!< Velocity threshold: fast samples are saccades.
+    DETECT_IDT      //!< Dispersion threshold: samples close together
+                    //!< for long enough are fixations.
+};
+
+/**
+ * gaze_kernel_isa
+ *
+ * The instruction set used by the kernels in PGazeKernels.h.
+ */
+enum gaze_kernel_isa {
+    KERNEL_SCALAR,  //!< Plain C++, available everywhere.
+    KERNEL_SSE2,    //!< 4 floats at a time on x86.
+    KERNEL_AVX2     //!< 8 floats at a time on x86.
 };
 
 #endif
@@ -0,0 +1,104 @@
+#include <cxxtest/TestSuite.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "../eyelog/EyeLog.h"
+
+
+class AscReaderSuite: public CxxTest::TestSuite
+{
+public:
+
+    /*
+     * Returns the eye that a monocular sample gets after "SAMPLES GAZE side".
+     */
+    entrytype eyeOf(const std::string& side)
+    {
+        std::string asc = "SAMPLES\tGAZE\t" + side + "\n1\t2.0\t3.0\t4.0\n";
+        PEyeLog log;
+        TS_ASSERT_EQUALS(
+                readAscBuffer(&log, asc.data(), asc.data() + asc.size()), 0
+                );
+        TS_ASSERT_EQUALS(log.getEntries().size(), 1);
+        return log.getEntries()[0]->getEntryType();
+    }
+
+    void testLines()
+    {
+        TS_TRACE("Testing parsing of asc lines");
+        std::string asc =
+            "** CONVERTED FROM test.edf\n"
+            "MSG\t10\t  trialbeg 1 \t\n"
+            "20\t1.5\t2.5\t3.5\t4.5\t5.5\t6.5\t.....\n"
+            "EFIX\tL\t20\t40\t20\t1.0\t2.0\t0\n"
+            "\n"
+            "30\t.\t.\t0.0\t4.5\t5.5\t6.5\t.....\n";
+        PEyeLog log;
+        TS_ASSERT_EQUALS(
+                readAscBuffer(&log, asc.data(), asc.data() + asc.size()), 0
+                );
+        const PEntryVec& e = log.getEntries();
+        TS_ASSERT_EQUALS(e.size(), 4);
+        if (e.size() != 4)
+            return;
+        TS_ASSERT_EQUALS(*e[0], PMessageEntry(10, "trialbeg 1"));
+        TS_ASSERT_EQUALS(*e[1], PGazeEntry(LGAZE, 20, 1.5, 2.5, 3.5));
+        TS_ASSERT_EQUALS(*e[2], PGazeEntry(RGAZE, 20, 4.5, 5.5, 6.5));
+        TS_ASSERT_EQUALS(*e[3], PFixationEntry(LFIX, 20, 20, 1.0, 2.0));
+    }
+
+    void testNothingUnderstood()
+    {
+        std::string asc = "this is\nnot an asc file\n";
+        PEyeLog log;
+        TS_ASSERT_EQUALS(
+                readAscBuffer(&log, asc.data(), asc.data() + asc.size()),
+                ERR_INVALID_FILE_FORMAT
+                );
+    }
+
+    void testChunkBoundaries()
+    {
+        TS_TRACE("Testing SAMPLES settings across chunk boundaries");
+        const entrytype left = eyeOf("LEFT");
+        const entrytype right = eyeOf("RIGHT");
+        TS_ASSERT_DIFFERS(left, right);
+
+        // Build a few MB of monocular samples, so the buffer is cut in
+        // several chunks, switching eyes every now and then.
+        std::string asc;
+        std::vector<entrytype> expected;
+        char line[128];
+        unsigned t = 0;
+        for (unsigned block = 0; block < 40; block++) {
+            bool isleftblock = block % 3 != 1;
+            asc += isleftblock ? "SAMPLES\tGAZE\tLEFT\n" : "SAMPLES\tGAZE\tRIGHT\n";
+            for (unsigned i = 0; i < 3000; i++, t++) {
+                snprintf(line, sizeof(line),
+                         "%u\t100.25\t200.5\t3.125\t...\t0\t0\t0\t......\n", t);
+                asc += line;
+                expected.push_back(isleftblock ? left : right);
+            }
+        }
+
+        for (unsigned nthreads = 1; nthreads <= 4; nthreads *= 2) {
+            PEyeLog log;
+            TS_ASSERT_EQUALS(
+                    readAscBuffer(&log,
+                                  asc.data(),
+                                  asc.data() + asc.size(),
+                                  nthreads
+                                  ),
+                    0
+                    );
+            const PEntryVec& e = log.getEntries();
+            TS_ASSERT_EQUALS(e.size(), expected.size());
+            unsigned nwrong = 0;
+            for (unsigned i = 0; i < e.size() && i < expected.size(); i++) {
+                if (e[i]->getEntryType() != expected[i] || e[i]->getTime() != i)
+                    nwrong++;
+            }
+            TS_ASSERT_EQUALS(nwrong, 0);
+        }
+    }
+};
@@ -0,0 +1,77 @@
+#include <cxxtest/TestSuite.h>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include "../eyelog/EyeLog.h"
+
+
+class BinaryWriterSuite: public CxxTest::TestSuite
+{
+    const char* fname1 = "binary_writer_test1.bin";
+    const char* fname2 = "binary_writer_test2.bin";
+
+public:
+
+    std::string contents(const char* fname)
+    {
+        std::ifstream in(fname, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in),
+                           std::istreambuf_iterator<char>()
+                           );
+    }
+
+    void fillLog(PEyeLog& log)
+    {
+        log.addEntry(new PMessageEntry(0, "Hi"));
+        log.addEntry(new PTrialEntry(0, "1", "group"));
+        log.addEntry(new PTrialStartEntry(0));
+        for (unsigned i = 0; i < 100000; i++) {
+            log.addEntry(new PGazeEntry(LGAZE, i, i, 11, 3));
+            log.addEntry(new PGazeEntry(RGAZE, i, i, 13, 4));
+        }
+        // larger than the buffer of the writer.
+        log.addEntry(new PMessageEntry(1e5,
+                    String(std::string(3 << 20, 'x').c_str())
+                    ));
+        log.addEntry(new PFixationEntry(LFIX, 1e5, 100, 10, 11));
+        log.addEntry(new PSaccadeEntry(RSAC, 1e5, 10, 1, 2, 3, 4));
+        log.addEntry(new PTrialEndEntry(1e5));
+    }
+
+    void writeLog(const char* fname, unsigned flags, int ntimes = 1)
+    {
+        PEyeLog log;
+        fillLog(log);
+        TS_ASSERT_EQUALS(log.open(fname), 0);
+        for (int i = 0; i < ntimes; i++)
+            TS_ASSERT_EQUALS(log.write(FORMAT_BINARY, flags), 0);
+    }
+
+    void testIdentical()
+    {
+        TS_TRACE("Testing that all write modes produce the same file");
+        writeLog(fname1, WRITE_STREAM);
+        writeLog(fname2, WRITE_BUFFERED);
+        TS_ASSERT(contents(fname1) == contents(fname2));
+        writeLog(fname2, WRITE_DIRECT);
+        TS_ASSERT(contents(fname1) == contents(fname2));
+
+        PEyeLog expected, log;
+        fillLog(expected);
+        TS_ASSERT_EQUALS(readLog(&log, fname2), 0);
+        TS_ASSERT_EQUALS(log.getEntries().size(), expected.getEntries().size());
+        remove(fname1);
+        remove(fname2);
+    }
+
+    void testAppend()
+    {
+        TS_TRACE("Testing that a second write appends without header");
+        writeLog(fname1, WRITE_STREAM, 2);
+        writeLog(fname2, WRITE_DIRECT, 2);
+        TS_ASSERT(contents(fname1) == contents(fname2));
+        remove(fname1);
+        remove(fname2);
+    }
+};
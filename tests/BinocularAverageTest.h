@@ -0,0 +1,148 @@
+#include <cxxtest/TestSuite.h>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include "../eyelog/EyeLog.h"
+#include "TestLogs.h"
+
+
+class BinocularAverageSuite: public CxxTest::TestSuite
+{
+    const char* fname = "binocular_average_test";
+
+    /*
+     * Binocular samples, a message at the time of a sample, a sample of
+     * which the right eye is missing and a monocular sample.
+     */
+    void fillLog(PEyeLog& log)
+    {
+        log.addEntry(new PGazeEntry(LGAZE, 0, 100, 200, 1000));
+        log.addEntry(new PGazeEntry(RGAZE, 0, 110, 220, 1100));
+        log.addEntry(new PMessageEntry(0, "start"));
+        log.addEntry(new PGazeEntry(LGAZE, 2, 102, 202, 1002));
+        log.addEntry(new PGazeEntry(RGAZE, 2, NAN, NAN, 0));
+        log.addEntry(new PFixationEntry(LFIX, 2, 50, 101, 201));
+        log.addEntry(new PGazeEntry(RGAZE, 4, 114, 224, 1104));
+        log.addEntry(new PGazeEntry(LGAZE, 6, 106, 206, 1006));
+        log.addEntry(new PGazeEntry(RGAZE, 6, 116, 226, 1106));
+        log.addEntry(new PMessageEntry(8, "end"));
+    }
+
+    void fillExpected(PEyeLog& log)
+    {
+        log.addEntry(new PMessageEntry(0, "start"));
+        log.addEntry(new PGazeEntry(AVGGAZE, 0, 105, 210, 1050));
+        log.addEntry(new PFixationEntry(LFIX, 2, 50, 101, 201));
+        log.addEntry(new PGazeEntry(AVGGAZE, 2, 102, 202, 1002));
+        log.addEntry(new PGazeEntry(AVGGAZE, 4, 114, 224, 1104));
+        log.addEntry(new PGazeEntry(AVGGAZE, 6, 111, 216, 1056));
+        log.addEntry(new PMessageEntry(8, "end"));
+    }
+
+public:
+
+    void testAverager()
+    {
+        TS_TRACE("Testing averaging the eyes of a stream of entries");
+        PEyeLog log, out, expected;
+        fillLog(log);
+        fillExpected(expected);
+        {
+            PBinocularAverager averager(&out, false);
+            for (const auto* e : log.getEntries())
+                averager.addEntry(e->clone());
+        }
+        TS_ASSERT(equalEntries(out.getEntries(), expected.getEntries()));
+
+        // With the eyes the output is still sorted.
+        PEyeLog both;
+        PBinocularAverager averager(&both);
+        for (const auto* e : log.getEntries())
+            averager.addEntry(e->clone());
+        averager.flush();
+        const PEntryVec& entries = both.getEntries();
+        TS_ASSERT_EQUALS(entries.size(), log.getEntries().size() + 4);
+        for (std::size_t i = 1; i < entries.size(); i++)
+            TS_ASSERT(entries[i - 1]->compare(*entries[i]) <= 0);
+    }
+
+    void testSampleStore()
+    {
+        TS_TRACE("Testing PSampleStore::average");
+        PEyeLog log, expected;
+        fillLog(log);
+        fillExpected(expected);
+        PSampleStore store(log);
+        store.average();
+        store.average(); // replaces the previous average.
+        const PGazeColumns& avg = store[AVGGAZE];
+        TS_ASSERT_EQUALS(avg.size(), 4);
+        if (avg.size() != 4)
+            return;
+        TS_ASSERT_EQUALS(avg.getTime()[2], 4);
+        TS_ASSERT_EQUALS(avg.getX()[3], 111);
+        TS_ASSERT_EQUALS(avg.getPupil()[1], 1002);
+
+        PEyeLog samples;
+        store.toLog(samples);
+        const PEntryVec& entries = samples.getEntries();
+        TS_ASSERT_EQUALS(entries.size(), store.size());
+        for (std::size_t i = 1; i < entries.size(); i++)
+            TS_ASSERT(entries[i - 1]->compare(*entries[i]) < 0);
+        TS_ASSERT_EQUALS(entries[2]->getEntryType(), AVGGAZE);
+    }
+
+    void testFormats()
+    {
+        TS_TRACE("Testing reading and writing AVGGAZE entries");
+        PEyeLog expected;
+        fillExpected(expected);
+        const eyelog_format formats[] = {FORMAT_BINARY, FORMAT_CSV};
+        for (eyelog_format f : formats) {
+            {
+                PEyeLog log;
+                fillExpected(log);
+                TS_ASSERT_EQUALS(log.open(fname), 0);
+                TS_ASSERT_EQUALS(log.write(f), 0);
+            }
+            PEyeLog log;
+            TS_ASSERT_EQUALS(log.read(fname), 0);
+            TS_ASSERT(equalEntries(log.getEntries(), expected.getEntries()));
+
+            PSampleStore store;
+            TS_ASSERT_EQUALS(readLog(&store, fname), 0);
+            TS_ASSERT_EQUALS(store[AVGGAZE].size(), 4);
+            remove(fname);
+        }
+    }
+
+    void testAscAverage()
+    {
+        TS_TRACE("Testing averaging the eyes while parsing asc");
+        std::string asc =
+            "MSG\t10\tstart\n"
+            "20\t1.5\t2.5\t3.5\t4.5\t5.5\t6.5\t.....\n"
+            "30\t.\t.\t0.0\t4.5\t5.5\t6.5\t.....\n"
+            "SAMPLES\tGAZE\tLEFT\n"
+            "40\t1.0\t2.0\t3.0\t...\n";
+        PEyeLog log;
+        bool isleft = false;
+        TS_ASSERT_EQUALS(readAscBuffer(&log,
+                                       asc.data(),
+                                       asc.data() + asc.size(),
+                                       1,
+                                       &isleft,
+                                       ASC_AVERAGE_EYES
+                                       ),
+                         0
+                         );
+        const PEntryVec& e = log.getEntries();
+        TS_ASSERT_EQUALS(e.size(), 4);
+        if (e.size() != 4)
+            return;
+        TS_ASSERT_EQUALS(*e[0], PMessageEntry(10, "start"));
+        TS_ASSERT_EQUALS(*e[1], PGazeEntry(AVGGAZE, 20, 3.0, 4.0, 5.0));
+        TS_ASSERT_EQUALS(*e[2], PGazeEntry(AVGGAZE, 30, 4.5, 5.5, 6.5));
+        TS_ASSERT_EQUALS(*e[3], PGazeEntry(AVGGAZE, 40, 1.0, 2.0, 3.0));
+    }
+};
@@ -0,0 +1,373 @@
+#include <cxxtest/TestSuite.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include "../eyelog/EyeLog.h"
+#include "TestLogs.h"
+
+
+class CompressedLogSuite: public CxxTest::TestSuite
+{
+    const char* fname = "compressed_log_test.bin";
+
+    /*
+     * More entries than fit in one block, with times that are not whole
+     * milliseconds and some that are not whole ticks either.
+     */
+    void fillLog(PEyeLog& log)
+    {
+        log.addEntry(new PMessageEntry(0, "meta data"));
+        for (unsigned i = 0; i < 10000; i++) {
+            double t = 1000 + i * 0.5;
+            if (i % 1000 == 0) {
+                log.addEntry(new PTrialEntry(t, "trial", "group"));
+                log.addEntry(new PTrialStartEntry(t));
+            }
+            if (i > 7000)
+                t += 1e-7;
+            float x = float(512 + 100 * std::sin(i / 100.0));
+            log.addEntry(new PGazeEntry(LGAZE, t, x, 384.25f, 3.1f));
+            log.addEntry(new PGazeEntry(RGAZE, t, -x, 384.5f, 2.9f));
+            log.addEntry(new PGazeEntry(AVGGAZE, t, 0, 384.375f, 3));
+            if (i % 100 == 0) {
+                log.addEntry(new PFixationEntry(LFIX, t, 100.5, 10, 11));
+                log.addEntry(new PSaccadeEntry(RSAC, t, 10, 1, 2, 3, 4));
+                log.addEntry(new PMessageEntry(t, ""));
+            }
+            if (i % 1000 == 999)
+                log.addEntry(new PTrialEndEntry(t));
+        }
+    }
+
+    long fileSize(const char* name)
+    {
+        std::ifstream in(name, std::ios::binary | std::ios::ate);
+        return long(in.tellg());
+    }
+
+public:
+
+    void testWriteLog()
+    {
+        TS_TRACE("Testing writing and reading FORMAT_BINARY_V2");
+        PEyeLog log;
+        fillLog(log);
+        TS_ASSERT_EQUALS(log.open(fname), 0);
+        TS_ASSERT_EQUALS(log.write(FORMAT_BINARY), 0);
+        log.close();
+        long v1size = fileSize(fname);
+
+        TS_ASSERT_EQUALS(log.open(fname), 0);
+        TS_ASSERT_EQUALS(log.write(FORMAT_BINARY_V2), 0);
+        log.close();
+        TS_ASSERT_LESS_THAN(fileSize(fname) * 4, v1size);
+
+        eyelog_format format;
+        TS_ASSERT_EQUALS(detectLogFormat(fname, &format), 0);
+        TS_ASSERT_EQUALS(format, FORMAT_BINARY_V2);
+
+        PEyeLog in;
+        TS_ASSERT_EQUALS(readLog(&in, fname, &format), 0);
+        TS_ASSERT_EQUALS(format, FORMAT_BINARY_V2);
+        TS_ASSERT(equalEntries(in.getEntries(), log.getEntries()));
+
+        PSampleStore store;
+        TS_ASSERT_EQUALS(readLog(&store, fname), 0);
+        TS_ASSERT_EQUALS(store[AVGGAZE].size(), 10000);
+
+        PTrialIndex trials;
+        TS_ASSERT_EQUALS(readTrialIndex(&trials, fname), 0);
+        TS_ASSERT_EQUALS(trials.size(), log.getTrialIndex().size());
+        remove(fname);
+    }
+
+    void testCodecs()
+    {
+        TS_TRACE("Testing the block codecs");
+        PEyeLog log;
+        fillLog(log);
+        const block_codec codecs[] = {
+            CODEC_NONE, CODEC_ZLIB, CODEC_LZ4, CODEC_ZSTD
+        };
+        TS_ASSERT(blockCodecSupported(CODEC_NONE));
+        TS_ASSERT(blockCodecSupported(defaultBlockCodec()));
+        for (block_codec codec : codecs) {
+            PCompressedWriter writer;
+            if (!blockCodecSupported(codec)) {
+                TS_ASSERT_EQUALS(writer.setCodec(codec), ERR_INVALID_PARAMETER);
+                continue;
+            }
+            TS_ASSERT_EQUALS(writer.setCodec(codec), 0);
+            TS_ASSERT_EQUALS(writer.open(fname), 0);
+            // Single entries and a vector of entries end up in the
+            // same blocks.
+            const PEntryVec& entries = log.getEntries();
+            for (std::size_t i = 0; i < 100; i++)
+                TS_ASSERT_EQUALS(writer.write(*entries[i]), 0);
+            PEntryVec rest;
+            for (std::size_t i = 100; i < entries.size(); i++)
+                rest.push_back(entries[i]);
+            TS_ASSERT_EQUALS(writer.write(rest), 0);
+            TS_ASSERT_EQUALS(writer.close(), 0);
+            TS_ASSERT(!writer.isOpen());
+
+            PEyeLog in;
+            TS_ASSERT_EQUALS(readCompressedLog(&in, fname), 0);
+            TS_ASSERT(equalEntries(in.getEntries(), log.getEntries()));
+            remove(fname);
+        }
+    }
+
+    void testSpecialValues()
+    {
+        TS_TRACE("Testing values that don't delta encode well");
+        PEyeLog log;
+        log.addEntry(new PGazeEntry(LGAZE, -5, NAN, INFINITY, -0.0f));
+        log.addEntry(new PGazeEntry(LGAZE, 1e12, -1e30f, 1e-30f, 0));
+        log.addEntry(new PGazeEntry(LGAZE, NAN, 1, 2, 3));
+        TS_ASSERT_EQUALS(log.open(fname), 0);
+        TS_ASSERT_EQUALS(log.write(FORMAT_BINARY_V2), 0);
+        log.close();
+
+        PEyeLog in;
+        TS_ASSERT_EQUALS(readLog(&in, fname), 0);
+        const PEntryVec& e = in.getEntries();
+        TS_ASSERT_EQUALS(e.size(), 3);
+        if (e.size() != 3)
+            return;
+        const PGazeEntry* g = static_cast<const PGazeEntry*>(e[0]);
+        TS_ASSERT(std::isnan(g->getX()));
+        TS_ASSERT(std::isinf(g->getY()));
+        TS_ASSERT(std::signbit(g->getPupil()));
+        TS_ASSERT_EQUALS(*e[1], *log.getEntries()[1]);
+        TS_ASSERT(std::isnan(e[2]->getTime()));
+        remove(fname);
+    }
+
+    void testBlockDirectory()
+    {
+        TS_TRACE("Testing the block directory of compressed logs");
+        PEyeLog log;
+        fillLog(log);
+        TS_ASSERT_EQUALS(log.open(fname), 0);
+        TS_ASSERT_EQUALS(log.write(FORMAT_BINARY_V2), 0);
+        log.close();
+
+        const PEntryVec& entries = log.getEntries();
+        PBlockIndex blocks;
+        TS_ASSERT_EQUALS(readCompressedBlocks(&blocks, fname), 0);
+        TS_ASSERT_EQUALS(blocks.size(), (entries.size() + 4095) / 4096);
+        TS_ASSERT_EQUALS(blocks[0].offset, 16u);
+        for (std::size_t i = 0; i < blocks.size(); i++) {
+            std::size_t first = std::size_t(blocks[i].first);
+            std::size_t end = std::min(first + 4096, entries.size());
+            TS_ASSERT_EQUALS(first, i * 4096);
+            double tmin = entries[first]->getTime(), tmax = tmin;
+            for (std::size_t j = first; j < end; j++) {
+                tmin = std::min(tmin, entries[j]->getTime());
+                tmax = std::max(tmax, entries[j]->getTime());
+            }
+            TS_ASSERT_EQUALS(blocks[i].tmin, tmin);
+            TS_ASSERT_EQUALS(blocks[i].tmax, tmax);
+        }
+        remove(fname);
+    }
+
+    void testParallelDecode()
+    {
+        TS_TRACE("Testing decoding blocks with several threads");
+        PEyeLog log;
+        fillLog(log);
+        TS_ASSERT_EQUALS(log.open(fname), 0);
+        TS_ASSERT_EQUALS(log.write(FORMAT_BINARY_V2), 0);
+        log.close();
+
+        for (unsigned nthreads = 0; nthreads < 5; nthreads++) {
+            PEyeLog in;
+            TS_ASSERT_EQUALS(readCompressedLog(&in, fname, nthreads), 0);
+            TS_ASSERT(equalEntries(in.getEntries(), log.getEntries()));
+
+            PEyeLog twice;
+            TS_ASSERT_EQUALS(readCompressedLog(&twice, fname, nthreads), 0);
+            TS_ASSERT_EQUALS(readCompressedLog(&twice, fname, nthreads), 0);
+            TS_ASSERT_EQUALS(twice.getEntries().size(),
+                             2 * log.getEntries().size()
+                             );
+
+            PSampleStore store;
+            TS_ASSERT_EQUALS(readCompressedLog(&store, fname, nthreads), 0);
+            TS_ASSERT_EQUALS(store.size(), 30000u);
+        }
+
+        remove(fname);
+    }
+
+    /*
+     * Overwrites bytes [begin, end) of block n of fname with 0xff.
+     */
+    void damageBlock(std::size_t n, std::size_t begin, std::size_t end)
+    {
+        PBlockIndex blocks;
+        TS_ASSERT_EQUALS(readCompressedBlocks(&blocks, fname), 0);
+        TS_ASSERT_LESS_THAN(n, blocks.size());
+        std::string data;
+        {
+            std::ifstream in(fname, std::ios::binary);
+            data.assign(std::istreambuf_iterator<char>(in),
+                        std::istreambuf_iterator<char>()
+                        );
+        }
+        for (std::size_t i = begin; i < end; i++)
+            data[std::size_t(blocks[n].offset) + i] = char(0xff);
+        std::ofstream out(fname, std::ios::binary);
+        out.write(data.data(), data.size());
+    }
+
+    void testCorruptBlock()
+    {
+        TS_TRACE("Testing a corrupt block with one and several threads");
+        PEyeLog log;
+        fillLog(log);
+        const block_codec codecs[] = {CODEC_NONE, defaultBlockCodec()};
+        for (block_codec codec : codecs) {
+            PCompressedWriter writer;
+            TS_ASSERT_EQUALS(writer.setCodec(codec), 0);
+            TS_ASSERT_EQUALS(writer.open(fname), 0);
+            TS_ASSERT_EQUALS(writer.write(log.getEntries()), 0);
+            TS_ASSERT_EQUALS(writer.close(), 0);
+            PBlockIndex blocks;
+            TS_ASSERT_EQUALS(readCompressedBlocks(&blocks, fname), 0);
+            TS_ASSERT_LESS_THAN(3u, blocks.size());
+            if (blocks.size() <= 3)
+                continue;
+            // Halfway through the entries of the middle block.
+            std::size_t middle =
+                std::size_t(blocks[3].offset - blocks[2].offset) / 2;
+            damageBlock(2, middle, middle + 20);
+
+            PEyeLog serial;
+            PEntrySink* sink = &serial;
+            TS_ASSERT_EQUALS(readCompressedLog(sink, fname, 1),
+                             ERR_INVALID_FILE_FORMAT
+                             );
+            std::size_t n = serial.getEntries().size();
+            TS_ASSERT_LESS_THAN_EQUALS(std::size_t(blocks[2].first), n);
+            TS_ASSERT_LESS_THAN(n, std::size_t(blocks[3].first));
+
+            for (unsigned nthreads = 2; nthreads < 5; nthreads++) {
+                PEyeLog parallel;
+                sink = &parallel;
+                TS_ASSERT_EQUALS(readCompressedLog(sink, fname, nthreads),
+                                 ERR_INVALID_FILE_FORMAT
+                                 );
+                TS_ASSERT(equalEntries(parallel.getEntries(),
+                                       serial.getEntries()
+                                       ));
+            }
+
+            // A log is left as it was.
+            for (unsigned nthreads = 1; nthreads < 4; nthreads++) {
+                PEyeLog empty, in;
+                // The first trial of the file would end this one.
+                in.addEntry(new PTrialEntry(-1, "open", "g"));
+                in.addGaze(LGAZE, -1, 1, 2, 3);
+                in.addEntry(new PMessageEntry(0, "before"));
+                PTrialIndex trials(in.getTrialIndex());
+                TS_ASSERT_EQUALS(readCompressedLog(&empty, fname, nthreads),
+                                 ERR_INVALID_FILE_FORMAT
+                                 );
+                TS_ASSERT_EQUALS(empty.getEntries().size(), 0u);
+                TS_ASSERT_EQUALS(empty.getTrialIndex().size(), 0u);
+                TS_ASSERT_EQUALS(readCompressedLog(&in, fname, nthreads),
+                                 ERR_INVALID_FILE_FORMAT
+                                 );
+                TS_ASSERT_EQUALS(in.getEntries().size(), 3u);
+                TS_ASSERT(in.getTrialIndex() == trials);
+                TS_ASSERT_EQUALS(in.getTrialIndex()[0].end, PTrialIndex::npos);
+                // The log can still grow.
+                in.addEntry(new PTrialEndEntry(1));
+                TS_ASSERT_EQUALS(in.getTrialIndex()[0].end, 4u);
+            }
+        }
+        remove(fname);
+    }
+
+    void testRange()
+    {
+        TS_TRACE("Testing reading a time range of compressed logs");
+        PEyeLog log;
+        fillLog(log);
+        TS_ASSERT_EQUALS(log.open(fname), 0);
+        TS_ASSERT_EQUALS(log.write(FORMAT_BINARY_V2), 0);
+        log.close();
+
+        const double ranges[][2] = {
+            {0, 1}, {1500, 1600}, {1000, 6000}, {-10, 0}, {5999, 1e9}
+        };
+        for (const auto& r : ranges) {
+            PEntryVec expected;
+            for (auto* e : log.getEntries())
+                if (e->getTime() >= r[0] && e->getTime() < r[1])
+                    expected.push_back(e);
+
+            PEyeLog part;
+            TS_ASSERT_EQUALS(readCompressedRange(&part, fname, r[0], r[1]), 0);
+            TS_ASSERT(equalEntries(part.getEntries(), expected));
+
+            PEyeLog mapped;
+            TS_ASSERT_EQUALS(readMappedRange(&mapped, fname, r[0], r[1]), 0);
+            TS_ASSERT(equalEntries(mapped.getEntries(), expected));
+        }
+        remove(fname);
+    }
+
+    void testInvalid()
+    {
+        TS_TRACE("Testing truncated and corrupt compressed logs");
+        PEyeLog log;
+        fillLog(log);
+        TS_ASSERT_EQUALS(log.open(fname), 0);
+        TS_ASSERT_EQUALS(log.write(FORMAT_BINARY_V2), 0);
+        log.close();
+
+        std::string data;
+        {
+            std::ifstream in(fname, std::ios::binary);
+            data.assign(std::istreambuf_iterator<char>(in),
+                        std::istreambuf_iterator<char>()
+                        );
+        }
+        PEyeLog in;
+        TS_ASSERT_EQUALS(
+                readCompressedBuffer(&in, data.data(), data.size() - 1),
+                ERR_INVALID_FILE_FORMAT
+                );
+
+        // A block with an unknown codec.
+        std::string corrupt = data;
+        corrupt[16 + 12] = char(100);
+        in.clear();
+        TS_ASSERT_EQUALS(
+                readCompressedBuffer(&in, corrupt.data(), corrupt.size()),
+                ERR_INVALID_FILE_FORMAT
+                );
+        TS_ASSERT_EQUALS(in.getEntries().size(), 0);
+
+        // Damaged data in the first block.
+        corrupt = data;
+        for (std::size_t i = 16 + 40; i < 16 + 60; i++)
+            corrupt[i] = char(0xff);
+        in.clear();
+        TS_ASSERT_EQUALS(
+                readCompressedBuffer(&in, corrupt.data(), corrupt.size()),
+                ERR_INVALID_FILE_FORMAT
+                );
+
+        PMappedLog mapped;
+        TS_ASSERT_EQUALS(mapped.open(fname), ERR_INVALID_FILE_FORMAT);
+        remove(fname);
+    }
+};
@@ -0,0 +1,188 @@
+#include <cxxtest/TestSuite.h>
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../eyelog/EyeLog.h"
+
+
+class CsvWriterSuite: public CxxTest::TestSuite
+{
+
+public:
+
+    void tearDown()
+    {
+        PEyeLogEntry::setSeparator("\t");
+        PEyeLogEntry::setPrecision(2);
+    }
+
+    std::string fixed(double value, unsigned precision)
+    {
+        std::vector<char> out;
+        PCsvWriter::formatFixed(out, value, precision);
+        return std::string(out.begin(), out.end());
+    }
+
+    std::string expected(double value, unsigned precision)
+    {
+        std::ostringstream stream;
+        stream.setf(std::ios::fixed);
+        stream.precision(precision);
+        stream << value;
+        return stream.str();
+    }
+
+    void testFormatFixed()
+    {
+        TS_TRACE("Testing fixed notation against iostream");
+        const double values[] = {
+            0, -0.0, 1, -1, 0.5, 1.5, 2.5, -2.5, 0.125, 0.005, 0.015,
+            1.005, 123.455, 9.995, 99.999999999, 1e12, -1e15, 1e300,
+            0.3, 2e-9, -4e-9, 4294967296.5, 1.0 / 3
+        };
+        for (unsigned p = 0; p <= 8; p++) {
+            for (double v : values)
+                TSM_ASSERT_EQUALS(expected(v, p).c_str(),
+                                  fixed(v, p), expected(v, p)
+                                  );
+        }
+
+        srand(42);
+        for (unsigned i = 0; i < 200000; i++) {
+            unsigned p = i % 9;
+            double v = (rand() - RAND_MAX / 2) / double(1 << (rand() % 24));
+            if (i % 3 == 0)
+                v = float(v);
+            if (fixed(v, p) != expected(v, p)) {
+                TS_FAIL(expected(v, p).c_str());
+                break;
+            }
+        }
+    }
+
+    void testSpecialValues()
+    {
+        TS_TRACE("Testing infinity and NaN");
+        TS_ASSERT_EQUALS(fixed(HUGE_VAL, 2), expected(HUGE_VAL, 2));
+        TS_ASSERT_EQUALS(fixed(-HUGE_VAL, 2), expected(-HUGE_VAL, 2));
+        TS_ASSERT_EQUALS(fixed(NAN, 2), expected(NAN, 2));
+    }
+
+    std::string writeAll(const PEyeLog& log)
+    {
+        std::ostringstream stream;
+        {
+            PCsvWriter writer(stream);
+            for (const auto& e : log.getEntries())
+                TS_ASSERT_EQUALS(writer.write(*e), 0);
+        }
+        return stream.str();
+    }
+
+    std::string toStrings(const PEyeLog& log)
+    {
+        std::string s;
+        for (const auto& e : log.getEntries()) {
+            s += e->toString().c_str();
+            s += '\n';
+        }
+        return s;
+    }
+
+    void testEntries()
+    {
+        TS_TRACE("Testing that entries are written like toString");
+        PEyeLog log;
+        log.addEntry(new PMessageEntry(1.125, "Hello, world"));
+        log.addEntry(new PTrialEntry(2, "1", "group"));
+        log.addEntry(new PTrialStartEntry(2.5));
+        for (unsigned i = 0; i < 10000; i++) {
+            log.addEntry(new PGazeEntry(LGAZE, i * .5, i / 3.0f, -11.7f, 3));
+            log.addEntry(new PGazeEntry(RGAZE, i * .5, 13, i * 1.1f, 4.05f));
+        }
+        log.addEntry(new PFixationEntry(LFIX, 10, 100.25, 10.1f, 11.9f));
+        log.addEntry(new PSaccadeEntry(RSAC, 12, 10, 1, -2, 3.3f, 4.45f));
+        log.addEntry(new PTrialEndEntry(13));
+
+        for (unsigned p = 0; p <= 8; p += 4) {
+            PEyeLogEntry::setPrecision(p);
+            TS_ASSERT(writeAll(log) == toStrings(log));
+        }
+        PEyeLogEntry::setSeparator(";");
+        TS_ASSERT(writeAll(log) == toStrings(log));
+    }
+
+    std::string writeAll(const PEyeLog& log, const PFormatContext& format)
+    {
+        std::ostringstream stream;
+        {
+            PCsvWriter writer(stream, format);
+            for (const auto& e : log.getEntries())
+                writer.write(*e);
+        }
+        return stream.str();
+    }
+
+    std::string toStrings(const PEyeLog& log, const PFormatContext& format)
+    {
+        std::string s;
+        for (const auto& e : log.getEntries()) {
+            s += e->toString(format).c_str();
+            s += '\n';
+        }
+        return s;
+    }
+
+    void testFormatContext()
+    {
+        TS_TRACE("Testing writers with a format context of their own");
+        PEyeLog log;
+        log.addEntry(new PMessageEntry(1.125, "Hello, world"));
+        for (unsigned i = 0; i < 1000; i++)
+            log.addEntry(new PGazeEntry(LGAZE, i * .5, i / 3.0f, -11.7f, 3));
+        log.addEntry(new PFixationEntry(LFIX, 10, 100.25, 10.1f, 11.9f));
+
+        PFormatContext format;
+        TS_ASSERT_EQUALS(format.getSeparator(), '\t');
+        TS_ASSERT_EQUALS(format.getPrecision(), 2u);
+        format.setPrecision(20);
+        TS_ASSERT_EQUALS(format.getPrecision(), 8u);
+
+        PGazeEntry gaze(LGAZE, 1.5, 2.25f, 3, 4);
+        TS_ASSERT_EQUALS(gaze.toString(PFormatContext(',', 1)),
+                         String("0,1.5,2.2,3.0,4.0")
+                         );
+        TS_ASSERT_EQUALS(gaze.toString(), String("0\t1.50\t2.25\t3.00\t4.00"));
+
+        // Writers in several threads with different settings, while the
+        // defaults change.
+        const PFormatContext formats[] = {
+            PFormatContext(';', 0), PFormatContext(',', 5), PFormatContext()
+        };
+        std::string expected[3], written[3];
+        for (int i = 0; i < 3; i++)
+            expected[i] = toStrings(log, formats[i]);
+
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 3; i++) {
+            threads.push_back(std::thread([&, i] () {
+                for (int n = 0; n < 20; n++) {
+                    written[i] = writeAll(log, formats[i]);
+                    if (written[i] != expected[i])
+                        break;
+                }
+            }));
+        }
+        for (unsigned p = 0; p < 100; p++) {
+            PEyeLogEntry::setPrecision(p % 9);
+            PEyeLogEntry::setSeparator(p % 2 ? ";" : " ");
+        }
+        for (auto& t : threads)
+            t.join();
+        for (int i = 0; i < 3; i++)
+            TS_ASSERT(written[i] == expected[i]);
+    }
+};
@@ -0,0 +1,164 @@
+#include <cxxtest/TestSuite.h>
+#include <stdexcept>
+#include <string>
+#include "../eyelog/DArray.h"
+#include "../eyelog/DArray.cpp"
+#include "../eyelog/EyeLog.h"
+
+/*
+ * Counts how it is constructed, copies are what DArray should avoid.
+ */
+struct Counted {
+
+    static int copies;
+    static int moves;
+    static int alive;
+
+    Counted() : value(0) {alive++;}
+    Counted(int v) : value(v) {alive++;}
+    Counted(int a, int b) : value(a + b) {alive++;}
+    Counted(const Counted& o) : value(o.value) {alive++; copies++;}
+    Counted(Counted&& o) noexcept : value(o.value) {alive++; moves++;}
+    Counted& operator=(const Counted& o) {value = o.value; copies++; return *this;}
+    Counted& operator=(Counted&& o) noexcept {value = o.value; moves++; return *this;}
+    ~Counted() {alive--;}
+
+    bool operator!=(const Counted& o) const {return value != o.value;}
+
+    static void reset() {copies = moves = alive = 0;}
+
+    int value;
+};
+
+int Counted::copies = 0;
+int Counted::moves = 0;
+int Counted::alive = 0;
+
+template class DArray<Counted>;
+
+/*
+ * Can only be copied, the copy throws when throw_at copies remain.
+ */
+struct Fragile : Counted {
+
+    static int throw_at;
+
+    Fragile(int v) : Counted(v) {}
+    Fragile(const Fragile& o) : Counted(o)
+    {
+        if (throw_at && --throw_at == 0)
+            throw std::runtime_error("copy failed");
+    }
+};
+
+int Fragile::throw_at = 0;
+
+class DArraySuite: public CxxTest::TestSuite
+{
+
+public:
+
+    void setUp()
+    {
+        Counted::reset();
+    }
+
+    void testGrowthMoves()
+    {
+        TS_TRACE("Testing that growing the array moves the items");
+        {
+            DArray<Counted> a;
+            for (int i = 0; i < 1000; i++)
+                a.emplace_back(i, 1);
+            TS_ASSERT_EQUALS(Counted::copies, 0);
+            TS_ASSERT_EQUALS(Counted::alive, 1000);
+            TS_ASSERT_EQUALS(a[999].value, 1000);
+
+            a.push_back(Counted(5));
+            TS_ASSERT_EQUALS(Counted::copies, 0);
+
+            // The capacity isn't constructed.
+            TS_ASSERT(a.capacity() > a.size());
+            TS_ASSERT_EQUALS(Counted::alive, 1001);
+        }
+        TS_ASSERT_EQUALS(Counted::alive, 0);
+    }
+
+    void testPushBackItself()
+    {
+        TS_TRACE("Testing push_back of an item of the array itself");
+        DArray<std::string> a;
+        a.push_back("first item that is not a short string");
+        for (int i = 0; i < 100; i++)
+            a.push_back(a[0]);
+        TS_ASSERT_EQUALS(a.size(), 101u);
+        TS_ASSERT_EQUALS(a[100], a[0]);
+    }
+
+    void testDestruction()
+    {
+        TS_TRACE("Testing that removed items are destroyed");
+        DArray<Counted> a(10, Counted(3));
+        TS_ASSERT_EQUALS(Counted::alive, 10);
+        a.pop_back();
+        TS_ASSERT_EQUALS(Counted::alive, 9);
+        a.resize(2);
+        TS_ASSERT_EQUALS(Counted::alive, 2);
+        a.resize(20, Counted(4));
+        TS_ASSERT_EQUALS(Counted::alive, 20);
+        TS_ASSERT_EQUALS(a[1].value, 3);
+        TS_ASSERT_EQUALS(a[19].value, 4);
+        a.erase(a.begin(), a.begin() + 5);
+        TS_ASSERT_EQUALS(Counted::alive, 15);
+        a.clear();
+        TS_ASSERT_EQUALS(Counted::alive, 0);
+    }
+
+    void testGrowthThrows()
+    {
+        TS_TRACE("Testing that a copy that throws leaves the array intact");
+        {
+            DArray<Fragile> a;
+            a.reserve(4);
+            for (int i = 0; i < 4; i++)
+                a.push_back(Fragile(i));
+            TS_ASSERT_EQUALS(Counted::alive, 4);
+            Fragile::throw_at = 3;
+            bool thrown = false;
+            try {
+                a.reserve(8);
+            }
+            catch (const std::runtime_error&) {
+                thrown = true;
+            }
+            TS_ASSERT(thrown);
+            Fragile::throw_at = 0;
+            TS_ASSERT_EQUALS(a.size(), 4u);
+            TS_ASSERT_EQUALS(a.capacity(), 4u);
+            TS_ASSERT_EQUALS(Counted::alive, 4);
+            for (int i = 0; i < 4; i++)
+                TS_ASSERT_EQUALS(a[i].value, i);
+        }
+        TS_ASSERT_EQUALS(Counted::alive, 0);
+    }
+
+    void testTrials()
+    {
+        TS_TRACE("Testing that trials are moved, not copied");
+        DArray<PTrial> trials;
+        for (int i = 0; i < 100; i++) {
+            PTrialEntry entry(i, "trial", "group");
+            PGazeEntry gaze(LGAZE, i, 1, 2, 3);
+            trials.emplace_back(entry);
+            trials[i].addEntry(&gaze);
+        }
+        TS_ASSERT_EQUALS(trials[0][LGAZE].size(), 1u);
+        TS_ASSERT_EQUALS(trials[99][LGAZE][0]->getTime(), 99);
+        TS_ASSERT_EQUALS(trials[0].getIdentifier(), String("trial"));
+        TS_ASSERT_EQUALS(trials[99].getGroup(), String("group"));
+
+        PTrial moved(std::move(trials[0]));
+        TS_ASSERT_EQUALS(moved[LGAZE].size(), 1u);
+        TS_ASSERT_EQUALS(trials[0][LGAZE].size(), 0u);
+    }
+};
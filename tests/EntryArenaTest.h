@@ -0,0 +1,66 @@
+#include <cxxtest/TestSuite.h>
+#include "../eyelog/EyeLog.h"
+
+
+class EntryArenaSuite: public CxxTest::TestSuite
+{
+
+public:
+
+    void testCreate()
+    {
+        TS_TRACE("Testing entries created in an arena");
+        PEntryArena arena;
+        PGazeEntry heap(LGAZE, 1, 2, 3, 4);
+        PEyeLogEntry* first = nullptr;
+        PEyeLogEntry* last = nullptr;
+
+        // More than one block.
+        for (unsigned i = 0; i < 100000; i++) {
+            last = arena.create<PGazeEntry>(RGAZE, i, 2, 3, 4);
+            if (!first)
+                first = last;
+        }
+        PEyeLogEntry* msg = arena.create<PMessageEntry>(1e5, "Hello");
+
+        TS_ASSERT(arena.owns(first));
+        TS_ASSERT(arena.owns(last));
+        TS_ASSERT(arena.owns(msg));
+        TS_ASSERT(!arena.owns(&heap));
+        TS_ASSERT(arena.size() >= 100000 * sizeof(PGazeEntry));
+        TS_ASSERT_EQUALS(last->getTime(), 99999);
+        TS_ASSERT_EQUALS(
+                static_cast<PMessageEntry*>(msg)->getMessage(),
+                String("Hello")
+                );
+
+        // Clones come from the heap and can be deleted.
+        PEyeLogEntry* clone = msg->clone();
+        TS_ASSERT(!arena.owns(clone));
+        TS_ASSERT(clone->compare(*msg) == 0);
+        delete clone;
+
+        arena.clear();
+        TS_ASSERT_EQUALS(arena.size(), 0u);
+        TS_ASSERT(!arena.owns(first));
+    }
+
+    void testLog()
+    {
+        TS_TRACE("Testing a log with entries from the heap and the arena");
+        PEyeLog log;
+        for (int n = 0; n < 2; n++) {
+            log.addEntry(new PMessageEntry(0, "start"));
+            for (unsigned i = 0; i < 50000; i++) {
+                log.addGaze(LGAZE, i, 1, 2, 3);
+                log.addEntry(new PGazeEntry(RGAZE, i, 1, 2, 3));
+            }
+            log.addEntry(new PTrialEndEntry(5e4));
+            TS_ASSERT_EQUALS(log.getEntries().size(), 100002u);
+            TS_ASSERT_EQUALS(log.getEntries()[1]->getEntryType(), LGAZE);
+            TS_ASSERT_EQUALS(log.getEntries()[2]->getEntryType(), RGAZE);
+            log.clear();
+            TS_ASSERT_EQUALS(log.getEntries().size(), 0u);
+        }
+    }
+};
@@ -0,0 +1,109 @@
+#include <cxxtest/TestSuite.h>
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+#include "../eyelog/EyeLog.h"
+#include "TestLogs.h"
+
+
+class EntrySortSuite: public CxxTest::TestSuite
+{
+
+public:
+
+    /*
+     * Many entries share their time, so the order also depends on the
+     * entrytype and the fields.
+     */
+    PEntryVec makeEntries(unsigned n)
+    {
+        PEntryVec entries;
+        srand(3);
+        for (unsigned i = 0; i < n; i++) {
+            double t = rand() % (n / 4 + 1);
+            if (i % 5 == 0)
+                t += 1e-7; // within the tolerance of compare.
+            switch (rand() % 4) {
+                case 0:
+                    entries.push_back(new PGazeEntry(LGAZE, t, rand() % 3, 1, 2));
+                    break;
+                case 1:
+                    entries.push_back(new PGazeEntry(RGAZE, t, rand() % 3, 1, 2));
+                    break;
+                case 2:
+                    entries.push_back(new PMessageEntry(t, i % 2 ? "a" : "b"));
+                    break;
+                default:
+                    entries.push_back(new PFixationEntry(LFIX, t, rand() % 3, 1, 2));
+            }
+        }
+        return entries;
+    }
+
+    bool samePointers(PEntryVec a, PEntryVec b)
+    {
+        std::vector<PEntryPtr> va(a.begin(), a.end());
+        std::vector<PEntryPtr> vb(b.begin(), b.end());
+        std::sort(va.begin(), va.end());
+        std::sort(vb.begin(), vb.end());
+        return va == vb;
+    }
+
+    void testSort()
+    {
+        TS_TRACE("Testing sortPEntryVec with one and more threads");
+        const unsigned sizes[] = {0, 1, 2, 100, 300000};
+        for (unsigned n : sizes) {
+            PEntryVec entries = makeEntries(n);
+            for (unsigned nthreads = 1; nthreads <= 5; nthreads += 2) {
+                PEntryVec sorted = entries;
+                sortPEntryVec(sorted, nthreads);
+                TS_ASSERT(isSorted(sorted));
+                TS_ASSERT(samePointers(sorted, entries));
+            }
+            destroyPEntyVec(entries);
+        }
+    }
+
+    void testMerge()
+    {
+        TS_TRACE("Testing merging sorted vectors");
+        PEntryVec entries = makeEntries(20000);
+        PEntryVec left, right, messages, empty;
+        for (auto* e : entries) {
+            if (e->getEntryType() == LGAZE)
+                left.push_back(e);
+            else if (e->getEntryType() == RGAZE)
+                right.push_back(e);
+            else
+                messages.push_back(e);
+        }
+        sortPEntryVec(left);
+        sortPEntryVec(right);
+        sortPEntryVec(messages);
+
+        std::vector<const PEntryVec*> inputs;
+        inputs.push_back(&left);
+        inputs.push_back(&empty);
+        inputs.push_back(&right);
+        inputs.push_back(&messages);
+        PEntryVec merged;
+        mergePEntryVecs(inputs, merged);
+        TS_ASSERT_EQUALS(merged.size(), entries.size());
+        TS_ASSERT(isSorted(merged));
+        TS_ASSERT(samePointers(merged, entries));
+
+        // equal entries keep the order of the inputs.
+        PGazeEntry a(LGAZE, 1, 2, 3, 4), b(LGAZE, 1, 2, 3, 4);
+        PEntryVec va, vb, out;
+        va.push_back(&a);
+        vb.push_back(&b);
+        inputs.clear();
+        inputs.push_back(&vb);
+        inputs.push_back(&va);
+        mergePEntryVecs(inputs, out);
+        TS_ASSERT_EQUALS(out.size(), 2);
+        TS_ASSERT_EQUALS(out[0], &b);
+        destroyPEntyVec(entries);
+    }
+};
@@ -0,0 +1,178 @@
+#include <cxxtest/TestSuite.h>
+#include <cmath>
+#include <cstdio>
+#include "../eyelog/EyeLog.h"
+#include "TestLogs.h"
+
+
+class EventDetectorSuite: public CxxTest::TestSuite
+{
+    static const unsigned NFIX = 5;
+
+public:
+
+    /*
+     * Fixations of 200 ms 200 pixels apart, with saccades of 20 ms in
+     * between, sampled at 1000 Hz with a little noise.
+     */
+    void addScanpath(PEntrySink& sink, entrytype eye, double start = 0)
+    {
+        double t = start;
+        for (unsigned f = 0; f < NFIX; f++) {
+            float x = 100.0f + 200 * f;
+            for (unsigned i = 0; i < 200; i++, t++) {
+                float noise = float(i % 3) * 0.3f;
+                sink.addGaze(eye, t, x + noise, 300 - noise, 4);
+            }
+            if (f + 1 == NFIX)
+                break;
+            for (unsigned j = 1; j < 20; j++, t++)
+                sink.addGaze(eye, t, x + 10 * j, 300, 4);
+        }
+    }
+
+    unsigned count(const PEyeLog& log, entrytype type)
+    {
+        unsigned n = 0;
+        for (const auto* e : log.getEntries())
+            n += e->getEntryType() == type;
+        return n;
+    }
+
+    void checkScanpath(const PEyeLog& log, entrytype fix, entrytype sac)
+    {
+        TS_ASSERT_EQUALS(count(log, fix), NFIX);
+        TS_ASSERT_EQUALS(count(log, sac), NFIX - 1);
+        unsigned f = 0;
+        for (const auto* e : log.getEntries()) {
+            if (e->getEntryType() == fix) {
+                const PFixationEntry* p = static_cast<const PFixationEntry*>(e);
+                TS_ASSERT_DELTA(p->getX(), 100.0 + 200 * f, 1);
+                TS_ASSERT_DELTA(p->getY(), 300.0, 1);
+                TS_ASSERT_DELTA(p->getDuration(), 199, 3);
+                f++;
+            }
+            else if (e->getEntryType() == sac) {
+                const PSaccadeEntry* p = static_cast<const PSaccadeEntry*>(e);
+                TS_ASSERT_DELTA(p->getX1(), 100.0 + 200 * (f - 1), 1);
+                TS_ASSERT_DELTA(p->getX2(), 100.0 + 200 * f, 1);
+                TS_ASSERT_DELTA(p->getDuration(), 20, 2);
+            }
+        }
+    }
+
+    void testVelocities()
+    {
+        TS_TRACE("Testing computeVelocities");
+        double t[] = {0, 1, 2, 2, 4};
+        float x[] = {0, 3, 3, 4, 4};
+        float y[] = {0, 4, 4, 4, 8};
+        float v[4];
+        computeVelocities(t, x, y, 5, v);
+        TS_ASSERT_DELTA(v[0], 5000, 1e-3);
+        TS_ASSERT_DELTA(v[1], 0, 1e-3);
+        TS_ASSERT_DELTA(v[2], 0, 1e-3);     // no time has passed.
+        TS_ASSERT_DELTA(v[3], 2000, 1e-3);
+    }
+
+    void testIvt()
+    {
+        TS_TRACE("Testing velocity threshold detection");
+        PEyeLog log;
+        PEventDetector detector(&log, DETECT_IVT);
+        addScanpath(detector, LGAZE);
+        detector.flush();
+        checkScanpath(log, LFIX, LSAC);
+    }
+
+    void testIdt()
+    {
+        TS_TRACE("Testing dispersion threshold detection");
+        PEyeLog log;
+        PEventDetector detector(&log, DETECT_IDT);
+        // The saccades move 10 pixels per sample.
+        detector.setDispersionThreshold(5);
+        addScanpath(detector, RGAZE);
+        detector.flush();
+        checkScanpath(log, RFIX, RSAC);
+    }
+
+    void testAverage()
+    {
+        TS_TRACE("Testing detection on averaged samples");
+        const detection_algorithm algorithms[] = {DETECT_IVT, DETECT_IDT};
+        for (detection_algorithm a : algorithms) {
+            PEyeLog log;
+            {
+                PEventDetector detector(&log, a);
+                detector.setDispersionThreshold(5);
+                addScanpath(detector, AVGGAZE);
+            } // the destructor flushes.
+            checkScanpath(log, AVGFIX, AVGSAC);
+            TS_ASSERT_EQUALS(count(log, LFIX) + count(log, RFIX), 0);
+        }
+    }
+
+    void testGap()
+    {
+        TS_TRACE("Testing that a gap in the samples ends an event");
+        const detection_algorithm algorithms[] = {DETECT_IVT, DETECT_IDT};
+        for (detection_algorithm a : algorithms) {
+            PEyeLog log;
+            PEventDetector detector(&log, a);
+            for (unsigned i = 0; i < 200; i++)
+                detector.addGaze(LGAZE, i, 10, 10, 1);
+            // a blink
+            for (unsigned i = 400; i < 600; i++)
+                detector.addGaze(LGAZE, i, 500, 10, 1);
+            detector.addGaze(LGAZE, 600, NAN, NAN, 0);
+            for (unsigned i = 601; i < 800; i++)
+                detector.addGaze(LGAZE, i, 500, 10, 1);
+            detector.flush();
+            TS_ASSERT_EQUALS(count(log, LFIX), 3);
+            TS_ASSERT_EQUALS(count(log, LSAC), 0);
+        }
+    }
+
+    void testFromFile()
+    {
+        TS_TRACE("Testing detection while reading a file");
+        const char* fn = "event_detector.bin";
+        PEyeLog samples, expected, log;
+        addScanpath(samples, LGAZE, 1000);
+        addScanpath(samples, RGAZE, 1000);
+        TS_ASSERT_EQUALS(samples.open(fn), 0);
+        TS_ASSERT_EQUALS(samples.write(FORMAT_BINARY), 0);
+        samples.close();
+
+        PEventDetector fromlog(&expected);
+        for (const auto* e : samples.getEntries())
+            fromlog.addEntry(e->clone());
+        fromlog.flush();
+
+        PEventDetector detector(&log);
+        TS_ASSERT_EQUALS(readLog(&detector, fn), 0);
+        detector.flush();
+        TS_ASSERT_EQUALS(log.getEntries().size(), 2 * (2 * NFIX - 1));
+        TS_ASSERT(equalEntries(log.getEntries(), expected.getEntries()));
+        remove(fn);
+    }
+
+    void testAverageEvents()
+    {
+        TS_TRACE("Testing writing and reading AVGFIX and AVGSAC");
+        const char* fn = "event_detector_avg";
+        const eyelog_format formats[] = {FORMAT_BINARY, FORMAT_CSV};
+        for (eyelog_format f : formats) {
+            PEyeLog log, in;
+            log.addEntry(new PFixationEntry(AVGFIX, 10, 200, 1, 2));
+            log.addEntry(new PSaccadeEntry(AVGSAC, 210, 20, 1, 2, 3, 4));
+            TS_ASSERT_EQUALS(log.open(fn), 0);
+            TS_ASSERT_EQUALS(log.write(f), 0);
+            log.close();
+            TS_ASSERT_EQUALS(readLog(&in, fn), 0);
+            TS_ASSERT(equalEntries(in.getEntries(), log.getEntries()));
+        }
+        remove(fn);
+    }
+};
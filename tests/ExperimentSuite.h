@@ -1,4 +1,5 @@
 #include <cxxtest/TestSuite.h>
+#include <vector>
 #include "../eyelog/EyeLog.h"
 
 
@@ -121,6 +122,151 @@ public:
 
         destroyPEntyVec(meta);
     }
+
+    void fillLog(PEyeLog& log)
+    {
+        log.addEntry(new PMessageEntry(0, "Meta"));
+        for (int t = 0; t < 10; t++) {
+            double time = t * 100;
+            log.addEntry(new PTrialEntry(time, "Trial", "Group"));
+            log.addEntry(new PTrialStartEntry(time));
+            for (int i = 0; i < 50; i++) {
+                log.addGaze(LGAZE, time + i, 10, 10, 0);
+                log.addGaze(RGAZE, time + i, 11, 11, 0);
+            }
+            log.addEntry(new PFixationEntry(LFIX, time, 50, 10, 10));
+            log.addEntry(new PTrialEndEntry(time + 50));
+            log.addEntry(new PMessageEntry(time + 60, "between trials"));
+        }
+    }
+
+    void testBorrowedExperiment()
+    {
+        TS_TRACE("Testing PExperiment that borrows the entries of a log");
+        PEyeLog log, copy;
+        fillLog(log);
+        fillLog(copy);
+        const PEyeLogEntry* first = log.getEntries()[0];
+        const PEyeLogEntry* gaze = log.getEntries()[3];
+
+        PExperiment expected(copy);
+        PExperiment borrowed(std::move(log));
+
+        TS_ASSERT_EQUALS(log.getEntries().size(), 0u);
+        TS_ASSERT(expected.ownsEntries());
+        TS_ASSERT(!borrowed.ownsEntries());
+        TS_ASSERT_EQUALS(borrowed, expected);
+        TS_ASSERT_EQUALS(borrowed.nTrials(), 10u);
+        TS_ASSERT_EQUALS(borrowed[0][LGAZE].size(), 50u);
+        TS_ASSERT_EQUALS(borrowed[0][LGAZE][0], gaze);
+
+        // Copies share the log.
+        PExperiment shared(borrowed);
+        TS_ASSERT(!shared.ownsEntries());
+        TS_ASSERT_EQUALS(shared[9][RGAZE][0], borrowed[9][RGAZE][0]);
+        expected = borrowed;
+        TS_ASSERT(!expected.ownsEntries());
+
+        // A copy of a trial owns its entries.
+        PTrial trial(borrowed[1]);
+        TS_ASSERT(trial.ownsEntries());
+        TS_ASSERT(!borrowed[1].ownsEntries());
+        TS_ASSERT_EQUALS(trial, borrowed[1]);
+
+        // Adding entries makes the experiment own them.
+        PTrialEntry extra(2000, "Extra", "Group");
+        shared.addEntry(&extra);
+        TS_ASSERT(shared.ownsEntries());
+        TS_ASSERT(shared[0].ownsEntries());
+        TS_ASSERT_EQUALS(shared.nTrials(), 11u);
+        TS_ASSERT_EQUALS(borrowed.nTrials(), 10u);
+        TS_ASSERT_EQUALS(shared[9], borrowed[9]);
+
+        PEyeLog out;
+        borrowed.getLog(out);
+        TS_ASSERT(out.getEntries()[0] != first);
+        TS_ASSERT_EQUALS(out.getEntries()[0]->compare(*first), 0);
+    }
+
+    void testSharedLog()
+    {
+        TS_TRACE("Testing PExperiment that shares a log");
+        std::shared_ptr<PEyeLog> log(new PEyeLog);
+        fillLog(*log);
+        PExperiment expected(*log);
+        PExperiment exp(log);
+        log.reset();
+        TS_ASSERT_EQUALS(exp, expected);
+    }
+
+    void testGazeColumns()
+    {
+        TS_TRACE("Testing the gaze columns of a PTrial");
+        PEyeLog log;
+        fillLog(log);
+        PExperiment owning(log);
+        PExperiment borrowed(std::move(log));
+
+        const PExperiment* experiments[] = {&owning, &borrowed};
+        for (const PExperiment* exp : experiments) {
+            const PTrial& trial = (*exp)[3];
+            const entrytype eyes[] = {LGAZE, RGAZE};
+            for (entrytype eye : eyes) {
+                const PGazeColumns& columns = trial.getGaze(eye);
+                const DArray<PEyeLogEntry*>& samples = trial[eye];
+                TS_ASSERT_EQUALS(columns.size(), samples.size());
+                for (unsigned i = 0; i < samples.size(); i++) {
+                    const PGazeEntry* g =
+                        static_cast<const PGazeEntry*>(samples[i]);
+                    TS_ASSERT_EQUALS(columns.getTime()[i], g->getTime());
+                    TS_ASSERT_EQUALS(columns.getX()[i], g->getX());
+                    TS_ASSERT_EQUALS(columns.getY()[i], g->getY());
+                    TS_ASSERT_EQUALS(columns.getPupil()[i], g->getPupil());
+                }
+            }
+            TS_ASSERT(trial.getGaze(AVGGAZE).empty());
+            TS_ASSERT(trial.getGaze(LFIX).empty());
+            TS_ASSERT_EQUALS(trial[LFIX].size(), 1u);
+            TS_ASSERT_EQUALS(trial[AVGGAZE].size(), 0u);
+            std::size_t n = 0;
+            for (unsigned t = LGAZE; t <= TRIALEND; t++)
+                n += trial[entrytype(t)].size();
+            TS_ASSERT_EQUALS(trial.size(), n);
+            TS_ASSERT_LESS_THAN(100u, n);
+        }
+
+        // Copies, moves and added entries keep the columns up to date.
+        PTrial copy(borrowed[3]);
+        TS_ASSERT_EQUALS(copy.getGaze(LGAZE).size(), 50u);
+        PTrial moved(std::move(copy));
+        TS_ASSERT_EQUALS(moved.getGaze(LGAZE).size(), 50u);
+        TS_ASSERT_EQUALS(copy.getGaze(LGAZE).size(), 0u);
+        TS_ASSERT_EQUALS(copy.size(), 0u);
+        PGazeEntry extra(AVGGAZE, 1000, 1, 2, 3);
+        moved.addEntry(&extra);
+        TS_ASSERT_EQUALS(moved.getGaze(AVGGAZE).size(), 1u);
+        TS_ASSERT_EQUALS(moved.getGaze(AVGGAZE).getX()[0], 1.0f);
+        moved.clear();
+        TS_ASSERT(moved.getGaze(LGAZE).empty());
+        TS_ASSERT_EQUALS(moved[LGAZE].size(), 0u);
+
+        // Threads that make the columns at once all get the same ones.
+        PExperiment fresh(owning);
+        const unsigned ntrials = fresh.nTrials();
+        std::vector<const PGazeColumns*> made(4 * ntrials);
+        PThreadPool pool(4);
+        pool.forEach(made.size(), [&] (std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; i++)
+                made[i] = &fresh[unsigned(i % ntrials)].getGaze(RGAZE);
+        });
+        bool same = true;
+        for (std::size_t i = 0; i < made.size(); i++)
+            same = same && made[i] == &fresh[i % ntrials].getGaze(RGAZE);
+        TS_ASSERT(same);
+        TS_ASSERT_EQUALS(fresh[3].getGaze(RGAZE).size(),
+                         fresh[3][RGAZE].size()
+                         );
+    }
 };
 
 
@@ -0,0 +1,145 @@
+#include <cxxtest/TestSuite.h>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+#include "../eyelog/EyeLog.h"
+
+
+class GazeKernelsSuite: public CxxTest::TestSuite
+{
+    // Not a multiple of 8, so the remainder is done by the scalar code.
+    static const std::size_t N = 1003;
+
+    std::vector<double> t;
+    std::vector<float>  x, y, p, r;
+
+public:
+
+    void setUp()
+    {
+        srand(5);
+        t.resize(N);
+        x.resize(N);
+        y.resize(N);
+        p.resize(N);
+        r.resize(N);
+        double time = 100;
+        for (std::size_t i = 0; i < N; i++) {
+            time += i % 97 == 0 ? 0 : 1 + rand() % 3; // some equal times.
+            t[i] = time;
+            x[i] = float(rand() % 19200) / 10;
+            y[i] = float(rand() % 10800) / 10;
+            p[i] = 1000 + float(rand() % 500);
+            r[i] = i % 13 == 0 ? NAN : x[i] + 5;
+        }
+        x[7] = NAN;
+    }
+
+    void tearDown()
+    {
+        // back to the best instruction set.
+        const gaze_kernel_isa best[] = {KERNEL_AVX2, KERNEL_SSE2, KERNEL_SCALAR};
+        for (gaze_kernel_isa isa : best)
+            if (setGazeKernelIsa(isa) == 0)
+                break;
+    }
+
+    bool same(const std::vector<float>& a, const std::vector<float>& b)
+    {
+        if (a.size() != b.size())
+            return false;
+        for (std::size_t i = 0; i < a.size(); i++) {
+            if (std::isnan(a[i]) || std::isnan(b[i])) {
+                if (std::isnan(a[i]) != std::isnan(b[i]))
+                    return false;
+            }
+            else if (std::fabs(a[i] - b[i]) > 1e-4 * (1 + std::fabs(a[i])))
+                return false;
+        }
+        return true;
+    }
+
+    /*
+     * Runs all kernels with the current instruction set.
+     */
+    std::vector<std::vector<float> > runKernels()
+    {
+        std::vector<std::vector<float> > out;
+        std::vector<float> v(N - 1), a(N - 2), avg(N), deg(N), z(N);
+        computeVelocities(t.data(), x.data(), y.data(), N, v.data());
+        computeAccelerations(t.data(), v.data(), N, a.data());
+        averageEyes(x.data(), r.data(), N, avg.data());
+        pixelsToDegrees(y.data(), N, 540, 35, deg.data());
+        normalizePupil(p.data(), N, z.data());
+        out.push_back(v);
+        out.push_back(a);
+        out.push_back(avg);
+        out.push_back(deg);
+        out.push_back(z);
+        return out;
+    }
+
+    void testScalar()
+    {
+        TS_TRACE("Testing the scalar gaze kernels");
+        TS_ASSERT(gazeKernelIsaSupported(KERNEL_SCALAR));
+        TS_ASSERT_EQUALS(setGazeKernelIsa(KERNEL_SCALAR), 0);
+        TS_ASSERT_EQUALS(getGazeKernelIsa(), KERNEL_SCALAR);
+
+        std::vector<std::vector<float> > out = runKernels();
+        const std::vector<float>& v = out[0];
+        const std::vector<float>& avg = out[2];
+        const std::vector<float>& z = out[4];
+
+        float dx = x[2] - x[1], dy = y[2] - y[1];
+        TS_ASSERT_DELTA(v[1],
+                        std::sqrt(dx * dx + dy * dy) * 1000 / (t[2] - t[1]),
+                        1e-2
+                        );
+        TS_ASSERT_EQUALS(v[96], 0);                 // t[97] == t[96]
+        TS_ASSERT_DELTA(out[1][1], (v[2] - v[1]) * 2000 / (t[3] - t[1]), 1);
+        TS_ASSERT_EQUALS(avg[1], x[1] + 2.5f);
+        TS_ASSERT_EQUALS(avg[13], x[13]);           // r[13] is missing
+        TS_ASSERT_EQUALS(avg[7], r[7]);             // x[7] is missing
+        TS_ASSERT_DELTA(out[3][0], (y[0] - 540) / 35, 1e-5);
+
+        double mean = 0, var = 0;
+        for (float f : z) {
+            mean += f;
+            var += f * f;
+        }
+        TS_ASSERT_DELTA(mean / N, 0, 1e-5);
+        TS_ASSERT_DELTA(var / N, 1, 1e-4);
+
+        std::vector<float> equal(10, 3.0f), zeros(10);
+        normalizePupil(equal.data(), equal.size(), zeros.data());
+        TS_ASSERT_EQUALS(zeros[9], 0);
+    }
+
+    void testVectorized()
+    {
+        TS_TRACE("Testing that SSE2 and AVX2 kernels match the scalar ones");
+        TS_ASSERT_EQUALS(setGazeKernelIsa(KERNEL_SCALAR), 0);
+        std::vector<std::vector<float> > expected = runKernels();
+
+        const gaze_kernel_isa isas[] = {KERNEL_SSE2, KERNEL_AVX2};
+        for (gaze_kernel_isa isa : isas) {
+            if (!gazeKernelIsaSupported(isa)) {
+                TS_ASSERT_EQUALS(setGazeKernelIsa(isa), ERR_INVALID_PARAMETER);
+                continue;
+            }
+            TS_ASSERT_EQUALS(setGazeKernelIsa(isa), 0);
+            TS_ASSERT_EQUALS(getGazeKernelIsa(), isa);
+            std::vector<std::vector<float> > out = runKernels();
+            for (std::size_t k = 0; k < out.size(); k++)
+                TS_ASSERT(same(out[k], expected[k]));
+
+            // short arrays only take the scalar path.
+            float v[2] = {-1, -1};
+            computeVelocities(t.data(), x.data(), y.data(), 2, v);
+            TS_ASSERT_EQUALS(v[0], expected[0][0]);
+            TS_ASSERT_EQUALS(v[1], -1);
+            computeVelocities(t.data(), x.data(), y.data(), 0, v);
+        }
+    }
+};
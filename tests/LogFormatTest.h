@@ -0,0 +1,98 @@
+#include <cxxtest/TestSuite.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include "../eyelog/EyeLog.h"
+
+
+class LogFormatSuite: public CxxTest::TestSuite
+{
+    const char* fname = "log_format_test.log";
+
+public:
+
+    eyelog_format detect(const std::string& s)
+    {
+        return detectLogFormat(s.data(), s.size());
+    }
+
+    void fillLog(PEyeLog& log)
+    {
+        log.addEntry(new PMessageEntry(0, "Hi"));
+        log.addEntry(new PGazeEntry(LGAZE, 1, 10, 11, 3));
+        log.addEntry(new PFixationEntry(LFIX, 1, 100, 10, 11));
+        log.addEntry(new PSaccadeEntry(RSAC, 1, 100, 10, 11, 12, 13));
+    }
+
+    void testDetect()
+    {
+        TS_TRACE("Testing detectLogFormat on buffers");
+        TS_ASSERT_EQUALS(detect(""), FORMAT_UNKNOWN);
+        TS_ASSERT_EQUALS(detect(" \n\n"), FORMAT_UNKNOWN);
+        TS_ASSERT_EQUALS(detect("\x89" "EYELOG\n"), FORMAT_BINARY);
+        TS_ASSERT_EQUALS(detect(std::string("\x05\0\0\0", 4)), FORMAT_BINARY);
+        TS_ASSERT_EQUALS(detect(std::string("\xff\xff\0\0", 4)), FORMAT_UNKNOWN);
+        TS_ASSERT_EQUALS(detect("\n0\t1.00\t10.00\t11.00\t3.00\n"), FORMAT_CSV);
+        TS_ASSERT_EQUALS(detect("5\t0.00\tHello world\n"), FORMAT_CSV);
+        TS_ASSERT_EQUALS(detect("** CONVERTED FROM x.edf\n"), FORMAT_ASC);
+        TS_ASSERT_EQUALS(detect("1\t2.0\t3.0\t4.0\n"), FORMAT_ASC);
+    }
+
+    void testBinary()
+    {
+        TS_TRACE("Testing reading and writing binary logs with a header");
+        eyelog_format f = FORMAT_UNKNOWN;
+        {
+            PEyeLog log;
+            fillLog(log);
+            TS_ASSERT_EQUALS(log.open(fname), 0);
+            TS_ASSERT_EQUALS(log.write(FORMAT_BINARY), 0);
+        }
+        TS_ASSERT_EQUALS(detectLogFormat(fname, &f), 0);
+        TS_ASSERT_EQUALS(f, FORMAT_BINARY);
+
+        PEyeLog expected, log;
+        fillLog(expected);
+        f = FORMAT_UNKNOWN;
+        TS_ASSERT_EQUALS(readLog(&log, fname, &f), 0);
+        TS_ASSERT_EQUALS(f, FORMAT_BINARY);
+        TS_ASSERT_EQUALS(log.getEntries().size(), expected.getEntries().size());
+        for (unsigned i = 0; i < log.getEntries().size(); i++)
+            TS_ASSERT_EQUALS(*log.getEntries()[i], *expected.getEntries()[i]);
+        remove(fname);
+    }
+
+    void testNewerVersion()
+    {
+        TS_TRACE("Testing that files of a newer version are refused");
+        char header[16] = "\x89" "EYELOG\n";
+        header[8] = 99;
+        {
+            std::ofstream out(fname, std::ios::binary);
+            out.write(header, sizeof(header));
+        }
+        PEyeLog log;
+        eyelog_format f;
+        TS_ASSERT_EQUALS(readLog(&log, fname, &f), ERR_INVALID_FILE_FORMAT);
+        TS_ASSERT_EQUALS(f, FORMAT_BINARY);
+        remove(fname);
+    }
+
+    void testCsv()
+    {
+        TS_TRACE("Testing readLog on a csv file");
+        {
+            PEyeLog log;
+            fillLog(log);
+            TS_ASSERT_EQUALS(log.open(fname), 0);
+            TS_ASSERT_EQUALS(log.write(FORMAT_CSV), 0);
+        }
+        PEyeLog log;
+        eyelog_format f = FORMAT_UNKNOWN;
+        TS_ASSERT_EQUALS(readLog(&log, fname, &f), 0);
+        TS_ASSERT_EQUALS(f, FORMAT_CSV);
+        TS_ASSERT_EQUALS(log.getEntries().size(), 4);
+        remove(fname);
+    }
+};
@@ -0,0 +1,188 @@
+#include <cxxtest/TestSuite.h>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <vector>
+#include "../eyelog/EyeLog.h"
+#include "TestLogs.h"
+
+
+class LogMergerSuite: public CxxTest::TestSuite
+{
+    const char* tracker = "log_merger_tracker.bin";
+    const char* stimuli = "log_merger_stimuli.csv";
+    const char* merged = "log_merger_merged";
+
+public:
+
+    void fillTracker(PEyeLog& log)
+    {
+        for (unsigned i = 0; i < 20000; i++) {
+            if (i % 1000 == 0)
+                log.addEntry(new PTrialEntry(i - 0.25, "t", "g"));
+            log.addGaze(LGAZE, i, i, 1, 2);
+            log.addGaze(RGAZE, i, i, 3, 4);
+            if (i % 500 == 0)
+                log.addEntry(new PMessageEntry(i, "tracker"));
+        }
+    }
+
+    void fillStimuli(PEyeLog& log)
+    {
+        for (unsigned i = 0; i < 20; i++) {
+            log.addEntry(new PMessageEntry(i * 1000, "stimulus"));
+            log.addEntry(new PMessageEntry(i * 1000 + 0.5, "onset"));
+            log.addEntry(new PMessageEntry(i * 1000 + 900, "offset"));
+        }
+    }
+
+    void testMergeLogs()
+    {
+        TS_TRACE("Testing merging logs in memory");
+        PEyeLog log, other, expected;
+        fillTracker(log);
+        fillStimuli(other);
+        std::size_t n = log.getEntries().size() + other.getEntries().size();
+        const PEyeLogEntry* first = other.getEntries()[0];
+        other.addEntry(new PTrialEntry(20000, "last", "g"));
+        n++;
+
+        log.merge(std::vector<PEyeLog*>{&other, &log});
+        TS_ASSERT_EQUALS(log.getEntries().size(), n);
+        TS_ASSERT_EQUALS(other.getEntries().size(), 0);
+        TS_ASSERT(isSorted(log.getEntries()));
+        TS_ASSERT_EQUALS(log.getTrialIndex().size(), 21);
+        TS_ASSERT_EQUALS(other.getTrialIndex().size(), 0);
+
+        // moved, not cloned.
+        bool found = false;
+        for (const auto* e : log.getEntries())
+            found = found || e == first;
+        TS_ASSERT(found);
+
+        // the gaze samples of both logs can still be added and freed.
+        other.addGaze(LGAZE, 1, 2, 3, 4);
+        log.addGaze(LGAZE, 1e6, 2, 3, 4);
+        log.clear();
+    }
+
+    void writeInputs()
+    {
+        PEyeLog log, other;
+        fillTracker(log);
+        fillStimuli(other);
+        TS_ASSERT_EQUALS(log.open(tracker), 0);
+        TS_ASSERT_EQUALS(log.write(FORMAT_BINARY), 0);
+        TS_ASSERT_EQUALS(other.open(stimuli), 0);
+        TS_ASSERT_EQUALS(other.write(FORMAT_CSV), 0);
+    }
+
+    void testMerger()
+    {
+        TS_TRACE("Testing merging files with a PLogMerger");
+        writeInputs();
+        PEyeLog expected, other;
+        fillTracker(expected);
+        fillStimuli(other);
+        expected.merge(std::vector<PEyeLog*>{&other});
+
+        PLogMerger merger;
+        PEyeLog log;
+        PEyeLogEntry* entry;
+        TS_ASSERT_EQUALS(merger.addFile(tracker), 0);
+        TS_ASSERT_EQUALS(merger.addFile(stimuli), 0);
+        while ((entry = merger.next()) != nullptr)
+            log.addEntry(entry);
+        TS_ASSERT_EQUALS(merger.status(), 0);
+        TS_ASSERT(equalEntries(log.getEntries(), expected.getEntries()));
+
+        TS_ASSERT_EQUALS(merger.addFile(tracker), ERR_INVALID_PARAMETER);
+        merger.close();
+        TS_ASSERT_DIFFERS(merger.addFile("log_merger_missing.bin"), 0);
+
+        // A reader is merged from the entry it returns next.
+        std::unique_ptr<PLogReader> reader(new PLogReader);
+        TS_ASSERT_EQUALS(reader->open(tracker), 0);
+        delete reader->next();
+        TS_ASSERT_EQUALS(merger.addReader(std::move(reader)), 0);
+        TS_ASSERT_EQUALS(merger.addFile(stimuli), 0);
+        TS_ASSERT_EQUALS(merger.addReader(std::unique_ptr<PLogReader>(
+                                              new PLogReader)),
+                         ERR_INVALID_PARAMETER
+                         );
+        log.clear();
+        while ((entry = merger.next()) != nullptr)
+            log.addEntry(entry);
+        TS_ASSERT_EQUALS(merger.status(), 0);
+        TS_ASSERT_EQUALS(log.getEntries().size(),
+                         expected.getEntries().size() - 1
+                         );
+        TS_ASSERT(isSorted(log.getEntries()));
+        merger.close();
+        remove(tracker);
+        remove(stimuli);
+    }
+
+    void testMergeFiles()
+    {
+        TS_TRACE("Testing merging files into a file");
+        writeInputs();
+        PEyeLog expected, other;
+        fillTracker(expected);
+        fillStimuli(other);
+        std::size_t nstimuli = other.getEntries().size();
+        expected.merge(std::vector<PEyeLog*>{&other});
+
+        std::vector<String> inputs;
+        inputs.push_back(stimuli);
+        inputs.push_back(tracker);
+        TS_ASSERT_EQUALS(mergeLogFiles(inputs, merged, FORMAT_BINARY), 0);
+        PEyeLog log;
+        TS_ASSERT_EQUALS(readLog(&log, merged), 0);
+        TS_ASSERT(equalEntries(log.getEntries(), expected.getEntries()));
+        TS_ASSERT(log.getTrialIndex() == expected.getTrialIndex());
+
+        // Our csv format has no trials, so merge the stimuli with themselves.
+        std::vector<String> csvinputs(2, stimuli);
+        TS_ASSERT_EQUALS(mergeLogFiles(csvinputs, merged, FORMAT_CSV), 0);
+        log.clear();
+        TS_ASSERT_EQUALS(readLog(&log, merged), 0);
+        TS_ASSERT_EQUALS(log.getEntries().size(),
+                         2 * nstimuli
+                         );
+        TS_ASSERT(isSorted(log.getEntries()));
+
+        TS_ASSERT_EQUALS(mergeLogFiles(inputs, merged, FORMAT_ASC),
+                         ERR_INVALID_PARAMETER
+                         );
+
+        // An input is never overwritten, not even under another name.
+        std::vector<String> self(inputs);
+        self.push_back(merged);
+        TS_ASSERT_EQUALS(mergeLogFiles(self, merged), ERR_INVALID_PARAMETER);
+        TS_ASSERT_EQUALS(mergeLogFiles(inputs, String("./") + String(tracker)),
+                         ERR_INVALID_PARAMETER
+                         );
+        log.clear();
+        TS_ASSERT_EQUALS(readLog(&log, tracker), 0);
+        TS_ASSERT_EQUALS(log.getEntries().size(),
+                         expected.getEntries().size() - nstimuli
+                         );
+
+        // A failed merge leaves neither a partial nor a temporary file.
+        std::FILE* f = std::fopen(stimuli, "ab");
+        if (f) {
+            std::fputs("\nnot an entry", f);
+            std::fclose(f);
+        }
+        TS_ASSERT_DIFFERS(mergeLogFiles(inputs, merged), 0);
+        log.clear();
+        TS_ASSERT_EQUALS(readLog(&log, merged), 0);
+        TS_ASSERT_EQUALS(log.getEntries().size(), 2 * nstimuli);
+        String temp = String(merged) + String(".tmp");
+        TS_ASSERT(!std::ifstream(temp.c_str()).is_open());
+        remove(tracker);
+        remove(stimuli);
+        remove(merged);
+    }
+};
@@ -0,0 +1,155 @@
+#include <cxxtest/TestSuite.h>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include "../eyelog/EyeLog.h"
+
+
+class LogReaderSuite: public CxxTest::TestSuite
+{
+    const char* fname = "log_reader_test.log";
+
+public:
+
+    /*
+     * A log of a few MB, larger than the buffer of the reader.
+     */
+    void fillLog(PEyeLog& log, bool trials)
+    {
+        log.addEntry(new PMessageEntry(0, "meta data"));
+        for (unsigned i = 0; i < 60000; i++) {
+            if (trials && i % 1000 == 0) {
+                log.addEntry(new PTrialEntry(i, "trial", "group"));
+                log.addEntry(new PTrialStartEntry(i));
+            }
+            log.addEntry(new PGazeEntry(LGAZE, i, i * 0.5f, 10, 3));
+            log.addEntry(new PGazeEntry(RGAZE, i, i * 0.25f, 11, 3));
+            if (i % 100 == 0) {
+                log.addEntry(new PFixationEntry(LFIX, i, 100, 10, 11));
+                log.addEntry(new PSaccadeEntry(RSAC, i, 10, 1, 2, 3, 4));
+                log.addEntry(new PMessageEntry(i, "Hello"));
+            }
+            if (trials && i % 1000 == 999)
+                log.addEntry(new PTrialEndEntry(i));
+        }
+    }
+
+    void compareReader(const PEyeLog& expected, eyelog_format format)
+    {
+        PLogReader reader;
+        TS_ASSERT_EQUALS(reader.open(fname), 0);
+        TS_ASSERT_EQUALS(reader.getFormat(), format);
+
+        const PEntryVec& entries = expected.getEntries();
+        unsigned n = 0, nwrong = 0;
+        PEyeLogEntry* e;
+        while ((e = reader.next()) != nullptr) {
+            if (n >= entries.size() || *e != *entries[n])
+                nwrong++;
+            n++;
+            delete e;
+        }
+        TS_ASSERT_EQUALS(reader.status(), 0);
+        TS_ASSERT_EQUALS(n, entries.size());
+        TS_ASSERT_EQUALS(nwrong, 0);
+    }
+
+    void testBinary()
+    {
+        TS_TRACE("Testing PLogReader on a binary log");
+        PEyeLog log;
+        fillLog(log, true);
+        TS_ASSERT_EQUALS(log.open(fname), 0);
+        TS_ASSERT_EQUALS(log.write(FORMAT_BINARY), 0);
+        log.close();
+        compareReader(log, FORMAT_BINARY);
+        remove(fname);
+    }
+
+    void testCompressed()
+    {
+        TS_TRACE("Testing PLogReader on a compressed binary log");
+        PEyeLog log;
+        fillLog(log, true);
+        TS_ASSERT_EQUALS(log.open(fname), 0);
+        TS_ASSERT_EQUALS(log.write(FORMAT_BINARY_V2), 0);
+        log.close();
+        compareReader(log, FORMAT_BINARY_V2);
+        remove(fname);
+    }
+
+    void testCsv()
+    {
+        TS_TRACE("Testing PLogReader on a csv log");
+        PEyeLog log, expected;
+        fillLog(log, false);
+        TS_ASSERT_EQUALS(log.open(fname), 0);
+        TS_ASSERT_EQUALS(log.write(FORMAT_CSV), 0);
+        log.close();
+        TS_ASSERT_EQUALS(readLog(&expected, fname), 0);
+        compareReader(expected, FORMAT_CSV);
+        remove(fname);
+    }
+
+    void testAsc()
+    {
+        TS_TRACE("Testing PLogReader on an asc log");
+        {
+            std::ofstream out(fname);
+            out << "** CONVERTED FROM test.edf\n";
+            for (unsigned i = 0; i < 80000; i++) {
+                if (i % 7000 == 0)
+                    out << (i % 14000 ? "SAMPLES\tGAZE\tLEFT\n" :
+                                        "SAMPLES\tGAZE\tRIGHT\n");
+                out << i << "\t  512.3\t  384.1\t 1024.0\t...\n";
+                if (i % 1000 == 0)
+                    out << "MSG\t" << i << " hello\n";
+            }
+        }
+        PEyeLog expected;
+        TS_ASSERT_EQUALS(readLog(&expected, fname), 0);
+        compareReader(expected, FORMAT_ASC);
+        remove(fname);
+    }
+
+    void testBatchesAndExperiment()
+    {
+        TS_TRACE("Testing building a PExperiment with PLogReader");
+        PEyeLog log;
+        fillLog(log, true);
+        TS_ASSERT_EQUALS(log.open(fname), 0);
+        TS_ASSERT_EQUALS(log.write(FORMAT_BINARY), 0);
+        log.close();
+
+        PExperiment expected(log);
+        PExperiment incremental;
+        PLogReader reader;
+        PEyeLog batch;
+        TS_ASSERT_EQUALS(reader.open(fname), 0);
+        // the first part in batches, the rest entry by entry.
+        for (int i = 0; i < 10; i++) {
+            TS_ASSERT_EQUALS(reader.readBatch(&batch, 1000), 1000);
+            for (const auto* e : batch.getEntries())
+                incremental.addEntry(e);
+            batch.clear();
+        }
+        TS_ASSERT_EQUALS(incremental.read(reader), 0);
+        TS_ASSERT_EQUALS(incremental.nTrials(), 60);
+        TS_ASSERT_EQUALS(incremental, expected);
+        remove(fname);
+    }
+
+    void testInvalid()
+    {
+        {
+            std::ofstream out(fname, std::ios::binary);
+            const char record[] = {5, 0, 1, 2, 3};  // a truncated message.
+            out.write(record, sizeof(record));
+        }
+        PLogReader reader;
+        TS_ASSERT_EQUALS(reader.open(fname), 0);
+        TS_ASSERT(reader.next() == nullptr);
+        TS_ASSERT_EQUALS(reader.status(), ERR_INVALID_FILE_FORMAT);
+        remove(fname);
+    }
+};
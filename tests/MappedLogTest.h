@@ -0,0 +1,123 @@
+#include <cxxtest/TestSuite.h>
+#include <cstdio>
+#include "../eyelog/EyeLog.h"
+
+
+class MappedLogSuite: public CxxTest::TestSuite
+{
+    const char* fname = "mapped_log_test.bin";
+
+public:
+
+    PEntryVec makeEntries()
+    {
+        PEntryVec entries;
+        entries.push_back(new PMessageEntry(0, "Hi"));
+        entries.push_back(new PTrialEntry(1, "Trial", "Group"));
+        entries.push_back(new PTrialStartEntry(1));
+        entries.push_back(new PGazeEntry(LGAZE, 2, 10, 11, 3));
+        entries.push_back(new PGazeEntry(RGAZE, 2, 12, 13, 4));
+        entries.push_back(new PFixationEntry(LFIX, 2, 100, 10, 11));
+        entries.push_back(new PSaccadeEntry(RSAC, 102, 20, 1, 2, 3, 4));
+        entries.push_back(new PMessageEntry(103, ""));
+        entries.push_back(new PTrialEndEntry(104));
+        return entries;
+    }
+
+    void writeEntries(const PEntryVec& entries)
+    {
+        PEyeLog log;
+        log.setEntries(entries);
+        TS_ASSERT_EQUALS(log.open(fname), 0);
+        TS_ASSERT_EQUALS(log.write(FORMAT_BINARY), 0);
+        log.close();
+    }
+
+    void testViews()
+    {
+        TS_TRACE("Testing PMappedLog views");
+        PEntryVec entries = makeEntries();
+        writeEntries(entries);
+
+        PMappedLog mapped;
+        PEntryView view;
+        TS_ASSERT_EQUALS(mapped.open(fname), 0);
+        TS_ASSERT_EQUALS(mapped.count(), long(entries.size()));
+
+        unsigned n = 0;
+        while (mapped.next(view)) {
+            TS_ASSERT_EQUALS(view.getEntryType(), entries[n]->getEntryType());
+            TS_ASSERT_EQUALS(view.getTime(), entries[n]->getTime());
+            PEyeLogEntry* e = view.toEntry();
+            TS_ASSERT_EQUALS(*e, *entries[n]);
+            delete e;
+            ++n;
+        }
+        TS_ASSERT_EQUALS(mapped.status(), 0);
+        TS_ASSERT_EQUALS(n, entries.size());
+
+        mapped.rewind();
+        TS_ASSERT(mapped.next(view));
+        TS_ASSERT_EQUALS(view.getMessage(), String("Hi"));
+        TS_ASSERT(mapped.next(view));
+        TS_ASSERT_EQUALS(view.getIdentifier(), String("Trial"));
+        TS_ASSERT_EQUALS(view.getGroup(), String("Group"));
+        TS_ASSERT(mapped.next(view));
+        TS_ASSERT(mapped.next(view));
+        TS_ASSERT_EQUALS(view.getX(), 10);
+        TS_ASSERT_EQUALS(view.getY(), 11);
+        TS_ASSERT_EQUALS(view.getPupil(), 3);
+
+        mapped.close();
+        destroyPEntyVec(entries);
+        remove(fname);
+    }
+
+    void testReadMappedLog()
+    {
+        TS_TRACE("Testing readMappedLog");
+        PEntryVec entries = makeEntries();
+        writeEntries(entries);
+
+        PEyeLog log;
+        TS_ASSERT_EQUALS(readMappedLog(&log, fname), 0);
+        const PEntryVec& read = log.getEntries();
+        TS_ASSERT_EQUALS(read.size(), entries.size());
+        for (unsigned i = 0; i < read.size() && i < entries.size(); i++)
+            TS_ASSERT_EQUALS(*read[i], *entries[i]);
+
+        destroyPEntyVec(entries);
+        remove(fname);
+    }
+
+    void testTruncatedFile()
+    {
+        TS_TRACE("Testing readMappedLog on a truncated file");
+        PEntryVec entries = makeEntries();
+        writeEntries(entries);
+
+        // Chop the last record in half.
+        std::FILE* f = std::fopen(fname, "rb");
+        std::fseek(f, 0, SEEK_END);
+        long size = std::ftell(f);
+        std::fclose(f);
+        PMappedFile file;
+        TS_ASSERT_EQUALS(file.open(fname), 0);
+        TS_ASSERT_EQUALS(long(file.size()), size);
+        std::FILE* out = std::fopen("mapped_log_test.trunc", "wb");
+        std::fwrite(file.data(), 1, size - 5, out);
+        std::fclose(out);
+        file.close();
+
+        PEyeLog log;
+        log.addEntry(new PMessageEntry(0, "existing"));
+        TS_ASSERT_EQUALS(readMappedLog(&log, "mapped_log_test.trunc"),
+                         ERR_INVALID_FILE_FORMAT
+                         );
+        TS_ASSERT_EQUALS(log.getEntries().size(), 1);
+
+        destroyPEntyVec(entries);
+        remove(fname);
+        remove("mapped_log_test.trunc");
+    }
+};
@@ -0,0 +1,83 @@
+#include <cxxtest/TestSuite.h>
+#include <cstdio>
+#include "../eyelog/EyeLog.h"
+
+
+class SampleStoreSuite: public CxxTest::TestSuite
+{
+    const char* fname = "sample_store_test.bin";
+
+public:
+
+    void fillLog(PEyeLog& log)
+    {
+        log.addEntry(new PMessageEntry(0, "Hi"));
+        log.addEntry(new PGazeEntry(LGAZE, 1, 10, 11, 3));
+        log.addEntry(new PGazeEntry(RGAZE, 1, 12, 13, 4));
+        log.addEntry(new PFixationEntry(LFIX, 1, 100, 10, 11));
+        log.addEntry(new PGazeEntry(LGAZE, 2, 14, 15, 3));
+        log.addEntry(new PGazeEntry(RGAZE, 2, 16, 17, 4));
+        log.addEntry(new PGazeEntry(RGAZE, 3, 18, 19, 5));
+    }
+
+    void testFromLog()
+    {
+        TS_TRACE("Testing PSampleStore::fromLog");
+        PEyeLog log;
+        fillLog(log);
+
+        PSampleStore store(log);
+        const PGazeColumns& left = store[LGAZE];
+        const PGazeColumns& right = store[RGAZE];
+
+        TS_ASSERT_EQUALS(store.size(), 5);
+        TS_ASSERT_EQUALS(left.size(), 2);
+        TS_ASSERT_EQUALS(right.size(), 3);
+        TS_ASSERT_EQUALS(left.getTime()[1], 2);
+        TS_ASSERT_EQUALS(left.getX()[1], 14);
+        TS_ASSERT_EQUALS(left.getY()[1], 15);
+        TS_ASSERT_EQUALS(left.getPupil()[1], 3);
+        TS_ASSERT_EQUALS(right.getX()[2], 18);
+    }
+
+    void testToLog()
+    {
+        TS_TRACE("Testing PSampleStore::toLog");
+        PEyeLog log, gazelog, out;
+        fillLog(log);
+        for (const auto* e : log.getEntries()) {
+            if (e->getEntryType() == LGAZE || e->getEntryType() == RGAZE)
+                gazelog.addEntry(e->clone());
+        }
+
+        PSampleStore store(log);
+        store.toLog(out);
+
+        const PEntryVec& expected = gazelog.getEntries();
+        const PEntryVec& result = out.getEntries();
+        TS_ASSERT_EQUALS(result.size(), expected.size());
+        for (unsigned i = 0; i < result.size() && i < expected.size(); i++)
+            TS_ASSERT_EQUALS(*result[i], *expected[i]);
+    }
+
+    void testReadLog()
+    {
+        TS_TRACE("Testing readLog into a PSampleStore");
+        {
+            PEyeLog log;
+            fillLog(log);
+            TS_ASSERT_EQUALS(log.open(fname), 0);
+            TS_ASSERT_EQUALS(log.write(FORMAT_BINARY), 0);
+        }
+        PEyeLog log;
+        fillLog(log);
+        PSampleStore expected(log);
+        PSampleStore store;
+        TS_ASSERT_EQUALS(readLog(&store, fname), 0);
+        TS_ASSERT_EQUALS(store.size(), expected.size());
+        TS_ASSERT_EQUALS(store[LGAZE].getX(), expected[LGAZE].getX());
+        TS_ASSERT_EQUALS(store[RGAZE].getTime(), expected[RGAZE].getTime());
+        TS_ASSERT_EQUALS(store[RGAZE].getPupil(), expected[RGAZE].getPupil());
+        remove(fname);
+    }
+};
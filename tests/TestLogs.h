@@ -0,0 +1,38 @@
+/*
+ * TestLogs.h
+ *
+ * Comparisons of entries that are shared by the test suites, the logs
+ * they compare are built by each suite itself. This header contains no
+ * suite, tests/CMakeLists.txt doesn't generate a part for it.
+ */
+
+#ifndef TEST_LOGS_H
+#define TEST_LOGS_H
+
+#include "../eyelog/EyeLog.h"
+
+/**
+ * @return true if a and b hold equal entries in the same order.
+ */
+inline bool equalEntries(const PEntryVec& a, const PEntryVec& b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (std::size_t i = 0; i < a.size(); i++)
+        if (*a[i] != *b[i])
+            return false;
+    return true;
+}
+
+/**
+ * @return true if no entry compares less than its predecessor.
+ */
+inline bool isSorted(const PEntryVec& entries)
+{
+    for (std::size_t i = 1; i < entries.size(); i++)
+        if (entries[i]->compare(*entries[i - 1]) < 0)
+            return false;
+    return true;
+}
+
+#endif
@@ -0,0 +1,98 @@
+#include <cxxtest/TestSuite.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <locale>
+#include <sstream>
+#include <string>
+#include "../eyelog/EyeLog.h"
+
+
+class TextScannerSuite: public CxxTest::TestSuite
+{
+public:
+
+    template <class T>
+    bool classic(const std::string& s, T& value)
+    {
+        std::istringstream stream(s);
+        stream.imbue(std::locale::classic());
+        return bool(stream >> value);
+    }
+
+    bool read(PTextScanner& scanner, float& value)
+    {
+        return scanner.readFloat(value);
+    }
+
+    bool read(PTextScanner& scanner, double& value)
+    {
+        return scanner.readDouble(value);
+    }
+
+    template <class T>
+    void compare(const std::string& s)
+    {
+        T expected = 0, value = 0;
+        bool ok = classic(s, expected);
+        PTextScanner scanner(s.data(), s.data() + s.size());
+        bool result = read(scanner, value);
+        TSM_ASSERT_EQUALS(s.c_str(), result, ok);
+        if (ok && result)
+            TSM_ASSERT_EQUALS(s.c_str(), memcmp(&value, &expected, sizeof(T)), 0);
+    }
+
+    void testNumbers()
+    {
+        TS_TRACE("Testing PTextScanner against istream");
+        const char* numbers[] = {
+            "0", "-0", "+1", "5.", ".5", "512.3", "-0.001", "1e3", "1E-3",
+            "123456789012345678901234567890", "0.1000000000000000055511151231257827",
+            "3.4028235e38", "1e-320", "9007199254740993", "16777217",
+            "  \t42.5", "7.25abc", "1e", "1e+", "."
+        };
+        for (const char* n : numbers) {
+            compare<float>(n);
+            compare<double>(n);
+        }
+    }
+
+    void testRandomNumbers()
+    {
+        char buffer[64];
+        srand(1);
+        for (int i = 0; i < 20000; i++) {
+            double d = (rand() - RAND_MAX / 2) / double(rand() % 100000 + 1);
+            snprintf(buffer, sizeof(buffer), "%.*f", i % 10, d);
+            compare<float>(buffer);
+            compare<double>(buffer);
+            snprintf(buffer, sizeof(buffer), "%.*g", i % 18 + 1, d * 1e-5);
+            compare<float>(buffer);
+            compare<double>(buffer);
+        }
+    }
+
+    void testTokens()
+    {
+        std::string s = " MSG\t10.5  hello world \r\n12 -3";
+        PTextScanner scanner(s.data(), s.data() + s.size());
+        const char *b, *e;
+        double d;
+        unsigned u;
+
+        TS_ASSERT(scanner.readToken(b, e));
+        TS_ASSERT_EQUALS(std::string(b, e), "MSG");
+        TS_ASSERT(scanner.readDouble(d));
+        TS_ASSERT_EQUALS(d, 10.5);
+        scanner.skipSpace();
+        scanner.readLine(b, e);
+        TS_ASSERT_EQUALS(std::string(b, e), "hello world \r");
+        TS_ASSERT(scanner.readUnsigned(u));
+        TS_ASSERT_EQUALS(u, 12);
+        TS_ASSERT(!scanner.readUnsigned(u));
+        TS_ASSERT(scanner.readDouble(d));
+        TS_ASSERT_EQUALS(d, -3);
+        TS_ASSERT(scanner.atEnd());
+        TS_ASSERT(!scanner.readToken(b, e));
+    }
+};
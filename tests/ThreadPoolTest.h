@@ -0,0 +1,231 @@
+#include <cxxtest/TestSuite.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../eyelog/EyeLog.h"
+
+
+class ThreadPoolSuite: public CxxTest::TestSuite
+{
+    /*
+     * A session of ntrials trials of which the number of samples varies
+     * a lot, like trials that end on a response.
+     */
+    void fillLog(PEyeLog& log, unsigned ntrials)
+    {
+        double t = 0;
+        log.addEntry(new PMessageEntry(t, "meta data"));
+        for (unsigned i = 0; i < ntrials; i++) {
+            log.addEntry(new PTrialEntry(t, std::to_string(i).c_str(), "g"));
+            log.addEntry(new PTrialStartEntry(t));
+            unsigned nsamples = 10 + (i % 7) * (i % 5) * 50;
+            for (unsigned j = 0; j < nsamples; j++, t++) {
+                log.addEntry(new PGazeEntry(LGAZE, t, float(i), float(j), 3));
+                log.addEntry(new PGazeEntry(RGAZE, t, float(j), float(i), 3));
+            }
+            log.addEntry(new PFixationEntry(LFIX, t, 100, float(i), 1));
+            log.addEntry(new PTrialEndEntry(t++));
+        }
+    }
+
+public:
+
+    void testForEach()
+    {
+        TS_TRACE("Testing that a parallel loop visits every index once");
+        for (unsigned nthreads = 1; nthreads <= 4; nthreads++) {
+            PThreadPool pool(nthreads);
+            TS_ASSERT_EQUALS(pool.size(), nthreads);
+            const std::size_t sizes[] = {0, 1, 7, 1000, 100003};
+            const std::size_t grains[] = {1, 3, 64};
+            for (std::size_t n : sizes) {
+                for (std::size_t grain : grains) {
+                    std::vector<std::atomic<int> > seen(n);
+                    for (auto& s : seen)
+                        s = 0;
+                    pool.forEach(n,
+                            [&] (std::size_t begin, std::size_t end) {
+                                TS_ASSERT(begin < end && end <= n);
+                                for (std::size_t i = begin; i < end; i++)
+                                    seen[i]++;
+                            },
+                            grain
+                            );
+                    bool once = true;
+                    for (auto& s : seen)
+                        once = once && s == 1;
+                    TS_ASSERT(once);
+                }
+            }
+        }
+    }
+
+    void testUnevenWork()
+    {
+        TS_TRACE("Testing that idle threads steal work");
+        PThreadPool pool(4);
+        std::mutex mutex;
+        std::vector<std::thread::id> ids;
+        // All work is at the start of the range, in the part of one thread.
+        pool.forEach(64, [&] (std::size_t begin, std::size_t end) {
+            if (begin < 16)
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            std::lock_guard<std::mutex> lock(mutex);
+            for (std::size_t i = begin; i < end; i++)
+                ids.push_back(std::this_thread::get_id());
+        });
+        TS_ASSERT_EQUALS(ids.size(), 64u);
+        std::sort(ids.begin(), ids.end());
+        TS_ASSERT_LESS_THAN(1, std::unique(ids.begin(), ids.end()) - ids.begin());
+    }
+
+    void testReduce()
+    {
+        TS_TRACE("Testing parallel reduce");
+        PThreadPool pool(3);
+        unsigned long sum = pool.reduce(
+                100000, 0ul,
+                [] (std::size_t i) {return (unsigned long)(i);},
+                [] (unsigned long a, unsigned long b) {return a + b;},
+                100
+                );
+        TS_ASSERT_EQUALS(sum, 100000ul * 99999ul / 2);
+
+        // Concatenation isn't commutative, the chunks are still in order.
+        std::string s = pool.reduce(
+                1000, std::string(),
+                [] (std::size_t i) {return std::string(1, char('a' + i % 26));},
+                [] (const std::string& a, const std::string& b) {return a + b;},
+                7
+                );
+        std::string expected;
+        for (std::size_t i = 0; i < 1000; i++)
+            expected += char('a' + i % 26);
+        TS_ASSERT_EQUALS(s, expected);
+
+        TS_ASSERT_EQUALS(
+                pool.reduce(0, 5, [] (std::size_t) {return 1;},
+                            [] (int a, int b) {return a + b;}),
+                5
+                );
+    }
+
+    void testNested()
+    {
+        TS_TRACE("Testing loops started from a loop and from other threads");
+        PThreadPool pool(3);
+        std::atomic<unsigned> count(0);
+        pool.forEach(10, [&] (std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; i++)
+                pool.forEach(10, [&] (std::size_t b, std::size_t e) {
+                    count += unsigned(e - b);
+                });
+        });
+        TS_ASSERT_EQUALS(count, 100u);
+
+        count = 0;
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 3; i++)
+            threads.push_back(std::thread([&] () {
+                for (int j = 0; j < 20; j++)
+                    pool.forEach(100, [&] (std::size_t b, std::size_t e) {
+                        count += unsigned(e - b);
+                    }, 8);
+            }));
+        for (auto& t : threads)
+            t.join();
+        TS_ASSERT_EQUALS(count, 3u * 20 * 100);
+    }
+
+    void testTrials()
+    {
+        TS_TRACE("Testing parallel loops over entries and trials");
+        PEyeLog log;
+        fillLog(log, 200);
+        PExperiment experiment(log);
+        PThreadPool pool(4);
+
+        std::vector<double> serial, parallel(experiment.nTrials());
+        for (unsigned i = 0; i < experiment.nTrials(); i++) {
+            double sum = 0;
+            for (const auto* e : experiment[i][LGAZE])
+                sum += static_cast<const PGazeEntry*>(e)->getY();
+            serial.push_back(sum);
+        }
+        forEachTrial(pool, experiment,
+                [&] (const PTrial& trial, std::size_t i) {
+                    double sum = 0;
+                    for (const auto* e : trial[LGAZE])
+                        sum += static_cast<const PGazeEntry*>(e)->getY();
+                    parallel[i] = sum;
+                });
+        TS_ASSERT(parallel == serial);
+
+        std::size_t nsamples = reduceTrials(pool, experiment, std::size_t(0),
+                [] (const PTrial& trial) {
+                    return trial[LGAZE].size() + trial[RGAZE].size();
+                },
+                [] (std::size_t a, std::size_t b) {return a + b;}
+                );
+        std::size_t ngaze = reduceEntries(pool, log.getEntries(),
+                std::size_t(0),
+                [] (const PEyeLogEntry& e) {
+                    return std::size_t(e.getEntryType() == LGAZE ||
+                                       e.getEntryType() == RGAZE);
+                },
+                [] (std::size_t a, std::size_t b) {return a + b;},
+                100
+                );
+        TS_ASSERT_EQUALS(nsamples, ngaze);
+
+        std::atomic<std::size_t> nentries(0);
+        forEachEntry(pool, log.getEntries(),
+                [&] (const PEyeLogEntry&, std::size_t) {nentries++;});
+        TS_ASSERT_EQUALS(nentries, log.getEntries().size());
+    }
+
+    void testConstAccess()
+    {
+        TS_TRACE("Testing const access to an experiment from many threads");
+        PEyeLog log;
+        fillLog(log, 50);
+        PExperiment experiment(log);
+
+        std::vector<std::string> expected;
+        for (unsigned i = 0; i < experiment.nTrials(); i++) {
+            std::string s;
+            PEntryVec entries = experiment[i].getEntries();
+            for (auto* e : entries) {
+                s += e->toString().c_str();
+                delete e;
+            }
+            expected.push_back(s);
+        }
+
+        std::atomic<int> mismatches(0);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; t++)
+            threads.push_back(std::thread([&] () {
+                const PExperiment& e = experiment;
+                for (unsigned i = 0; i < e.nTrials(); i++) {
+                    if (e[i][AVGGAZE].size() != 0 || e[i][MESSAGE].size() != 0)
+                        mismatches++;
+                    std::string s;
+                    PEntryVec entries = e[i].getEntries();
+                    for (auto* entry : entries) {
+                        s += entry->toString().c_str();
+                        delete entry;
+                    }
+                    if (s != expected[i])
+                        mismatches++;
+                }
+            }));
+        for (auto& t : threads)
+            t.join();
+        TS_ASSERT_EQUALS(mismatches, 0);
+    }
+};
@@ -0,0 +1,168 @@
+#include <cxxtest/TestSuite.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "../eyelog/EyeLog.h"
+
+
+class TimeIndexSuite: public CxxTest::TestSuite
+{
+    const char* fname = "time_index_test.bin";
+
+public:
+
+    void fillLog(PEyeLog& log, unsigned nsamples)
+    {
+        log.addEntry(new PMessageEntry(0, "start"));
+        for (unsigned i = 0; i < nsamples; i++) {
+            // irregular like a real tracker that drops a sample now and then.
+            double t = i * 2 + (i % 7 == 0 ? 1 : 0);
+            log.addGaze(LGAZE, t, i, 1, 2);
+            log.addGaze(RGAZE, t, i, 3, 4);
+            if (i % 100 == 99) {
+                // reported when it has ended, so not in order of time.
+                log.addEntry(new PFixationEntry(LFIX, t - 150, 150, 1, 2));
+                log.addEntry(new PMessageEntry(t, "event"));
+            }
+        }
+    }
+
+    std::vector<std::size_t> scan(const PEyeLog& log,
+                                  int type,
+                                  double t0,
+                                  double t1
+                                  )
+    {
+        std::vector<std::size_t> out;
+        const PEntryVec& e = log.getEntries();
+        for (std::size_t i = 0; i < e.size(); i++) {
+            double t = e[i]->getTime();
+            if ((type < 0 || e[i]->getEntryType() == type) && t >= t0 && t < t1)
+                out.push_back(i);
+        }
+        return out;
+    }
+
+    void testFind()
+    {
+        TS_TRACE("Testing range queries against a scan of the log");
+        PEyeLog log;
+        fillLog(log, 10000);
+        PTimeIndex index(log.getEntries());
+        TS_ASSERT_EQUALS(index.size(LGAZE), 10000);
+        TS_ASSERT_EQUALS(index.size(LFIX), 100);
+        TS_ASSERT_EQUALS(index.size(TRIAL), 0);
+
+        srand(7);
+        for (int i = 0; i < 2000; i++) {
+            double t0 = rand() % 21000 - 500 + (i % 2 ? 0.5 : 0);
+            double t1 = t0 + rand() % 3000;
+            const entrytype types[] = {LGAZE, LFIX, MESSAGE, TRIAL};
+            for (entrytype type : types) {
+                PTimeIndex::Positions p = index.find(type, t0, t1);
+                std::vector<std::size_t> found(p.begin(), p.end());
+                std::sort(found.begin(), found.end());
+                if (found != scan(log, type, t0, t1)) {
+                    TS_FAIL("find differs from a scan");
+                    return;
+                }
+            }
+            if (index.findAll(t0, t1) != scan(log, -1, t0, t1)) {
+                TS_FAIL("findAll differs from a scan");
+                return;
+            }
+        }
+    }
+
+    void testOrder()
+    {
+        TS_TRACE("Testing that positions are ordered by time");
+        PEyeLog log;
+        log.addEntry(new PFixationEntry(LFIX, 30, 10, 1, 2));
+        log.addEntry(new PFixationEntry(LFIX, 10, 10, 1, 2));
+        log.addEntry(new PFixationEntry(LFIX, 20, 10, 1, 2));
+        log.addEntry(new PFixationEntry(LFIX, 20, 20, 1, 2));
+        PTimeIndex index(log.getEntries());
+
+        PTimeIndex::Positions p = index.find(LFIX, 10, 30);
+        TS_ASSERT_EQUALS(p.size(), 3);
+        if (p.size() == 3) {
+            TS_ASSERT_EQUALS(p[0], 1);
+            TS_ASSERT_EQUALS(p[1], 2);
+            TS_ASSERT_EQUALS(p[2], 3);
+        }
+        TS_ASSERT(index.find(LFIX, 30, 30).empty());
+        TS_ASSERT(index.find(LFIX, 31, 100).empty());
+        TS_ASSERT(index.find(LFIX, -5, 10).empty());
+
+        PEntryVec selected;
+        index.select(log.getEntries(), LFIX, 0, 21, &selected);
+        TS_ASSERT_EQUALS(selected.size(), 3);
+        TS_ASSERT_EQUALS(selected[0], log.getEntries()[1]);
+    }
+
+    void testBlockIndex()
+    {
+        TS_TRACE("Testing range reads with the block index of a file");
+        const unsigned modes[] = {WRITE_STREAM, WRITE_BUFFERED, WRITE_DIRECT};
+        PBlockIndex first;
+        for (unsigned mode : modes) {
+            PEyeLog log;
+            fillLog(log, 10000);
+            TS_ASSERT_EQUALS(log.open(fname), 0);
+            TS_ASSERT_EQUALS(log.write(FORMAT_BINARY, mode), 0);
+            log.close();
+
+            PMappedLog mapped;
+            TS_ASSERT_EQUALS(mapped.open(fname), 0);
+            const PBlockIndex& blocks = mapped.getBlockIndex();
+            std::size_t n = log.getEntries().size();
+            TS_ASSERT_EQUALS(blocks.size(),
+                    (n + PBlockIndex::BLOCK_ENTRIES - 1) / PBlockIndex::BLOCK_ENTRIES
+                    );
+            if (mode == WRITE_STREAM)
+                first = blocks;
+            else
+                TS_ASSERT(blocks == first);
+
+            const double ranges[][2] = {
+                {0, 1}, {5000, 5100}, {100, 19000}, {-10, 0}, {19990, 1e9}
+            };
+            for (const auto& r : ranges) {
+                PEyeLog part;
+                TS_ASSERT_EQUALS(readMappedRange(&part, fname, r[0], r[1]), 0);
+                std::vector<std::size_t> expected = scan(log, -1, r[0], r[1]);
+                TS_ASSERT_EQUALS(part.getEntries().size(), expected.size());
+                for (std::size_t i = 0; i < expected.size() &&
+                        i < part.getEntries().size(); i++)
+                    TS_ASSERT_EQUALS(*part.getEntries()[i],
+                                     *log.getEntries()[expected[i]]
+                                     );
+            }
+        }
+        remove(fname);
+    }
+
+    void testWithoutBlockIndex()
+    {
+        TS_TRACE("Testing range reads of a file without block index");
+        PEyeLog log;
+        fillLog(log, 1000);
+        TS_ASSERT_EQUALS(log.open(fname), 0);
+        TS_ASSERT_EQUALS(log.write(FORMAT_BINARY), 0);
+        TS_ASSERT_EQUALS(log.write(FORMAT_BINARY), 0);
+        log.close();
+
+        PMappedLog mapped;
+        TS_ASSERT_EQUALS(mapped.open(fname), 0);
+        TS_ASSERT_EQUALS(mapped.getBlockIndex().size(), 0);
+
+        PEyeLog part;
+        TS_ASSERT_EQUALS(readMappedRange(&part, fname, 500, 600), 0);
+        TS_ASSERT_EQUALS(part.getEntries().size(),
+                         2 * scan(log, -1, 500, 600).size()
+                         );
+        remove(fname);
+    }
+};
@@ -0,0 +1,114 @@
+#include <cxxtest/TestSuite.h>
+#include <string>
+#include <vector>
+#include "../eyelog/EyeLog.h"
+
+
+class TrialAnalysisSuite: public CxxTest::TestSuite
+{
+    /*
+     * Checks that bounds split n items in at most nchunks chunks.
+     */
+    bool validBounds(const std::vector<std::size_t>& bounds,
+                     std::size_t n,
+                     unsigned nchunks
+                     )
+    {
+        if (bounds.empty() || bounds.front() != 0 || bounds.back() != n)
+            return false;
+        if (n > 0 && bounds.size() - 1 > nchunks)
+            return false;
+        for (std::size_t i = 1; i < bounds.size(); i++)
+            if (bounds[i - 1] >= bounds[i])
+                return false;
+        return true;
+    }
+
+public:
+
+    void testChunkByCost()
+    {
+        TS_TRACE("Testing splitting trials in chunks of the same cost");
+        std::vector<std::size_t> costs;
+        std::vector<std::size_t> bounds = chunkByCost(costs, 4);
+        TS_ASSERT_EQUALS(bounds, std::vector<std::size_t>(1, 0));
+
+        costs.assign(8, 10);
+        bounds = chunkByCost(costs, 4);
+        TS_ASSERT_EQUALS(bounds, (std::vector<std::size_t>{0, 2, 4, 6, 8}));
+        bounds = chunkByCost(costs, 1);
+        TS_ASSERT_EQUALS(bounds, (std::vector<std::size_t>{0, 8}));
+        bounds = chunkByCost(costs, 0);
+        TS_ASSERT_EQUALS(bounds, (std::vector<std::size_t>{0, 8}));
+        bounds = chunkByCost(costs, 100);
+        TS_ASSERT(validBounds(bounds, 8, 100));
+        TS_ASSERT_EQUALS(bounds.size(), 9u);
+
+        // The expensive trial gets a chunk of its own.
+        costs = {1, 1, 100, 1, 1};
+        bounds = chunkByCost(costs, 4);
+        TS_ASSERT_EQUALS(bounds, (std::vector<std::size_t>{0, 2, 3, 5}));
+
+        // Trials without a cost are spread as well.
+        costs.assign(6, 0);
+        bounds = chunkByCost(costs, 3);
+        TS_ASSERT_EQUALS(bounds, (std::vector<std::size_t>{0, 2, 4, 6}));
+
+        for (unsigned nchunks = 1; nchunks < 20; nchunks++) {
+            costs.clear();
+            for (std::size_t i = 0; i < 97; i++)
+                costs.push_back((i * 7919) % 1000);
+            TS_ASSERT(validBounds(chunkByCost(costs, nchunks), 97, nchunks));
+        }
+    }
+
+    void testAnalyzeTrials()
+    {
+        TS_TRACE("Testing analyzing trials in parallel");
+        PEyeLog log;
+        double t = 0;
+        for (unsigned i = 0; i < 100; i++) {
+            log.addEntry(new PTrialEntry(t, std::to_string(i).c_str(), "g"));
+            // A few trials are much longer than the others.
+            unsigned nsamples = i % 10 == 3 ? 5000 : 20 + i;
+            for (unsigned j = 0; j < nsamples; j++, t++)
+                log.addEntry(new PGazeEntry(LGAZE, t, float(i), float(j), 3));
+        }
+        PExperiment experiment(log);
+        TS_ASSERT_EQUALS(experiment.nTrials(), 100u);
+        TS_ASSERT_EQUALS(experiment[3].size(), 5000u);
+        TS_ASSERT_EQUALS(experiment[4].size(), 24u);
+
+        auto kernel = [] (const PTrial& trial) {
+            double sum = 0;
+            for (const auto* e : trial[LGAZE])
+                sum += static_cast<const PGazeEntry*>(e)->getY();
+            return sum;
+        };
+        std::vector<double> serial;
+        for (unsigned i = 0; i < experiment.nTrials(); i++)
+            serial.push_back(kernel(experiment[i]));
+
+        const unsigned sizes[] = {1, 2, 4};
+        for (unsigned nthreads : sizes) {
+            PThreadPool pool(nthreads);
+            TS_ASSERT(analyzeTrials(pool, experiment, kernel) == serial);
+        }
+
+        PThreadPool pool(3);
+        std::vector<std::string> ids = analyzeTrials(pool, experiment,
+                [] (const PTrial& trial) {
+                    return std::string(trial.getIdentifier().c_str());
+                },
+                [] (const PTrial&) {return std::size_t(1);}
+                );
+        TS_ASSERT_EQUALS(ids.size(), 100u);
+        bool inorder = true;
+        for (unsigned i = 0; i < ids.size(); i++)
+            inorder = inorder && ids[i] == std::to_string(i);
+        TS_ASSERT(inorder);
+
+        PExperiment empty;
+        TS_ASSERT(analyzeTrials(pool, empty, kernel).empty());
+    }
+};
@@ -0,0 +1,151 @@
+#include <cxxtest/TestSuite.h>
+#include <cstdio>
+#include <string>
+#include "../eyelog/EyeLog.h"
+
+
+class TrialIndexSuite: public CxxTest::TestSuite
+{
+    const char* fname = "trial_index_test.bin";
+
+public:
+
+    void fillLog(PEyeLog& log)
+    {
+        const char* groups[] = {"a", "b", "a"};
+        log.addEntry(new PMessageEntry(0, "Hi"));
+        for (unsigned t = 0; t < 3; t++) {
+            double time = t * 1000;
+            log.addEntry(new PTrialEntry(time, String(std::to_string(t).c_str()),
+                                         groups[t]
+                                         ));
+            log.addEntry(new PTrialStartEntry(time));
+            for (unsigned i = 0; i < 100; i++)
+                log.addGaze(LGAZE, time + i, i, 11, 3);
+            log.addEntry(new PTrialEndEntry(time + 100));
+            log.addEntry(new PMessageEntry(time + 101, "between"));
+        }
+    }
+
+    void testLookup()
+    {
+        TS_TRACE("Testing finding trials and their entries");
+        PEyeLog log;
+        fillLog(log);
+        const PTrialIndex& index = log.getTrialIndex();
+        TS_ASSERT_EQUALS(index.size(), 3);
+
+        const PTrialIndex::Trial* t = index.find("1");
+        TS_ASSERT(t);
+        TS_ASSERT(!index.find("3"));
+        TS_ASSERT_EQUALS(t->time, 1000);
+        TS_ASSERT_EQUALS(t->group, String("b"));
+
+        PEntryRange range = log.getTrialEntries(*t);
+        TS_ASSERT_EQUALS(range.size(), 103);
+        TS_ASSERT_EQUALS(range[0]->getEntryType(), TRIAL);
+        TS_ASSERT_EQUALS(range[1]->getEntryType(), TRIALSTART);
+        TS_ASSERT_EQUALS(range[102]->getEntryType(), TRIALEND);
+        TS_ASSERT_EQUALS(range[0], log.getEntries()[t->begin]);
+        TS_ASSERT_EQUALS(t->start, t->begin + 1);
+
+        std::vector<std::size_t> a = index.findGroup("a");
+        TS_ASSERT_EQUALS(a.size(), 2);
+        TS_ASSERT_EQUALS(a[0], 0);
+        TS_ASSERT_EQUALS(a[1], 2);
+        TS_ASSERT(index.findGroup("c").empty());
+
+        log.clear();
+        TS_ASSERT_EQUALS(log.getTrialIndex().size(), 0);
+    }
+
+    void testAscMessages()
+    {
+        TS_TRACE("Testing trials marked by messages in asc files");
+        std::string asc =
+            "MSG\t10\ttrialbeg 004 1 004 CNDB\n"
+            "20\t1.5\t2.5\t3.5\t4.5\t5.5\t6.5\t.....\n"
+            "MSG\t30\ttrialend 004 1 004 CNDB\n"
+            "MSG\t40\ttrialbegin is not a trial\n"
+            "MSG\t50\ttrialbeg 003 2 003 FILL\n"
+            "60\t1.5\t2.5\t3.5\t4.5\t5.5\t6.5\t.....\n";
+        PEyeLog log;
+        TS_ASSERT_EQUALS(
+                readAscBuffer(&log, asc.data(), asc.data() + asc.size()), 0
+                );
+        const PTrialIndex& index = log.getTrialIndex();
+        TS_ASSERT_EQUALS(index.size(), 2);
+        if (index.size() != 2)
+            return;
+        TS_ASSERT_EQUALS(index[0].identifier, String("004"));
+        TS_ASSERT_EQUALS(index[0].group, String("CNDB"));
+        TS_ASSERT_EQUALS(log.getTrialEntries(index[0]).size(), 4);
+        TS_ASSERT_EQUALS(index[1].identifier, String("003"));
+        TS_ASSERT_EQUALS(index[1].group, String("FILL"));
+        TS_ASSERT_EQUALS(index[1].end, PTrialIndex::npos);
+        TS_ASSERT_EQUALS(log.getTrialEntries(index[1]).size(), 3);
+    }
+
+    void testBinaryIndex()
+    {
+        TS_TRACE("Testing the index at the end of binary files");
+        const unsigned modes[] = {WRITE_STREAM, WRITE_BUFFERED, WRITE_DIRECT};
+        for (unsigned mode : modes) {
+            PEyeLog log;
+            fillLog(log);
+            TS_ASSERT_EQUALS(log.open(fname), 0);
+            TS_ASSERT_EQUALS(log.write(FORMAT_BINARY, mode), 0);
+            log.close();
+
+            PTrialIndex index;
+            TS_ASSERT_EQUALS(readTrialIndex(&index, fname), 0);
+            TS_ASSERT(index == log.getTrialIndex());
+
+            // The readers skip the index.
+            PEyeLog read;
+            TS_ASSERT_EQUALS(readLog(&read, fname), 0);
+            TS_ASSERT_EQUALS(read.getEntries().size(), log.getEntries().size());
+            TS_ASSERT(read.getTrialIndex() == log.getTrialIndex());
+
+            PLogReader reader;
+            PEyeLog streamed;
+            TS_ASSERT_EQUALS(reader.open(fname), 0);
+            reader.readBatch(&streamed, std::size_t(-1));
+            TS_ASSERT_EQUALS(reader.status(), 0);
+            TS_ASSERT_EQUALS(streamed.getEntries().size(),
+                             log.getEntries().size()
+                             );
+        }
+
+        PEyeLog open;
+        open.addEntry(new PTrialEntry(0, "open", "group"));
+        open.addGaze(LGAZE, 1, 2, 3, 4);
+        TS_ASSERT_EQUALS(open.open(fname), 0);
+        TS_ASSERT_EQUALS(open.write(FORMAT_BINARY), 0);
+        open.close();
+        PTrialIndex index;
+        TS_ASSERT_EQUALS(readTrialIndex(&index, fname), 0);
+        TS_ASSERT(index == open.getTrialIndex());
+        remove(fname);
+    }
+
+    void testAppendedFile()
+    {
+        TS_TRACE("Testing the index of a file that was appended to");
+        PEyeLog log;
+        fillLog(log);
+        TS_ASSERT_EQUALS(log.open(fname), 0);
+        TS_ASSERT_EQUALS(log.write(FORMAT_BINARY), 0);
+        TS_ASSERT_EQUALS(log.write(FORMAT_BINARY), 0);
+        log.close();
+
+        PEyeLog twice;
+        fillLog(twice);
+        fillLog(twice);
+        PTrialIndex index;
+        TS_ASSERT_EQUALS(readTrialIndex(&index, fname), 0);
+        TS_ASSERT_EQUALS(index.size(), 6);
+        TS_ASSERT(index == twice.getTrialIndex());
+        remove(fname);
+    }
+};